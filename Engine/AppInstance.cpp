@@ -16,6 +16,7 @@
 
 #include <fstream>
 #include <list>
+#include <map>
 #include <stdexcept>
 
 #include <QDir>
@@ -25,9 +26,13 @@
 #include <QFileInfo>
 #include <QEventLoop>
 #include <QSettings>
+#include <QTimer>
+#include <QThread>
+#include <QCoreApplication>
 
 #if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
 #include <boost/bind.hpp>
+#include <boost/weak_ptr.hpp>
 #endif
 
 #include "Global/QtCompat.h"
@@ -76,6 +81,13 @@ FlagSetter::~FlagSetter()
 
 
 
+struct PendingEvaluation
+{
+    boost::weak_ptr<Natron::Node> node;
+    bool incrementAge;
+    bool significant;
+};
+
 struct AppInstancePrivate
 {
     boost::shared_ptr<Natron::Project> _currentProject; //< ptr to the project
@@ -86,6 +98,10 @@ struct AppInstancePrivate
     bool _creatingGroup;
     bool _creatingNode;
     
+    ///Only accessed on the main-thread, see requestNodeEvaluation
+    std::list<PendingEvaluation> pendingEvaluations;
+    U64 nEvaluationsRequested,nEvaluationsDone,nEvaluationsProcessed;
+    
     AppInstancePrivate(int appID,
                        AppInstance* app)
     : _currentProject( new Natron::Project(app) )
@@ -94,6 +110,10 @@ struct AppInstancePrivate
     , creatingGroupMutex()
     , _creatingGroup(false)
     , _creatingNode(false)
+    , pendingEvaluations()
+    , nEvaluationsRequested(0)
+    , nEvaluationsDone(0)
+    , nEvaluationsProcessed(0)
     {
     }
     
@@ -985,7 +1005,7 @@ AppInstance::triggerAutoSave()
 }
 
 
-void
+bool
 AppInstance::startWritersRendering(const std::list<RenderRequest>& writers)
 {
     std::list<RenderWork> renderers;
@@ -1036,21 +1056,34 @@ AppInstance::startWritersRendering(const std::list<RenderRequest>& writers)
         }
     }
     
-    startWritersRendering(renderers);
+    return startWritersRendering(renderers);
 }
 
-void
+bool
 AppInstance::startWritersRendering(const std::list<RenderWork>& writers)
 {
     
     if (writers.empty()) {
-        return;
+        return true;
+    }
+    
+    ///Make sure the hash of the nodes reflects the latest changes made to their knobs
+    if ( QThread::currentThread() == qApp->thread() ) {
+        processPendingEvaluations();
     }
     
     if ( appPTR->isBackground() ) {
         
         //blocking call, we don't want this function to return pre-maturely, in which case it would kill the app
-        QtConcurrent::blockingMap( writers,boost::bind(&AppInstance::startRenderingFullSequence,this,_1,false,QString()) );
+        QAtomicInt nFailedRenders(0);
+        QtConcurrent::blockingMap( writers,boost::bind(&AppInstance::renderFullSequenceBlocking,this,_1,&nFailedRenders) );
+        
+        appPTR->printOfxMultiThreadStats();
+        appPTR->printRenderPriorityStats();
+        printEvaluationsStats();
+        appPTR->printNumaPlacementStats();
+
+        return (int)nFailedRenders == 0;
     } else {
         
         //Take a snapshot of the graph at this time, this will be the version loaded by the process
@@ -1061,11 +1094,19 @@ AppInstance::startWritersRendering(const std::list<RenderWork>& writers)
             ///Use the frame range defined by the writer GUI because we're in an interactive session
             startRenderingFullSequence(*it,renderInSeparateProcess,savePath);
         }
+
+        return true;
     }
 }
 
 void
 AppInstance::startRenderingFullSequence(const RenderWork& writerWork,bool /*renderInSeparateProcess*/,const QString& /*savePath*/)
+{
+    renderFullSequenceBlocking(writerWork, 0);
+}
+
+void
+AppInstance::renderFullSequenceBlocking(const RenderWork& writerWork,QAtomicInt* nFailedRenders)
 {
     BlockingBackgroundRender backgroundRender(writerWork.writer);
     int first,last;
@@ -1079,7 +1120,10 @@ AppInstance::startRenderingFullSequence(const RenderWork& writerWork,bool /*rend
         last = writerWork.lastFrame;
     }
     
-    backgroundRender.blockingRender(first,last); //< doesn't return before rendering is finished
+    //doesn't return before rendering is finished
+    if ( !backgroundRender.blockingRender(first,last) && nFailedRenders ) {
+        nFailedRenders->ref();
+    }
 }
 
 void
@@ -1264,3 +1308,111 @@ AppInstance::onGroupCreationFinished(const boost::shared_ptr<Natron::Node>& /*no
 //        isGrp->forceGetClipPreferencesOnAllTrees();
 //    }
 }
+
+void
+AppInstance::requestNodeEvaluation(const boost::shared_ptr<Natron::Node>& node,
+                                   bool incrementAge,
+                                   bool significant)
+{
+    ///Only called by the main-thread
+    assert( QThread::currentThread() == qApp->thread() );
+    
+    ++_imp->nEvaluationsRequested;
+    
+    bool found = false;
+    for (std::list<PendingEvaluation>::iterator it = _imp->pendingEvaluations.begin(); it != _imp->pendingEvaluations.end(); ++it) {
+        if (it->node.lock() == node) {
+            it->incrementAge |= incrementAge;
+            it->significant |= significant;
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        PendingEvaluation e;
+        e.node = node;
+        e.incrementAge = incrementAge;
+        e.significant = significant;
+        if ( _imp->pendingEvaluations.empty() && !appPTR->isBackground() ) {
+            QTimer::singleShot( 0, this, SLOT( processPendingEvaluations() ) );
+        }
+        _imp->pendingEvaluations.push_back(e);
+    }
+    
+    ///In background mode there's no event loop running while scripts are executed: evaluate right away
+    if ( appPTR->isBackground() ) {
+        processPendingEvaluations();
+    }
+}
+
+void
+AppInstance::processPendingEvaluations()
+{
+    ///Only called by the main-thread
+    assert( QThread::currentThread() == qApp->thread() );
+    
+    if ( _imp->pendingEvaluations.empty() ) {
+        return;
+    }
+    
+    std::list<PendingEvaluation> evaluations;
+    evaluations.swap(_imp->pendingEvaluations);
+    ++_imp->nEvaluationsProcessed;
+    
+    std::list<NodePtr> nodes;
+    std::list<Natron::Node*> agedNodes;
+    std::map<ViewerInstance*,bool> viewers;
+    for (std::list<PendingEvaluation>::iterator it = evaluations.begin(); it != evaluations.end(); ++it) {
+        NodePtr node = it->node.lock();
+        if ( !node || !node->isActivated() ) {
+            continue;
+        }
+        ++_imp->nEvaluationsDone;
+        nodes.push_back(node);
+        if (it->incrementAge) {
+            agedNodes.push_back( node.get() );
+        }
+        std::list<ViewerInstance*> nodeViewers;
+        node->hasViewersConnected(&nodeViewers);
+        for (std::list<ViewerInstance*>::iterator it2 = nodeViewers.begin(); it2 != nodeViewers.end(); ++it2) {
+            viewers[*it2] |= it->significant;
+        }
+    }
+    
+    ///Recompute the hashes once, upstream nodes first
+    Natron::Node::incrementKnobsAgeOfNodes(agedNodes);
+    
+    for (std::map<ViewerInstance*,bool>::iterator it = viewers.begin(); it != viewers.end(); ++it) {
+        if (it->second) {
+            it->first->renderCurrentFrame(true);
+        } else {
+            it->first->redrawViewer();
+        }
+    }
+    
+    for (std::list<NodePtr>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        (*it)->refreshPreviewsRecursivelyDownstream( (*it)->getLiveInstance()->getCurrentTime() );
+    }
+}
+
+void
+AppInstance::getEvaluationsStats(U64* requested,
+                                 U64* evaluated,
+                                 U64* processed) const
+{
+    *requested = _imp->nEvaluationsRequested;
+    *evaluated = _imp->nEvaluationsDone;
+    *processed = _imp->nEvaluationsProcessed;
+}
+
+void
+AppInstance::printEvaluationsStats() const
+{
+    U64 requested,evaluated,processed;
+    getEvaluationsStats(&requested, &evaluated, &processed);
+    if (requested == 0) {
+        return;
+    }
+    std::cout << "Knob changes: " << requested << " evaluations requested, " << evaluated << " done after merging them, in "
+              << processed << " batches" << std::endl;
+}
@@ -24,6 +24,7 @@
 #include <boost/scoped_ptr.hpp>
 #endif
 #include <QStringList>
+#include <QAtomicInt>
 
 #include "Global/GlobalDefines.h"
 
@@ -35,6 +36,7 @@ class xml_oarchive;
 }
 
 class NodeSerialization;
+class ProjectGuiSerialization;
 class TimeLine;
 struct AppInstancePrivate;
 class KnobSerialization;
@@ -262,7 +264,17 @@ public:
     {
     }
 
-    virtual void saveProjectGui(boost::archive::xml_oarchive & /*archive*/)
+    /**
+     * @brief Returns a copy of the Gui state of the project. This must be called on the main-thread.
+     * The returned object can then be written with saveProjectGui() by any thread.
+     **/
+    virtual boost::shared_ptr<ProjectGuiSerialization> takeProjectGuiSnapshot() const
+    {
+        return boost::shared_ptr<ProjectGuiSerialization>();
+    }
+
+    virtual void saveProjectGui(boost::archive::xml_oarchive & /*archive*/,
+                                const boost::shared_ptr<ProjectGuiSerialization> & /*snapshot*/)
     {
     }
 
@@ -323,8 +335,12 @@ public:
     
   
     
-    void startWritersRendering(const std::list<RenderRequest>& writers);
-    void startWritersRendering(const std::list<RenderWork>& writers);
+    /**
+     * @brief Renders the given writers. In background mode this returns once the renders are done, returning false
+     * if any of them was aborted or failed. Otherwise the renders are not waited for and this returns true.
+     **/
+    bool startWritersRendering(const std::list<RenderRequest>& writers);
+    bool startWritersRendering(const std::list<RenderWork>& writers);
 
     virtual void startRenderingFullSequence(const RenderWork& writerWork,bool renderInSeparateProcess,const QString& savePath);
 
@@ -377,8 +393,35 @@ public:
     void setCreatingNode(bool b);
     bool isCreatingNode() const;
     
+    /**
+     * @brief Requests the node to be evaluated following a change of its knobs: its knobs age is incremented,
+     * the viewers downstream are refreshed and the previews updated.
+     * The evaluations requested until the event loop is reached again are merged: the hash of each node affected
+     * is computed once and each viewer renders once.
+     * @param incrementAge If true, the node's knobs age is incremented and the viewers render again, otherwise they are only redrawn
+     * @param significant If true, the viewers downstream render again, otherwise they are only redrawn
+     **/
+    void requestNodeEvaluation(const boost::shared_ptr<Natron::Node>& node,bool incrementAge,bool significant);
+    
+    /**
+     * @brief Returns the number of evaluations requested with requestNodeEvaluation, the number of evaluations
+     * actually done after merging them and the number of times the pending evaluations were processed.
+     **/
+    void getEvaluationsStats(U64* requested,U64* evaluated,U64* processed) const;
+    
+    /**
+     * @brief Prints the statistics returned by getEvaluationsStats
+     **/
+    void printEvaluationsStats() const;
+    
 public Q_SLOTS:
     
+    /**
+     * @brief Evaluates all the nodes for which an evaluation was requested. This must be called before
+     * anything relying on the hash of the nodes, e.g: starting a render.
+     **/
+    void processPendingEvaluations();
+    
     void quit();
 
     virtual void redrawAllViewers() {}
@@ -416,6 +459,9 @@ private:
     
     void getWritersWorkForCL(const CLArgs& cl,std::list<AppInstance::RenderRequest>& requests);
 
+    ///Renders the writer and waits for the render, increments nFailedRenders (if not NULL) if it was aborted or failed
+    void renderFullSequenceBlocking(const RenderWork& writerWork,QAtomicInt* nFailedRenders);
+
 
     boost::shared_ptr<Natron::Node> createNodeInternal(const QString & pluginID,const std::string & multiInstanceParentName,
                                                        int majorVersion,int minorVersion,
@@ -22,6 +22,7 @@
 #include "Engine/NodeGroup.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Settings.h"
+#include "Engine/TrackScheduler.h"
 
 App::App(AppInstance* instance)
 : Group()
@@ -222,6 +223,26 @@ App::render(const std::list<Effect*>& effects,const std::list<int>& firstFrames,
     _instance->startWritersRendering(l);
 }
 
+void
+App::track(Effect* tracker,int firstFrame,int lastFrame)
+{
+    NodePtr node = tracker ? tracker->getInternalNode() : NodePtr();
+    if (!node) {
+        std::cerr << QObject::tr("Invalid tracker node").toStdString() << std::endl;
+        return;
+    }
+    bool forward = firstFrame < lastFrame;
+    std::list<Button_Knob*> buttons;
+    TrackScheduler::getTrackButtons(node, forward, &buttons);
+    if (buttons.empty()) {
+        std::cerr << QObject::tr("%1 has no track to track").arg(node->getScriptName().c_str()).toStdString() << std::endl;
+        return;
+    }
+    
+    TrackScheduler scheduler(_instance, 0);
+    scheduler.trackBlocking(firstFrame, lastFrame, forward, buttons);
+}
+
 Param*
 App::getProjectParam(const std::string& name) const
 {
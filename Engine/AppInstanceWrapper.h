@@ -83,6 +83,12 @@ public:
     void render(Effect* writeNode,int firstFrame, int lastFrame);
     void render(const std::list<Effect*>& effects,const std::list<int>& firstFrames,const std::list<int>& lastFrames);
     
+    /**
+     * @brief Tracks all enabled tracks of the given tracker from their position at firstFrame up to lastFrame,
+     * backward if lastFrame < firstFrame. This function returns once tracking is finished.
+     **/
+    void track(Effect* tracker,int firstFrame, int lastFrame);
+    
     Param* getProjectParam(const std::string& name) const;
 };
 
@@ -20,6 +20,8 @@
 #endif
 
 #include <clocale>
+#include <iostream>
+#include <map>
 #include <cstddef>
 #include <QDebug>
 #include <QTextCodec>
@@ -50,6 +52,10 @@
 
 #include "Engine/AppInstance.h"
 #include "Engine/OfxHost.h"
+#include "Engine/RenderPriority.h"
+#include "Engine/NumaPlacement.h"
+#include "Engine/RenderProfiler.h"
+#include "Engine/RenderServer.h"
 #include "Engine/Settings.h"
 #include "Engine/LibraryBinary.h"
 #include "Engine/ProcessHandler.h"
@@ -70,13 +76,14 @@
 #include "Engine/NoOp.h"
 #include "Engine/Project.h"
 #include "Engine/BackDrop.h"
+#include "Engine/Timer.h"
 
 
 
 BOOST_CLASS_EXPORT(Natron::FrameParams)
 BOOST_CLASS_EXPORT(Natron::ImageParams)
 
-#define NATRON_CACHE_VERSION 2
+#define NATRON_CACHE_VERSION 4
 
 
 using namespace Natron;
@@ -104,6 +111,7 @@ struct AppManagerPrivate
     QString diskCachesLocation;
     
     ProcessInputChannel* _backgroundIPC; //< object used to communicate with the main app
+    RenderServer* renderServer; //< the server rendering the jobs of its clients in --server mode
     //if this app is background, see the ProcessInputChannel def
     bool _loaded; //< true when the first instance is completly loaded.
     QString _binaryPath; //< the path to the application's binary
@@ -139,6 +147,12 @@ struct AppManagerPrivate
     // Another method could be to analyse all cores running, but this is way more expensive and would impair performances.
     QAtomicInt runningThreadsCount;
     
+    boost::scoped_ptr<Natron::RenderPriorityArbiter> renderPriorityArbiter; //< shared by all the renders of the application
+    boost::scoped_ptr<Natron::NumaPlacement> numaPlacement;
+    
+    ///The phases of the startup and the seconds spent in each of them, see addStartupTiming
+    std::list<std::pair<std::string,double> > startupTimings;
+    
      //To by-pass a bug introduced in RC2 / RC3 with the serialization of bezier curves
     bool lastProjectLoadedCreatedDuringRC2Or3;
     
@@ -223,6 +237,7 @@ AppManagerPrivate::AppManagerPrivate()
 , diskCachesLocationMutex()
 , diskCachesLocation()
 ,_backgroundIPC(0)
+,renderServer(0)
 ,_loaded(false)
 ,_binaryPath()
 ,_wasAbortAnyProcessingCalled(false)
@@ -238,6 +253,9 @@ AppManagerPrivate::AppManagerPrivate()
 ,useThreadPool(true)
 ,nThreadsMutex()
 ,runningThreadsCount()
+,renderPriorityArbiter(new Natron::RenderPriorityArbiter)
+,numaPlacement(new Natron::NumaPlacement)
+,startupTimings()
 ,lastProjectLoadedCreatedDuringRC2Or3(false)
 ,args()
 ,mainModule(0)
@@ -345,6 +363,10 @@ struct CLArgsPrivate
     
     bool isEmpty;
     
+    QString profileFilename;
+    
+    QString serverName;
+    
     CLArgsPrivate()
     : args()
     , filename()
@@ -357,6 +379,8 @@ struct CLArgsPrivate
     , range()
     , rangeSet(false)
     , isEmpty(true)
+    , profileFilename()
+    , serverName()
     {
         
     }
@@ -436,6 +460,17 @@ CLArgs::printUsage(const std::string& programName)
               "start it."
               "NatronRenderer and " NATRON_APPLICATION_NAME "will do the same thing in this mode, only the init.py script will be loaded.");
     W_LINE("\n");
+    W_TR_LINE("[--profile] <trace file path> records where the time goes during renders and writes it once the renders are finished "
+              "to a trace file that can be opened in chrome://tracing.");
+    W_LINE("\n");
+    W_TR_LINE("[--server] <local socket name> keeps " NATRON_APPLICATION_NAME " running in background mode to render the jobs sent "
+              "to the given local socket, one after the other. Each job is a single line made of tab separated fields:\n"
+              "--job <project file path> <Writer node script name> <first frame> <last frame> [optional]<Python lines>...\n"
+              "The writer and the frames can be left empty to render all the writers of the project with their own frame range. "
+              "The Python lines are run once the project is loaded. The progress of each frame is written back to the socket "
+              "and the server stops when it receives --quit.");
+    W_LINE("./NatronRenderer --server /tmp/natron_render_server");
+    W_LINE("\n");
     
     W_TR_LINE("- Options for the execution of " NATRON_APPLICATION_NAME " projects:\n");
     W_LINE(programName + " <project file path>");
@@ -551,6 +586,18 @@ CLArgs::isPythonScript() const
     return _imp->isPythonScript;
 }
 
+const QString&
+CLArgs::getProfileFilename() const
+{
+    return _imp->profileFilename;
+}
+
+const QString&
+CLArgs::getServerName() const
+{
+    return _imp->serverName;
+}
+
 QStringList::iterator
 CLArgsPrivate::hasFileNameWithExtension(const QString& extension)
 {
@@ -655,6 +702,42 @@ CLArgsPrivate::parse()
     }
     
     
+    {
+        QStringList::iterator it = hasToken("profile", "");
+        if (it != args.end()) {
+            QStringList::iterator next = it;
+            ++next;
+            if (next == args.end() || next->startsWith("-")) {
+                std::cout << QObject::tr("You must specify the filename of the trace file when using the --profile option").toStdString() << std::endl;
+                error = 1;
+                return;
+            }
+            profileFilename = *next;
+#if defined(Q_OS_UNIX)
+            profileFilename = AppManager::qt_tildeExpansion(profileFilename);
+#endif
+            ++next;
+            args.erase(it, next);
+        }
+    }
+    
+    {
+        QStringList::iterator it = hasToken("server", "");
+        if (it != args.end()) {
+            QStringList::iterator next = it;
+            ++next;
+            if (next == args.end() || next->startsWith("-")) {
+                std::cout << QObject::tr("You must specify the name of the local socket when using the --server option").toStdString() << std::endl;
+                error = 1;
+                return;
+            }
+            serverName = *next;
+            isBackground = true;
+            ++next;
+            args.erase(it, next);
+        }
+    }
+    
     {
         QStringList::iterator it = hasToken("IPCpipe", "");
         if (it != args.end()) {
@@ -667,7 +750,7 @@ CLArgsPrivate::parse()
         QStringList::iterator it = hasFileNameWithExtension(NATRON_PROJECT_FILE_EXT);
         if (it == args.end()) {
             it = hasFileNameWithExtension("py");
-            if (it == args.end() && !isInterpreterMode && isBackground) {
+            if (it == args.end() && !isInterpreterMode && serverName.isEmpty() && isBackground) {
                 std::cout << QObject::tr("You must specify the filename of a script or " NATRON_APPLICATION_NAME " project. (." NATRON_PROJECT_FILE_EXT
                                          ")").toStdString() << std::endl;
                 error = 1;
@@ -1060,6 +1143,7 @@ AppManager::loadInternal(const CLArgs& cl)
         _imp->_nodeCache.reset( new Cache<Image>("NodeCache",NATRON_CACHE_VERSION, maxCacheRAM - playbackSize,1.) );
         _imp->_diskCache.reset( new Cache<Image>("DiskCache",NATRON_CACHE_VERSION, maxDiskCacheNode,0.) );
         _imp->_viewerCache.reset( new Cache<FrameEntry>("ViewerCache",NATRON_CACHE_VERSION,viewerCacheSize,(double)playbackSize / (double)viewerCacheSize) );
+        setApplicationsCachesCompression( _imp->_settings->getDiskCacheCodec(), _imp->_settings->isPlaybackDiskCacheHalfFloatEnabled() );
     } catch (std::logic_error) {
         // ignore
     }
@@ -1106,6 +1190,10 @@ AppManager::loadInternal(const CLArgs& cl)
         _imp->_appType = eAppTypeGui;
     }
 
+    if ( !cl.getProfileFilename().isEmpty() ) {
+        RenderProfiler::setEnabled(true);
+    }
+    
     AppInstance* mainInstance = newAppInstance(cl);
     
     hideSplashScreen();
@@ -1114,6 +1202,39 @@ AppManager::loadInternal(const CLArgs& cl)
         return false;
     } else {
         onLoadCompleted();
+        
+        if ( isBackground() ) {
+            printStartupTimings();
+        }
+
+        if ( !cl.getServerName().isEmpty() ) {
+            RenderServer server( mainInstance, cl.getServerName() );
+            std::string error;
+            if ( !server.listen(&error) ) {
+                std::cout << error << std::endl;
+            } else {
+                _imp->renderServer = &server;
+                server.exec();
+                _imp->renderServer = 0;
+            }
+            try {
+                mainInstance->getProject()->closeProject();
+            } catch (std::logic_error) {
+                // ignore
+            }
+            try {
+                mainInstance->quit();
+            } catch (std::logic_error) {
+                // ignore
+            }
+        }
+
+        if ( isBackground() && !cl.getProfileFilename().isEmpty() ) {
+            std::string error;
+            if ( !RenderProfiler::exportChromeTrace(cl.getProfileFilename().toStdString(), &error) ) {
+                std::cout << error << std::endl;
+            }
+        }
 
         ///In background project auto-run the rendering is finished at this point, just exit the instance
         if ( (_imp->_appType == eAppTypeBackgroundAutoRun ||
@@ -1304,6 +1425,9 @@ bool
 AppManager::writeToOutputPipe(const QString & longMessage,
                               const QString & shortMessage)
 {
+    if ( _imp->renderServer && _imp->renderServer->writeToClient(shortMessage) ) {
+        return true;
+    }
     if (!_imp->_backgroundIPC) {
         
         QMutexLocker k(&_imp->_ofxLogMutex);
@@ -1354,6 +1478,15 @@ AppManager::setApplicationsCachesMaximumDiskSpace(unsigned long long size)
     _imp->_diskCache->setMaximumCacheSize(size);
 }
 
+void
+AppManager::setApplicationsCachesCompression(Natron::CacheCodecEnum codec,
+                                             bool viewerFloatToHalf)
+{
+    _imp->_nodeCache->setCompression(codec, false);
+    _imp->_diskCache->setCompression(codec, false);
+    _imp->_viewerCache->setCompression(codec, viewerFloatToHalf);
+}
+
 void
 AppManager::setPlaybackCacheMaximumSize(double p)
 {
@@ -1378,10 +1511,13 @@ AppManager::loadAllPlugins()
 
     /*loading node plugins*/
 
+    TimeLapse timer;
     loadBuiltinNodePlugins(&readersMap, &writersMap);
+    addStartupTiming( "built-in plug-ins", timer.getTimeElapsedReset() );
 
     /*loading ofx plugins*/
     _imp->ofxHost->loadOFXPlugins( &readersMap, &writersMap);
+    timer.getTimeElapsedReset();
     
     std::vector<Natron::Plugin*> ignoredPlugins;
     _imp->_settings->populatePluginsTab(ignoredPlugins);
@@ -1442,7 +1578,9 @@ AppManager::loadAllPlugins()
     
     //Load python groups and init.py & initGui.py scripts
     //Should be done after settings are declared
+    timer.getTimeElapsedReset();
     loadPythonGroups();
+    addStartupTiming( "Python plug-ins", timer.getTimeElapsedReset() );
 
     onAllPluginsLoaded();
 }
@@ -2096,6 +2234,18 @@ AppManager::removeAllTexturesFromCacheWithMatchingKey(U64 treeVersion)
     _imp->_viewerCache->removeAllImagesFromCacheWithMatchingKey(treeVersion);
 }
 
+std::size_t
+AppManager::prefetchDiskCachedFrame(const std::list<U64>& treeVersions,
+                                    SequenceTime time) const
+{
+    std::size_t ret = 0;
+    for (std::list<U64>::const_iterator it = treeVersions.begin(); it != treeVersions.end(); ++it) {
+        ret += _imp->_viewerCache->prefetchEntries(*it, time);
+        ret += _imp->_diskCache->prefetchEntries(*it, time);
+    }
+    return ret;
+}
+
 const QString &
 AppManager::getApplicationBinaryPath() const
 {
@@ -2178,6 +2328,14 @@ AppManager::getCachesTotalMemorySize() const
     return _imp->_viewerCache->getMemoryCacheSize() + _imp->_nodeCache->getMemoryCacheSize();
 }
 
+void
+AppManager::getViewerCacheMemoryUsage(std::size_t* size,
+                                      std::size_t* maxSize) const
+{
+    *size = _imp->_viewerCache->getMemoryCacheSize();
+    *maxSize = _imp->_viewerCache->getMaximumMemorySize();
+}
+
 Natron::CacheSignalEmitter*
 AppManager::getOrActivateViewerCacheSignalEmitter() const
 {
@@ -2301,12 +2459,15 @@ void restoreCache(AppManagerPrivate* p,Natron::Cache<T>* cache)
         } catch (const std::ifstream::failure & e) {
             qDebug() << "Failed to open the cache restoration file:" << e.what();
             
+            ///Still remove the slabs of the previous session, no entry references them
+            cache->restore( typename Natron::Cache<T>::CacheTOC() );
             return;
         }
         
         if ( !ifile.good() ) {
             qDebug() << "Failed to cache file for restoration:" <<  settingsFilePath.c_str();
             ifile.close();
+            cache->restore( typename Natron::Cache<T>::CacheTOC() );
             
             return;
         }
@@ -2327,6 +2488,7 @@ void restoreCache(AppManagerPrivate* p,Natron::Cache<T>* cache)
         } catch (const std::exception & e) {
             qDebug() << "Exception when reading disk cache TOC:" << e.what();
             ifile.close();
+            cache->restore( typename Natron::Cache<T>::CacheTOC() );
             
             return;
         }
@@ -2841,9 +3003,97 @@ AppManager::getNRunningThreads() const
 }
 
 void
-AppManager::setThreadAsActionCaller(bool actionCaller)
+AppManager::setThreadAsActionCaller(Natron::OfxImageEffectInstance* instance,
+                                    bool actionCaller)
 {
-    _imp->ofxHost->setThreadAsActionCaller(actionCaller);
+    _imp->ofxHost->setThreadAsActionCaller(instance, actionCaller);
+}
+
+void
+AppManager::printOfxMultiThreadStats() const
+{
+    std::map<std::string,OfxMultiThreadStats> stats;
+    _imp->ofxHost->getMultiThreadStats(&stats);
+    for (std::map<std::string,OfxMultiThreadStats>::iterator it = stats.begin(); it != stats.end(); ++it) {
+        double utilization = it->second.availableTime > 0. ? it->second.threadsTime / it->second.availableTime : 0.;
+        std::cout << it->first << ": " << it->second.nCalls << " multi-thread calls, " << it->second.wallTime << "s, "
+                  << (int)(utilization * 100.) << "% SMP utilization" << std::endl;
+    }
+}
+
+Natron::RenderPriorityArbiter*
+AppManager::getRenderPriorityArbiter() const
+{
+    return _imp->renderPriorityArbiter.get();
+}
+
+void
+AppManager::printRenderPriorityStats() const
+{
+    for (int i = 0; i < NATRON_RENDER_PRIORITIES_COUNT; ++i) {
+        RenderPriorityStats stats;
+        _imp->renderPriorityArbiter->getStats( (Natron::RenderPriorityEnum)i, &stats );
+        if ( (stats.nRenders == 0) && (stats.nPreemptions == 0) ) {
+            continue;
+        }
+        double meanLatency = stats.nRenders > 0 ? stats.totalLatency / stats.nRenders : 0.;
+        std::cout << RenderPriorityArbiter::getPriorityName( (Natron::RenderPriorityEnum)i ) << " renders: " << stats.nRenders
+                  << " frames, " << meanLatency << "s mean latency, " << stats.maxLatency << "s max latency, "
+                  << stats.nPreemptions << " tiles preempted for " << stats.preemptedTime << "s" << std::endl;
+    }
+}
+
+Natron::NumaPlacement*
+AppManager::getNumaPlacement() const
+{
+    return _imp->numaPlacement.get();
+}
+
+void
+AppManager::setNumaAwareRenderingEnabled(bool enabled)
+{
+    _imp->numaPlacement->setEnabled(enabled);
+    Natron::NumaPlacement::setFirstTouchAllocationEnabled( enabled && _imp->numaPlacement->getNodesCount() > 1 );
+}
+
+void
+AppManager::printNumaPlacementStats() const
+{
+    int nNodes = _imp->numaPlacement->getNodesCount();
+    if (nNodes < 2) {
+        return;
+    }
+    for (int i = 0; i < nNodes; ++i) {
+        std::cout << "NUMA node " << i << ": " << _imp->numaPlacement->getNodeCores(i).size() << " cores, "
+                  << _imp->numaPlacement->getPlacedFramesCount(i) << " frames placed" << std::endl;
+    }
+    std::cout << "Frames rendered on all NUMA nodes: " << _imp->numaPlacement->getPlacedFramesCount(-1) << std::endl;
+}
+
+void
+AppManager::loadDeferredOFXPlugins()
+{
+    _imp->ofxHost->loadDeferredOFXPlugins();
+}
+
+void
+AppManager::addStartupTiming(const std::string& phase,
+                             double seconds)
+{
+    _imp->startupTimings.push_back( std::make_pair(phase, seconds) );
+}
+
+void
+AppManager::printStartupTimings() const
+{
+    double total = 0.;
+    std::cout << "Startup:";
+    for (std::list<std::pair<std::string,double> >::const_iterator it = _imp->startupTimings.begin();
+         it != _imp->startupTimings.end(); ++it) {
+        std::cout << ( it == _imp->startupTimings.begin() ? " " : ", " ) << it->first << " " << it->second << "s";
+        total += it->second;
+    }
+    std::cout << " (total " << total << "s)" << std::endl;
 }
 
 std::list<std::string>
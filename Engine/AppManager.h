@@ -30,6 +30,7 @@ CLANG_DIAG_ON(deprecated)
 #include <boost/noncopyable.hpp>
 #endif
 
+#include "Engine/CacheCodec.h"
 #include "Engine/Plugin.h"
 #include "Engine/KnobFactory.h"
 #include "Engine/ImageLocker.h"
@@ -60,6 +61,9 @@ class FrameParams;
 class FrameEntry;
 class Plugin;
 class CacheSignalEmitter;
+class OfxImageEffectInstance;
+class RenderPriorityArbiter;
+class NumaPlacement;
 
 enum AppInstanceStatusEnum
 {
@@ -123,6 +127,16 @@ public:
     
     bool isPythonScript() const;
     
+    /**
+     * @brief The file where to export the render profile once the renders are finished, empty if not profiling
+     **/
+    const QString& getProfileFilename() const;
+    
+    /**
+     * @brief The name of the local socket where to listen to render jobs, empty if not in --server mode
+     **/
+    const QString& getServerName() const;
+    
 private:
     
     boost::scoped_ptr<CLArgsPrivate> _imp;
@@ -240,6 +254,11 @@ public:
 
     U64 getCachesTotalMemorySize() const;
 
+    /**
+     * @brief Returns the memory taken by the RAM portion of the viewer cache and its maximum size
+     **/
+    void getViewerCacheMemoryUsage(std::size_t* size,std::size_t* maxSize) const;
+
     Natron::CacheSignalEmitter* getOrActivateViewerCacheSignalEmitter() const;
 
     void setApplicationsCachesMaximumMemoryPercent(double p);
@@ -248,6 +267,12 @@ public:
     
     void setApplicationsCachesMaximumDiskSpace(unsigned long long size);
 
+    /**
+     * @brief Sets how the entries written to the disk portion of the caches are encoded
+     * @param viewerFloatToHalf If true, the floating point textures of the viewer cache are stored as half floats
+     **/
+    void setApplicationsCachesCompression(Natron::CacheCodecEnum codec,bool viewerFloatToHalf);
+
     void setPlaybackCacheMaximumSize(double p);
 
     void removeFromNodeCache(const boost::shared_ptr<Natron::Image> & image);
@@ -263,6 +288,13 @@ public:
     void  removeAllImagesFromDiskCacheWithMatchingKey(U64 treeVersion);
     void  removeAllTexturesFromCacheWithMatchingKey(U64 treeVersion);
 
+    /**
+     * @brief Brings back into RAM the viewer textures and the DiskCache nodes images at the given time
+     * whose tree version is one of the given ones, if they are only on disk.
+     * Returns the number of bytes read from disk.
+     **/
+    std::size_t prefetchDiskCachedFrame(const std::list<U64>& treeVersions, SequenceTime time) const;
+
     boost::shared_ptr<Settings> getCurrentSettings() const WARN_UNUSED_RETURN;
     const KnobFactory & getKnobFactory() const WARN_UNUSED_RETURN;
 
@@ -382,7 +414,53 @@ public:
      **/
     int getNRunningThreads() const;
     
-    void setThreadAsActionCaller(bool actionCaller);
+    void setThreadAsActionCaller(Natron::OfxImageEffectInstance* instance,bool actionCaller);
+    
+    /**
+     * @brief Prints for each OpenFX plug-in how well it used the threads of the multi-thread suite
+     **/
+    void printOfxMultiThreadStats() const;
+    
+    /**
+     * @brief Returns the object deciding which renders get the cores, see ParallelRenderArgs::priority
+     **/
+    Natron::RenderPriorityArbiter* getRenderPriorityArbiter() const;
+    
+    /**
+     * @brief Prints for each render priority class the latency of the frame renders and how long they were preempted
+     **/
+    void printRenderPriorityStats() const;
+    
+    /**
+     * @brief Returns the NUMA nodes of the computer on which frame renders are placed, see ParallelRenderArgs::numaNode
+     **/
+    Natron::NumaPlacement* getNumaPlacement() const;
+    
+    /**
+     * @brief Enables the placement of frame renders on NUMA nodes and the first-touch allocation of image buffers
+     **/
+    void setNumaAwareRenderingEnabled(bool enabled);
+    
+    /**
+     * @brief Prints the number of frame renders placed on each NUMA node, on a computer with several nodes
+     **/
+    void printNumaPlacementStats() const;
+
+    /**
+     * @brief Reads the OFX plugin cache if the OpenFX plug-ins were registered from the plug-ins registry.
+     * @see OfxHost::loadDeferredOFXPlugins
+     **/
+    void loadDeferredOFXPlugins();
+
+    /**
+     * @brief Records the time in seconds spent in a phase of the startup, such as loading a kind of plug-ins.
+     **/
+    void addStartupTiming(const std::string& phase,double seconds);
+
+    /**
+     * @brief Prints the time spent in each phase of the startup recorded with addStartupTiming
+     **/
+    void printStartupTimings() const;
 
     /**
      * @brief Returns a list of IDs of all the plug-ins currently loaded.
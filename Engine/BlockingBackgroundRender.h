@@ -25,6 +25,7 @@ class OutputEffectInstance;
 class BlockingBackgroundRender
 {
     bool _running;
+    bool _aborted; //< the render was aborted or failed
     QWaitCondition _runningCond;
     QMutex _runningMutex;
     Natron::OutputEffectInstance* _writer;
@@ -42,9 +43,12 @@ public:
         return _writer;
     }
 
-    void notifyFinished();
+    void notifyFinished(bool aborted);
 
-    void blockingRender(int first,int last);
+    /**
+     * @brief Renders the frame range with the writer, returns false if the render was aborted or failed.
+     **/
+    bool blockingRender(int first,int last);
 };
 
 #endif // BLOCKINGBACKGROUNDRENDER_H
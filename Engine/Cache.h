@@ -21,8 +21,10 @@
 #include <fstream>
 #include <functional>
 #include <list>
+#include <map>
 #include <cstddef>
 #include <utility>
+#include <algorithm>
 
 #include "Global/GlobalDefines.h"
 #include "Global/MemoryInfo.h"
@@ -68,6 +70,9 @@ CLANG_DIAG_ON(unused-parameter)
 //Beyond that percentage of occupation, the cache will start evicting LRU entries
 #define NATRON_CACHE_LIMIT_PERCENT 0.9
 
+///Size of the files in which the entries stored on disk are packed
+#define NATRON_CACHE_SLAB_SIZE ( (U64)256 * 1024 * 1024 )
+
 ///When defined, number of opened files, memory size and disk size of the cache are printed whenever there's activity.
 //#define NATRON_DEBUG_CACHE
 
@@ -268,8 +273,11 @@ public:
         hash_type hash;
         typename EntryType::key_type key;
         ParamsTypePtr params;
-        std::size_t size; //< the data size in bytes
+        std::size_t size; //< the size in bytes of the data on disk
         std::string filePath; //< we need to serialize it as several entries can have the same hash, hence we index them
+        int slab; //< the index of the slab holding the entry, or -1 if the entry has a file of its own
+        U64 slabOffset; //< the offset of the entry in the slab
+        int codec; //< the Natron::CacheCodecEnum the entry was encoded with
         
         SerializedEntry()
         : hash(0)
@@ -277,6 +285,9 @@ public:
         , params()
         , size(0)
         , filePath()
+        , slab(-1)
+        , slabOffset(0)
+        , codec(0)
         {
             
         }
@@ -290,6 +301,9 @@ public:
             ar & boost::serialization::make_nvp("Params",params);
             ar & boost::serialization::make_nvp("Size",size);
             ar & boost::serialization::make_nvp("Filename",filePath);
+            ar & boost::serialization::make_nvp("Slab",slab);
+            ar & boost::serialization::make_nvp("SlabOffset",slabOffset);
+            ar & boost::serialization::make_nvp("Codec",codec);
         }
         
         template<class Archive>
@@ -301,6 +315,9 @@ public:
             ar & boost::serialization::make_nvp("Params",params);
             ar & boost::serialization::make_nvp("Size",size);
             ar & boost::serialization::make_nvp("Filename",filePath);
+            ar & boost::serialization::make_nvp("Slab",slab);
+            ar & boost::serialization::make_nvp("SlabOffset",slabOffset);
+            ar & boost::serialization::make_nvp("Codec",codec);
         }
         
         BOOST_SERIALIZATION_SPLIT_MEMBER()
@@ -312,7 +329,18 @@ public:
 public:
 
 
-#ifdef USE_VARIADIC_TEMPLATES
+#ifdef NATRON_CACHE_USE_FLAT
+
+    typedef FlatLRUHashTable<hash_type, EntryTypePtr> CacheContainer;
+    typedef typename CacheContainer::iterator CacheIterator;
+    typedef typename CacheContainer::const_iterator ConstCacheIterator;
+    typedef typename CacheContainer::value_type CacheEntriesList;
+    static CacheEntriesList &  getValueFromIterator(CacheIterator it)
+    {
+        return it->second;
+    }
+
+#elif defined(USE_VARIADIC_TEMPLATES)
 
 #ifdef NATRON_CACHE_USE_BOOST
 #ifdef NATRON_CACHE_USE_HASH
@@ -322,7 +350,8 @@ public:
 #endif
     typedef typename CacheContainer::container_type::left_iterator CacheIterator;
     typedef typename CacheContainer::container_type::left_const_iterator ConstCacheIterator;
-    static std::list<CachedValue> &  getValueFromIterator(CacheIterator it)
+    typedef std::list<EntryTypePtr> CacheEntriesList;
+    static CacheEntriesList &  getValueFromIterator(CacheIterator it)
     {
         return it->second;
     }
@@ -336,7 +365,8 @@ public:
 #endif
     typedef typename CacheContainer::key_to_value_type::iterator CacheIterator;
     typedef typename CacheContainer::key_to_value_type::const_iterator ConstCacheIterator;
-    static std::list<EntryTypePtr> &  getValueFromIterator(CacheIterator it)
+    typedef std::list<EntryTypePtr> CacheEntriesList;
+    static CacheEntriesList &  getValueFromIterator(CacheIterator it)
     {
         return it->second;
     }
@@ -353,7 +383,8 @@ public:
 #endif
     typedef typename CacheContainer::container_type::left_iterator CacheIterator;
     typedef typename CacheContainer::container_type::left_const_iterator ConstCacheIterator;
-    static std::list<EntryTypePtr> &  getValueFromIterator(CacheIterator it)
+    typedef std::list<EntryTypePtr> CacheEntriesList;
+    static CacheEntriesList &  getValueFromIterator(CacheIterator it)
     {
         return it->second;
     }
@@ -363,14 +394,15 @@ public:
     typedef StlLRUHashTable<hash_type, EntryTypePtr > CacheContainer;
     typedef typename CacheContainer::key_to_value_type::iterator CacheIterator;
     typedef typename CacheContainer::key_to_value_type::const_iterator ConstCacheIterator;
-    static std::list<EntryTypePtr> &   getValueFromIterator(CacheIterator it)
+    typedef std::list<EntryTypePtr> CacheEntriesList;
+    static CacheEntriesList &  getValueFromIterator(CacheIterator it)
     {
         return it->second.first;
     }
 
 #endif // NATRON_CACHE_USE_BOOST
 
-#endif // USE_VARIADIC_TEMPLATES
+#endif // NATRON_CACHE_USE_FLAT
 
 private:
 
@@ -393,6 +425,14 @@ private:
          when we call get() and we want this function to be const.*/
     mutable CacheContainer _memoryCache;
     mutable CacheContainer _diskCache;
+    
+    ///For each tree version, the hash keys of the entries of the memory and disk portions with that tree version,
+    ///with the number of entries under each hash key. This is what removeAllImagesFromCacheWithMatchingKey() looks up
+    ///instead of scanning both portions. Protected by _lock.
+    typedef std::map<hash_type,unsigned int> IndexedHashes;
+    typedef std::map<U64,IndexedHashes> TreeVersionIndex;
+    mutable TreeVersionIndex _treeVersionIndex;
+    
     const std::string _cacheName;
     const unsigned int _version;
 
@@ -405,8 +445,16 @@ private:
 
     bool _tearingDown;
     
+    ///Created on demand, it must outlive the entries
+    mutable QMutex _slabsLock;
+    mutable boost::scoped_ptr<MemoryFileSlabAllocator> _slabs;
+    
     mutable Natron::DeleterThread<EntryType> _deleterThread;
     mutable QWaitCondition _memoryFullCondition; //< protected by _sizeLock
+
+    mutable QMutex _compressionLock; //< protects _codec and _codecFloatToHalf
+    Natron::CacheCodecEnum _codec;
+    bool _codecFloatToHalf;
     
 public:
 
@@ -428,13 +476,19 @@ public:
           , _getLock()
           ,_memoryCache()
           ,_diskCache()
+          ,_treeVersionIndex()
           ,_cacheName(cacheName)
           ,_version(version)
           ,_signalEmitter(new CacheSignalEmitter)
           ,_maxPhysicalRAM( getSystemTotalRAM() )
           ,_tearingDown(false)
+          ,_slabsLock()
+          ,_slabs()
           ,_deleterThread(this)
           ,_memoryFullCondition()
+          ,_compressionLock()
+          ,_codec(Natron::eCacheCodecNone)
+          ,_codecFloatToHalf(false)
     {
     }
 
@@ -444,6 +498,7 @@ public:
         _tearingDown = true;
         _memoryCache.clear();
         _diskCache.clear();
+        _treeVersionIndex.clear();
         delete _signalEmitter;
         
     }
@@ -697,11 +752,13 @@ public:
         QMutexLocker locker(&_lock);
         std::pair<hash_type,EntryTypePtr> evictedFromMemory = _memoryCache.evict();
         while (evictedFromMemory.second) {
+            unindexEntry(evictedFromMemory.second);
             if ( evictedFromMemory.second->isStoredOnDisk() ) {
                 evictedFromMemory.second->removeAnyBackingFile();
             }
             evictedFromMemory = _memoryCache.evict();
         }
+        getSlabAllocator()->releaseFreeSlabs();
 
         if (_signalEmitter) {
             _signalEmitter->blockSignals(false);
@@ -728,9 +785,13 @@ public:
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
         while (evictedFromDisk.second) {
+            unindexEntry(evictedFromDisk.second);
             evictedFromDisk.second->removeAnyBackingFile();
             evictedFromDisk = _diskCache.evict();
         }
+        
+        ///Give back the disk space preallocated for the slabs that are now empty
+        getSlabAllocator()->releaseFreeSlabs();
 
         
         _signalEmitter->blockSignals(false);
@@ -771,6 +832,7 @@ public:
                         if (!evictedFromDisk.second) {
                             break;
                         }
+                        unindexEntry(evictedFromDisk.second);
                         ///Erase the file from the disk if we reach the limit.
                         evictedFromDisk.second->removeAnyBackingFile();
                     }
@@ -786,7 +848,11 @@ public:
                 /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
                 if ( existingDiskCacheEntry == _diskCache.end() ) {
                     _diskCache.insert(evictedFromMemory.second->getHashKey(),evictedFromMemory.second);
+                } else {
+                    unindexEntry(evictedFromMemory.second);
                 }
+            } else {
+                unindexEntry(evictedFromMemory.second);
             }
 
             evictedFromMemory = _memoryCache.evict();
@@ -844,11 +910,11 @@ public:
         QMutexLocker locker(&_lock);
 
         for (CacheIterator it = _memoryCache.begin(); it != _memoryCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+            const CacheEntriesList & entries = getValueFromIterator(it);
             copy->insert(copy->end(),entries.begin(),entries.end());
         }
         for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+            const CacheEntriesList & entries = getValueFromIterator(it);
             copy->insert(copy->end(),entries.begin(),entries.end());
         }
     }
@@ -889,6 +955,7 @@ public:
         /*if it is stored on disk, remove it from memory*/
         
         assert( evicted.second.unique() );
+        unindexEntry(evicted.second);
         evicted.second->removeAnyBackingFile();
         
         return true;
@@ -924,7 +991,8 @@ public:
      **/
     virtual void notifyEntryAllocated(int time,
                                       std::size_t size,
-                                      Natron::StorageModeEnum storage) const OVERRIDE FINAL
+                                      Natron::StorageModeEnum storage,
+                                      bool openedFile) const OVERRIDE FINAL
     {
         ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache, hence the
         ///lock should already be taken.
@@ -933,7 +1001,7 @@ public:
         _memoryCacheSize += size;
         _signalEmitter->emitAddedEntry(time);
 
-        if (storage == Natron::eStorageModeDisk) {
+        if ( (storage == Natron::eStorageModeDisk) && openedFile ) {
             appPTR->increaseNCacheFilesOpened();
         }
 #ifdef NATRON_DEBUG_CACHE
@@ -980,7 +1048,9 @@ public:
     virtual void notifyEntryStorageChanged(Natron::StorageModeEnum oldStorage,
                                            Natron::StorageModeEnum newStorage,
                                            int time,
-                                           std::size_t size) const OVERRIDE FINAL
+                                           std::size_t size,
+                                           std::size_t diskSize,
+                                           bool openedFile) const OVERRIDE FINAL
     {
         if (_tearingDown) {
             return;
@@ -991,27 +1061,31 @@ public:
         assert(newStorage != Natron::eStorageModeNone);
         if (oldStorage == Natron::eStorageModeRAM) {
             _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
-            _diskCacheSize += size;
+            _diskCacheSize += diskSize;
 #ifdef NATRON_DEBUG_CACHE
             qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
             qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
 #endif
             ///We switched from RAM to DISK that means the MemoryFile object has been destroyed hence the file has been closed.
-            appPTR->decreaseNCacheFilesOpened();
+            if (openedFile) {
+                appPTR->decreaseNCacheFilesOpened();
+            }
         } else if (oldStorage == Natron::eStorageModeDisk) {
             _memoryCacheSize += size;
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            _diskCacheSize = diskSize > _diskCacheSize ? 0 : _diskCacheSize - diskSize;
 #ifdef NATRON_DEBUG_CACHE
             qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
             qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
 #endif
             ///We switched from DISK to RAM that means the MemoryFile object has been created and the file opened
-            appPTR->increaseNCacheFilesOpened();
+            if (openedFile) {
+                appPTR->increaseNCacheFilesOpened();
+            }
         } else {
             if (newStorage == Natron::eStorageModeRAM) {
                 _memoryCacheSize += size;
             } else if (newStorage == Natron::eStorageModeDisk) {
-                _diskCacheSize += size;
+                _diskCacheSize += diskSize;
             }
         }
        
@@ -1024,6 +1098,41 @@ public:
         appPTR->decreaseNCacheFilesOpened();
     }
 
+    /**
+     * @brief The slabs live in the cache directory. A mapped region of a slab does not keep a file descriptor
+     * opened, hence entries stored in slabs are not counted in the opened files.
+     **/
+    virtual MemoryFileSlabAllocator* getSlabAllocator() const OVERRIDE FINAL
+    {
+        QMutexLocker k(&_slabsLock);
+        if (!_slabs) {
+            _slabs.reset( new MemoryFileSlabAllocator(getCachePath().toStdString(), NATRON_CACHE_SLAB_SIZE) );
+        }
+        return _slabs.get();
+    }
+
+    virtual void getCompression(Natron::CacheCodecEnum* codec,
+                                bool* floatToHalf) const OVERRIDE FINAL
+    {
+        QMutexLocker k(&_compressionLock);
+        *codec = _codec;
+        *floatToHalf = _codecFloatToHalf;
+    }
+
+    /**
+     * @brief Sets how the entries are encoded when they are written to the disk portion of the cache. The entries
+     * already on disk keep their codec.
+     * @param floatToHalf If true, floating point entries are stored as half floats, this must only be used for
+     * entries that are only displayed.
+     **/
+    void setCompression(Natron::CacheCodecEnum codec,
+                        bool floatToHalf)
+    {
+        QMutexLocker k(&_compressionLock);
+        _codec = codec;
+        _codecFloatToHalf = floatToHalf;
+    }
+
     // const data member: no need to take the lock
     const std::string & cacheName() const
     {
@@ -1098,6 +1207,108 @@ public:
     }
     
 
+    /**
+     * @brief Brings back into RAM the entries of the disk portion of the cache with the given tree version and time,
+     * so that a later get() does not have to read them from disk. Entries are not prefetched if it would
+     * require to evict other entries from the RAM. The entries are found with the tree version index and the data is
+     * read once the lock is released, so that get() is not blocked while reading.
+     * Returns the number of bytes read from disk, or decoded for compressed entries.
+     **/
+    std::size_t prefetchEntries(U64 treeVersion,
+                                SequenceTime time) const
+    {
+        std::list<EntryTypePtr> matches;
+        {
+            QMutexLocker locker(&_lock);
+            
+            ///Only look at the entries with the tree version, so that the lock is held for a time proportional to their
+            ///number rather than to the size of the disk cache
+            typename TreeVersionIndex::const_iterator found = _treeVersionIndex.find(treeVersion);
+            if ( found == _treeVersionIndex.end() ) {
+                return 0;
+            }
+            std::size_t matchesSize = 0;
+            for (typename IndexedHashes::const_iterator hIt = found->second.begin(); hIt != found->second.end(); ++hIt) {
+                CacheIterator dIt = _diskCache(hIt->first);
+                if ( dIt == _diskCache.end() ) {
+                    continue;
+                }
+                CacheEntriesList & entries = getValueFromIterator(dIt);
+                for (typename CacheEntriesList::iterator it = entries.begin(); it != entries.end(); ++it) {
+                    if ( ( (*it)->getKey().getTreeVersion() == treeVersion ) && ( (*it)->getTime() == time ) ) {
+                        matches.push_back(*it);
+                        matchesSize += (*it)->getParams()->getElementsCount() * sizeof(data_t);
+                    }
+                }
+            }
+            
+            ///Do not decode entries that will not fit in RAM anyway
+            QMutexLocker k(&_sizeLock);
+            while ( !matches.empty() && (_memoryCacheSize + matchesSize > _maximumInMemorySize) ) {
+                matchesSize -= matches.back()->getParams()->getElementsCount() * sizeof(data_t);
+                matches.pop_back();
+            }
+        }
+        
+        ///Compressed entries are decoded out of the lock, this is what takes time for them
+        std::size_t ret = 0;
+        for (typename std::list<EntryTypePtr>::iterator it = matches.begin(); it != matches.end(); ++it) {
+            ret += (*it)->decodeAhead();
+        }
+        
+        std::list<EntryTypePtr> prefetched;
+        {
+            QMutexLocker locker(&_lock);
+            
+            for (typename std::list<EntryTypePtr>::iterator it = matches.begin(); it != matches.end(); ++it) {
+                {
+                    QMutexLocker k(&_sizeLock);
+                    std::size_t entrySize = (*it)->getParams()->getElementsCount() * sizeof(data_t);
+                    if (_memoryCacheSize + entrySize > _maximumInMemorySize) {
+                        break;
+                    }
+                }
+                
+                ///Same as getInternal(): remove the entry from the disk cache before inserting it in the memory cache.
+                ///The entry may have been fetched or removed while it was decoded.
+                CacheIterator diskCached = _diskCache( (*it)->getHashKey() );
+                if ( diskCached == _diskCache.end() ) {
+                    continue;
+                }
+                CacheEntriesList & entries = getValueFromIterator(diskCached);
+                typename CacheEntriesList::iterator found = std::find(entries.begin(), entries.end(), *it);
+                if ( found == entries.end() ) {
+                    continue;
+                }
+                entries.erase(found);
+                if ( entries.empty() ) {
+                    _diskCache.erase(diskCached);
+                }
+                
+                try {
+                    (*it)->reOpenFileMapping();
+                } catch (const std::exception & e) {
+                    qDebug() << "Error while reopening cache file: " << e.what();
+                    unindexEntry(*it);
+                    continue;
+                }
+                _memoryCache.insert( (*it)->getHashKey(), *it );
+                prefetched.push_back(*it);
+            }
+        } // QMutexLocker locker(&_lock);
+        
+        ///Release what was decoded for the entries that could not be brought back
+        for (typename std::list<EntryTypePtr>::iterator it = matches.begin(); it != matches.end(); ++it) {
+            (*it)->dropDecodedAhead();
+        }
+        
+        ///Read the data out of the lock, this is what takes time
+        for (typename std::list<EntryTypePtr>::iterator it = prefetched.begin(); it != prefetched.end(); ++it) {
+            ret += (*it)->prefault();
+        }
+        return ret;
+    }
+
 
     /** @brief This function can be called to remove a specific entry from the cache. For example a frame
      * that has had its render aborted but already belong to the cache.
@@ -1114,11 +1325,12 @@ public:
             QMutexLocker l(&_lock);
             CacheIterator existingEntry = _memoryCache( entry->getHashKey() );
             if ( existingEntry != _memoryCache.end() ) {
-                std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
-                for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+                CacheEntriesList & ret = getValueFromIterator(existingEntry);
+                for (typename CacheEntriesList::iterator it = ret.begin(); it != ret.end(); ++it) {
                     if ( (*it)->getKey() == entry->getKey() ) {
                         toRemove.push_back(*it);
                         //(*it)->scheduleForDestruction();
+                        unindexEntry(*it);
                         ret.erase(it);
                         break;
                     }
@@ -1129,11 +1341,12 @@ public:
             } else {
                 existingEntry = _diskCache( entry->getHashKey() );
                 if ( existingEntry != _diskCache.end() ) {
-                    std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
-                    for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+                    CacheEntriesList & ret = getValueFromIterator(existingEntry);
+                    for (typename CacheEntriesList::iterator it = ret.begin(); it != ret.end(); ++it) {
                         if ( (*it)->getKey() == entry->getKey() ) {
                             //(*it)->scheduleForDestruction();
                             toRemove.push_back(*it);
+                            unindexEntry(*it);
                             ret.erase(it);
                             break;
                         }
@@ -1161,20 +1374,22 @@ public:
             QMutexLocker l(&_lock);
             CacheIterator existingEntry = _memoryCache( hash);
             if ( existingEntry != _memoryCache.end() ) {
-                std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
-                for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+                CacheEntriesList & ret = getValueFromIterator(existingEntry);
+                for (typename CacheEntriesList::iterator it = ret.begin(); it != ret.end(); ++it) {
                     //(*it)->scheduleForDestruction();
                     toRemove.push_back(*it);
+                    unindexEntry(*it);
                 }
                 _memoryCache.erase(existingEntry);
                 
             } else {
                 existingEntry = _diskCache( hash );
                 if ( existingEntry != _diskCache.end() ) {
-                    std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
-                    for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
+                    CacheEntriesList & ret = getValueFromIterator(existingEntry);
+                    for (typename CacheEntriesList::iterator it = ret.begin(); it != ret.end(); ++it) {
                         //(*it)->scheduleForDestruction();
                         toRemove.push_back(*it);
+                        unindexEntry(*it);
                     }
                     _diskCache.erase(existingEntry);
                     
@@ -1190,58 +1405,28 @@ public:
         }
     }
     
+    /**
+     * @brief Removes all entries whose key has the given tree version. The entries are found with the tree version
+     * index, so that the lock is only held for a time proportional to the number of entries removed. They are
+     * destroyed by the deleter thread.
+     **/
     void removeAllImagesFromCacheWithMatchingKey(U64 treeVersion)
     {
         std::list<EntryTypePtr> toDelete;
-        CacheContainer newMemCache,newDiskCache;
         {
             QMutexLocker locker(&_lock);
             
-            for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
-                
-                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-                if (!entries.empty()) {
-                    
-                    const EntryTypePtr& front = entries.front();
-                    
-                    if (front->getKey().getTreeVersion() == treeVersion) {
-                        
-                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                            //(*it)->scheduleForDestruction();
-                            toDelete.push_back(*it);
-                        }
-                        
-                    } else {
-                        typename EntryType::hash_type hash = front->getHashKey();
-                        newMemCache.insert(hash,entries);
-                    }
-                }
+            typename TreeVersionIndex::iterator found = _treeVersionIndex.find(treeVersion);
+            if ( found == _treeVersionIndex.end() ) {
+                return;
             }
-            
-            for (CacheIterator dIt = _diskCache.begin(); dIt != _diskCache.end(); ++dIt) {
-                
-                std::list<EntryTypePtr> & entries = getValueFromIterator(dIt);
-                if (!entries.empty()) {
-                    
-                    const EntryTypePtr& front = entries.front();
-
-                    if (front->getKey().getTreeVersion() == treeVersion) {
-                        
-                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                            //(*it)->scheduleForDestruction();
-                            toDelete.push_back(*it);
-                        }
-                        
-                    } else {
-                        typename EntryType::hash_type hash = front->getHashKey();
-                        newDiskCache.insert(hash,entries);
-                    }
+            for (typename IndexedHashes::iterator it = found->second.begin(); it != found->second.end(); ++it) {
+                unsigned int nRemoved = takeEntriesWithTreeVersion(_memoryCache, it->first, treeVersion, &toDelete);
+                if (nRemoved < it->second) {
+                    takeEntriesWithTreeVersion(_diskCache, it->first, treeVersion, &toDelete);
                 }
             }
-            
-            _memoryCache = newMemCache;
-            _diskCache = newDiskCache;
-            
+            _treeVersionIndex.erase(found);
             
         } // QMutexLocker locker(&_lock);
         
@@ -1263,24 +1448,39 @@ public:
         QMutexLocker l(&_lock);     // must be locked
 
         for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
-            std::list<EntryTypePtr> & listOfValues  = getValueFromIterator(it);
-            for (typename std::list<EntryTypePtr>::const_iterator it2 = listOfValues.begin(); it2 != listOfValues.end(); ++it2) {
+            CacheEntriesList & listOfValues  = getValueFromIterator(it);
+            for (typename CacheEntriesList::const_iterator it2 = listOfValues.begin(); it2 != listOfValues.end(); ++it2) {
                 if ( (*it2)->isStoredOnDisk() ) {
                     SerializedEntry serialization;
                     serialization.hash = (*it2)->getHashKey();
                     serialization.params = (*it2)->getParams();
                     serialization.key = (*it2)->getKey();
-                    serialization.size = (*it2)->dataSize();
+                    serialization.size = (*it2)->getDiskSize();
                     serialization.filePath = (*it2)->getFilePath();
+                    serialization.codec = (int)(*it2)->getCodec();
+                    const MemoryFileSlabAllocator::Extent & extent = (*it2)->getSlabExtent();
+                    if ( extent.isValid() ) {
+                        ///The mapping is closed, the extent holds the data size
+                        serialization.size = extent.size;
+                        serialization.slab = extent.slab;
+                        serialization.slabOffset = extent.offset;
+                    }
                     tableOfContents->push_back(serialization);
 #ifdef DEBUG
-                    if (!CacheAPI::checkFileNameMatchesHash(serialization.filePath, serialization.hash)) {
+                    if ( (serialization.slab < 0) && !CacheAPI::checkFileNameMatchesHash(serialization.filePath, serialization.hash) ) {
                         qDebug() << "WARNING: Cache entry filename is not the same as the serialized hash key";
                     }
 #endif
                 }
             }
         }
+        
+        ///The entries only scheduled the write-back of their data when they were closed:
+        ///make sure it reached the disk before the table of contents is written.
+        getSlabAllocator()->sync();
+        
+        ///Do not leave empty preallocated slabs on the disk
+        getSlabAllocator()->releaseFreeSlabs();
     }
 
 
@@ -1308,11 +1508,22 @@ public:
             }
             
 #ifdef DEBUG
-            if (!checkFileNameMatchesHash(it->filePath, it->hash)) {
+            if ( (it->slab < 0) && !checkFileNameMatchesHash(it->filePath, it->hash) ) {
                 qDebug() << "WARNING: Cache entry filename is not the same as the serialized hash key";
             }
 #endif
             
+            MemoryFileSlabAllocator::Extent extent;
+            if (it->slab >= 0) {
+                extent.slab = it->slab;
+                extent.offset = it->slabOffset;
+                extent.size = it->size;
+                if ( !getSlabAllocator()->reserve(extent) ) {
+                    qDebug() << "WARNING: Cache entry could not be found in" << it->filePath.c_str();
+                    continue;
+                }
+            }
+            
             EntryType* value = NULL;
 
             Natron::StorageModeEnum storage = Natron::eStorageModeDisk;
@@ -1321,9 +1532,12 @@ public:
                 value = new EntryType(it->key,it->params,this,storage,it->filePath);
                 
                 ///This will not put the entry back into RAM, instead we just insert back the entry into the disk cache
-                value->restoreMetaDataFromFile(it->size);
+                value->restoreMetaDataFromFile( it->size, extent, (Natron::CacheCodecEnum)it->codec );
             } catch (const std::exception & e) {
                 qDebug() << e.what();
+                if ( extent.isValid() ) {
+                    getSlabAllocator()->free(extent);
+                }
                 continue;
             }
 
@@ -1332,6 +1546,9 @@ public:
                 sealEntry(EntryTypePtr(value), false);
             }
         }
+        
+        ///The slabs that no restored entry references would never be reused: remove them
+        getSlabAllocator()->removeUnregisteredSlabs();
     }
 
 private:
@@ -1349,8 +1566,8 @@ private:
         if ( memoryCached != _memoryCache.end() ) {
             ///we found something with a matching hash key. There may be several entries linked to
              ///this key, we need to find one with matching params
-            std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
-            for (typename std::list<EntryTypePtr>::const_iterator it = ret.begin(); it != ret.end(); ++it) {
+            CacheEntriesList & ret = getValueFromIterator(memoryCached);
+            for (typename CacheEntriesList::const_iterator it = ret.begin(); it != ret.end(); ++it) {
                 if ((*it)->getKey() == key) {
                     returnValue->push_back(*it);
                     
@@ -1374,35 +1591,39 @@ private:
             } else {
                 /*we found something with a matching hash key. There may be several entries linked to
                  this key, we need to find one with matching values(operator ==)*/
-                std::list<EntryTypePtr> & ret = getValueFromIterator(diskCached);
+                CacheEntriesList & ret = getValueFromIterator(diskCached);
                 
-                for (typename std::list<EntryTypePtr>::iterator it = ret.begin();
+                for (typename CacheEntriesList::iterator it = ret.begin();
                      it != ret.end(); ++it) {
                     if ((*it)->getKey() == key) {
                         /*If we found 1 entry in the list that has exactly the same key params,
                          we re-open the mapping to the RAM put the entry
                          back into the memoryCache.*/
                         
+                        ///Remove the entry from the disk cache before inserting anything in the caches:
+                        ///inserting may invalidate the references to the values of the containers
+                        EntryTypePtr entry = *it;
+                        ret.erase(it);
                         if ( ret.empty() ) {
                             _diskCache.erase(diskCached);
                         }
                         
                         try {
-                            (*it)->reOpenFileMapping();
+                            entry->reOpenFileMapping();
                         } catch (const std::exception & e) {
                             qDebug() << "Error while reopening cache file: " << e.what();
-                            ret.erase(it);
+                            unindexEntry(entry);
                             
                             return false;
                         } catch (...) {
                             qDebug() << "Error while reopening cache file";
-                            ret.erase(it);
+                            unindexEntry(entry);
                             
                             return false;
                         }
                         
                         //put it back into the RAM
-                        _memoryCache.insert((*it)->getHashKey(),*it);
+                        _memoryCache.insert(entry->getHashKey(),entry);
                         
                         U64 memoryCacheSize,maximumInMemorySize;
                         {
@@ -1429,8 +1650,7 @@ private:
 
                         }
                         
-                        returnValue->push_back(*it);
-                        ret.erase(it);
+                        returnValue->push_back(entry);
                         ///Q_EMIT te added signal otherwise when first reading something that's already cached
                         ///the timeline wouldn't update
                         if (_signalEmitter) {
@@ -1456,6 +1676,8 @@ private:
         assert( !_lock.tryLock() );   // must be locked
         typename EntryType::hash_type hash = entry->getHashKey();
         
+        ++_treeVersionIndex[entry->getKey().getTreeVersion()][hash];
+        
         if (inMemory) {
             
             /*if the entry doesn't exist on the memory cache,make a new list and insert it*/
@@ -1520,7 +1742,7 @@ private:
                     ///Erase the file from the disk if we reach the limit.
                     //evictedFromDisk.second->scheduleForDestruction();
                     
-                    
+                    unindexEntry(evictedFromDisk.second);
                     entriesToBeDeleted.push_back(evictedFromDisk.second);
                 }
                 {
@@ -1539,11 +1761,64 @@ private:
                 getValueFromIterator(existingDiskCacheEntry).push_back(evicted.second);
             }
         } else {
+            unindexEntry(evicted.second);
             entriesToBeDeleted.push_back(evicted.second);
         }
 
         return true;
     }
+    
+    /**
+     * @brief Removes from the tree version index an entry which is no longer in the memory nor the disk portion.
+     **/
+    void unindexEntry(const EntryTypePtr & entry) const
+    {
+        assert( !_lock.tryLock() );   // must be locked
+        typename TreeVersionIndex::iterator found = _treeVersionIndex.find( entry->getKey().getTreeVersion() );
+        if ( found == _treeVersionIndex.end() ) {
+            return;
+        }
+        typename IndexedHashes::iterator foundHash = found->second.find( entry->getHashKey() );
+        if ( foundHash == found->second.end() ) {
+            return;
+        }
+        if (--foundHash->second == 0) {
+            found->second.erase(foundHash);
+            if ( found->second.empty() ) {
+                _treeVersionIndex.erase(found);
+            }
+        }
+    }
+    
+    /**
+     * @brief Moves to toDelete the entries of the container under the given hash key which have the given tree version.
+     * Returns the number of entries moved.
+     **/
+    static unsigned int takeEntriesWithTreeVersion(CacheContainer & container,
+                                                   hash_type hash,
+                                                   U64 treeVersion,
+                                                   std::list<EntryTypePtr>* toDelete)
+    {
+        CacheIterator found = container(hash);
+        if ( found == container.end() ) {
+            return 0;
+        }
+        unsigned int ret = 0;
+        CacheEntriesList & entries = getValueFromIterator(found);
+        for (typename CacheEntriesList::iterator it = entries.begin(); it != entries.end();) {
+            if ( (*it)->getKey().getTreeVersion() == treeVersion ) {
+                toDelete->push_back(*it);
+                it = entries.erase(it);
+                ++ret;
+            } else {
+                ++it;
+            }
+        }
+        if ( entries.empty() ) {
+            container.erase(found);
+        }
+        return ret;
+    }
 };
 }
 
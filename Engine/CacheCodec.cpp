@@ -0,0 +1,683 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include "CacheCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QByteArray>
+#include <QMutex>
+#include <QtConcurrentMap>
+
+#include "Engine/Timer.h"
+
+///The number of decoded bytes of a tile. Tiles are encoded and decoded in parallel.
+///This must be a multiple of 4 so that a tile always contains whole elements.
+#define NATRON_CACHE_CODEC_TILE_SIZE (512 * 1024)
+
+///"NCCD" little-endian
+#define NATRON_CACHE_CODEC_MAGIC 0x4443434e
+
+using namespace Natron;
+
+namespace {
+
+enum HeaderFlagsEnum
+{
+    eHeaderFlagHalf = 0x1 //< the buffer contained floats which were stored as half floats
+};
+
+enum TileFlagsEnum
+{
+    eTileFlagCompressed = 0x1 //< otherwise the shuffled bytes are stored as is
+};
+
+struct EncodedHeader
+{
+    U32 magic;
+    U32 codec;
+    U32 elementSize; //< the size of the stored elements, 2 if eHeaderFlagHalf is set
+    U32 flags;
+    U64 decodedSize;
+    U32 tileSize; //< the decoded size of all tiles but the last one
+    U32 nTiles;
+};
+
+struct TileHeader
+{
+    U32 encodedSize;
+    U32 flags;
+};
+
+QMutex gStatsMutex;
+CacheCodecStats gStats;
+
+////////////////////////////////////////////////////////////////////////// half floats
+
+U16
+floatToHalf(float f)
+{
+    U32 x;
+    std::memcpy( &x, &f, sizeof(float) );
+    U32 sign = (x >> 16) & 0x8000;
+    U32 biasedExp = (x >> 23) & 0xff;
+    U32 mant = x & 0x7fffff;
+
+    if (biasedExp == 0xff) {
+        ///infinity or NaN
+        return (U16)( sign | 0x7c00 | (mant ? 0x200 : 0) );
+    }
+    int exp = (int)biasedExp - 127 + 15;
+    if (exp >= 31) {
+        return (U16)(sign | 0x7c00);
+    }
+    if (exp <= 0) {
+        ///denormalized half
+        if (exp < -10) {
+            return (U16)sign;
+        }
+        mant |= 0x800000;
+        int shift = 14 - exp;
+        U32 h = mant >> shift;
+        U32 rem = mant & ( (1u << shift) - 1 );
+        U32 halfway = 1u << (shift - 1);
+        if ( (rem > halfway) || ( (rem == halfway) && (h & 1) ) ) {
+            ++h;
+        }
+
+        return (U16)(sign | h);
+    }
+    U32 h = ( (U32)exp << 10 ) | (mant >> 13);
+    U32 rem = mant & 0x1fff;
+    ///round to nearest even, a carry in the exponent correctly rounds to infinity
+    if ( (rem > 0x1000) || ( (rem == 0x1000) && (h & 1) ) ) {
+        ++h;
+    }
+
+    return (U16)(sign | h);
+}
+
+float
+halfToFloat(U16 h)
+{
+    U32 sign = (U32)(h & 0x8000) << 16;
+    U32 exp = (h >> 10) & 0x1f;
+    U32 mant = h & 0x3ff;
+    U32 x;
+
+    if (exp == 0) {
+        if (mant == 0) {
+            x = sign;
+        } else {
+            ///denormalized half, normalize it
+            exp = 127 - 15 + 1;
+            while ( !(mant & 0x400) ) {
+                mant <<= 1;
+                --exp;
+            }
+            mant &= 0x3ff;
+            x = sign | (exp << 23) | (mant << 13);
+        }
+    } else if (exp == 31) {
+        x = sign | 0x7f800000 | (mant << 13);
+    } else {
+        x = sign | ( (exp + 127 - 15) << 23 ) | (mant << 13);
+    }
+    float f;
+    std::memcpy( &f, &x, sizeof(float) );
+
+    return f;
+}
+
+////////////////////////////////////////////////////////////////////////// byte shuffling
+
+///Gathers the i-th byte of every element together
+void
+shuffleBytes(const unsigned char* src,
+             std::size_t size,
+             int elementSize,
+             unsigned char* dst)
+{
+    std::size_t nElements = size / elementSize;
+
+    for (int b = 0; b < elementSize; ++b) {
+        unsigned char* out = dst + b * nElements;
+        const unsigned char* in = src + b;
+        for (std::size_t i = 0; i < nElements; ++i, in += elementSize) {
+            out[i] = *in;
+        }
+    }
+    ///The trailing bytes that do not make a whole element are copied as is
+    std::size_t tail = nElements * elementSize;
+    std::memcpy(dst + tail, src + tail, size - tail);
+}
+
+void
+unshuffleBytes(const unsigned char* src,
+               std::size_t size,
+               int elementSize,
+               unsigned char* dst)
+{
+    std::size_t nElements = size / elementSize;
+
+    for (int b = 0; b < elementSize; ++b) {
+        const unsigned char* in = src + b * nElements;
+        unsigned char* out = dst + b;
+        for (std::size_t i = 0; i < nElements; ++i, out += elementSize) {
+            *out = in[i];
+        }
+    }
+    std::size_t tail = nElements * elementSize;
+    std::memcpy(dst + tail, src + tail, size - tail);
+}
+
+////////////////////////////////////////////////////////////////////////// tiles
+
+struct EncodeTileJob
+{
+    const unsigned char* src;
+    std::size_t size; //< decoded size of the tile
+    CacheCodecEnum codec;
+    int elementSize; //< of the source
+    bool floatToHalf;
+    std::vector<unsigned char> encoded;
+    U32 flags;
+};
+
+void
+encodeTile(EncodeTileJob & job)
+{
+    ///Convert and shuffle to a staging buffer
+    std::vector<unsigned char> stage;
+    const unsigned char* src = job.src;
+    std::size_t size = job.size;
+    int elementSize = job.elementSize;
+    std::vector<U16> halves;
+
+    if (job.floatToHalf) {
+        std::size_t nFloats = size / sizeof(float);
+        halves.resize(nFloats);
+        const float* floats = (const float*)src;
+        for (std::size_t i = 0; i < nFloats; ++i) {
+            float f;
+            std::memcpy( &f, floats + i, sizeof(float) );
+            halves[i] = floatToHalf(f);
+        }
+        src = (const unsigned char*)&halves.front();
+        size = nFloats * sizeof(U16);
+        elementSize = sizeof(U16);
+    }
+    stage.resize(size);
+    if (elementSize > 1) {
+        shuffleBytes(src, size, elementSize, &stage.front());
+    } else {
+        std::memcpy(&stage.front(), src, size);
+    }
+
+    job.flags = 0;
+    switch (job.codec) {
+    case eCacheCodecLZ4: {
+        job.encoded.resize( CacheCodec::lz4CompressBound(size) );
+        std::size_t compressed = CacheCodec::lz4Compress(&stage.front(), size, &job.encoded.front());
+        job.encoded.resize(compressed);
+        job.flags = eTileFlagCompressed;
+        break;
+    }
+    case eCacheCodecDeflate: {
+        ///Favour speed: level 1 is several times faster than the default and compresses images about as well
+        QByteArray compressed = qCompress(&stage.front(), (int)size, 1);
+        job.encoded.assign( compressed.constData(), compressed.constData() + compressed.size() );
+        job.flags = eTileFlagCompressed;
+        break;
+    }
+    case eCacheCodecNone:
+        break;
+    }
+
+    ///Noise does not compress, do not pay for decompressing it
+    if ( !(job.flags & eTileFlagCompressed) || (job.encoded.size() >= size) ) {
+        job.encoded.swap(stage);
+        job.flags = 0;
+    }
+}
+
+struct DecodeTileJob
+{
+    const unsigned char* src;
+    std::size_t encodedSize;
+    U32 flags;
+    CacheCodecEnum codec;
+    int elementSize; //< of the stored elements
+    bool halfToFloat;
+    unsigned char* dst;
+    std::size_t size; //< decoded size of the tile
+    bool ok;
+};
+
+void
+decodeTile(DecodeTileJob & job)
+{
+    std::size_t stageSize = job.halfToFloat ? (job.size / sizeof(float)) * sizeof(U16) : job.size;
+    std::vector<unsigned char> stage;
+    const unsigned char* shuffled = job.src;
+    QByteArray uncompressed;
+
+    job.ok = false;
+    if (job.flags & eTileFlagCompressed) {
+        if (job.codec == eCacheCodecLZ4) {
+            stage.resize(stageSize);
+            if ( !CacheCodec::lz4Decompress(job.src, job.encodedSize, &stage.front(), stageSize) ) {
+                return;
+            }
+            shuffled = &stage.front();
+        } else if (job.codec == eCacheCodecDeflate) {
+            uncompressed = qUncompress(job.src, (int)job.encodedSize);
+            if ( (std::size_t)uncompressed.size() != stageSize ) {
+                return;
+            }
+            shuffled = (const unsigned char*)uncompressed.constData();
+        } else {
+            return;
+        }
+    } else if (job.encodedSize != stageSize) {
+        return;
+    }
+
+    if (!job.halfToFloat) {
+        if (job.elementSize > 1) {
+            unshuffleBytes(shuffled, stageSize, job.elementSize, job.dst);
+        } else {
+            std::memcpy(job.dst, shuffled, stageSize);
+        }
+    } else {
+        std::vector<U16> halves(stageSize / sizeof(U16));
+        unshuffleBytes( shuffled, stageSize, sizeof(U16), (unsigned char*)&halves.front() );
+        for (std::size_t i = 0; i < halves.size(); ++i) {
+            float f = halfToFloat(halves[i]);
+            std::memcpy( job.dst + i * sizeof(float), &f, sizeof(float) );
+        }
+    }
+    job.ok = true;
+}
+
+////////////////////////////////////////////////////////////////////////// LZ4
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5 //< the last bytes of a block are always literals
+#define LZ4_MF_LIMIT 12 //< no match may start in the last bytes of a block
+#define LZ4_HASH_LOG 14
+#define LZ4_MAX_OFFSET 65535
+
+inline U32
+read32(const unsigned char* p)
+{
+    U32 v;
+    std::memcpy( &v, p, sizeof(U32) );
+
+    return v;
+}
+
+inline U32
+hashSequence(U32 sequence)
+{
+    return (sequence * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+inline unsigned char*
+writeLength(std::size_t length,
+            unsigned char* op)
+{
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char)length;
+
+    return op;
+}
+
+inline bool
+readLength(const unsigned char** ip,
+           const unsigned char* iend,
+           std::size_t* length)
+{
+    unsigned char b;
+    do {
+        if (*ip >= iend) {
+            return false;
+        }
+        b = *(*ip)++;
+        *length += b;
+    } while (b == 255);
+
+    return true;
+}
+
+unsigned char*
+writeLiterals(const unsigned char* anchor,
+              std::size_t nLiterals,
+              unsigned char* token,
+              unsigned char* op)
+{
+    if (nLiterals >= 15) {
+        *token = 15 << 4;
+        op = writeLength(nLiterals - 15, op);
+    } else {
+        *token = (unsigned char)(nLiterals << 4);
+    }
+    std::memcpy(op, anchor, nLiterals);
+
+    return op + nLiterals;
+}
+
+} // anon namespace
+
+namespace Natron {
+namespace CacheCodec {
+
+std::size_t
+lz4CompressBound(std::size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+std::size_t
+lz4Compress(const unsigned char* src,
+            std::size_t size,
+            unsigned char* dst)
+{
+    const unsigned char* ip = src;
+    const unsigned char* anchor = src;
+    const unsigned char* end = src + size;
+    unsigned char* op = dst;
+
+    if (size > LZ4_MF_LIMIT) {
+        std::vector<U32> table(1 << LZ4_HASH_LOG, 0);
+        const unsigned char* mfLimit = end - LZ4_MF_LIMIT;
+        const unsigned char* matchLimit = end - LZ4_LAST_LITERALS;
+        unsigned int nMisses = 0;
+
+        while (ip < mfLimit) {
+            U32 sequence = read32(ip);
+            U32 h = hashSequence(sequence);
+            const unsigned char* ref = src + table[h];
+            table[h] = (U32)(ip - src);
+            if ( (ref >= ip) || (ip - ref > LZ4_MAX_OFFSET) || (read32(ref) != sequence) ) {
+                ///Skip faster and faster through data that does not compress
+                ip += 1 + (nMisses++ >> 6);
+                continue;
+            }
+            nMisses = 0;
+
+            const unsigned char* mp = ip + LZ4_MIN_MATCH;
+            const unsigned char* rp = ref + LZ4_MIN_MATCH;
+            while (mp < matchLimit && *mp == *rp) {
+                ++mp;
+                ++rp;
+            }
+
+            unsigned char* token = op++;
+            op = writeLiterals(anchor, ip - anchor, token, op);
+
+            U32 offset = (U32)(ip - ref);
+            *op++ = (unsigned char)(offset & 0xff);
+            *op++ = (unsigned char)(offset >> 8);
+
+            std::size_t matchLength = mp - ip - LZ4_MIN_MATCH;
+            if (matchLength >= 15) {
+                *token |= 15;
+                op = writeLength(matchLength - 15, op);
+            } else {
+                *token |= (unsigned char)matchLength;
+            }
+
+            ip = mp;
+            anchor = ip;
+        }
+    }
+
+    ///The last sequence only has literals
+    unsigned char* token = op++;
+    op = writeLiterals(anchor, end - anchor, token, op);
+
+    return op - dst;
+}
+
+bool
+lz4Decompress(const unsigned char* src,
+              std::size_t size,
+              unsigned char* dst,
+              std::size_t dstSize)
+{
+    const unsigned char* ip = src;
+    const unsigned char* iend = src + size;
+    unsigned char* op = dst;
+    unsigned char* oend = dst + dstSize;
+
+    while (ip < iend) {
+        unsigned char token = *ip++;
+
+        std::size_t nLiterals = token >> 4;
+        if ( (nLiterals == 15) && !readLength(&ip, iend, &nLiterals) ) {
+            return false;
+        }
+        if ( ( nLiterals > (std::size_t)(iend - ip) ) || ( nLiterals > (std::size_t)(oend - op) ) ) {
+            return false;
+        }
+        std::memcpy(op, ip, nLiterals);
+        op += nLiterals;
+        ip += nLiterals;
+
+        if (ip == iend) {
+            ///This was the last sequence
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return false;
+        }
+        std::size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if ( (offset == 0) || ( offset > (std::size_t)(op - dst) ) ) {
+            return false;
+        }
+
+        std::size_t matchLength = token & 15;
+        if ( (matchLength == 15) && !readLength(&ip, iend, &matchLength) ) {
+            return false;
+        }
+        matchLength += LZ4_MIN_MATCH;
+        if ( matchLength > (std::size_t)(oend - op) ) {
+            return false;
+        }
+
+        const unsigned char* match = op - offset;
+        if (offset >= matchLength) {
+            std::memcpy(op, match, matchLength);
+        } else {
+            ///The match overlaps the output: it repeats the last offset bytes
+            for (std::size_t i = 0; i < matchLength; ++i) {
+                op[i] = match[i];
+            }
+        }
+        op += matchLength;
+    }
+
+    return op == oend;
+}
+
+void
+encode(const void* src,
+       std::size_t size,
+       CacheCodecEnum codec,
+       int elementSize,
+       bool floatToHalf,
+       std::vector<char>* encoded)
+{
+    TimeLapse timer;
+
+    ///Half floats need whole floats
+    floatToHalf = floatToHalf && (elementSize == sizeof(float)) && (size % sizeof(float) == 0);
+
+    std::size_t nTiles = (size + NATRON_CACHE_CODEC_TILE_SIZE - 1) / NATRON_CACHE_CODEC_TILE_SIZE;
+    std::vector<EncodeTileJob> jobs(nTiles);
+    for (std::size_t i = 0; i < nTiles; ++i) {
+        jobs[i].src = (const unsigned char*)src + i * NATRON_CACHE_CODEC_TILE_SIZE;
+        jobs[i].size = std::min( (std::size_t)NATRON_CACHE_CODEC_TILE_SIZE, size - i * NATRON_CACHE_CODEC_TILE_SIZE );
+        jobs[i].codec = codec;
+        jobs[i].elementSize = std::max(1, elementSize);
+        jobs[i].floatToHalf = floatToHalf;
+        jobs[i].flags = 0;
+    }
+    if (nTiles > 1) {
+        QtConcurrent::blockingMap(jobs, encodeTile);
+    } else if (nTiles == 1) {
+        encodeTile(jobs[0]);
+    }
+
+    EncodedHeader header;
+    header.magic = NATRON_CACHE_CODEC_MAGIC;
+    header.codec = (U32)codec;
+    header.elementSize = floatToHalf ? sizeof(U16) : std::max(1, elementSize);
+    header.flags = floatToHalf ? eHeaderFlagHalf : 0;
+    header.decodedSize = size;
+    header.tileSize = NATRON_CACHE_CODEC_TILE_SIZE;
+    header.nTiles = (U32)nTiles;
+
+    std::size_t totalSize = sizeof(EncodedHeader) + nTiles * sizeof(TileHeader);
+    for (std::size_t i = 0; i < nTiles; ++i) {
+        totalSize += jobs[i].encoded.size();
+    }
+    encoded->resize(totalSize);
+
+    char* out = &encoded->front();
+    std::memcpy( out, &header, sizeof(EncodedHeader) );
+    out += sizeof(EncodedHeader);
+    for (std::size_t i = 0; i < nTiles; ++i) {
+        TileHeader tile;
+        tile.encodedSize = (U32)jobs[i].encoded.size();
+        tile.flags = jobs[i].flags;
+        std::memcpy( out, &tile, sizeof(TileHeader) );
+        out += sizeof(TileHeader);
+    }
+    for (std::size_t i = 0; i < nTiles; ++i) {
+        if ( !jobs[i].encoded.empty() ) {
+            std::memcpy( out, &jobs[i].encoded.front(), jobs[i].encoded.size() );
+            out += jobs[i].encoded.size();
+        }
+    }
+
+    double elapsed = timer.getTimeSinceCreation();
+    QMutexLocker k(&gStatsMutex);
+    ++gStats.nEncoded;
+    gStats.rawBytes += size;
+    gStats.encodedBytes += totalSize;
+    gStats.encodeSeconds += elapsed;
+}
+
+bool
+isEncoded(const char* data,
+          std::size_t size)
+{
+    if ( !data || (size < sizeof(EncodedHeader)) ) {
+        return false;
+    }
+    EncodedHeader header;
+    std::memcpy( &header, data, sizeof(EncodedHeader) );
+
+    return header.magic == NATRON_CACHE_CODEC_MAGIC;
+}
+
+std::size_t
+getDecodedSize(const char* data,
+               std::size_t size)
+{
+    if ( !isEncoded(data, size) ) {
+        return 0;
+    }
+    EncodedHeader header;
+    std::memcpy( &header, data, sizeof(EncodedHeader) );
+
+    return (std::size_t)header.decodedSize;
+}
+
+bool
+decode(const char* data,
+       std::size_t size,
+       void* dst,
+       std::size_t dstSize)
+{
+    TimeLapse timer;
+
+    if ( !isEncoded(data, size) ) {
+        return false;
+    }
+    EncodedHeader header;
+    std::memcpy( &header, data, sizeof(EncodedHeader) );
+    if ( (header.decodedSize != dstSize) || (header.tileSize == 0) || (header.elementSize == 0) ||
+         ( (U64)header.nTiles * header.tileSize < header.decodedSize ) ||
+         ( size - sizeof(EncodedHeader) < (std::size_t)header.nTiles * sizeof(TileHeader) ) ) {
+        return false;
+    }
+
+    bool toFloat = (header.flags & eHeaderFlagHalf) != 0;
+    const char* tiles = data + sizeof(EncodedHeader);
+    const char* payload = tiles + header.nTiles * sizeof(TileHeader);
+    const char* end = data + size;
+
+    std::vector<DecodeTileJob> jobs(header.nTiles);
+    for (U32 i = 0; i < header.nTiles; ++i) {
+        TileHeader tile;
+        std::memcpy( &tile, tiles + i * sizeof(TileHeader), sizeof(TileHeader) );
+        U64 tileOffset = (U64)i * header.tileSize;
+        if ( ( tile.encodedSize > (std::size_t)(end - payload) ) || (tileOffset >= header.decodedSize) ) {
+            return false;
+        }
+        jobs[i].src = (const unsigned char*)payload;
+        jobs[i].encodedSize = tile.encodedSize;
+        jobs[i].flags = tile.flags;
+        jobs[i].codec = (CacheCodecEnum)header.codec;
+        jobs[i].elementSize = (int)header.elementSize;
+        jobs[i].halfToFloat = toFloat;
+        jobs[i].dst = (unsigned char*)dst + tileOffset;
+        jobs[i].size = (std::size_t)std::min( (U64)header.tileSize, header.decodedSize - tileOffset );
+        jobs[i].ok = false;
+        payload += tile.encodedSize;
+    }
+    if (header.nTiles > 1) {
+        QtConcurrent::blockingMap(jobs, decodeTile);
+    } else if (header.nTiles == 1) {
+        decodeTile(jobs[0]);
+    }
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        if (!jobs[i].ok) {
+            return false;
+        }
+    }
+
+    double elapsed = timer.getTimeSinceCreation();
+    QMutexLocker k(&gStatsMutex);
+    ++gStats.nDecoded;
+    gStats.decodedBytes += dstSize;
+    gStats.decodeSeconds += elapsed;
+
+    return true;
+}
+
+void
+getStats(CacheCodecStats* stats)
+{
+    QMutexLocker k(&gStatsMutex);
+    *stats = gStats;
+}
+
+} // namespace CacheCodec
+} // namespace Natron
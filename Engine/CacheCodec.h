@@ -0,0 +1,124 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_CACHECODEC_H_
+#define NATRON_ENGINE_CACHECODEC_H_
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+
+namespace Natron {
+
+/**
+ * @brief The compression applied to the cache entries when they are written to the disk portion of a cache
+ **/
+enum CacheCodecEnum
+{
+    eCacheCodecNone = 0, //< the entries are mapped as is, this is the fastest to write
+    eCacheCodecLZ4, //< LZ4 block format, decodes at several GB/s per core
+    eCacheCodecDeflate //< zlib deflate, smaller but slower to decode
+};
+
+/**
+ * @brief Accumulated statistics of all the entries encoded and decoded since the application started
+ **/
+struct CacheCodecStats
+{
+    U64 nEncoded; //< number of buffers encoded
+    U64 rawBytes; //< their size before encoding
+    U64 encodedBytes; //< their size once encoded
+    double encodeSeconds;
+    U64 nDecoded;
+    U64 decodedBytes; //< the size of the decoded buffers
+    double decodeSeconds;
+
+    CacheCodecStats()
+    : nEncoded(0)
+    , rawBytes(0)
+    , encodedBytes(0)
+    , encodeSeconds(0)
+    , nDecoded(0)
+    , decodedBytes(0)
+    , decodeSeconds(0)
+    {
+    }
+
+    double getCompressionRatio() const
+    {
+        return encodedBytes ? (double)rawBytes / encodedBytes : 1.;
+    }
+
+    ///In bytes per second
+    double getDecodeThroughput() const
+    {
+        return decodeSeconds > 0 ? decodedBytes / decodeSeconds : 0.;
+    }
+};
+
+/**
+ * @brief Encodes the buffers of cache entries stored on disk. A buffer is cut in tiles which are encoded and
+ * decoded in parallel. Before compression, the bytes of each tile are shuffled by significance (all the first bytes
+ * of the elements, then all the second bytes, ...): this is what makes floating point images compressible.
+ * Tiles that do not compress are stored as is.
+ * The encoded buffer starts with a header so that it is self-describing: decode() only needs the encoded bytes.
+ **/
+namespace CacheCodec {
+
+/**
+ * @brief Encodes size bytes from src in encoded.
+ * @param elementSize The size in bytes of a channel of a pixel (1 for bytes, 2 for shorts, 4 for floats).
+ * @param floatToHalf If true and elementSize is 4, the floats are stored as half floats. This loses precision and
+ * must only be used for buffers that are only displayed.
+ **/
+void encode(const void* src,
+            std::size_t size,
+            Natron::CacheCodecEnum codec,
+            int elementSize,
+            bool floatToHalf,
+            std::vector<char>* encoded);
+
+/**
+ * @brief Returns true if the given data starts with the header written by encode()
+ **/
+bool isEncoded(const char* data,std::size_t size);
+
+/**
+ * @brief Returns the size of the buffer that was given to encode(), or 0 if the data was not encoded
+ **/
+std::size_t getDecodedSize(const char* data,std::size_t size);
+
+/**
+ * @brief Decodes the given data to dst, which must be getDecodedSize() bytes long.
+ * Returns false if the data is corrupted.
+ **/
+bool decode(const char* data,std::size_t size,void* dst,std::size_t dstSize);
+
+void getStats(Natron::CacheCodecStats* stats);
+
+///The LZ4 block format primitives, used by encode() and decode()
+std::size_t lz4CompressBound(std::size_t size);
+
+/**
+ * @brief Compresses size bytes of src to dst, which must be at least lz4CompressBound(size) bytes long.
+ * Returns the compressed size.
+ **/
+std::size_t lz4Compress(const unsigned char* src,std::size_t size,unsigned char* dst);
+
+/**
+ * @brief Decompresses a LZ4 block to exactly dstSize bytes. Returns false if the block is corrupted.
+ **/
+bool lz4Decompress(const unsigned char* src,std::size_t size,unsigned char* dst,std::size_t dstSize);
+
+} // namespace CacheCodec
+} // namespace Natron
+
+#endif // NATRON_ENGINE_CACHECODEC_H_
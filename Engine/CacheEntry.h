@@ -19,11 +19,14 @@
 #include <iostream>
 #include <cassert>
 #include <cstdio> // for std::remove
+#include <cstring> // for memcpy
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 #include <fstream>
 #include <QtCore/QFile>
 #include <QtCore/QReadWriteLock>
+#include <QtCore/QAtomicInt>
 #include <QtCore/QDir>
 #include <QtCore/QDebug>
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
@@ -31,9 +34,11 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 #endif
+#include "Engine/CacheCodec.h"
 #include "Engine/Hash64.h"
 #include "Engine/MemoryFile.h"
 #include "Engine/NonKeyParams.h"
+#include "Engine/NumaPlacement.h"
 #include <SequenceParsing.h> // for removePath
 
 namespace Natron {
@@ -45,12 +50,14 @@ class RamBuffer
 {
     T* data;
     U64 count;
+    bool mapped; //< see NumaPlacement::allocateBuffer()
     
 public:
     
     RamBuffer()
     : data(0)
     , count(0)
+    , mapped(false)
     {
         
     }
@@ -69,6 +76,7 @@ public:
     {
         std::swap(data, other.data);
         std::swap(count, other.count);
+        std::swap(mapped, other.mapped);
     }
     
     U64 size() const
@@ -81,12 +89,9 @@ public:
         if (size == 0) {
             return;
         }
+        deallocate();
         count = size;
-        if (data) {
-            free(data);
-            data = 0;
-        }
-        data = (T*)malloc(size * sizeof(T));
+        data = (T*)NumaPlacement::allocateBuffer(size * sizeof(T), &mapped);
         if (!data) {
             throw std::bad_alloc();
         }
@@ -94,18 +99,23 @@ public:
     
     void clear()
     {
+        deallocate();
         count = 0;
-        if (data) {
-            free(data);
-            data = 0;
-        }
     }
     
     ~RamBuffer()
+    {
+        deallocate();
+    }
+    
+private:
+    
+    void deallocate()
     {
         if (data) {
-            free(data);
+            NumaPlacement::freeBuffer(data, count * sizeof(T), mapped);
             data = 0;
+            mapped = false;
         }
     }
 };
@@ -118,6 +128,10 @@ public:
  * scheme evolve in the future with other storage devices such as OpenGL textures, Cuda buffers,
  * ... etc
  *
+ * When a codec is set with setCompression(), a buffer stored on disk lives in RAM while it is allocated and
+ * is encoded to its file (or extent of a slab) when it is deallocated, instead of being a mapping of the file.
+ * The data is only encoded again if the buffer was written since it was last stored.
+ *
  * Thread safety : This class is not thread-safe but is used ONLY by the CacheEntryHelper class
  * which is itself manipulated by the Cache which is thread-safe.
  *
@@ -129,13 +143,45 @@ class Buffer
 {
 public:
 
+    /**
+     * @brief Where the encoded data of a compressed buffer is stored. It is copied under the lock of the entry so
+     * that the data can be decoded without holding the lock, see CacheEntryHelper::decodeAhead()
+     **/
+    struct StoredData
+    {
+        std::string path;
+        bool inSlab;
+        MemoryFileSlabAllocator::Extent extent;
+        std::size_t encodedSize;
+        U64 storeCount; //< changes every time the data is stored or removed
+
+        StoredData()
+        : path()
+        , inSlab(false)
+        , extent()
+        , encodedSize(0)
+        , storeCount(0)
+        {
+        }
+    };
+
 
     Buffer()
     : _path()
     , _buffer()
     , _backingFile()
+    , _slabs(NULL)
+    , _extent()
     , _storageMode(eStorageModeRAM)
+    , _codec(Natron::eCacheCodecNone)
+    , _codecElementSize(1)
+    , _codecFloatToHalf(false)
+    , _encodedSize(0)
+    , _storeCount(0)
+    , _dirty()
+    , _decodedAhead()
     {
+        _dirty = 0;
     }
     
     ~Buffer()
@@ -155,7 +201,13 @@ public:
         }
 
 
-        if (storage == Natron::eStorageModeDisk) {
+        if ( (storage == Natron::eStorageModeDisk) && (_codec != Natron::eCacheCodecNone) ) {
+            ///The file is only written when the buffer is deallocated
+            _storageMode = eStorageModeDisk;
+            _path = path;
+            _buffer.resize(count);
+            _dirty = 1;
+        } else if (storage == Natron::eStorageModeDisk) {
             _storageMode = eStorageModeDisk;
             _path = path;
             try {
@@ -181,6 +233,45 @@ public:
         }
     }
 
+    /**
+     * @brief Allocates the buffer on disk, in an extent of a slab of the given allocator rather than in a file of its own.
+     * Returns false if no extent could be allocated, in which case nothing is allocated.
+     **/
+    bool allocateInSlab(U64 count,
+                        MemoryFileSlabAllocator* slabs)
+    {
+        assert( _path.empty() && (_buffer.size() == 0) && !_backingFile );
+        if ( slabs && isCompressed(eStorageModeDisk) ) {
+            ///The extent is allocated once the size of the encoded buffer is known
+            _buffer.resize(count);
+            _storageMode = eStorageModeDisk;
+            _slabs = slabs;
+            _dirty = 1;
+
+            return true;
+        }
+        MemoryFileSlabAllocator::Extent extent;
+        if ( !slabs || !slabs->allocate(count * sizeof(DataType), &extent) ) {
+            return false;
+        }
+        std::string path = slabs->getSlabFilePath(extent.slab);
+        try {
+            _backingFile.reset( new MemoryFile(path, extent.offset, extent.size) );
+        } catch (const std::exception & e) {
+            std::cout << e.what() << std::endl;
+            _backingFile.reset();
+            slabs->free(extent);
+
+            return false;
+        }
+        _storageMode = eStorageModeDisk;
+        _path = path;
+        _slabs = slabs;
+        _extent = extent;
+
+        return true;
+    }
+
     /**
      * @brief Reallocates the internal buffer so that it countains "count" elements of the DataType.
      * Content defined in the previous portions of the buffer will be kept.
@@ -189,12 +280,13 @@ public:
      **/
     void reallocate(U64 count)
     {
-        if (_storageMode == eStorageModeRAM) {
+        if ( isInRAMBuffer() ) {
             assert(_buffer.size() > 0); // could be 0 if we allocate 0...
             _buffer.resize(count);
+            _dirty = 1;
         } else if (_storageMode == eStorageModeDisk) {
             assert(_backingFile);
-            _backingFile->resize( count * sizeof(DataType) );
+            resizeBackingFile( count * sizeof(DataType) );
         }
     }
     
@@ -203,8 +295,9 @@ public:
      **/
     void swap(Buffer& other)
     {
-        if (_storageMode == eStorageModeRAM) {
-            if (other._storageMode == eStorageModeRAM) {
+        if ( isInRAMBuffer() ) {
+            _dirty = 1;
+            if ( other.isInRAMBuffer() ) {
                 _buffer.swap(other._buffer);
             } else {
                 _buffer.resize(other._backingFile->size() / sizeof(DataType));
@@ -212,13 +305,16 @@ public:
                 char* dst = (char*)_buffer.getData();
                 memcpy(dst,src,other._backingFile->size());
             }
-        } else if (_storageMode == eStorageModeDisk) {
-            if (other._storageMode == eStorageModeDisk) {
+        } else {
+            if ( !other.isInRAMBuffer() ) {
                 assert(_backingFile);
                 _backingFile.swap(other._backingFile);
-                _path = other._path;
+                ///other now owns our backing file, it must also own its extent
+                _path.swap(other._path);
+                std::swap(_slabs, other._slabs);
+                std::swap(_extent, other._extent);
             } else {
-                _backingFile->resize(other._buffer.size() * sizeof(DataType));
+                resizeBackingFile(other._buffer.size() * sizeof(DataType));
                 const char* src = (const char*)other._buffer.getData();
                 char* dst = (char*)_backingFile->data();
                 memcpy(dst,src,other._buffer.size() * sizeof(DataType));
@@ -231,30 +327,233 @@ public:
         return _path;
     }
 
+    bool isInSlab() const
+    {
+        return _slabs != NULL;
+    }
+
+    /**
+     * @brief Sets the codec used to store the buffer on disk. This must be called before the buffer is allocated
+     * or restored.
+     * @param elementSize The size of a channel of the elements of the buffer, see CacheCodec::encode()
+     **/
+    void setCompression(Natron::CacheCodecEnum codec,
+                        int elementSize,
+                        bool floatToHalf)
+    {
+        assert( !isAllocated() );
+        _codec = codec;
+        _codecElementSize = elementSize;
+        _codecFloatToHalf = floatToHalf;
+    }
+
+    /**
+     * @brief Returns true if the buffer is encoded when it is stored on disk, in which case it is never a mapping of
+     * its file.
+     **/
+    bool isCompressed(Natron::StorageModeEnum storage) const
+    {
+        return (storage == eStorageModeDisk) && (_codec != Natron::eCacheCodecNone);
+    }
+
+    bool isCompressed() const
+    {
+        return isCompressed(_storageMode);
+    }
+
+    Natron::CacheCodecEnum getCodec() const
+    {
+        return isCompressed() ? _codec : Natron::eCacheCodecNone;
+    }
+
+    /**
+     * @brief True if the buffer keeps a file opened while it is allocated
+     **/
+    bool holdsOpenedFile() const
+    {
+        return !_slabs && !isCompressed();
+    }
+
+    /**
+     * @brief The number of bytes written on disk by the last deallocation of a compressed buffer
+     **/
+    std::size_t getEncodedSize() const
+    {
+        return _encodedSize;
+    }
+
+    const MemoryFileSlabAllocator::Extent& getSlabExtent() const
+    {
+        return _extent;
+    }
+
     void reOpenFileMapping() const
     {
         assert(!_backingFile && _storageMode == eStorageModeDisk);
+        if ( isCompressed() ) {
+            if ( _decodedAhead.size() > 0 ) {
+                _buffer.swap(_decodedAhead);
+                _decodedAhead.clear();
+            } else {
+                decodeStoredData(getStoredData(), &_buffer);
+            }
+            ///The stored data is kept as long as the buffer is only read
+            _dirty = 0;
+
+            return;
+        }
         try{
-            _backingFile.reset( new MemoryFile(_path,MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate) );
+            if (_slabs) {
+                _backingFile.reset( new MemoryFile(_path, _extent.offset, _extent.size) );
+            } else {
+                _backingFile.reset( new MemoryFile(_path,MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate) );
+            }
         } catch (const std::exception & e) {
             _backingFile.reset();
             throw std::bad_alloc();
         }
+        ///The entry is re-opened because it is about to be read
+        _backingFile->prefetch();
+    }
+
+    /**
+     * @brief Reads every page of the mapping of the backing file so that the page faults happen now
+     * rather than when the buffer is accessed. Returns the number of bytes read.
+     **/
+    std::size_t prefault() const
+    {
+        if (!_backingFile) {
+            ///A compressed buffer is decoded in RAM, see decodeAhead()
+            return 0;
+        }
+        const char* data = _backingFile->data();
+        std::size_t size = _backingFile->size();
+        const std::size_t pageSize = 4096;
+        volatile char sum = 0;
+        for (std::size_t i = 0; i < size; i += pageSize) {
+            sum += data[i];
+        }
+        (void)sum;
+
+        return size;
+    }
+
+    /**
+     * @brief Returns false if the buffer has no stored data that could be decoded ahead of reOpenFileMapping(): it is
+     * not compressed, it is allocated or it was already decoded ahead.
+     **/
+    bool getStoredDataToDecodeAhead(StoredData* stored) const
+    {
+        if ( !isCompressed() || isAllocated() || (_decodedAhead.size() > 0) || (_encodedSize == 0) ) {
+            return false;
+        }
+        *stored = getStoredData();
+
+        return true;
+    }
+
+    /**
+     * @brief Keeps the data decoded from stored, so that the following reOpenFileMapping() does not have to decode
+     * it. The data is dropped if the buffer was re-opened, stored again or removed since stored was returned by
+     * getStoredDataToDecodeAhead(). This does not change the buffer as seen by its users.
+     * Returns the number of bytes kept.
+     **/
+    std::size_t setDecodedAhead(const StoredData& stored,
+                                RamBuffer<DataType>* decoded) const
+    {
+        StoredData current;
+        if ( !getStoredDataToDecodeAhead(&current) || (current.storeCount != stored.storeCount) ) {
+            return 0;
+        }
+        _decodedAhead.swap(*decoded);
+
+        return _decodedAhead.size() * sizeof(DataType);
+    }
+
+    /**
+     * @brief Decodes the data written by storeEncodedData() to the given buffer, throws std::bad_alloc on failure
+     * like reOpenFileMapping()
+     **/
+    static void decodeStoredData(const StoredData& stored,
+                                 RamBuffer<DataType>* buffer)
+    {
+        if (stored.encodedSize == 0) {
+            throw std::bad_alloc();
+        }
+        boost::scoped_ptr<MemoryFile> file;
+        try {
+            if (stored.inSlab) {
+                if ( !stored.extent.isValid() ) {
+                    throw std::bad_alloc();
+                }
+                file.reset( new MemoryFile(stored.path, stored.extent.offset, stored.extent.size) );
+            } else {
+                file.reset( new MemoryFile(stored.path, MemoryFile::eFileOpenModeEnumIfExistsKeepElseFail) );
+            }
+        } catch (const std::exception & e) {
+            throw std::bad_alloc();
+        }
+        file->prefetch();
+        std::size_t encodedSize = std::min( stored.encodedSize, file->size() );
+        std::size_t decodedSize = Natron::CacheCodec::getDecodedSize(file->data(), encodedSize);
+        if ( (decodedSize == 0) || (decodedSize % sizeof(DataType) != 0) ) {
+            throw std::bad_alloc();
+        }
+        RamBuffer<DataType> decoded;
+        decoded.resize( decodedSize / sizeof(DataType) );
+        if ( !Natron::CacheCodec::decode(file->data(), encodedSize, decoded.getData(), decodedSize) ) {
+            throw std::bad_alloc();
+        }
+        buffer->swap(decoded);
     }
 
-    void restoreBufferFromFile(const std::string & path)
+    /**
+     * @brief Releases the data decoded by decodeAhead() if reOpenFileMapping() was not called after all
+     **/
+    void dropDecodedAhead() const
+    {
+        _decodedAhead.clear();
+    }
+
+    /**
+     * @param encodedSize For a compressed buffer, the size of the file (or extent) holding the encoded data
+     **/
+    void restoreBufferFromFile(const std::string & path,
+                               std::size_t encodedSize)
     {
         _path = path;
         _storageMode = eStorageModeDisk;
+        _encodedSize = isCompressed() ? encodedSize : 0;
+    }
+
+    void restoreBufferFromSlab(MemoryFileSlabAllocator* slabs,
+                               const MemoryFileSlabAllocator::Extent& extent)
+    {
+        _path = slabs->getSlabFilePath(extent.slab);
+        _slabs = slabs;
+        _extent = extent;
+        _storageMode = eStorageModeDisk;
+        _encodedSize = isCompressed() ? extent.size : 0;
     }
 
     void deallocate()
     {
-        if (_storageMode == eStorageModeRAM) {
+        _decodedAhead.clear();
+        if ( isCompressed() ) {
+            if ( _buffer.size() > 0 ) {
+                ///A buffer that was only read since it was re-opened keeps its stored data
+                if ( ( (int)_dirty != 0 ) || (_encodedSize == 0) ) {
+                    storeEncodedData();
+                }
+                _buffer.clear();
+                _dirty = 0;
+            }
+        } else if (_storageMode == eStorageModeRAM) {
             _buffer.clear();
         } else {
             if (_backingFile) {
-                bool flushOk = _backingFile->flush();
+                ///Only schedule the write-back, the slabs are synced all at once when the cache is saved
+                bool flushOk = _backingFile->flush(MemoryFile::eFlushTypeAsync);
                 _backingFile.reset();
                 if (!flushOk) {
                     throw std::runtime_error("Failed to flush RAM data to backing file.");
@@ -265,7 +564,36 @@ public:
 
     bool removeAnyBackingFile() const
     {
+        if ( isCompressed() ) {
+            ///The buffer does not hold its file opened, and it must not be encoded again by deallocate()
+            _buffer.clear();
+            _decodedAhead.clear();
+            _dirty = 0;
+            ++_storeCount;
+            if (_slabs) {
+                if ( _extent.isValid() ) {
+                    _slabs->free(_extent);
+                    _extent = MemoryFileSlabAllocator::Extent();
+                }
+            } else if ( !_path.empty() ) {
+                int ret_code = std::remove( _path.c_str() );
+                (void)ret_code;
+            }
+            _encodedSize = 0;
+
+            return false;
+        }
         if (_storageMode == eStorageModeDisk) {
+            if (_slabs) {
+                ///The slab file is shared with other entries, just give back the extent
+                _backingFile.reset();
+                if ( _extent.isValid() ) {
+                    _slabs->free(_extent);
+                    _extent = MemoryFileSlabAllocator::Extent();
+                }
+
+                return false;
+            }
             if (_backingFile) {
                 _backingFile->remove();
                 _backingFile.reset();
@@ -284,7 +612,7 @@ public:
      **/
     size_t size() const
     {
-        if (_storageMode == eStorageModeRAM) {
+        if ( isInRAMBuffer() ) {
             return _buffer.size() * sizeof(DataType);
         } else {
             return _backingFile ? _backingFile->size() : 0;
@@ -298,7 +626,11 @@ public:
 
     DataType* writable()
     {
-        if (_storageMode == eStorageModeDisk) {
+        ///Written data must be encoded again when the buffer is deallocated
+        if ( (int)_dirty == 0 ) {
+            _dirty = 1;
+        }
+        if ( !isInRAMBuffer() ) {
             if (_backingFile) {
                 return (DataType*)_backingFile->data();
             } else {
@@ -311,7 +643,7 @@ public:
 
     const DataType* readable() const
     {
-        if (_storageMode == eStorageModeDisk) {
+        if ( !isInRAMBuffer() ) {
             return (const DataType*)_backingFile->data();
         } else {
             return _buffer.getData();
@@ -325,13 +657,122 @@ public:
 
 private:
 
+    ///True if the data is in _buffer rather than in a mapping of the backing file
+    bool isInRAMBuffer() const
+    {
+        return _storageMode == eStorageModeRAM || isCompressed();
+    }
+
+    /**
+     * @brief Encodes _buffer to a new extent of the slabs or to the file of the buffer. Errors are not thrown since this
+     * is called on destruction: the buffer is left without stored data and will fail to be re-opened.
+     **/
+    void storeEncodedData()
+    {
+        std::vector<char> encoded;
+        Natron::CacheCodec::encode(_buffer.getData(), _buffer.size() * sizeof(DataType), _codec, _codecElementSize, _codecFloatToHalf, &encoded);
+        _encodedSize = 0;
+        ++_storeCount;
+        try {
+            if (_slabs) {
+                ///The size of the encoded data changes every time, always take a new extent
+                if ( _extent.isValid() ) {
+                    _slabs->free(_extent);
+                    _extent = MemoryFileSlabAllocator::Extent();
+                }
+                MemoryFileSlabAllocator::Extent extent;
+                if ( !_slabs->allocate(encoded.size(), &extent) ) {
+                    throw std::runtime_error("Failed to allocate disk space for the cache entry");
+                }
+                try {
+                    MemoryFile file(_slabs->getSlabFilePath(extent.slab), extent.offset, extent.size);
+                    memcpy( file.data(), &encoded.front(), encoded.size() );
+                    file.flush(MemoryFile::eFlushTypeAsync);
+                } catch (...) {
+                    _slabs->free(extent);
+                    throw;
+                }
+                _extent = extent;
+                _path = _slabs->getSlabFilePath(extent.slab);
+            } else {
+                MemoryFile file(_path, MemoryFile::eFileOpenModeEnumIfExistsTruncateElseCreate);
+                file.resize( encoded.size() );
+                memcpy( file.data(), &encoded.front(), encoded.size() );
+                file.flush(MemoryFile::eFlushTypeAsync);
+            }
+        } catch (const std::exception & e) {
+            qDebug() << "Failed to write compressed cache entry:" << e.what();
+
+            return;
+        }
+        _encodedSize = encoded.size();
+    }
+
+    StoredData getStoredData() const
+    {
+        StoredData ret;
+        ret.path = _path;
+        ret.inSlab = _slabs != NULL;
+        ret.extent = _extent;
+        ret.encodedSize = _encodedSize;
+        ret.storeCount = _storeCount;
+
+        return ret;
+    }
+
+    /**
+     * @brief Resizes the backing file to the given number of bytes, keeping its content.
+     * An extent of a slab cannot grow in place: the data is moved to a new extent.
+     **/
+    void resizeBackingFile(size_t size)
+    {
+        if (!_slabs) {
+            _backingFile->resize(size);
+
+            return;
+        }
+        MemoryFileSlabAllocator::Extent extent;
+        if ( !_slabs->allocate(size, &extent) ) {
+            throw std::bad_alloc();
+        }
+        boost::scoped_ptr<MemoryFile> file;
+        try {
+            file.reset( new MemoryFile(_slabs->getSlabFilePath(extent.slab), extent.offset, extent.size) );
+        } catch (const std::exception & e) {
+            _slabs->free(extent);
+            throw std::bad_alloc();
+        }
+        if (_backingFile) {
+            memcpy( file->data(), _backingFile->data(), std::min( size, _backingFile->size() ) );
+        }
+        _backingFile.swap(file);
+        file.reset();
+        _slabs->free(_extent);
+        _extent = extent;
+        _path = _slabs->getSlabFilePath(extent.slab);
+    }
+
     std::string _path;
-    RamBuffer<DataType> _buffer;
+
+    ///mutable so that reOpenFileMapping() can decode a compressed buffer
+    mutable RamBuffer<DataType> _buffer;
 
     /*mutable so the reOpenFileMapping function can reopen the mmaped file. It doesn't
        change the underlying data*/
     mutable boost::scoped_ptr<MemoryFile> _backingFile;
+
+    ///When not NULL, the buffer is stored in an extent of a slab of this allocator instead of a file of its own
+    MemoryFileSlabAllocator* _slabs;
+    mutable MemoryFileSlabAllocator::Extent _extent;
     Natron::StorageModeEnum _storageMode;
+
+    Natron::CacheCodecEnum _codec;
+    int _codecElementSize;
+    bool _codecFloatToHalf;
+    mutable std::size_t _encodedSize;
+    mutable U64 _storeCount; //< see StoredData
+    mutable QAtomicInt _dirty; //< the buffer was written since it was allocated or re-opened, see writable()
+    mutable RamBuffer<DataType> _decodedAhead; //< see setDecodedAhead()
 };
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -352,8 +793,9 @@ public:
 
     /**
      * @brief To be called by a CacheEntry on allocation.
+     * @param openedFile True if the entry holds a file opened for its own use
      **/
-    virtual void notifyEntryAllocated(int time, size_t size, Natron::StorageModeEnum storage) const = 0;
+    virtual void notifyEntryAllocated(int time, size_t size, Natron::StorageModeEnum storage, bool openedFile) const = 0;
 
     /**
      * @brief To be called by a CacheEntry on destruction.
@@ -373,9 +815,24 @@ public:
     /**
      * @brief To be called whenever an entry is deallocated from memory and put back on disk or whenever
      * it is reallocated in the RAM.
+     * @param size The size of the entry in RAM
+     * @param diskSize The size of the entry on disk, which is smaller than size if the entry is compressed
+     * @param openedFile True if the entry opens a file for its own use when it is in RAM
      **/
     virtual void notifyEntryStorageChanged(Natron::StorageModeEnum oldStorage,Natron::StorageModeEnum newStorage,
-                                           int time,size_t size) const = 0;
+                                           int time,size_t size,size_t diskSize,bool openedFile) const = 0;
+    
+    /**
+     * @brief Returns the allocator packing the entries stored on disk in a few large files, or NULL
+     * if each entry should have a file of its own.
+     **/
+    virtual MemoryFileSlabAllocator* getSlabAllocator() const = 0;
+
+    /**
+     * @brief Returns how the entries should be encoded when they are stored on disk
+     * @param floatToHalf If true, floating point entries may be stored as half floats
+     **/
+    virtual void getCompression(Natron::CacheCodecEnum* codec,bool* floatToHalf) const = 0;
     
     
 #ifdef DEBUG
@@ -558,15 +1015,20 @@ public:
         }
         
         if (_cache) {
-            _cache->notifyEntryAllocated( getTime(),size(),_data.getStorageMode() );
+            _cache->notifyEntryAllocated( getTime(),size(),_data.getStorageMode(), _data.holdsOpenedFile() );
         }
     }
     
     /**
      * @brief To be called for disk-cached entries when restoring them from a file.
      * The file-path will be the one passed to the constructor
+     * @param size The size of the entry on disk
+     * @param extent If valid, the entry is stored in this extent of a slab of the cache, which must have been reserved
+     * @param codec The codec the entry was encoded with when it was stored
      **/
-    void restoreMetaDataFromFile(std::size_t size)
+    void restoreMetaDataFromFile(std::size_t size,
+                                 const MemoryFileSlabAllocator::Extent& extent = MemoryFileSlabAllocator::Extent(),
+                                 Natron::CacheCodecEnum codec = Natron::eCacheCodecNone)
     {
         if (!_cache || _requestedStorage != Natron::eStorageModeDisk) {
             return;
@@ -577,17 +1039,31 @@ public:
         {
             QWriteLocker k(&_entryLock);
             
-            restoreBufferFromFile(_requestedPath);
+            setCompression(codec);
+            if ( extent.isValid() ) {
+                _data.restoreBufferFromSlab(_cache->getSlabAllocator(), extent);
+            } else {
+                restoreBufferFromFile(_requestedPath, size);
+            }
             
             onMemoryAllocated(true);
 
         }
         
         if (_cache) {
-            _cache->notifyEntryStorageChanged(Natron::eStorageModeNone, Natron::eStorageModeDisk, getTime(),size);
+            _cache->notifyEntryStorageChanged(Natron::eStorageModeNone, Natron::eStorageModeDisk, getTime(),size, size, _data.holdsOpenedFile());
         }
     }
 
+    /**
+     * @brief Returns the size in bytes of a channel of the elements of the buffer, which the codec uses to make
+     * the data more compressible.
+     **/
+    virtual int getCompressionElementSize() const
+    {
+        return sizeof(DataType);
+    }
+
     /**
      * @brief Called right away once the buffer is allocated. Used in debug mode to initialize image with a default color.
      * @param diskRestoration If true, this is called by restoreMetaDataFromFile() and the memory is in fact not allocated, this should
@@ -606,6 +1082,34 @@ public:
     const std::string& getFilePath() const {
         return _data.getFilePath();
     }
+    
+    /**
+     * @brief If the entry is stored in a slab of the cache, returns its extent, otherwise returns an invalid extent.
+     **/
+    const MemoryFileSlabAllocator::Extent& getSlabExtent() const {
+        return _data.getSlabExtent();
+    }
+
+    /**
+     * @brief Returns the codec of the entry when it is stored on disk
+     **/
+    Natron::CacheCodecEnum getCodec() const
+    {
+        return _data.getCodec();
+    }
+
+    /**
+     * @brief Returns the size of the entry on disk, this is the size of the encoded data for a compressed entry
+     * and its size in RAM otherwise.
+     **/
+    std::size_t getDiskSize() const
+    {
+        if ( _data.isCompressed() ) {
+            return _data.getEncodedSize();
+        }
+
+        return _params->getElementsCount() * sizeof(DataType);
+    }
 
     typename AbstractCacheEntry<KeyType>::hash_type getHashKey() const OVERRIDE FINAL
     {
@@ -649,15 +1153,59 @@ public:
      **/
     void reOpenFileMapping() const
     {
+        std::size_t diskSize = getDiskSize();
         {
             QWriteLocker k(&_entryLock);
             _data.reOpenFileMapping();
         }
         if (_cache) {
-            _cache->notifyEntryStorageChanged( Natron::eStorageModeDisk, Natron::eStorageModeRAM,getTime(), size() );
+            _cache->notifyEntryStorageChanged( Natron::eStorageModeDisk, Natron::eStorageModeRAM,getTime(), size(), diskSize, _data.holdsOpenedFile() );
         }
     }
 
+    /**
+     * @brief For a compressed entry stored on disk, decodes its data without making it available yet, so that the
+     * following reOpenFileMapping() is immediate. This is used to decode the entries out of the cache lock.
+     * Returns the number of bytes decoded.
+     **/
+    std::size_t decodeAhead() const
+    {
+        typename Buffer<DataType>::StoredData stored;
+        {
+            QReadLocker k(&_entryLock);
+            if ( !_data.getStoredDataToDecodeAhead(&stored) ) {
+                return 0;
+            }
+        }
+        ///The data is decoded without holding the lock, then handed over to the buffer if it did not change meanwhile
+        RamBuffer<DataType> decoded;
+        try {
+            Buffer<DataType>::decodeStoredData(stored, &decoded);
+        } catch (const std::exception & e) {
+            return 0;
+        }
+        QWriteLocker k(&_entryLock);
+
+        return _data.setDecodedAhead(stored, &decoded);
+    }
+
+    void dropDecodedAhead() const
+    {
+        QWriteLocker k(&_entryLock);
+        _data.dropDecodedAhead();
+    }
+
+    /**
+     * @brief Reads the pages of an entry whose file mapping was re-opened so that the data is in RAM
+     * before it is accessed. The entry cannot be deallocated meanwhile.
+     * Returns the number of bytes read.
+     **/
+    std::size_t prefault() const
+    {
+        QReadLocker k(&_entryLock);
+        return _data.prefault();
+    }
+
     /**
      * @brief Can be called several times without harm
      **/
@@ -674,7 +1222,7 @@ public:
         if (_cache) {
             if ( isStoredOnDisk() ) {
                 if (dataAllocated) {
-                    _cache->notifyEntryStorageChanged( Natron::eStorageModeRAM, Natron::eStorageModeDisk, time, sz );
+                    _cache->notifyEntryStorageChanged( Natron::eStorageModeRAM, Natron::eStorageModeDisk, time, sz, getDiskSize(), _data.holdsOpenedFile() );
                 }
             } else {
                 if (dataAllocated) {
@@ -730,6 +1278,7 @@ public:
         }
         
         bool isAlloc = _data.isAllocated();
+        std::size_t diskSize = getDiskSize();
         bool hasRemovedFile;
         {
             QWriteLocker k(&_entryLock);
@@ -743,7 +1292,7 @@ public:
             _cache->notifyEntryDestroyed(getTime(), _params->getElementsCount() * sizeof(DataType),Natron::eStorageModeRAM);
         } else {
             ///size() will return 0 at this point, we have to recompute it
-            _cache->notifyEntryDestroyed(getTime(), _params->getElementsCount() * sizeof(DataType),Natron::eStorageModeDisk);
+            _cache->notifyEntryDestroyed(getTime(), diskSize, Natron::eStorageModeDisk);
         }
     }
     
@@ -810,6 +1359,18 @@ private:
         
         if (storage == Natron::eStorageModeDisk) {
             
+            if (_cache) {
+                Natron::CacheCodecEnum codec;
+                bool floatToHalf;
+                _cache->getCompression(&codec, &floatToHalf);
+                setCompression(codec);
+            }
+            
+            ///Pack the entry in a slab of the cache rather than creating a file for it
+            if ( _cache && _data.allocateInSlab( count, _cache->getSlabAllocator() ) ) {
+                return;
+            }
+            
             typename AbstractCacheEntry<KeyType>::hash_type hashKey = getHashKey();
             try {
                 fileName = generateStringFromHash(path,hashKey);
@@ -845,16 +1406,27 @@ private:
      * We must ensure that this function is called ONLY by allocateMemory(), that's why
      * it is private.
      **/
-    void restoreBufferFromFile(const std::string & path)
+    void restoreBufferFromFile(const std::string & path,
+                               std::size_t size)
     {
         
         if (!fileExists(path)) {
             throw std::runtime_error("Cache restore, no such file: " + path);
         }
-        _data.restoreBufferFromFile(path);
+        _data.restoreBufferFromFile(path, size);
        
     }
 
+    void setCompression(Natron::CacheCodecEnum codec)
+    {
+        Natron::CacheCodecEnum unused;
+        bool floatToHalf = false;
+        if (_cache) {
+            _cache->getCompression(&unused, &floatToHalf);
+        }
+        _data.setCompression( codec, getCompressionElementSize(), floatToHalf );
+    }
+
 protected:
 
     KeyType _key;
@@ -0,0 +1,423 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include "ColorOperation.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include "Engine/Image.h"
+#include "Engine/Rect.h"
+
+///The minimum number of samples of a curve resulting from the merge of 2 curves
+#define NATRON_COLOR_OPERATION_MERGED_CURVE_SIZE 1024
+
+///The maximum extension of the domain of a merged curve, in number of times the width of the domain of the first curve
+#define NATRON_COLOR_OPERATION_MAX_DOMAIN_EXTENSION 16
+
+using namespace Natron;
+
+namespace {
+
+///The values of each channel of the colours on which merged operations are validated. They go out of [0,1] since
+///curves are extrapolated and images are not clamped.
+const float kTestValues[] = { -0.5f, -0.1f, 0.f, 0.02f, 0.18f, 0.35f, 0.5f, 0.8f, 1.f, 1.2f, 2.f, 4.f };
+const int kNumTestValues = sizeof(kTestValues) / sizeof(kTestValues[0]);
+
+void
+applyOperations(const std::vector<ColorOperation> & ops,
+                float* rgb)
+{
+    for (std::vector<ColorOperation>::const_iterator it = ops.begin(); it != ops.end(); ++it) {
+        it->apply(rgb);
+    }
+}
+
+struct ApplyRowsJob
+{
+    const ColorOperationChain* chain;
+    const Image::ReadAccess* src;
+    Image::WriteAccess* dst;
+    int nComps;
+    int x1, x2;
+    int y1, y2;
+};
+
+void
+applyRows(ApplyRowsJob & job)
+{
+    for (int y = job.y1; y < job.y2; ++y) {
+        const float* src = (const float*)job.src->pixelAt(job.x1, y);
+        float* dst = (float*)job.dst->pixelAt(job.x1, y);
+        assert(src && dst);
+        for (int x = job.x1; x < job.x2; ++x, src += job.nComps, dst += job.nComps) {
+            float rgb[3] = { src[0], src[1], src[2] };
+            job.chain->apply(rgb);
+            dst[0] = rgb[0];
+            dst[1] = rgb[1];
+            dst[2] = rgb[2];
+            if (job.nComps == 4) {
+                dst[3] = src[3];
+            }
+        }
+    }
+}
+
+}
+
+ColorOperation::ColorOperation()
+: _type(eTypeMatrix)
+, _domainMin(0.)
+, _domainMax(1.)
+, _curve()
+, _lutSize(0)
+, _lut()
+{
+    for (int i = 0; i < 12; ++i) {
+        _matrix[i] = (i % 5 == 0) ? 1. : 0.;
+    }
+}
+
+void
+ColorOperation::setMatrix(const double matrix[12])
+{
+    _type = eTypeMatrix;
+    std::copy(matrix, matrix + 12, _matrix);
+    _curve.clear();
+    _lut.clear();
+    _lutSize = 0;
+}
+
+void
+ColorOperation::setCurve(double domainMin,
+                         double domainMax,
+                         const std::vector<float> & samples)
+{
+    assert(_type == eTypeMatrix && domainMax > domainMin && samples.size() >= 6 && samples.size() % 3 == 0);
+    _domainMin = domainMin;
+    _domainMax = domainMax;
+    _curve = samples;
+}
+
+void
+ColorOperation::setLut3D(int size,
+                         double domainMin,
+                         double domainMax,
+                         const std::vector<float> & samples)
+{
+    assert(size >= 2 && domainMax > domainMin && samples.size() == (std::size_t)size * size * size * 3);
+    _type = eTypeLut3D;
+    _domainMin = domainMin;
+    _domainMax = domainMax;
+    _lutSize = size;
+    _lut = samples;
+    _curve.clear();
+}
+
+bool
+ColorOperation::isMatrixDiagonal() const
+{
+    for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 3; ++col) {
+            if ( (row != col) && (_matrix[row * 4 + col] != 0.) ) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool
+ColorOperation::isIdentity() const
+{
+    if ( (_type != eTypeMatrix) || hasCurve() ) {
+        return false;
+    }
+    for (int i = 0; i < 12; ++i) {
+        if ( _matrix[i] != ( (i % 5 == 0) ? 1. : 0. ) ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+double
+ColorOperation::evaluateCurve(int channel,
+                              double x) const
+{
+    int nSamples = (int)_curve.size() / 3;
+    double t = (x - _domainMin) / (_domainMax - _domainMin) * (nSamples - 1);
+    ///Out of the domain, t is extrapolated from the first or last segment
+    int i = std::max( 0, std::min(nSamples - 2, (int)std::floor(t)) );
+    double f = t - i;
+    double a = _curve[i * 3 + channel];
+    double b = _curve[(i + 1) * 3 + channel];
+
+    return a + (b - a) * f;
+}
+
+void
+ColorOperation::applyLut3D(float* rgb) const
+{
+    int idx[3];
+    double f[3];
+    for (int c = 0; c < 3; ++c) {
+        double t = (rgb[c] - _domainMin) / (_domainMax - _domainMin) * (_lutSize - 1);
+        t = std::max( 0., std::min( (double)(_lutSize - 1), t ) );
+        idx[c] = std::min(_lutSize - 2, (int)t);
+        f[c] = t - idx[c];
+    }
+    double out[3] = { 0., 0., 0. };
+    for (int corner = 0; corner < 8; ++corner) {
+        int dr = corner & 1;
+        int dg = (corner >> 1) & 1;
+        int db = (corner >> 2) & 1;
+        double w = (dr ? f[0] : 1. - f[0]) * (dg ? f[1] : 1. - f[1]) * (db ? f[2] : 1. - f[2]);
+        if (w == 0.) {
+            continue;
+        }
+        std::size_t i = ( ( (std::size_t)(idx[2] + db) * _lutSize + (idx[1] + dg) ) * _lutSize + (idx[0] + dr) ) * 3;
+        out[0] += w * _lut[i];
+        out[1] += w * _lut[i + 1];
+        out[2] += w * _lut[i + 2];
+    }
+    rgb[0] = (float)out[0];
+    rgb[1] = (float)out[1];
+    rgb[2] = (float)out[2];
+}
+
+void
+ColorOperation::apply(float* rgb) const
+{
+    if (_type == eTypeLut3D) {
+        applyLut3D(rgb);
+
+        return;
+    }
+    double in[3] = { rgb[0], rgb[1], rgb[2] };
+    for (int c = 0; c < 3; ++c) {
+        const double* row = &_matrix[c * 4];
+        double v = row[0] * in[0] + row[1] * in[1] + row[2] * in[2] + row[3];
+        if ( hasCurve() ) {
+            v = evaluateCurve(c, v);
+        }
+        rgb[c] = (float)v;
+    }
+}
+
+bool
+ColorOperation::merge(const ColorOperation & other,
+                      ColorOperation* merged) const
+{
+    if ( isIdentity() ) {
+        *merged = other;
+
+        return true;
+    }
+    if ( other.isIdentity() ) {
+        *merged = *this;
+
+        return true;
+    }
+
+    if (_type == eTypeLut3D) {
+        ///Apply other to each sample of the LUT, its input is clamped to the domain anyway
+        *merged = *this;
+        for (std::size_t i = 0; i < merged->_lut.size(); i += 3) {
+            other.apply(&merged->_lut[i]);
+        }
+
+        return true;
+    }
+
+    if (other._type == eTypeLut3D) {
+        return false;
+    }
+
+    if ( !hasCurve() ) {
+        ///other.matrix * this.matrix, the offsets being the 4th column of a 4x4 affine matrix
+        double m[12];
+        for (int row = 0; row < 3; ++row) {
+            for (int col = 0; col < 4; ++col) {
+                double v = (col == 3) ? other._matrix[row * 4 + 3] : 0.;
+                for (int k = 0; k < 3; ++k) {
+                    v += other._matrix[row * 4 + k] * _matrix[k * 4 + col];
+                }
+                m[row * 4 + col] = v;
+            }
+        }
+        *merged = other;
+        std::copy(m, m + 12, merged->_matrix);
+
+        return true;
+    }
+
+    if ( !other.isMatrixDiagonal() ) {
+        return false;
+    }
+
+    ///Both curves are per-channel: resample other's curve applied to ours.
+    ///Out of our domain our curve is linear: extend the domain until the input of other's curve is out of its domain
+    ///too, so that the merged curve is linear where the composition of both curves is.
+    double domainMin = _domainMin;
+    double domainMax = _domainMax;
+    if ( other.hasCurve() ) {
+        double width = _domainMax - _domainMin;
+        int nCurveSamples = (int)_curve.size() / 3;
+        double step = width / (nCurveSamples - 1);
+        for (int c = 0; c < 3; ++c) {
+            double gain = other._matrix[c * 5];
+            for (int end = 0; end < 2; ++end) {
+                double x0 = end ? _domainMax : _domainMin;
+                double y0 = gain * evaluateCurve(c, x0) + other._matrix[c * 4 + 3];
+                double slope = gain * ( evaluateCurve(c, x0 + step) - evaluateCurve(c, x0) ) / step;
+                if (slope == 0.) {
+                    continue;
+                }
+                for (int bound = 0; bound < 2; ++bound) {
+                    double x = x0 + ( (bound ? other._domainMax : other._domainMin) - y0 ) / slope;
+                    if (end) {
+                        domainMax = std::max( domainMax, std::min(x, _domainMax + NATRON_COLOR_OPERATION_MAX_DOMAIN_EXTENSION * width) );
+                    } else {
+                        domainMin = std::min( domainMin, std::max(x, _domainMin - NATRON_COLOR_OPERATION_MAX_DOMAIN_EXTENSION * width) );
+                    }
+                }
+            }
+        }
+    }
+
+    int nSamples = std::max( (int)_curve.size() / 3, NATRON_COLOR_OPERATION_MERGED_CURVE_SIZE );
+    nSamples = (int)( nSamples * (domainMax - domainMin) / (_domainMax - _domainMin) );
+    if ( other.hasCurve() ) {
+        ///Add a sample on each side so that the first and last segments, from which the merged curve is
+        ///extrapolated, are where the composition is linear
+        double step = (domainMax - domainMin) / (nSamples - 1);
+        domainMin -= step;
+        domainMax += step;
+        nSamples += 2;
+    }
+    std::vector<float> samples(nSamples * 3);
+    for (int i = 0; i < nSamples; ++i) {
+        double x = domainMin + (domainMax - domainMin) * i / (nSamples - 1);
+        for (int c = 0; c < 3; ++c) {
+            double v = other._matrix[c * 5] * evaluateCurve(c, x) + other._matrix[c * 4 + 3];
+            if ( other.hasCurve() ) {
+                v = other.evaluateCurve(c, v);
+            }
+            samples[i * 3 + c] = (float)v;
+        }
+    }
+    *merged = *this;
+    merged->setCurve(domainMin, domainMax, samples);
+
+    return true;
+}
+
+ColorOperationChain::ColorOperationChain(const std::list<ColorOperation> & ops,
+                                         double tolerance)
+: _ops()
+, _nConcatenated( (int)ops.size() )
+{
+    std::vector<ColorOperation> originals( ops.begin(), ops.end() );
+    ///Index in originals of the first operation merged in the last operation of _ops
+    std::size_t firstMerged = 0;
+
+    for (std::size_t i = 0; i < originals.size(); ++i) {
+        ColorOperation merged;
+        if ( !_ops.empty() && _ops.back().merge(originals[i], &merged) ) {
+            std::vector<ColorOperation> ref(originals.begin() + firstMerged, originals.begin() + i + 1);
+            std::vector<ColorOperation> fused(1, merged);
+            if (getMaxError(ref, fused) <= tolerance) {
+                _ops.back() = merged;
+                continue;
+            }
+        }
+        _ops.push_back(originals[i]);
+        firstMerged = i;
+    }
+}
+
+void
+ColorOperationChain::apply(float* rgb) const
+{
+    applyOperations(_ops, rgb);
+}
+
+double
+ColorOperationChain::getMaxError(const std::vector<ColorOperation> & ref,
+                                 const std::vector<ColorOperation> & fused)
+{
+    double maxError = 0.;
+
+    for (int r = 0; r < kNumTestValues; ++r) {
+        for (int g = 0; g < kNumTestValues; ++g) {
+            for (int b = 0; b < kNumTestValues; ++b) {
+                float expected[3] = { kTestValues[r], kTestValues[g], kTestValues[b] };
+                float actual[3] = { kTestValues[r], kTestValues[g], kTestValues[b] };
+                applyOperations(ref, expected);
+                applyOperations(fused, actual);
+                for (int c = 0; c < 3; ++c) {
+                    double error = std::fabs( (double)actual[c] - expected[c] ) / std::max( 1., std::fabs( (double)expected[c] ) );
+                    if ( !(error <= maxError) ) {
+                        ///This also catches NaNs
+                        maxError = (error == error) ? error : HUGE_VAL;
+                    }
+                }
+            }
+        }
+    }
+
+    return maxError;
+}
+
+void
+ColorOperationChain::applyToImage(const Natron::Image & src,
+                                  const RectI & roi,
+                                  Natron::Image* dst) const
+{
+    assert(src.getBitDepth() == eImageBitDepthFloat && dst->getBitDepth() == eImageBitDepthFloat);
+    assert( src.getComponentsCount() == dst->getComponentsCount() && src.getComponentsCount() >= 3 );
+
+    RectI window;
+    if ( !roi.intersect(src.getBounds(), &window) || !window.intersect(dst->getBounds(), &window) ) {
+        return;
+    }
+
+    Image::ReadAccess srcAcc = src.getReadRights();
+    Image::WriteAccess dstAcc = dst->getWriteRights();
+
+    ///Process bands of rows in parallel
+    int nBands = std::max( 1, std::min( window.height(), QThread::idealThreadCount() * 4 ) );
+    int bandHeight = (window.height() + nBands - 1) / nBands;
+    std::vector<ApplyRowsJob> jobs;
+    for (int y = window.y1; y < window.y2; y += bandHeight) {
+        ApplyRowsJob job;
+        job.chain = this;
+        job.src = &srcAcc;
+        job.dst = &dstAcc;
+        job.nComps = (int)src.getComponentsCount();
+        job.x1 = window.x1;
+        job.x2 = window.x2;
+        job.y1 = y;
+        job.y2 = std::min(y + bandHeight, window.y2);
+        jobs.push_back(job);
+    }
+    if (jobs.size() > 1) {
+        QtConcurrent::blockingMap(jobs, applyRows);
+    } else if ( !jobs.empty() ) {
+        applyRows(jobs[0]);
+    }
+}
@@ -0,0 +1,174 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_COLOROPERATION_H_
+#define NATRON_ENGINE_COLOROPERATION_H_
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include <list>
+#include <vector>
+
+///The error allowed when colour operations are fused, relative to the magnitude of the colour when it is above 1.
+///This is below the quantization step of a 10-bit display.
+#define NATRON_COLOR_CONCATENATION_TOLERANCE 1e-3
+
+class RectI;
+
+namespace Natron {
+
+class Image;
+
+/**
+ * @brief The per-pixel operation a colour effect applies to the red, green and blue channels of its input.
+ * Alpha is never modified. The operation is either:
+ * - an affine 3x4 matrix (the last column is the offset) optionally followed by a per-channel curve,
+ * - or a sampled 3D LUT.
+ * This is what EffectInstance::getColorOperation() returns so that chains of colour effects can be applied in
+ * a single pass over their input, the same way transforms are concatenated.
+ **/
+class ColorOperation
+{
+public:
+
+    enum TypeEnum
+    {
+        eTypeMatrix = 0,
+        eTypeLut3D
+    };
+
+    ///Constructs the identity
+    ColorOperation();
+
+    /**
+     * @brief Makes this operation a matrix, the rows are red, green and blue: out = matrix[0..2] . in + matrix[3]
+     * The curve, if any, is removed.
+     **/
+    void setMatrix(const double matrix[12]);
+
+    /**
+     * @brief Sets the curve applied after the matrix. samples contains nSamples interleaved RGB triplets evenly
+     * spaced in [domainMin,domainMax]. The curve is linearly interpolated, and extrapolated from the slope of its
+     * first and last segments out of its domain.
+     **/
+    void setCurve(double domainMin,
+                  double domainMax,
+                  const std::vector<float> & samples);
+
+    /**
+     * @brief Makes this operation a 3D LUT of size^3 RGB triplets, red varying the fastest, evenly spaced
+     * in [domainMin,domainMax] on the 3 axes. The LUT is trilinearly interpolated, and its input is clamped
+     * to its domain.
+     **/
+    void setLut3D(int size,
+                  double domainMin,
+                  double domainMax,
+                  const std::vector<float> & samples);
+
+    TypeEnum getType() const
+    {
+        return _type;
+    }
+
+    bool hasCurve() const
+    {
+        return !_curve.empty();
+    }
+
+    ///True if the matrix does not mix channels
+    bool isMatrixDiagonal() const;
+
+    bool isIdentity() const;
+
+    const double* getMatrix() const
+    {
+        return _matrix;
+    }
+
+    void apply(float* rgb) const;
+
+    /**
+     * @brief Returns the operation doing other after this one, if it can be expressed as a single operation,
+     * i.e: matrices without curves, or curves separated by a diagonal matrix.
+     * Merging curves resamples them: the result must be validated against the 2 original operations.
+     **/
+    bool merge(const ColorOperation & other,
+               ColorOperation* merged) const;
+
+private:
+
+    double evaluateCurve(int channel,
+                         double x) const;
+
+    void applyLut3D(float* rgb) const;
+
+    TypeEnum _type;
+    double _matrix[12];
+    double _domainMin, _domainMax;
+    std::vector<float> _curve; //< interleaved RGB samples
+    int _lutSize;
+    std::vector<float> _lut; //< interleaved RGB samples
+};
+
+/**
+ * @brief A chain of colour operations, reduced to as few operations as possible. Merged operations are
+ * validated against the unfused chain on a set of test colours and only kept if the error is within the
+ * tolerance. Whatever the result, the chain is applied in a single pass over the image.
+ **/
+class ColorOperationChain
+{
+public:
+
+    /**
+     * @param ops The operations in the order they are applied, i.e: from upstream to downstream
+     * @param tolerance The maximum error allowed, relative to the magnitude of the expected value when it is above 1
+     **/
+    ColorOperationChain(const std::list<ColorOperation> & ops,
+                        double tolerance);
+
+    ///The number of operations the chain was made of
+    int getNumConcatenated() const
+    {
+        return _nConcatenated;
+    }
+
+    ///The number of operations applied to each pixel, 1 if the chain could be fused entirely
+    int getNumOperations() const
+    {
+        return (int)_ops.size();
+    }
+
+    bool isFused() const
+    {
+        return _ops.size() <= 1;
+    }
+
+    void apply(float* rgb) const;
+
+    /**
+     * @brief Applies the chain to the roi of src, which must be a float image with 3 or 4 components, and writes the
+     * result to dst which must have the same components and depth.
+     **/
+    void applyToImage(const Natron::Image & src,
+                      const RectI & roi,
+                      Natron::Image* dst) const;
+
+    /**
+     * @brief Returns the maximum error made by applying fused instead of ref on the test colours.
+     **/
+    static double getMaxError(const std::vector<ColorOperation> & ref,
+                              const std::vector<ColorOperation> & fused);
+
+private:
+
+    std::vector<ColorOperation> _ops;
+    int _nConcatenated;
+};
+} // namespace Natron
+
+#endif // NATRON_ENGINE_COLOROPERATION_H_
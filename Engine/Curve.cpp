@@ -375,6 +375,55 @@ Curve::addKeyFrame(KeyFrame key)
     return it.second;
 }
 
+void
+Curve::addKeyFrames(const std::vector<KeyFrame>& keys,
+                    std::vector<bool>* added)
+{
+    if ( keys.empty() ) {
+        return;
+    }
+    
+    QMutexLocker l(&_imp->_lock);
+    
+    bool constantInterp = (_imp->type == CurvePrivate::eCurveTypeBool) || (_imp->type == CurvePrivate::eCurveTypeString) ||
+                          ( _imp->type == CurvePrivate::eCurveTypeIntConstantInterp);
+    double minTime = keys.front().getTime();
+    double maxTime = minTime;
+    for (std::vector<KeyFrame>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        std::pair<KeyFrameSet::iterator,bool> newKey;
+        if (constantInterp) {
+            KeyFrame key = *it;
+            key.setInterpolation(Natron::eKeyframeTypeConstant);
+            newKey = addKeyFrameNoUpdate(key);
+        } else {
+            newKey = addKeyFrameNoUpdate(*it);
+        }
+        if (added) {
+            added->push_back(newKey.second);
+        }
+        minTime = std::min( minTime, newKey.first->getTime() );
+        maxTime = std::max( maxTime, newKey.first->getTime() );
+    }
+    
+    ///Refresh the derivatives of the keyframes in the range that changed as well as of their neighbours, in time order
+    KeyFrameSet::iterator it = _imp->keyFrames.lower_bound( KeyFrame(minTime, 0.) );
+    if ( it != _imp->keyFrames.begin() ) {
+        --it;
+    }
+    KeyFrameSet::iterator last = _imp->keyFrames.upper_bound( KeyFrame(maxTime, 0.) );
+    if ( last != _imp->keyFrames.end() ) {
+        ++last;
+    }
+    while (it != last) {
+        if ( (it->getInterpolation() != Natron::eKeyframeTypeBroken) && (it->getInterpolation() != Natron::eKeyframeTypeFree) &&
+             ( it->getInterpolation() != Natron::eKeyframeTypeNone) ) {
+            it = refreshDerivatives(eCurveChangedReasonDerivativesChanged, it);
+        }
+        ++it;
+    }
+    onCurveChanged();
+}
+
 std::pair<KeyFrameSet::iterator,bool> Curve::addKeyFrameNoUpdate(const KeyFrame & cp)
 {
     // PRIVATE - should not lock
@@ -193,6 +193,13 @@ public:
     ///existing key at this time.
     bool addKeyFrame(KeyFrame key);
 
+    /**
+     * @brief Same as calling addKeyFrame for each key, but the curve is locked once and the derivatives are refreshed
+     * in a single pass over the keyframes that changed.
+     * @param added[out] If not NULL, for each key, whether it was added or replaced an already existing key at its time.
+     **/
+    void addKeyFrames(const std::vector<KeyFrame>& keys,std::vector<bool>* added);
+
     void removeKeyFrameWithTime(double time);
 
     void removeKeyFrameWithIndex(int index);
@@ -15,6 +15,7 @@
 
 #include "EffectInstance.h"
 
+#include <algorithm>
 #include <map>
 #include <sstream>
 #include <QtConcurrentMap>
@@ -30,6 +31,7 @@
 #include "Engine/AppManager.h"
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/Node.h"
+#include "Engine/NumaPlacement.h"
 #include "Engine/ViewerInstance.h"
 #include "Engine/Log.h"
 #include "Engine/Image.h"
@@ -47,7 +49,9 @@
 #include "Engine/RotoContext.h"
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/Transform.h"
+#include "Engine/ColorOperation.h"
 #include "Engine/DiskCacheNode.h"
+#include "Engine/RenderProfiler.h"
 
 //#define NATRON_ALWAYS_ALLOCATE_FULL_IMAGE_BOUNDS
 
@@ -737,7 +741,9 @@ EffectInstance::setParallelRenderArgsTLS(int time,
                                          Natron::OutputEffectInstance* renderRequester,
                                          int textureIndex,
                                          const TimeLine* timeline,
-                                         bool isAnalysis)
+                                         bool isAnalysis,
+                                         Natron::RenderPriorityEnum priority,
+                                         int numaNode)
 {
     ParallelRenderArgs& args = _imp->frameRenderArgs.localData();
     args.time = time;
@@ -753,6 +759,8 @@ EffectInstance::setParallelRenderArgsTLS(int time,
     args.renderRequester = renderRequester;
     args.textureIndex = textureIndex;
     args.isAnalysis = isAnalysis;
+    args.priority = priority;
+    args.numaNode = numaNode;
     
     ++args.validArgs;
     
@@ -861,6 +869,15 @@ EffectInstance::aborted() const
                     return ret;
                 }
                 
+            } else if (args.priority == Natron::eRenderPrioritySpeculative) {
+
+                ///Speculative renders only use idle cores: back off as soon as any other render starts or the tree changed
+                bool ret = (appPTR->getRenderPriorityArbiter()->hasHigherPriorityRenders(args.priority) ||
+                            args.nodeHash != getHash() ||
+                            !getNode()->isActivated() ||
+                            (args.renderRequester && args.renderRequester->isSpeculativeRenderBeingAborted()));
+                return ret;
+
             } else {
                 ///Rendering is playback or render on disk, we rely on the flag set on the node that requested the render
                 if (args.renderRequester) {
@@ -1627,6 +1644,7 @@ EffectInstance::getImageFromCacheAndConvertIfNeeded(bool useCache,
                                                     const EffectInstance::InputImagesMap& inputImages,
                                                     boost::shared_ptr<Natron::Image>* image)
 {
+    ProfilerScope profile("cacheLookup", this);
     ImageList cachedImages;
     bool isCached = false;
     
@@ -1922,6 +1940,144 @@ EffectInstance::tryConcatenateTransforms(const RenderRoIArgs& args,
 
 }
 
+bool
+EffectInstance::tryConcatenateColorOperations(const RenderRoIArgs& args,
+                                              Natron::EffectInstance** sourceEffect,
+                                              std::list<Natron::ColorOperation>* ops)
+{
+    ///Colour operations are applied on float RGB(A) images only
+    if (args.bitdepth != eImageBitDepthFloat) {
+        return false;
+    }
+    for (std::list<Natron::ImageComponents>::const_iterator it = args.components.begin(); it != args.components.end(); ++it) {
+        if ( !it->isColorPlane() || (it->getNumComponents() < 3) ) {
+            return false;
+        }
+    }
+
+    // recursion upstream, ops are pushed from downstream to upstream
+    Natron::EffectInstance* effect = this;
+    while (effect) {
+        Natron::ColorOperation op;
+        int inputNb = -1;
+        Natron::StatusEnum stat = effect->getColorOperation_public(args.time, args.scale, args.view, &inputNb, &op);
+        if (stat != eStatusOK) {
+            break;
+        }
+        Natron::EffectInstance* input = effect->getInput(inputNb);
+        if ( input && input->getNode()->isNodeDisabled() ) {
+            input = input->getNearestNonDisabled();
+        }
+        if (!input) {
+            break;
+        }
+        ops->push_front(op);
+        *sourceEffect = input;
+        effect = input;
+    }
+
+    ///A single colour effect is cheaper to render by itself
+    if (ops->size() < 2) {
+        ops->clear();
+        *sourceEffect = 0;
+
+        return false;
+    }
+
+    return true;
+}
+
+EffectInstance::RenderRoIRetCode
+EffectInstance::renderConcatenatedColorOperations(const RenderRoIArgs& args,
+                                                  Natron::EffectInstance* sourceEffect,
+                                                  const std::list<Natron::ColorOperation>& ops,
+                                                  ImageList* outputPlanes)
+{
+    ProfilerScope profile("colorConcatenation", this);
+
+    ///The output is cached with the key of this effect, as if this effect had rendered it
+    U64 nodeHash = _imp->frameRenderArgs.localData().nodeHash;
+    bool isFrameVaryingOrAnimated = isFrameVaryingOrAnimated_Recursive();
+    bool useCache = !args.byPassCache && shouldCacheOutput(isFrameVaryingOrAnimated);
+    Natron::ImageKey key = Natron::Image::makeKey(nodeHash, isFrameVaryingOrAnimated, args.time, args.view);
+    if (useCache) {
+        ImageList cachedImages;
+        ImageList cachedPlanes;
+        if ( Natron::getImageFromCache(key, &cachedImages) ) {
+            for (std::list<Natron::ImageComponents>::const_iterator it = args.components.begin(); it != args.components.end(); ++it) {
+                for (ImageList::iterator it2 = cachedImages.begin(); it2 != cachedImages.end(); ++it2) {
+                    std::list<RectI> restToRender;
+                    (*it2)->getRestToRender(args.roi, restToRender);
+                    if ( ( (*it2)->getMipMapLevel() == args.mipMapLevel ) && ( (*it2)->getComponents() == *it ) &&
+                         ( (*it2)->getBitDepth() == eImageBitDepthFloat ) && restToRender.empty() ) {
+                        cachedPlanes.push_back(*it2);
+                        break;
+                    }
+                }
+            }
+        }
+        if ( cachedPlanes.size() == args.components.size() ) {
+            outputPlanes->insert( outputPlanes->end(), cachedPlanes.begin(), cachedPlanes.end() );
+
+            return eRenderRoIRetCodeOk;
+        }
+    }
+
+    ///A cached image with other components or bitdepth than the preferred ones of this effect would be thrown away
+    ///by the next lookup of renderRoI
+    Natron::ImageBitDepthEnum prefDepth;
+    std::list<Natron::ImageComponents> prefComps;
+    getPreferredDepthAndComponents(-1, &prefComps, &prefDepth);
+
+    Natron::ColorOperationChain chain(ops, NATRON_COLOR_CONCATENATION_TOLERANCE);
+
+    RenderRoIArgs inputArgs = args;
+    inputArgs.preComputedRoD.clear(); //< the RoD of the source might not be the same
+    ImageList inputPlanes;
+    RenderRoIRetCode ret = sourceEffect->renderRoI(inputArgs, &inputPlanes);
+    if (ret != eRenderRoIRetCodeOk) {
+        return ret;
+    }
+
+    for (ImageList::iterator it = inputPlanes.begin(); it != inputPlanes.end(); ++it) {
+        if ( ( (*it)->getBitDepth() != eImageBitDepthFloat ) || ( (*it)->getComponentsCount() < 3 ) ) {
+            return eRenderRoIRetCodeFailed;
+        }
+        RectI bounds;
+        if ( !args.roi.intersect( (*it)->getBounds(), &bounds ) ) {
+            continue;
+        }
+        ImagePtr output;
+        bool cacheOutput = useCache && (prefDepth == eImageBitDepthFloat) &&
+                           ( std::find( prefComps.begin(), prefComps.end(), (*it)->getComponents() ) != prefComps.end() );
+        if (cacheOutput) {
+            boost::shared_ptr<Natron::ImageParams> params = Natron::Image::makeParams( 0,
+                                                                                       (*it)->getRoD(),
+                                                                                       bounds,
+                                                                                       (*it)->getPixelAspectRatio(),
+                                                                                       (*it)->getMipMapLevel(),
+                                                                                       (*it)->getParams()->isRodProjectFormat(),
+                                                                                       (*it)->getComponents(),
+                                                                                       eImageBitDepthFloat,
+                                                                                       FramesNeededMap() );
+            getOrCreateFromCacheInternal(key, params, true, false, &output);
+        }
+        if (!output) {
+            output.reset( new Natron::Image( (*it)->getComponents(),
+                                             (*it)->getRoD(),
+                                             bounds,
+                                             (*it)->getMipMapLevel(),
+                                             (*it)->getPixelAspectRatio(),
+                                             eImageBitDepthFloat ) );
+        }
+        chain.applyToImage(**it, bounds, output.get());
+        output->markForRendered(bounds);
+        outputPlanes->push_back(output);
+    }
+
+    return eRenderRoIRetCodeOk;
+}
+
 class TransformReroute_RAII
 {
     EffectInstance* self;
@@ -2036,6 +2192,7 @@ EffectInstance::allocateImagePlane(const ImageKey& key,
 
 EffectInstance::RenderRoIRetCode EffectInstance::renderRoI(const RenderRoIArgs & args,ImageList* outputPlanes)
 {
+    ProfilerScope profile("renderRoI", this);
    
     //Do nothing if no components were requested
     if (args.components.empty()) {
@@ -2220,6 +2377,19 @@ EffectInstance::RenderRoIRetCode EffectInstance::renderRoI(const RenderRoIArgs &
     }
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     ////////////////////////////// End identity check ///////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ////////////////////////////// Color operations concatenation //////////////////////////////////////////////////////////
+    ///If this effect and the effects upstream are colour effects, apply their operations at once on the first non colour effect
+    if ( appPTR->getCurrentSettings()->isColorConcatenationEnabled() ) {
+        Natron::EffectInstance* colorSource = 0;
+        std::list<Natron::ColorOperation> colorOps;
+        if ( tryConcatenateColorOperations(args, &colorSource, &colorOps) ) {
+            return renderConcatenatedColorOperations(args, colorSource, colorOps, outputPlanes);
+        }
+    }
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ////////////////////////////// End color operations concatenation //////////////////////////////////////////////////////
     
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     ////////////////////////////// Handle pass-through for planes //////////////////////////////////////////////////////////
@@ -3664,8 +3834,18 @@ EffectInstance::tiledRenderingFunctor(RenderArgs & args,
                                       const boost::shared_ptr<Natron::Image>& originalInputImage,
                                       ImagePlanesToRender& planes)
 {
+    ProfilerScope profile("renderTile", this);
     
+    ///Preemption point: let the renders of a higher priority use the cores before rendering this tile
+    RenderPriorityArbiter* arbiter = appPTR->getRenderPriorityArbiter();
+    if ( arbiter->hasHigherPriorityRenders(frameArgs.priority) ) {
+        ProfilerScope preemption("preempted", this);
+        arbiter->yieldToHigherPriorities(frameArgs.priority);
+    }
     
+    ///Run the tile on the cores of the NUMA node of the frame: the pages of the images it writes first are allocated
+    ///in the memory of that node, where the tiles of the frame downstream read them
+    NumaThreadPlacement numaPlacement(appPTR->getNumaPlacement(), frameArgs.numaNode);
     
     const PlaneToRender& firstPlane = planes.planes.begin()->second;
     
@@ -4247,28 +4427,9 @@ EffectInstance::evaluate(KnobI* knob,
         }
     }
 
-    ///increments the knobs age following a change
-    if (!button && isSignificant) {
-        node->incrementKnobsAge();
-    }
-    
-    
-    int time = getCurrentTime();
-    
-    
-    std::list<ViewerInstance* > viewers;
-    node->hasViewersConnected(&viewers);
-    for (std::list<ViewerInstance* >::iterator it = viewers.begin();
-         it != viewers.end();
-         ++it) {
-        if (isSignificant) {
-            (*it)->renderCurrentFrame(true);
-        } else {
-            (*it)->redrawViewer();
-        }
-    }
-    
-    getNode()->refreshPreviewsRecursivelyDownstream(time);
+    ///increments the knobs age following a change and refresh the viewers and previews. This is done once
+    ///for all the changes made until the event loop is reached again.
+    getApp()->requestNodeEvaluation(node, !button && isSignificant, isSignificant);
 } // evaluate
 
 bool
@@ -4669,6 +4830,7 @@ Natron::StatusEnum
 EffectInstance::render_public(const RenderActionArgs& args)
 {
     NON_RECURSIVE_ACTION();
+    ProfilerScope profile("render", this);
     return render(args);
 
 }
@@ -4685,6 +4847,17 @@ EffectInstance::getTransform_public(SequenceTime time,
     return getTransform(time, renderScale, view, inputToTransform, transform);
 }
 
+Natron::StatusEnum
+EffectInstance::getColorOperation_public(SequenceTime time,
+                                         const RenderScale& renderScale,
+                                         int view,
+                                         int* inputNb,
+                                         Natron::ColorOperation* op)
+{
+    RECURSIVE_ACTION();
+    return getColorOperation(time, renderScale, view, inputNb, op);
+}
+
 bool
 EffectInstance::isIdentity_public(U64 hash,
                                   SequenceTime time,
@@ -5537,6 +5710,9 @@ EffectInstance::onKnobValueChanged_public(KnobI* k,
     if (isReader() && k->getName() == kOfxImageEffectFileParamName) {
         node->computeFrameRangeForReader(k);
     }
+    
+    ///The node must be written by the next incremental save
+    getApp()->getProject()->markNodeModified(node);
 
     
     KnobHelper* kh = dynamic_cast<KnobHelper*>(k);
@@ -5556,7 +5732,10 @@ EffectInstance::onKnobValueChanged_public(KnobI* k,
                                                  dynamic_cast<OutputEffectInstance*>(this),
                                                  0, //texture index
                                                  getApp()->getTimeLine().get(),
-                                                 true);
+                                                 true,
+                                                 Natron::eRenderPriorityInteractive,
+                                                 false, // is a frame rendered ?
+                                                 false); // is this one of the frames of a sequence rendered in parallel ?
 
         RECURSIVE_ACTION();
         knobChanged(k, reason, /*view*/ 0, time, originatedFromMainThread);
@@ -6026,10 +6205,10 @@ OutputEffectInstance::renderFullSequence(BlockingBackgroundRender* renderControl
 }
 
 void
-OutputEffectInstance::notifyRenderFinished()
+OutputEffectInstance::notifyRenderFinished(bool aborted)
 {
     if (_renderController) {
-        _renderController->notifyFinished();
+        _renderController->notifyFinished(aborted);
         _renderController = 0;
     }
 }
@@ -6078,6 +6257,12 @@ OutputEffectInstance::isSequentialRenderBeingAborted() const
     return _engine ? _engine->isSequentialRenderBeingAborted() : false;
 }
 
+bool
+OutputEffectInstance::isSpeculativeRenderBeingAborted() const
+{
+    return _engine ? _engine->isSpeculativeRenderBeingAborted() : false;
+}
+
 void
 OutputEffectInstance::setFirstFrame(int f)
 {
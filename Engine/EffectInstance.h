@@ -29,6 +29,7 @@
 #include "Engine/Rect.h"
 #include "Engine/ImageLocker.h"
 #include "Engine/ImageComponents.h"
+#include "Engine/RenderPriority.h"
 
 // Various useful plugin IDs, @see EffectInstance::getPluginID()
 #define PLUGINID_OFX_MERGE        "net.sf.openfx.MergePlugin"
@@ -66,6 +67,7 @@ class RenderEngine;
 class BufferableObject;
 namespace Natron {
 class OutputEffectInstance;
+class ColorOperation;
 }
 namespace Transform {
 struct Matrix3x3;
@@ -124,6 +126,12 @@ struct ParallelRenderArgs
     ///Was the render started in the instanceChangedAction (knobChanged)
     bool isAnalysis;
     
+    ///The priority class of the render: tiles yield the cores to the renders of a higher priority
+    Natron::RenderPriorityEnum priority;
+    
+    ///The NUMA node whose cores run the tiles of the frame, or -1 to use all cores, see NumaPlacement
+    int numaNode;
+    
     ParallelRenderArgs()
     : time(0)
     , timeline(0)
@@ -138,6 +146,8 @@ struct ParallelRenderArgs
     , renderRequester(0)
     , textureIndex(0)
     , isAnalysis(false)
+    , priority(Natron::eRenderPriorityInteractive)
+    , numaNode(-1)
     {
         
     }
@@ -588,7 +598,9 @@ public:
                                   Natron::OutputEffectInstance* renderRequested,
                                   int textureIndex,
                                   const TimeLine* timeline,
-                                  bool isAnalysis);
+                                  bool isAnalysis,
+                                  Natron::RenderPriorityEnum priority,
+                                  int numaNode);
 
     void setParallelRenderArgsTLS(const ParallelRenderArgs& args); 
 
@@ -760,7 +772,19 @@ protected:
         return Natron::eStatusReplyDefault;
     }
 
-
+    /**
+     * @brief Can be overloaded by colour effects to describe the per-pixel operation they apply to the input inputNb,
+     * so that chains of colour effects are rendered in a single pass. This must only succeed if the output of the
+     * effect is entirely described by the operation with the current parameters (e.g: no mask, mix at 1).
+     **/
+    virtual Natron::StatusEnum getColorOperation(SequenceTime /*time*/,
+                                                 const RenderScale& /*renderScale*/,
+                                                 int /*view*/,
+                                                 int* /*inputNb*/,
+                                                 Natron::ColorOperation* /*op*/) WARN_UNUSED_RETURN
+    {
+        return Natron::eStatusReplyDefault;
+    }
 
 public:
 
@@ -774,6 +798,12 @@ public:
                                            Natron::EffectInstance** inputToTransform,
                                            Transform::Matrix3x3* transform) WARN_UNUSED_RETURN;
 
+    Natron::StatusEnum getColorOperation_public(SequenceTime time,
+                                                const RenderScale& renderScale,
+                                                int view,
+                                                int* inputNb,
+                                                Natron::ColorOperation* op) WARN_UNUSED_RETURN;
+
 protected:
 /**
      * @brief Can be overloaded to indicates whether the effect is an identity, i.e it doesn't produce
@@ -1507,6 +1537,26 @@ private:
     void tryConcatenateTransforms(const RenderRoIArgs& args,
                                   std::list<InputMatrix>* inputTransforms);
 
+    /**
+     * @brief Check if this effect and the effects upstream are colour effects whose operations can be applied in
+     * a single pass.
+     * @param sourceEffect[out] The effect whose image the operations must be applied to
+     * @param ops[out] The operations, from upstream to downstream
+     * @returns True if at least 2 operations were found
+     **/
+    bool tryConcatenateColorOperations(const RenderRoIArgs& args,
+                                       Natron::EffectInstance** sourceEffect,
+                                       std::list<Natron::ColorOperation>* ops);
+
+    /**
+     * @brief Renders the image of sourceEffect and applies the concatenated colour operations to it
+     * instead of rendering the effects of the chain.
+     **/
+    RenderRoIRetCode renderConcatenatedColorOperations(const RenderRoIArgs& args,
+                                                       Natron::EffectInstance* sourceEffect,
+                                                       const std::list<Natron::ColorOperation>& ops,
+                                                       std::list<boost::shared_ptr<Image> >* outputPlanes);
+
     /**
      * @brief Called by getImage when the thread-storage was not set by the caller thread (mostly because this is a thread that is not
      * a thread controlled by Natron).
@@ -1671,6 +1721,11 @@ public:
      **/
     bool isSequentialRenderBeingAborted() const;
 
+    /**
+     * @brief Returns true if the frames prerendered by the viewer while idle are being aborted
+     **/
+    bool isSpeculativeRenderBeingAborted() const;
+
 
     /**
      * @brief Starts rendering of all the sequence available, from start to end.
@@ -1678,7 +1733,10 @@ public:
      **/
     void renderFullSequence(BlockingBackgroundRender* renderController,int first,int last);
 
-    void notifyRenderFinished();
+    /**
+     * @brief Called when the render started by renderFullSequence() is done, aborted is true if it was aborted or failed.
+     **/
+    void notifyRenderFinished(bool aborted);
 
     void renderCurrentFrame(bool canAbort);
 
@@ -61,6 +61,8 @@ SOURCES += \
     AppManager.cpp \
     BackDrop.cpp \
     BlockingBackgroundRender.cpp \
+    CacheCodec.cpp \
+    ColorOperation.cpp \
     CoonsRegularization.cpp \
     Curve.cpp \
     CurveSerialization.cpp \
@@ -97,6 +99,7 @@ SOURCES += \
     NodeSerialization.cpp \
     NodeGroupSerialization.cpp \
     NoOp.cpp \
+    NumaPlacement.cpp \
     OfxClipInstance.cpp \
     OfxHost.cpp \
     OfxImageEffectInstance.cpp \
@@ -114,6 +117,9 @@ SOURCES += \
     ProjectSerialization.cpp \
     PySideCompat.cpp \
     Rect.cpp \
+    RenderPriority.cpp \
+    RenderProfiler.cpp \
+    RenderServer.cpp \
     RotoContext.cpp \
     RotoPaint.cpp \
     RotoSerialization.cpp  \
@@ -124,6 +130,7 @@ SOURCES += \
     StringAnimationManager.cpp \
     TimeLine.cpp \
     Timer.cpp \
+    TrackScheduler.cpp \
     Transform.cpp \
     ViewerInstance.cpp \
     ../libs/SequenceParsing/SequenceParsing.cpp \
@@ -174,7 +181,9 @@ HEADERS += \
     BackDrop.h \
     BlockingBackgroundRender.h \
     Cache.h \
+    CacheCodec.h \
     CacheEntry.h \
+    ColorOperation.h \
     CoonsRegularization.h \
     Curve.h \
     CurveSerialization.h \
@@ -227,6 +236,7 @@ HEADERS += \
     NonKeyParamsSerialization.h \
     NodeSerialization.h \
     NoOp.h \
+    NumaPlacement.h \
     OfxClipInstance.h \
     OfxHost.h \
     OfxImageEffectInstance.h \
@@ -246,6 +256,9 @@ HEADERS += \
     ProjectSerialization.h \
     Pyside_Engine_Python.h \
     Rect.h \
+    RenderPriority.h \
+    RenderProfiler.h \
+    RenderServer.h \
     RotoContext.h \
     RotoContextPrivate.h \
     RotoPaint.h \
@@ -261,6 +274,7 @@ HEADERS += \
     ThreadStorage.h \
     TimeLine.h \
     Timer.h \
+    TrackScheduler.h \
     Transform.h \
     Variant.h \
     ViewerInstance.h \
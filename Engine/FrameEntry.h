@@ -56,6 +56,12 @@ public:
     {
     }
 
+    ///The textures are either 8-bit or 32-bit floating point, see FrameParams
+    virtual int getCompressionElementSize() const OVERRIDE FINAL
+    {
+        return _key.getBitDepth() != 0 ? sizeof(float) : sizeof(U8);
+    }
+
     
     static boost::shared_ptr<FrameParams> makeParams(const RectI & rod,
                                                      int bitDepth,
@@ -10,10 +10,20 @@
 #include "HistogramCPU.h"
 
 #include <algorithm>
+#include <cmath>
 #include <QMutex>
 #include <QWaitCondition>
+#include <QtConcurrentMap>
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/bind.hpp>
+#include <boost/weak_ptr.hpp>
+#endif
 
 #include "Engine/Image.h"
+#include "Engine/AppManager.h"
+
+///Histograms are first computed with this many more bins, then smoothed and downsampled
+#define HISTOGRAM_UPSCALE 5
 
 
 struct HistogramRequest
@@ -80,10 +90,42 @@ struct FinishedHistogram
     }
 };
 
+///A portion of the image whose pixels are added (weight = 1) or removed (weight = -1) from the histograms
+struct HistogramStripe
+{
+    RectI rect;
+    float weight;
+
+    HistogramStripe()
+        : rect()
+          , weight(1.f)
+    {
+    }
+
+    HistogramStripe(const RectI & rect,
+                    float weight)
+        : rect(rect)
+          , weight(weight)
+    {
+    }
+};
+
+///The bins computed by one thread for a stripe
+struct HistogramStripeResult
+{
+    std::vector<float> bins[3];
+    bool aborted;
+
+    HistogramStripeResult()
+        : aborted(false)
+    {
+    }
+};
+
 struct HistogramCPUPrivate
 {
     QWaitCondition requestCond;
-    QMutex requestMutex;
+    mutable QMutex requestMutex;
     std::list<HistogramRequest> requests;
     QMutex producedMutex;
     std::list<boost::shared_ptr<FinishedHistogram> > produced;
@@ -91,6 +133,13 @@ struct HistogramCPUPrivate
     QMutex mustQuitMutex;
     bool mustQuit;
 
+    ///The last computed histograms, before smoothing. Only accessed by the histogram thread.
+    ///If the next request is on the same image, only the pixels that entered or left the rectangle are processed.
+    boost::weak_ptr<Natron::Image> lastImage;
+    HistogramRequest lastRequest; //< with a NULL image, so that lastImage is not kept alive
+    std::vector<float> lastRawHistograms[3];
+    bool hasLastRawHistograms;
+
     HistogramCPUPrivate()
         : requestCond()
           , requestMutex()
@@ -100,8 +149,22 @@ struct HistogramCPUPrivate
           , mustQuitCond()
           , mustQuitMutex()
           , mustQuit(false)
+          , lastImage()
+          , lastRequest()
+          , lastRawHistograms()
+          , hasLastRawHistograms(false)
+    {
+    }
+
+    ///A newer request (or a request to quit) makes the current computation useless
+    bool hasPendingRequest() const
     {
+        QMutexLocker l(&requestMutex);
+
+        return !requests.empty();
     }
+
+    bool computeRawHistograms(const HistogramRequest & request,int nHistograms,std::vector<float>* raw);
 };
 
 HistogramCPU::HistogramCPU()
@@ -242,33 +305,215 @@ struct pix_lum
 
 template <float pix_func(const float*)>
 void
+addToHisto(const float* pix,
+           double vmin,
+           double vmax,
+           double binSize,
+           float weight,
+           std::vector<float> & histo)
+{
+    float v = pix_func(pix);
+    if ( (vmin <= v) && (v < vmax) ) {
+        int index = (int)( (v - vmin) / binSize );
+        assert( 0 <= index && index < (int)histo.size() );
+        histo[index] += weight;
+    }
+}
+
+///Adds the pixels of the stripe to the histograms: all histograms are computed in a single pass over the image.
+///Every few rows we check whether a newer request arrived, in which case the computation is aborted.
+template <float pix_func1(const float*), float pix_func2(const float*), float pix_func3(const float*)>
+void
 computeHisto(const HistogramRequest & request,
-             int upscale,
-             std::vector<float> *histo)
+             int nHistograms,
+             const HistogramCPUPrivate* imp,
+             const HistogramStripe & stripe,
+             HistogramStripeResult* ret)
 {
-    assert(histo);
-    histo->resize(request.binsCount * upscale);
-    std::fill(histo->begin(), histo->end(), 0.f);
-    double binSize = (request.vmax - request.vmin) / histo->size();
+    const int binsCount = request.binsCount * HISTOGRAM_UPSCALE;
+    for (int i = 0; i < nHistograms; ++i) {
+        ret->bins[i].resize(binsCount);
+        std::fill(ret->bins[i].begin(), ret->bins[i].end(), 0.f);
+    }
+    double binSize = (request.vmax - request.vmin) / binsCount;
 
     ///Images come from the viewer which is in float.
     assert(request.image->getBitDepth() == Natron::eImageBitDepthFloat);
 
     Natron::Image::ReadAccess acc = request.image->getReadRights();
+    int nComps = request.image->getComponentsCount();
     
-    for (int y = request.rect.bottom(); y < request.rect.top(); ++y) {
-        for (int x = request.rect.left(); x < request.rect.right(); ++x) {
-            const float *pix = (const float*)acc.pixelAt(x, y);
-            float v = pix_func(pix);
-            if ( (request.vmin <= v) && (v < request.vmax) ) {
-                int index = (int)( (v - request.vmin) / binSize );
-                assert( 0 <= index && index < (int)histo->size() );
-                (*histo)[index] += 1.f;
+    for (int y = stripe.rect.bottom(); y < stripe.rect.top(); ++y) {
+        if ( ( (y - stripe.rect.bottom()) % 64 == 0 ) && imp->hasPendingRequest() ) {
+            ret->aborted = true;
+
+            return;
+        }
+        const float *pix = (const float*)acc.pixelAt(stripe.rect.left(), y);
+        assert(pix);
+        for (int x = stripe.rect.left(); x < stripe.rect.right(); ++x, pix += nComps) {
+            addToHisto<pix_func1>(pix, request.vmin, request.vmax, binSize, stripe.weight, ret->bins[0]);
+            if (nHistograms > 1) {
+                addToHisto<pix_func2>(pix, request.vmin, request.vmax, binSize, stripe.weight, ret->bins[1]);
+                addToHisto<pix_func3>(pix, request.vmin, request.vmax, binSize, stripe.weight, ret->bins[2]);
             }
         }
     }
 }
 
+static HistogramStripeResult
+computeHistogramStripe(const HistogramRequest & request,
+                       int nHistograms,
+                       const HistogramCPUPrivate* imp,
+                       const HistogramStripe & stripe)
+{
+    HistogramStripeResult ret;
+
+    /// keep the mode parameter in sync with Histogram::DisplayModeEnum
+    switch (request.mode) {
+    case 0:     //< RGB
+        computeHisto<&pix_red::val, &pix_green::val, &pix_blue::val>(request, nHistograms, imp, stripe, &ret);
+        break;
+    case 1:     //< A
+        computeHisto<&pix_alpha::val, &pix_alpha::val, &pix_alpha::val>(request, nHistograms, imp, stripe, &ret);
+        break;
+    case 2:     //<Y
+        computeHisto<&pix_lum::val, &pix_lum::val, &pix_lum::val>(request, nHistograms, imp, stripe, &ret);
+        break;
+    case 3:     //< R
+        computeHisto<&pix_red::val, &pix_red::val, &pix_red::val>(request, nHistograms, imp, stripe, &ret);
+        break;
+    case 4:     //< G
+        computeHisto<&pix_green::val, &pix_green::val, &pix_green::val>(request, nHistograms, imp, stripe, &ret);
+        break;
+    case 5:     //< B
+        computeHisto<&pix_blue::val, &pix_blue::val, &pix_blue::val>(request, nHistograms, imp, stripe, &ret);
+        break;
+    default:
+        assert(false);
+        break;
+    }
+
+    return ret;
+}
+
+///Appends to ret the parts of a that are not in b
+static void
+subtractRect(const RectI & a,
+             const RectI & b,
+             std::vector<RectI>* ret)
+{
+    RectI inter;
+    if ( !a.intersect(b, &inter) ) {
+        if ( !a.isNull() ) {
+            ret->push_back(a);
+        }
+
+        return;
+    }
+    if (inter.y1 > a.y1) {
+        ret->push_back( RectI(a.x1, a.y1, a.x2, inter.y1) );
+    }
+    if (inter.y2 < a.y2) {
+        ret->push_back( RectI(a.x1, inter.y2, a.x2, a.y2) );
+    }
+    if (inter.x1 > a.x1) {
+        ret->push_back( RectI(a.x1, inter.y1, inter.x1, inter.y2) );
+    }
+    if (inter.x2 < a.x2) {
+        ret->push_back( RectI(inter.x2, inter.y1, a.x2, inter.y2) );
+    }
+}
+
+///Splits the rectangle in stripes of rows so that each thread of the pool gets a few of them
+static void
+splitInStripes(const RectI & rect,
+               float weight,
+               std::vector<HistogramStripe>* stripes)
+{
+    int nThreads = std::max(1, appPTR->getHardwareIdealThreadCount());
+    int rowsPerStripe = std::max( 16, (int)std::ceil( (double)rect.height() / (nThreads * 4) ) );
+    for (int y = rect.y1; y < rect.y2; y += rowsPerStripe) {
+        stripes->push_back( HistogramStripe(RectI( rect.x1, y, rect.x2, std::min(y + rowsPerStripe, rect.y2) ), weight) );
+    }
+}
+
+bool
+HistogramCPUPrivate::computeRawHistograms(const HistogramRequest & request,
+                                          int nHistograms,
+                                          std::vector<float>* raw)
+{
+    const int binsCount = request.binsCount * HISTOGRAM_UPSCALE;
+    std::vector<HistogramStripe> stripes;
+
+    bool incremental = hasLastRawHistograms && lastImage.lock() == request.image && lastRequest.mode == request.mode &&
+                       lastRequest.binsCount == request.binsCount && lastRequest.vmin == request.vmin && lastRequest.vmax == request.vmax;
+    if (incremental) {
+        ///Only process the pixels that entered or left the rectangle, if it's worth it
+        std::vector<RectI> added,removed;
+        subtractRect(request.rect, lastRequest.rect, &added);
+        subtractRect(lastRequest.rect, request.rect, &removed);
+        U64 area = 0;
+        for (std::vector<RectI>::iterator it = added.begin(); it != added.end(); ++it) {
+            area += it->area();
+            splitInStripes(*it, 1.f, &stripes);
+        }
+        for (std::vector<RectI>::iterator it = removed.begin(); it != removed.end(); ++it) {
+            area += it->area();
+            splitInStripes(*it, -1.f, &stripes);
+        }
+        if ( area >= request.rect.area() ) {
+            incremental = false;
+            stripes.clear();
+        }
+    }
+    if (incremental) {
+        for (int i = 0; i < nHistograms; ++i) {
+            raw[i] = lastRawHistograms[i];
+        }
+    } else {
+        for (int i = 0; i < nHistograms; ++i) {
+            raw[i].assign(binsCount, 0.f);
+        }
+        splitInStripes(request.rect, 1.f, &stripes);
+    }
+    hasLastRawHistograms = false;
+
+    if ( !stripes.empty() ) {
+        QFuture<HistogramStripeResult> future = QtConcurrent::mapped( stripes,
+                                                                      boost::bind(computeHistogramStripe,
+                                                                                  request,
+                                                                                  nHistograms,
+                                                                                  this,
+                                                                                  _1) );
+        future.waitForFinished();
+
+        ///Merge the bins of each thread
+        HistogramStripeResult result;
+        Q_FOREACH ( result, future.results() ) {
+            if (result.aborted) {
+                return false;
+            }
+            for (int i = 0; i < nHistograms; ++i) {
+                assert( (int)result.bins[i].size() == binsCount );
+                for (int b = 0; b < binsCount; ++b) {
+                    raw[i][b] += result.bins[i][b];
+                }
+            }
+        }
+    }
+
+    lastImage = request.image;
+    lastRequest = request;
+    lastRequest.image.reset();
+    for (int i = 0; i < nHistograms; ++i) {
+        lastRawHistograms[i] = raw[i];
+    }
+    hasLastRawHistograms = true;
+
+    return true;
+}
+
 /// IIR Gaussian filter: recursive implementation.
 
 static void
@@ -405,62 +650,16 @@ iir_1d_filter(SrcIterator src,
     }
 } // iir_1d_filter
 
+///Smoothes the upscaled histogram and downsamples it to obtain the final histogram
 static void
-computeHistogramStatic(const HistogramRequest & request,
-                       boost::shared_ptr<FinishedHistogram> ret,
-                       int histogramIndex)
+smoothHistogram(const HistogramRequest & request,
+                const std::vector<float> & rawHisto,
+                std::vector<float>* histo)
 {
-    const int upscale = 5;
-    std::vector<float> *histo = 0;
-
-    switch (histogramIndex) {
-    case 1:
-        histo = &ret->histogram1;
-        break;
-    case 2:
-        histo = &ret->histogram2;
-        break;
-    case 3:
-        histo = &ret->histogram3;
-        break;
-    default:
-        break;
-    }
-    assert(histo);
-
-    /// keep the mode parameter in sync with Histogram::DisplayModeEnum
-
-    int mode = request.mode;
-
-    ///if the mode is RGB, adjust the mode to either R,G or B depending on the histogram index
-    if (mode == 0) {
-        mode = histogramIndex + 2;
-    }
-
-    ret->pixelsCount = request.rect.area();
+    const int upscale = HISTOGRAM_UPSCALE;
     // a histogram with upscale more bins
-    std::vector<float> histo_upscaled;
-    switch (mode) {
-    case 1:     //< A
-        computeHisto<&pix_alpha::val>(request, upscale, &histo_upscaled);
-        break;
-    case 2:     //<Y
-        computeHisto<&pix_lum::val>(request, upscale, &histo_upscaled);
-        break;
-    case 3:     //< R
-        computeHisto<&pix_red::val>(request, upscale, &histo_upscaled);
-        break;
-    case 4:     //< G
-        computeHisto<&pix_green::val>(request, upscale, &histo_upscaled);
-        break;
-    case 5:     //< B
-        computeHisto<&pix_blue::val>(request, upscale, &histo_upscaled);
-        break;
+    std::vector<float> histo_upscaled(rawHisto);
 
-    default:
-        assert(false);
-        break;
-    }
     double sigma = upscale;
     if (request.smoothingKernelSize > 1) {
         sigma *= request.smoothingKernelSize;
@@ -485,7 +684,7 @@ computeHistogramStatic(const HistogramRequest & request,
             std::advance (it_in,upscale);
         }
     }
-} // computeHistogramStatic
+} // smoothHistogram
 
 void
 HistogramCPU::run()
@@ -521,26 +720,20 @@ HistogramCPU::run()
         ret->vmin = request.vmin;
         ret->vmax = request.vmax;
         ret->mipMapLevel = request.image->getMipMapLevel();
-
-
-        switch (request.mode) {
-        case 0:     //< RGB
-            computeHistogramStatic(request, ret, 1);
-            computeHistogramStatic(request, ret, 2);
-            computeHistogramStatic(request, ret, 3);
-            break;
-        case 1:
-        case 2:
-        case 3:
-        case 4:
-        case 5:
-            computeHistogramStatic(request, ret, 1);
-            break;
-        default:
-            assert(false);     //< unknown case.
-            break;
+        ret->pixelsCount = request.rect.area();
+
+        ///In RGB mode the 3 histograms are computed in the same pass
+        int nHistograms = request.mode == 0 ? 3 : 1;
+        std::vector<float> rawHistograms[3];
+        if ( !_imp->computeRawHistograms(request, nHistograms, rawHistograms) ) {
+            ///A newer request is pending
+            continue;
+        }
+        smoothHistogram(request, rawHistograms[0], &ret->histogram1);
+        if (nHistograms > 1) {
+            smoothHistogram(request, rawHistograms[1], &ret->histogram2);
+            smoothHistogram(request, rawHistograms[2], &ret->histogram3);
         }
-
 
         {
             QMutexLocker l(&_imp->producedMutex);
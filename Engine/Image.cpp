@@ -21,6 +21,7 @@
 #endif
 #include "Engine/AppManager.h"
 #include "Engine/Lut.h"
+#include "Engine/RenderProfiler.h"
 
 using namespace Natron;
 
@@ -2429,7 +2430,7 @@ Image::convertToFormat(const RectI & renderWindow,
                        bool requiresUnpremult,
                        Natron::Image* dstImg) const
 {
-
+    ProfilerScope profile("convertToFormat", 0);
 
     QWriteLocker k(&dstImg->_entryLock);
     QReadLocker k2(&_entryLock);
@@ -172,6 +172,11 @@ namespace Natron {
 
         virtual void onMemoryAllocated(bool diskRestoration) OVERRIDE FINAL;
 
+        virtual int getCompressionElementSize() const OVERRIDE FINAL
+        {
+            return getSizeOfForBitDepth( _params->getBitDepth() );
+        }
+
         static ImageKey makeKey(U64 nodeHashKey,
                                 bool frameVaryingOrAnimated,
                                 SequenceTime time,
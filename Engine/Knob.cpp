@@ -45,6 +45,18 @@
 using namespace Natron;
 using std::make_pair; using std::pair;
 
+namespace {
+class MetaTypesRegistration
+{
+public:
+    inline MetaTypesRegistration()
+    {
+        qRegisterMetaType<std::list<SequenceTime> >("std::list<SequenceTime>");
+    }
+};
+}
+static MetaTypesRegistration registration;
+
 KnobSignalSlotHandler::KnobSignalSlotHandler(const boost::shared_ptr<KnobI>& knob)
 : QObject()
 , k(knob)
@@ -88,6 +100,17 @@ KnobSignalSlotHandler::onMasterKeyFrameSet(SequenceTime time,int dimension,int r
     Q_EMIT keyFrameSet(time, dimension, reason, added);
 }
 
+void
+KnobSignalSlotHandler::onMasterMultipleKeyFramesSet(std::list<SequenceTime> keys,int dimension,int reason)
+{
+    KnobSignalSlotHandler* handler = qobject_cast<KnobSignalSlotHandler*>( sender() );
+    assert(handler);
+    boost::shared_ptr<KnobI> master = handler->getKnob();
+    
+    getKnob()->clone(master.get(), dimension);
+    Q_EMIT multipleKeyFramesSet(keys, dimension, reason);
+}
+
 void
 KnobSignalSlotHandler::onMasterKeyFrameRemoved(SequenceTime time,int dimension,int reason)
 {
@@ -2243,6 +2266,8 @@ KnobHelper::slaveTo(int dimension,
         //QObject::connect( helper->_signalSlotHandler.get(), SIGNAL( updateSlaves(int) ), _signalSlotHandler.get(), SLOT( onMasterChanged(int) ) );
         QObject::connect( helper->_signalSlotHandler.get(), SIGNAL( keyFrameSet(SequenceTime,int,int,bool) ),
                          _signalSlotHandler.get(), SLOT( onMasterKeyFrameSet(SequenceTime,int,int,bool) ) );
+        QObject::connect( helper->_signalSlotHandler.get(), SIGNAL( multipleKeyFramesSet(std::list<SequenceTime>,int,int) ),
+                         _signalSlotHandler.get(), SLOT( onMasterMultipleKeyFramesSet(std::list<SequenceTime>,int,int) ) );
         QObject::connect( helper->_signalSlotHandler.get(), SIGNAL( keyFrameRemoved(SequenceTime,int,int) ),
                          _signalSlotHandler.get(), SLOT( onMasterKeyFrameRemoved(SequenceTime,int,int)) );
         
@@ -17,6 +17,7 @@
 #include <Python.h>
 
 #include <vector>
+#include <list>
 #include <string>
 #include <set>
 #include <map>
@@ -97,6 +98,13 @@ public:
         Q_EMIT keyFrameSet(time,dimension,reason,added);
     }
     
+    void s_multipleKeyFramesSet(const std::list<SequenceTime>& keys,
+                                int dimension,
+                                int reason)
+    {
+        Q_EMIT multipleKeyFramesSet(keys,dimension,reason);
+    }
+    
     void s_keyFrameRemoved(SequenceTime time,
                            int dimension,
                            int reason)
@@ -218,6 +226,8 @@ public Q_SLOTS:
 
     void onMasterKeyFrameSet(SequenceTime time,int dimension,int reason,bool added);
     
+    void onMasterMultipleKeyFramesSet(std::list<SequenceTime> keys,int dimension,int reason);
+    
     void onMasterKeyFrameRemoved(SequenceTime time,int dimension,int reason);
     
     void onMasterKeyFrameMoved(int dimension,int oldTime,int newTime);
@@ -250,6 +260,10 @@ Q_SIGNALS:
     ///@param added True if this is the first time that the keyframe was set
     void keyFrameSet(SequenceTime time,int dimension,int reason,bool added);
     
+    ///Emitted once when several keyframes are set at once (see Knob::setValuesAtTimes), instead of keyFrameSet for each of them
+    ///@param keys The keyframes that were added
+    void multipleKeyFramesSet(std::list<SequenceTime> keys,int dimension,int reason);
+    
     
     ///Emitted whenever a keyframe is removed with a reason different of eValueChangedReasonUserEdited
     void keyFrameRemoved(SequenceTime,int dimension,int reason);
@@ -1450,6 +1464,17 @@ public:
     void setValuesAtTime(int time,const T& value0, const T& value1, const T& value2, Natron::ValueChangedReasonEnum reason);
     void setValuesAtTime(int time,const T& value0, const T& value1, const T& value2, const T& value3, Natron::ValueChangedReasonEnum reason);
 
+    /**
+     * @brief Sets a keyframe at each of the given times with the value at the same index for the given dimension.
+     * The keyframes are added to the curve in one go and the change is evaluated only once.
+     **/
+    void setValuesAtTimes(const std::vector<int>& times,const std::vector<T>& values,int dimension,Natron::ValueChangedReasonEnum reason);
+
+    /**
+     * @brief Returns in values the result of getValueAtTime for each of the given times.
+     **/
+    void getValuesAtTimes(const std::vector<double>& times,int dimension,std::vector<T>* values) const;
+
     /**
      * @brief Unlike getValueAtTime this function doesn't interpolate the values.
      * Instead the true value of the keyframe at the given index will be returned.
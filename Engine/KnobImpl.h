@@ -1283,6 +1283,79 @@ Knob<T>::setValuesAtTime(int time,const T& value0, const T& value1, const T& val
     }
 }
 
+template<typename T>
+void
+Knob<T>::setValuesAtTimes(const std::vector<int>& times,
+                          const std::vector<T>& values,
+                          int dimension,
+                          Natron::ValueChangedReasonEnum reason)
+{
+    assert(dimension >= 0 && dimension < getDimension());
+    assert( times.size() == values.size() );
+    if ( times.empty() ) {
+        return;
+    }
+    
+    Natron::EffectInstance* holder = dynamic_cast<Natron::EffectInstance*>( getHolder() );
+    
+    ///When the values must be queued or go through the undo/redo stack, fallback on setting keys one by one
+    if ( !canAnimate() || !isAnimationEnabled() || (holder && !holder->canSetValue()) ||
+         ( holder && (reason == Natron::eValueChangedReasonPluginEdited) && getKnobGuiPointer() &&
+           (holder->getMultipleParamsEditLevel() != KnobHolder::eMultipleParamsEditOff) ) ) {
+        beginChanges();
+        blockValueChanges();
+        for (std::size_t i = 0; i < times.size(); ++i) {
+            if (i == times.size() - 1) {
+                unblockValueChanges();
+            }
+            KeyFrame k;
+            (void)setValueAtTime(times[i], values[i], dimension, reason, &k);
+        }
+        endChanges();
+        return;
+    }
+    
+    ///There might be stuff in the queue that must be processed first
+    dequeueValuesSet(true);
+    
+    boost::shared_ptr<Curve> curve = getCurve(dimension,true);
+    assert(curve);
+    std::vector<KeyFrame> keys( times.size() );
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        makeKeyFrame(curve.get(), times[i], values[i], &keys[i]);
+    }
+    std::vector<bool> added;
+    curve->addKeyFrames(keys, &added);
+    if (holder) {
+        holder->setHasAnimation(true);
+    }
+    guiCurveCloneInternalCurve(dimension);
+    
+    ///Notify once for all keys so that the curve editor and the dope sheet are refreshed once
+    if (_signalSlotHandler) {
+        std::list<SequenceTime> addedTimes;
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            if (added[i]) {
+                addedTimes.push_back(times[i]);
+            }
+        }
+        _signalSlotHandler->s_multipleKeyFramesSet(addedTimes,dimension,(int)reason);
+    }
+    evaluateValueChange(dimension, reason);
+}
+
+template<typename T>
+void
+Knob<T>::getValuesAtTimes(const std::vector<double>& times,
+                          int dimension,
+                          std::vector<T>* values) const
+{
+    values->resize( times.size() );
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        (*values)[i] = getValueAtTime(times[i], dimension);
+    }
+}
+
 template<typename T>
 void
 Knob<T>::unSlave(int dimension,
@@ -1300,6 +1373,8 @@ Knob<T>::unSlave(int dimension,
                              SLOT( onMasterChanged(int) ) );
         QObject::disconnect( helper->getSignalSlotHandler().get(), SIGNAL( keyFrameSet(SequenceTime,int,int,bool) ),
                          _signalSlotHandler.get(), SLOT( onMasterKeyFrameSet(SequenceTime,int,int,bool) ) );
+        QObject::disconnect( helper->getSignalSlotHandler().get(), SIGNAL( multipleKeyFramesSet(std::list<SequenceTime>,int,int) ),
+                         _signalSlotHandler.get(), SLOT( onMasterMultipleKeyFramesSet(std::list<SequenceTime>,int,int) ) );
         QObject::disconnect( helper->getSignalSlotHandler().get(), SIGNAL( keyFrameRemoved(SequenceTime,int,int) ),
                          _signalSlotHandler.get(), SLOT( onMasterKeyFrameRemoved(SequenceTime,int,int)) );
         
@@ -1365,6 +1440,10 @@ Knob<std::string>::unSlave(int dimension,
                             SIGNAL( keyFrameSet(SequenceTime,int,int,bool) ),
                             _signalSlotHandler.get(),
                             SLOT( onMasterKeyFrameSet(SequenceTime,int,int,bool) ) );
+        QObject::disconnect( helper->getSignalSlotHandler().get(),
+                            SIGNAL( multipleKeyFramesSet(std::list<SequenceTime>,int,int) ),
+                            _signalSlotHandler.get(),
+                            SLOT( onMasterMultipleKeyFramesSet(std::list<SequenceTime>,int,int) ) );
         QObject::disconnect( helper->getSignalSlotHandler().get(),
                             SIGNAL( keyFrameRemoved(SequenceTime,int,int) ),
                             _signalSlotHandler.get(),
@@ -33,6 +33,11 @@ ValueSerialization::ValueSerialization(const boost::shared_ptr<KnobI> & knob,
     , _master()
     , _expression()
     , _exprHasRetVar(false)
+    , _enabled(true)
+    , _hasMaster(false)
+    , _animation()
+    , _value()
+    , _defaultValue()
 {
 }
 
@@ -45,7 +50,44 @@ ValueSerialization::ValueSerialization(const boost::shared_ptr<KnobI> & knob,
 , _master()
 , _expression(expr)
 , _exprHasRetVar(exprHasRetVar)
+, _enabled(true)
+, _hasMaster(false)
+, _animation()
+, _value()
+, _defaultValue()
 {
+    _enabled = knob->isEnabled(dimension);
+    _hasMaster = knob->isSlave(dimension);
+    if (knob->isAnimated(dimension)) {
+        boost::shared_ptr<Curve> curve = knob->getCurve(dimension,true);
+        assert(curve);
+        if (curve) {
+            _animation.reset(new Curve);
+            _animation->clone(*curve);
+        }
+    }
+    
+    Knob<int>* isInt = dynamic_cast<Knob<int>*>( knob.get() );
+    Knob<bool>* isBool = dynamic_cast<Knob<bool>*>( knob.get() );
+    Knob<double>* isDouble = dynamic_cast<Knob<double>*>( knob.get() );
+    Knob<std::string>* isString = dynamic_cast<Knob<std::string>*>( knob.get() );
+    Parametric_Knob* isParametric = dynamic_cast<Parametric_Knob*>( knob.get() );
+    if (isInt) {
+        _value.intValue = isInt->getValue(dimension);
+        _defaultValue.intValue = isInt->getDefaultValue(dimension);
+    } else if (isBool) {
+        _value.boolValue = isBool->getValue(dimension);
+        _defaultValue.boolValue = isBool->getDefaultValue(dimension);
+    } else if (isDouble) {
+        if (!isParametric) {
+            _value.doubleValue = isDouble->getValue(dimension);
+        }
+        _defaultValue.doubleValue = isDouble->getDefaultValue(dimension);
+    } else if (isString) {
+        _value.stringValue = isString->getValue(dimension);
+        _defaultValue.stringValue = isString->getDefaultValue(dimension);
+    }
+    
     std::pair< int, boost::shared_ptr<KnobI> > m = knob->getMaster(dimension);
     if ( m.second && !knob->isMastersPersistenceIgnored() ) {
         _master.masterDimension = m.first;
@@ -149,6 +149,26 @@ public:
     double dmax;
 };
 
+/**
+ * @brief A plain copy of the value held by one dimension of a knob. Only the member
+ * corresponding to the type of the knob is meaningful.
+ **/
+struct SerializedValue
+{
+    int intValue;
+    bool boolValue;
+    double doubleValue;
+    std::string stringValue;
+
+    SerializedValue()
+        : intValue(0)
+        , boolValue(false)
+        , doubleValue(0.)
+        , stringValue()
+    {
+    }
+};
+
 struct ValueSerialization
 {
     boost::shared_ptr<KnobI> _knob;
@@ -157,11 +177,20 @@ struct ValueSerialization
     std::string _expression;
     bool _exprHasRetVar;
     
+    ///The following are only used when saving: this is a copy of the knob state at the time
+    ///the save constructor was called, so that the archive can be written afterwards by another
+    ///thread while the knob keeps on changing.
+    bool _enabled;
+    bool _hasMaster;
+    boost::shared_ptr<Curve> _animation; //< NULL if the dimension is not animated
+    SerializedValue _value;
+    SerializedValue _defaultValue;
+    
     ///Load
     ValueSerialization(const boost::shared_ptr<KnobI> & knob,
                        int dimension);
     
-    ///Save
+    ///Save: this must be called on the thread owning the knob (generally the main-thread)
     ValueSerialization(const boost::shared_ptr<KnobI> & knob,
                        int dimension,
                        bool exprHasRetVar,
@@ -184,39 +213,34 @@ struct ValueSerialization
         Separator_Knob* isSep = dynamic_cast<Separator_Knob*>(_knob.get());
         Button_Knob* btn = dynamic_cast<Button_Knob*>(_knob.get());
         
-        bool enabled = _knob->isEnabled(_dimension);
+        bool enabled = _enabled;
         ar & boost::serialization::make_nvp("Enabled",enabled);
-        bool hasAnimation = _knob->isAnimated(_dimension);
+        bool hasAnimation = _animation.get() != 0;
         ar & boost::serialization::make_nvp("HasAnimation",hasAnimation);
 
         if (hasAnimation) {
-            ar & boost::serialization::make_nvp("Curve",*( _knob->getCurve(_dimension,true) ));
+            ar & boost::serialization::make_nvp("Curve",*_animation);
         }
 
         if (isInt && !isChoice) {
-            int v = isInt->getValue(_dimension);
+            int v = _value.intValue;
             ar & boost::serialization::make_nvp("Value",v);
         } else if (isBool && !isPage && !isGrp && !isSep && !btn) {
-            bool v = isBool->getValue(_dimension);
+            bool v = _value.boolValue;
             ar & boost::serialization::make_nvp("Value",v);
         } else if (isDouble && !isParametric) {
-            double v = isDouble->getValue(_dimension);
+            double v = _value.doubleValue;
             ar & boost::serialization::make_nvp("Value",v);
         } else if (isChoice) {
-            int v = isChoice->getValue(_dimension);
-            std::vector<std::string> entries = isChoice->getEntries_mt_safe();
-            std::string label ;
-            if (v < (int)entries.size() && v >= 0) {
-                label = entries[v];
-            }
+            int v = _value.intValue;
             ar & boost::serialization::make_nvp("Value", v);
        
         } else if (isString) {
-            std::string v = isString->getValue(_dimension);
+            std::string v = _value.stringValue;
             ar & boost::serialization::make_nvp("Value",v);
         }
 
-        bool hasMaster = _knob->isSlave(_dimension);
+        bool hasMaster = _hasMaster;
         ar & boost::serialization::make_nvp("HasMaster",hasMaster);
         if (hasMaster) {
             ar & boost::serialization::make_nvp("Master",_master);
@@ -371,8 +395,13 @@ public:
 class KnobSerialization : public KnobSerializationBase
 {
     boost::shared_ptr<KnobI> _knob; //< used when serializing
+    std::string _name; //< only used when serializing
+    bool _secret; //< only used when serializing
     std::string _typeName;
     int _dimension;
+    std::vector<ValueSerialization> _values; //< used when serializing, a copy of the state of each dimension
+    std::map<int,std::string> _stringAnimation; //< used when serializing
+    std::list<Double_Knob::SerializedTrack> _savedTracks; //< used when serializing
     std::list<MasterSerialization> _masters; //< used when deserializating, we can't restore it before all knobs have been restored.
     std::vector<std::pair<std::string,bool> > _expressions; //< used when deserializing, we can't restore it before all knobs have been restored.
     std::list< Curve > parametricCurves;
@@ -401,30 +430,27 @@ class KnobSerialization : public KnobSerializationBase
         Double_Knob* isDouble = dynamic_cast<Double_Knob*>( _knob.get() );
      
         
-        std::string name = _knob->getName();
+        std::string name = _name;
         ar & boost::serialization::make_nvp("Name",name);
         ar & boost::serialization::make_nvp("Type",_typeName);
         ar & boost::serialization::make_nvp("Dimension",_dimension);
-        bool secret = _knob->getIsSecret();
+        bool secret = _secret;
         ar & boost::serialization::make_nvp("Secret",secret);
 
-        for (int i = 0; i < _knob->getDimension(); ++i) {
-            ValueSerialization vs(_knob,i,_expressions[i].second,_expressions[i].first);
-            ar & boost::serialization::make_nvp("item",vs);
+        assert((int)_values.size() == _dimension);
+        for (std::vector<ValueSerialization>::const_iterator it = _values.begin(); it != _values.end(); ++it) {
+            ar & boost::serialization::make_nvp("item",*it);
         }
 
         ////restore extra datas
         if (isParametric) {
-            std::list< Curve > curves;
-            isParametric->saveParametricCurves(&curves);
+            std::list< Curve > curves = parametricCurves;
             ar & boost::serialization::make_nvp("ParametricCurves",curves);
         } else if (isString) {
-            std::map<int,std::string> extraDatas;
-            isString->getAnimation().save(&extraDatas);
+            std::map<int,std::string> extraDatas = _stringAnimation;
             ar & boost::serialization::make_nvp("StringsAnimation",extraDatas);
-        } else if ( isDouble && (isDouble->getName() == "center") && (isDouble->getDimension() == 2) ) {
-            std::list<Double_Knob::SerializedTrack> tracks;
-            isDouble->serializeTracks(&tracks);
+        } else if ( isDouble && (_name == "center") && (_dimension == 2) ) {
+            std::list<Double_Knob::SerializedTrack> tracks = _savedTracks;
             int count = (int)tracks.size();
             ar & boost::serialization::make_nvp("SlavePtsNo",count);
             for (std::list<Double_Knob::SerializedTrack>::iterator it = tracks.begin(); it != tracks.end(); ++it) {
@@ -474,8 +500,8 @@ class KnobSerialization : public KnobSerializationBase
                 }
             }
             
-            if (isDouble && isDouble->getDimension() == 2) {
-                bool useOverlay = isDouble->getHasNativeOverlayHandle();
+            if (isDouble && _dimension == 2) {
+                bool useOverlay = _useHostOverlay;
                 ar & boost::serialization::make_nvp("HasOverlayHandle",useOverlay);
             }
             
@@ -484,18 +510,18 @@ class KnobSerialization : public KnobSerializationBase
             Bool_Knob* isBool = dynamic_cast<Bool_Knob*>(_knob.get());
             Knob<std::string>* isStr = dynamic_cast<Knob<std::string>*>(_knob.get());
             
-            for (int i = 0; i < _knob->getDimension(); ++i) {
+            for (std::vector<ValueSerialization>::const_iterator it = _values.begin(); it != _values.end(); ++it) {
                 if (isDbl) {
-                    double def = isDbl->getDefaultValue(i);
+                    double def = it->_defaultValue.doubleValue;
                     ar & boost::serialization::make_nvp("DefaultValue",def);
                 } else if (isInt) {
-                    int def = isInt->getDefaultValue(i);
+                    int def = it->_defaultValue.intValue;
                     ar & boost::serialization::make_nvp("DefaultValue",def);
                 } else if (isBool) {
-                    bool def = isBool->getDefaultValue(i);
+                    bool def = it->_defaultValue.boolValue;
                     ar & boost::serialization::make_nvp("DefaultValue",def);
                 } else if (isStr) {
-                    std::string def = isStr->getDefaultValue(i);
+                    std::string def = it->_defaultValue.stringValue;
                     ar & boost::serialization::make_nvp("DefaultValue",def);
                 }
             }
@@ -685,6 +711,8 @@ public:
     ///Constructor used to serialize
     explicit KnobSerialization(const boost::shared_ptr<KnobI> & knob)
         : _knob()
+        , _name()
+        , _secret(false)
         , _dimension(0)
         , _extraData(NULL)
         , _isUserKnob(false)
@@ -706,11 +734,29 @@ public:
         
         _knob = knob;
         
+        _name = knob->getName();
+        _secret = knob->getIsSecret();
         _typeName = knob->typeName();
         _dimension = knob->getDimension();
         
         for (int i = 0; i < _dimension ; ++i) {
             _expressions.push_back(std::make_pair(knob->getExpression(i),knob->isExpressionUsingRetVariable(i)));
+            _values.push_back(ValueSerialization(knob, i, _expressions[i].second, _expressions[i].first));
+        }
+        
+        ///Copy now everything that save() needs so that writing the archive does not touch the knob anymore
+        Parametric_Knob* isParametric = dynamic_cast<Parametric_Knob*>( _knob.get() );
+        AnimatingString_KnobHelper* isAnimatedString = dynamic_cast<AnimatingString_KnobHelper*>( _knob.get() );
+        Double_Knob* isDouble = dynamic_cast<Double_Knob*>( _knob.get() );
+        if (isParametric) {
+            isParametric->saveParametricCurves(&parametricCurves);
+        } else if (isAnimatedString) {
+            isAnimatedString->getAnimation().save(&_stringAnimation);
+        } else if ( isDouble && (_name == "center") && (_dimension == 2) ) {
+            isDouble->serializeTracks(&_savedTracks);
+        }
+        if (isDouble && _dimension == 2) {
+            _useHostOverlay = isDouble->getHasNativeOverlayHandle();
         }
         
         _isUserKnob = knob->isUserKnob();
@@ -787,6 +833,8 @@ public:
     ///this the deserialization will not succeed.
     KnobSerialization()
         : _knob()
+        , _name()
+        , _secret(false)
         , _dimension(0)
         , _extraData(NULL)
         , _isUserKnob(false)
@@ -812,6 +860,16 @@ public:
      **/
     void restoreExpressions(const boost::shared_ptr<KnobI> & knob);
 
+    const std::list<MasterSerialization>& getMasters() const
+    {
+        return _masters;
+    }
+
+    const std::vector<std::pair<std::string,bool> >& getExpressions() const
+    {
+        return _expressions;
+    }
+
     virtual boost::shared_ptr<KnobI> getKnob() const OVERRIDE FINAL
     {
         return _knob;
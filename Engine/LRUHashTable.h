@@ -33,7 +33,11 @@
 
 #include <map>
 #include <list>
+#include <vector>
 #include <utility>
+#include <cassert>
+#include <boost/cstdint.hpp>
+#include <boost/functional/hash.hpp>
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 CLANG_DIAG_OFF(unknown-pragmas)
 CLANG_DIAG_OFF(redeclared-class-member)
@@ -48,18 +52,24 @@ CLANG_DIAG_ON(unknown-pragmas)
 //#define USE_VARIADIC_TEMPLATES
 #define NATRON_CACHE_USE_HASH
 #define NATRON_CACHE_USE_BOOST
+#define NATRON_CACHE_USE_FLAT
 
 
-/**@brief 4 types of LRU caches are defined here:
+/**@brief 5 types of LRU caches are defined here:
  *
  *- STL with hashing : std::unordered_map
  *- STL with comparison: std::map
  *- BOOST with hashing: boost::bimap with boost::unordered_set_of
  *- BOOST with comparison : boost::bimap with boost::set_of
+ *- Flat: open-addressing hash table with an intrusive LRU list (FlatLRUHashTable)
  *
  * Using the appropriate #define , the software can be tuned to use a specific
  * underlying container version for all caches.
  *
+ * NATRON_CACHE_USE_FLAT : define this to use FlatLRUHashTable for all caches. It takes
+ * precedence over all other defines. The other containers remain available (they are
+ * used to benchmark the flat table).
+ *
  * USE_VARIADIC_TEMPLATES : define this if c++11 features like var args are
  * supported. It will make use of variadic templates to greatly
  * reduce the line of codes necessary, and it will also make it possible
@@ -79,6 +89,500 @@ CLANG_DIAG_ON(unknown-pragmas)
  *
  **/
 
+/**
+ * @brief A vector-like list of values which stores up to N values inline and only allocates
+ * when more values share the same key. Most cache keys map to a single entry, so a lookup
+ * does not have to follow any pointer to reach the entries.
+ * It has the subset of the std::list interface used by the Cache.
+ * Erased values are reset so that they do not hold a reference anymore.
+ **/
+template <typename V,int N>
+class LRUSmallList
+{
+public:
+    typedef V value_type;
+    typedef V* iterator;
+    typedef const V* const_iterator;
+
+    LRUSmallList()
+    : _inline()
+    , _overflow()
+    , _size(0)
+    , _spilled(false)
+    {
+    }
+
+    iterator begin()
+    {
+        return _spilled ? &_overflow[0] : _inline;
+    }
+
+    const_iterator begin() const
+    {
+        return _spilled ? &_overflow[0] : _inline;
+    }
+
+    iterator end()
+    {
+        return begin() + _size;
+    }
+
+    const_iterator end() const
+    {
+        return begin() + _size;
+    }
+
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    V& front()
+    {
+        assert(_size > 0);
+        return *begin();
+    }
+
+    const V& front() const
+    {
+        assert(_size > 0);
+        return *begin();
+    }
+
+    void push_back(const V& v)
+    {
+        if (!_spilled && _size < (std::size_t)N) {
+            _inline[_size] = v;
+        } else {
+            if (!_spilled) {
+                ///Move the inline values to the heap, the vector is kept afterwards
+                _overflow.assign(_inline, _inline + _size);
+                for (std::size_t i = 0; i < _size; ++i) {
+                    _inline[i] = V();
+                }
+                _spilled = true;
+            } else {
+                _overflow.resize(_size);
+            }
+            _overflow.push_back(v);
+        }
+        ++_size;
+    }
+
+    iterator erase(iterator it)
+    {
+        iterator last = end();
+        assert(it >= begin() && it < last);
+        for (iterator next = it + 1; next != last; ++next) {
+            *(next - 1) = *next;
+        }
+        *(last - 1) = V();
+        --_size;
+        return it;
+    }
+
+    void clear()
+    {
+        for (iterator it = begin(); it != end(); ++it) {
+            *it = V();
+        }
+        _size = 0;
+    }
+
+private:
+    V _inline[N];
+    std::vector<V> _overflow; //< holds the values when there are more than N, its size may be greater than _size
+    std::size_t _size;
+    bool _spilled;
+};
+
+/**
+ * @brief LRU-replacement cache with the same interface as the other LRU tables. The records are stored
+ * in a contiguous pool, linked in access order by indices (most recent at the back), and indexed by an
+ * open-addressing table (linear probing) storing only the record index and 32 bits of the hash so that
+ * probing does not touch the records. Erased records are recycled through a free list: once the table
+ * has grown to its working size, inserting, finding and evicting records does not allocate.
+ * Iterators and references to values remain valid until the table is modified.
+ **/
+template <typename K,typename V,int N = 1>
+class FlatLRUHashTable
+{
+public:
+    typedef K key_type;
+    typedef LRUSmallList<V,N> value_type;
+
+private:
+
+    enum { eInvalidIndex = 0xFFFFFFFF };
+
+    struct Record
+    {
+        key_type first;
+        value_type second;
+        boost::uint32_t prev,next; //< LRU links for used records, next is the free list link for unused records
+        boost::uint32_t hash;
+        bool used;
+
+        Record()
+        : first()
+        , second()
+        , prev(eInvalidIndex)
+        , next(eInvalidIndex)
+        , hash(0)
+        , used(false)
+        {
+        }
+    };
+
+    struct Bucket
+    {
+        boost::uint32_t record; //< eInvalidIndex when empty
+        boost::uint32_t hash;
+    };
+
+public:
+
+    class iterator
+    {
+        friend class FlatLRUHashTable;
+
+        FlatLRUHashTable* _table;
+        boost::uint32_t _index;
+
+        iterator(FlatLRUHashTable* table,
+                 boost::uint32_t index)
+        : _table(table)
+        , _index(index)
+        {
+        }
+
+    public:
+
+        iterator()
+        : _table(0)
+        , _index(eInvalidIndex)
+        {
+        }
+
+        Record& operator*() const
+        {
+            return _table->_records[_index];
+        }
+
+        Record* operator->() const
+        {
+            return &_table->_records[_index];
+        }
+
+        iterator& operator++()
+        {
+            _index = _table->nextUsedRecord(_index + 1);
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const iterator& other) const
+        {
+            return _index == other._index;
+        }
+
+        bool operator!=(const iterator& other) const
+        {
+            return _index != other._index;
+        }
+    };
+
+    typedef iterator const_iterator;
+
+private:
+
+    friend class iterator;
+
+public:
+
+    FlatLRUHashTable()
+    : _records()
+    , _buckets()
+    , _mask(0)
+    , _size(0)
+    , _lruHead(eInvalidIndex)
+    , _lruTail(eInvalidIndex)
+    , _freeHead(eInvalidIndex)
+    {
+    }
+
+    // Obtain the record for k and mark it as the most recently used
+    iterator operator()(const key_type & k)
+    {
+        boost::uint32_t hash;
+        boost::uint32_t index = findRecord(k, &hash);
+        if (index == eInvalidIndex) {
+            return end();
+        }
+        touch(index);
+        return iterator(this, index);
+    }
+
+    void erase(iterator it)
+    {
+        assert(it._table == this && it._index < _records.size() && _records[it._index].used);
+        eraseRecord(it._index);
+    }
+
+    iterator end()
+    {
+        return iterator(this, eInvalidIndex);
+    }
+
+    iterator begin()
+    {
+        return iterator( this, nextUsedRecord(0) );
+    }
+
+    void insert(const key_type & k,
+                const value_type& list)
+    {
+        boost::uint32_t hash;
+        boost::uint32_t index = findRecord(k, &hash);
+        if (index != eInvalidIndex) {
+            _records[index].second = list;
+            touch(index);
+        } else {
+            index = createRecord(k, hash);
+            _records[index].second = list;
+        }
+    }
+
+    void insert(const key_type & k,
+                const V & v)
+    {
+        boost::uint32_t hash;
+        boost::uint32_t index = findRecord(k, &hash);
+        if (index != eInvalidIndex) {
+            touch(index);
+        } else {
+            index = createRecord(k, hash);
+        }
+        _records[index].second.push_back(v);
+    }
+
+    void clear()
+    {
+        _records.clear();
+        _buckets.clear();
+        _mask = 0;
+        _size = 0;
+        _lruHead = _lruTail = _freeHead = eInvalidIndex;
+    }
+
+    // Purge the least-recently-used value which is not referenced outside of the cache
+    std::pair<key_type,V> evict()
+    {
+        for (boost::uint32_t index = _lruHead; index != eInvalidIndex; index = _records[index].next) {
+            Record& r = _records[index];
+            for (typename value_type::iterator it = r.second.begin(); it != r.second.end(); ++it) {
+                if ( (*it).use_count() == 1 ) {
+                    std::pair<key_type,V> ret = std::make_pair(r.first,*it);
+                    if (r.second.size() == 1) {
+                        eraseRecord(index);
+                    } else {
+                        r.second.erase(it);
+                    }
+
+                    return ret;
+                }
+            }
+        }
+
+        return std::make_pair( key_type(),V() );
+    }
+
+    unsigned int size()
+    {
+        return _size;
+    }
+
+private:
+
+    static boost::uint32_t hashKey(const key_type& k)
+    {
+        ///The cache keys are often already hashes: mix all the bits anyway since only the low bits select the bucket
+        boost::uint64_t h = (boost::uint64_t)boost::hash<key_type>()(k);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return (boost::uint32_t)h;
+    }
+
+    boost::uint32_t nextUsedRecord(boost::uint32_t index) const
+    {
+        for (; index < _records.size(); ++index) {
+            if (_records[index].used) {
+                return index;
+            }
+        }
+        return eInvalidIndex;
+    }
+
+    /**
+     * @brief Returns the index of the record of k, or eInvalidIndex. The hash of k is returned in hash.
+     **/
+    boost::uint32_t findRecord(const key_type& k,
+                               boost::uint32_t* hash) const
+    {
+        *hash = hashKey(k);
+        if ( _buckets.empty() ) {
+            return eInvalidIndex;
+        }
+        for (std::size_t i = *hash & _mask; ; i = (i + 1) & _mask) {
+            const Bucket& b = _buckets[i];
+            if (b.record == eInvalidIndex) {
+                return eInvalidIndex;
+            }
+            if ( b.hash == *hash && _records[b.record].first == k ) {
+                return b.record;
+            }
+        }
+    }
+
+    void unlink(boost::uint32_t index)
+    {
+        Record& r = _records[index];
+        if (r.prev != eInvalidIndex) {
+            _records[r.prev].next = r.next;
+        } else {
+            _lruHead = r.next;
+        }
+        if (r.next != eInvalidIndex) {
+            _records[r.next].prev = r.prev;
+        } else {
+            _lruTail = r.prev;
+        }
+        r.prev = r.next = eInvalidIndex;
+    }
+
+    void linkAtBack(boost::uint32_t index)
+    {
+        Record& r = _records[index];
+        r.prev = _lruTail;
+        r.next = eInvalidIndex;
+        if (_lruTail != eInvalidIndex) {
+            _records[_lruTail].next = index;
+        } else {
+            _lruHead = index;
+        }
+        _lruTail = index;
+    }
+
+    void touch(boost::uint32_t index)
+    {
+        if (index != _lruTail) {
+            unlink(index);
+            linkAtBack(index);
+        }
+    }
+
+    void insertInBuckets(boost::uint32_t index,
+                         boost::uint32_t hash)
+    {
+        std::size_t i = hash & _mask;
+        while (_buckets[i].record != eInvalidIndex) {
+            i = (i + 1) & _mask;
+        }
+        _buckets[i].record = index;
+        _buckets[i].hash = hash;
+    }
+
+    void rehash(std::size_t nBuckets)
+    {
+        Bucket empty;
+        empty.record = eInvalidIndex;
+        empty.hash = 0;
+        _buckets.assign(nBuckets, empty);
+        _mask = nBuckets - 1;
+        for (boost::uint32_t index = _lruHead; index != eInvalidIndex; index = _records[index].next) {
+            insertInBuckets(index, _records[index].hash);
+        }
+    }
+
+    boost::uint32_t createRecord(const key_type& k,
+                                 boost::uint32_t hash)
+    {
+        ///Keep the load factor under 1/2 so that probe sequences stay short
+        if ( (_size + 1) * 2 > _buckets.size() ) {
+            rehash(_buckets.empty() ? 16 : _buckets.size() * 2);
+        }
+        boost::uint32_t index;
+        if (_freeHead != eInvalidIndex) {
+            index = _freeHead;
+            _freeHead = _records[index].next;
+        } else {
+            index = (boost::uint32_t)_records.size();
+            _records.push_back( Record() );
+        }
+        Record& r = _records[index];
+        r.first = k;
+        r.hash = hash;
+        r.used = true;
+        linkAtBack(index);
+        insertInBuckets(index, hash);
+        ++_size;
+        return index;
+    }
+
+    void eraseRecord(boost::uint32_t index)
+    {
+        Record& r = _records[index];
+        std::size_t i = r.hash & _mask;
+        while (_buckets[i].record != index) {
+            i = (i + 1) & _mask;
+        }
+        ///Backward shift deletion: move back the buckets of the probe sequence which would not be found anymore
+        std::size_t j = i;
+        for (;;) {
+            j = (j + 1) & _mask;
+            if (_buckets[j].record == eInvalidIndex) {
+                break;
+            }
+            std::size_t home = _buckets[j].hash & _mask;
+            bool stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+            if (!stays) {
+                _buckets[i] = _buckets[j];
+                i = j;
+            }
+        }
+        _buckets[i].record = eInvalidIndex;
+
+        unlink(index);
+        r.first = key_type();
+        r.second.clear();
+        r.used = false;
+        r.next = _freeHead;
+        _freeHead = index;
+        --_size;
+    }
+
+    std::vector<Record> _records;
+    std::vector<Bucket> _buckets;
+    std::size_t _mask;
+    std::size_t _size;
+    boost::uint32_t _lruHead,_lruTail; //< least and most recently used records
+    boost::uint32_t _freeHead;
+};
+
 #ifdef USE_VARIADIC_TEMPLATES // c++11 is defined as well as unordered_map
 
 #  ifndef NATRON_CACHE_USE_BOOST
@@ -31,16 +31,31 @@
 #endif
 #include <iostream>
 #include <stdexcept>
+#include <map>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cassert>
+
+#include <QtCore/QMutex>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QStringList>
 
 #include "Global/Macros.h"
 
 #define MIN_FILE_SIZE 4096
 
+///Offsets of mapped regions must be a multiple of this: 64 KiB is a multiple of the page size and of the allocation granularity of Windows
+#define MEMORY_FILE_MAPPING_ALIGNMENT 65536
+
 struct MemoryFilePrivate
 {
     std::string path; //< filepath of the backing file
     char* data; //< pointer to the begining of the mapped file
     size_t size; //< the effective size of the file
+    bool isRegion; //< true if only a region of the file is mapped, @see MemoryFile(const std::string&,U64,size_t)
 #if defined(__NATRON_UNIX__)
     int file_handle; //< unix file handle
 #elif defined(__NATRON_WIN32__)
@@ -54,6 +69,7 @@ struct MemoryFilePrivate
         : path(filepath)
           , data(0)
           , size(0)
+          , isRegion(false)
 #if defined(__NATRON_UNIX__)
           , file_handle(-1)
 #elif defined(__NATRON_WIN32__)
@@ -65,6 +81,8 @@ struct MemoryFilePrivate
 
     void openInternal(MemoryFile::FileOpenModeEnum open_mode);
 
+    void openRegion(U64 offset,size_t regionSize);
+
     void closeMapping();
 };
 
@@ -89,6 +107,25 @@ MemoryFile::MemoryFile(const std::string & filepath,
     resize(size);
 }
 
+MemoryFile::MemoryFile(const std::string & filepath,
+                       U64 offset,
+                       size_t size)
+    : _imp( new MemoryFilePrivate(filepath) )
+{
+    try {
+        _imp->openRegion(offset, size);
+    } catch (...) {
+        delete _imp;
+        throw;
+    }
+}
+
+size_t
+MemoryFile::getMappingAlignment()
+{
+    return MEMORY_FILE_MAPPING_ALIGNMENT;
+}
+
 void
 MemoryFile::open(const std::string & filepath,
                  FileOpenModeEnum open_mode)
@@ -253,6 +290,52 @@ MemoryFilePrivate::openInternal(MemoryFile::FileOpenModeEnum open_mode)
 #endif // if defined(__NATRON_UNIX__)
 } // openInternal
 
+void
+MemoryFilePrivate::openRegion(U64 offset,
+                              size_t regionSize)
+{
+    assert(offset % MEMORY_FILE_MAPPING_ALIGNMENT == 0);
+    isRegion = true;
+#if defined(__NATRON_UNIX__)
+    int fd = ::open(path.c_str(), O_RDWR);
+    if (fd == -1) {
+        std::string str("MemoryFile EXC : Failed to open ");
+        str.append(path);
+        throw std::runtime_error(str);
+    }
+    void* mapped = ::mmap(0, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t)offset);
+    ///The mapping holds a reference to the file, the descriptor is not needed anymore
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        std::string str("MemoryFile EXC : Failed to create mapping: ");
+        str.append(path);
+        throw std::runtime_error(str);
+    }
+    data = static_cast<char*>(mapped);
+#elif defined(__NATRON_WIN32__)
+    ///Other regions of the same file may be mapped at the same time
+    HANDLE handle = ::CreateFile(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                                 FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (handle == INVALID_HANDLE_VALUE) {
+        std::string str("MemoryFile EXC : Failed to open file ");
+        str.append(path);
+        throw std::runtime_error(str);
+    }
+    HANDLE mapping = ::CreateFileMapping(handle, 0, PAGE_READWRITE, 0, 0, 0);
+    if (mapping) {
+        data = static_cast<char*>( ::MapViewOfFile(mapping, FILE_MAP_WRITE,
+                                                   (DWORD)(offset >> 32), (DWORD)(offset & 0xFFFFFFFF), regionSize) );
+        ///The view holds a reference to the mapping object and the file
+        ::CloseHandle(mapping);
+    }
+    ::CloseHandle(handle);
+    if (!data) {
+        throw std::runtime_error("MemoryFile EXC : Failed to create mapping.");
+    }
+#endif
+    size = regionSize;
+}
+
 char*
 MemoryFile::data() const
 {
@@ -274,6 +357,9 @@ MemoryFile::path() const
 void
 MemoryFile::resize(size_t new_size)
 {
+    if (_imp->isRegion) {
+        throw std::logic_error("MemoryFile EXC : A mapped region cannot be resized");
+    }
 #if defined(__NATRON_UNIX__)
     if (_imp->data) {
         if (::munmap(_imp->data, _imp->size) < 0) {
@@ -320,28 +406,50 @@ MemoryFilePrivate::closeMapping()
         str.append( std::strerror(errno) );
         throw std::runtime_error(str);
     }
-    ::close(file_handle);
+    if (file_handle != -1) {
+        ::close(file_handle);
+    }
 #elif defined(__NATRON_WIN32__)
     if (::UnmapViewOfFile(data) == 0) {
         throw std::runtime_error("Failed to unmap the mapped file");
     }
-    ::CloseHandle(file_mapping_handle);
-    ::CloseHandle(file_handle);
+    if (!isRegion) {
+        ::CloseHandle(file_mapping_handle);
+        ::CloseHandle(file_handle);
+    }
 #endif
 }
 
 bool
-MemoryFile::flush()
+MemoryFile::flush(FlushTypeEnum type)
 {
 #if defined(__NATRON_UNIX__)
 
-    return ::msync(_imp->data, _imp->size, MS_SYNC) == 0;
+    return ::msync(_imp->data, _imp->size, type == eFlushTypeSync ? MS_SYNC : MS_ASYNC) == 0;
 #elif defined(__NATRON_WIN32__)
+    ///FlushViewOfFile only initiates the write-back
+    (void)type;
 
     return ::FlushViewOfFile(_imp->data, _imp->size) != 0;
 #endif
 }
 
+void
+MemoryFile::prefetch()
+{
+    if (!_imp->data || _imp->size == 0) {
+        return;
+    }
+#if defined(__NATRON_UNIX__)
+#  if defined(MADV_SEQUENTIAL) && defined(MADV_WILLNEED)
+    ///Read-ahead aggressively and start reading the whole mapping now rather than on each page fault
+    ::madvise(_imp->data, _imp->size, MADV_SEQUENTIAL);
+    ::madvise(_imp->data, _imp->size, MADV_WILLNEED);
+#  endif
+#endif
+    ///On Windows PrefetchVirtualMemory is only available from Windows 8: rely on the system read-ahead
+}
+
 MemoryFile::~MemoryFile()
 {
     if (_imp->data) {
@@ -361,7 +469,8 @@ MemoryFile::remove()
         if (_imp->data) {
             _imp->closeMapping();
         }
-        if (::remove( _imp->path.c_str() ) != 0) {
+        ///The file of a region is shared with other regions
+        if ( !_imp->isRegion && (::remove( _imp->path.c_str() ) != 0) ) {
             std::cerr << "Attempt to remove an unexisting file." << std::endl;
         }
         _imp->path.clear();
@@ -369,3 +478,394 @@ MemoryFile::remove()
     }
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////SLAB ALLOCATOR/////////////////////////////////////////////////
+
+namespace {
+struct MemoryFileSlab
+{
+    bool registered; //< false if this index is not used by this allocator
+    U64 size;
+    std::map<U64,U64> freeExtents; //< offset -> size of the free extents, adjacent extents are always merged
+
+    MemoryFileSlab()
+        : registered(false)
+          , size(0)
+          , freeExtents()
+    {
+    }
+};
+
+typedef std::multimap<U64,std::pair<int,U64> > FreeExtentsBySize; //< size -> (slab,offset)
+
+U64
+alignedExtentSize(U64 size)
+{
+    return ( (size + MEMORY_FILE_MAPPING_ALIGNMENT - 1) / MEMORY_FILE_MAPPING_ALIGNMENT ) * MEMORY_FILE_MAPPING_ALIGNMENT;
+}
+
+/**
+ * @brief Creates the file with the given size, reserving the disk space where the system allows it.
+ * Fails if the file already exists, in which case exists is set to true.
+ **/
+bool
+createPreallocatedFile(const std::string & path,
+                       U64 size,
+                       bool* exists)
+{
+    *exists = false;
+#if defined(__NATRON_UNIX__)
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd == -1) {
+        *exists = (errno == EEXIST);
+
+        return false;
+    }
+    int err = -1;
+#  if defined(__linux__)
+    err = ::posix_fallocate(fd, 0, (off_t)size);
+#  endif
+    if (err != 0) {
+        ///Not supported by the file-system: the file will be sparse
+        err = ::ftruncate(fd, (off_t)size) == 0 ? 0 : errno;
+    }
+    ::close(fd);
+    if (err != 0) {
+        ::remove( path.c_str() );
+
+        return false;
+    }
+
+    return true;
+#elif defined(__NATRON_WIN32__)
+    HANDLE handle = ::CreateFile(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                                 FILE_SHARE_READ | FILE_SHARE_WRITE, 0, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, 0);
+    if (handle == INVALID_HANDLE_VALUE) {
+        *exists = (::GetLastError() == ERROR_FILE_EXISTS);
+
+        return false;
+    }
+    LARGE_INTEGER li;
+    li.QuadPart = size;
+    bool ok = ::SetFilePointerEx(handle, li, 0, FILE_BEGIN) && ::SetEndOfFile(handle);
+    ::CloseHandle(handle);
+    if (!ok) {
+        ::DeleteFile( path.c_str() );
+    }
+
+    return ok;
+#endif
+}
+
+bool
+syncFile(const std::string & path)
+{
+#if defined(__NATRON_UNIX__)
+    int fd = ::open(path.c_str(), O_RDWR);
+    if (fd == -1) {
+        return false;
+    }
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+
+    return ok;
+#elif defined(__NATRON_WIN32__)
+    HANDLE handle = ::CreateFile(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                                 FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    bool ok = ::FlushFileBuffers(handle) != 0;
+    ::CloseHandle(handle);
+
+    return ok;
+#endif
+}
+}
+
+struct MemoryFileSlabAllocatorPrivate
+{
+    std::string directory;
+    U64 slabSize;
+    mutable QMutex lock; //< protects slabs and freeExtentsBySize
+    std::vector<MemoryFileSlab> slabs;
+    FreeExtentsBySize freeExtentsBySize; //< all the free extents of all slabs, to find the best fit
+
+    MemoryFileSlabAllocatorPrivate(const std::string & directory,
+                                   U64 slabSize)
+        : directory(directory)
+          , slabSize( alignedExtentSize(slabSize) )
+          , lock()
+          , slabs()
+          , freeExtentsBySize()
+    {
+        if ( !this->directory.empty() && (this->directory[this->directory.size() - 1] != '/') &&
+             (this->directory[this->directory.size() - 1] != '\\') ) {
+            this->directory.push_back('/');
+        }
+    }
+
+    std::string getSlabFilePath(int slab) const
+    {
+        std::stringstream ss;
+        ss << directory << "slab_" << std::setfill('0') << std::setw(4) << slab << "." NATRON_CACHE_FILE_EXT;
+
+        return ss.str();
+    }
+
+    void insertFreeExtent(int slab,
+                          U64 offset,
+                          U64 size)
+    {
+        slabs[slab].freeExtents.insert( std::make_pair(offset, size) );
+        freeExtentsBySize.insert( std::make_pair( size, std::make_pair(slab, offset) ) );
+    }
+
+    void eraseFreeExtent(int slab,
+                         std::map<U64,U64>::iterator it)
+    {
+        std::pair<FreeExtentsBySize::iterator,FreeExtentsBySize::iterator> range = freeExtentsBySize.equal_range(it->second);
+        for (FreeExtentsBySize::iterator it2 = range.first; it2 != range.second; ++it2) {
+            if ( (it2->second.first == slab) && (it2->second.second == it->first) ) {
+                freeExtentsBySize.erase(it2);
+                break;
+            }
+        }
+        slabs[slab].freeExtents.erase(it);
+    }
+
+    void registerSlab(int index,
+                      U64 size)
+    {
+        if ( (int)slabs.size() <= index ) {
+            slabs.resize(index + 1);
+        }
+        MemoryFileSlab & slab = slabs[index];
+        slab.registered = true;
+        slab.size = size;
+        slab.freeExtents.clear();
+        insertFreeExtent(index, 0, size);
+    }
+
+    bool createSlab(U64 size)
+    {
+        ///Never reuse a file this allocator did not create: it may be used by another process or hold the entries of a previous session
+        for (int i = 0; i < 100000; ++i) {
+            if ( ( i < (int)slabs.size() ) && slabs[i].registered ) {
+                continue;
+            }
+            bool exists;
+            if ( createPreallocatedFile(getSlabFilePath(i), size, &exists) ) {
+                registerSlab(i, size);
+
+                return true;
+            }
+            if (!exists) {
+                return false;
+            }
+        }
+
+        return false;
+    }
+
+    bool registerExistingSlab(int index)
+    {
+        QFileInfo info( getSlabFilePath(index).c_str() );
+        if ( !info.exists() ) {
+            return false;
+        }
+        U64 size = ( (U64)info.size() / MEMORY_FILE_MAPPING_ALIGNMENT ) * MEMORY_FILE_MAPPING_ALIGNMENT;
+        if (size == 0) {
+            return false;
+        }
+        registerSlab(index, size);
+
+        return true;
+    }
+};
+
+MemoryFileSlabAllocator::MemoryFileSlabAllocator(const std::string & directory,
+                                                 U64 slabSize)
+    : _imp( new MemoryFileSlabAllocatorPrivate(directory, slabSize) )
+{
+}
+
+MemoryFileSlabAllocator::~MemoryFileSlabAllocator()
+{
+    delete _imp;
+}
+
+bool
+MemoryFileSlabAllocator::allocate(U64 size,
+                                  Extent* extent)
+{
+    if (size == 0) {
+        return false;
+    }
+    U64 allocSize = alignedExtentSize(size);
+    QMutexLocker k(&_imp->lock);
+
+    ///Best fit: the smallest free extent that is large enough
+    FreeExtentsBySize::iterator found = _imp->freeExtentsBySize.lower_bound(allocSize);
+    if ( found == _imp->freeExtentsBySize.end() ) {
+        if ( !_imp->createSlab( std::max(allocSize, _imp->slabSize) ) ) {
+            return false;
+        }
+        found = _imp->freeExtentsBySize.lower_bound(allocSize);
+        assert( found != _imp->freeExtentsBySize.end() );
+    }
+    int slab = found->second.first;
+    U64 offset = found->second.second;
+    U64 freeSize = found->first;
+    _imp->freeExtentsBySize.erase(found);
+    _imp->slabs[slab].freeExtents.erase(offset);
+    if (freeSize > allocSize) {
+        _imp->insertFreeExtent(slab, offset + allocSize, freeSize - allocSize);
+    }
+    extent->slab = slab;
+    extent->offset = offset;
+    extent->size = size;
+
+    return true;
+}
+
+void
+MemoryFileSlabAllocator::free(const Extent & extent)
+{
+    if ( !extent.isValid() ) {
+        return;
+    }
+    U64 offset = extent.offset;
+    U64 size = alignedExtentSize(extent.size);
+    QMutexLocker k(&_imp->lock);
+    assert( extent.slab < (int)_imp->slabs.size() && _imp->slabs[extent.slab].registered );
+    std::map<U64,U64> & freeExtents = _imp->slabs[extent.slab].freeExtents;
+
+    ///Merge with the following free extent
+    std::map<U64,U64>::iterator next = freeExtents.lower_bound(offset);
+    assert( next == freeExtents.end() || next->first >= offset + size );
+    if ( ( next != freeExtents.end() ) && (next->first == offset + size) ) {
+        size += next->second;
+        _imp->eraseFreeExtent(extent.slab, next);
+    }
+    ///Merge with the preceding free extent
+    std::map<U64,U64>::iterator prev = freeExtents.lower_bound(offset);
+    if ( prev != freeExtents.begin() ) {
+        --prev;
+        assert(prev->first + prev->second <= offset);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            _imp->eraseFreeExtent(extent.slab, prev);
+        }
+    }
+    _imp->insertFreeExtent(extent.slab, offset, size);
+}
+
+bool
+MemoryFileSlabAllocator::reserve(const Extent & extent)
+{
+    if ( !extent.isValid() || (extent.size == 0) || (extent.offset % MEMORY_FILE_MAPPING_ALIGNMENT != 0) ) {
+        return false;
+    }
+    QMutexLocker k(&_imp->lock);
+    if ( ( extent.slab >= (int)_imp->slabs.size() ) || !_imp->slabs[extent.slab].registered ) {
+        if ( !_imp->registerExistingSlab(extent.slab) ) {
+            return false;
+        }
+    }
+    std::map<U64,U64> & freeExtents = _imp->slabs[extent.slab].freeExtents;
+    U64 size = alignedExtentSize(extent.size);
+
+    ///Find the free extent containing the reserved one
+    std::map<U64,U64>::iterator it = freeExtents.upper_bound(extent.offset);
+    if ( it == freeExtents.begin() ) {
+        return false;
+    }
+    --it;
+    U64 freeOffset = it->first;
+    U64 freeEnd = it->first + it->second;
+    U64 end = extent.offset + size;
+    if (freeEnd < end) {
+        return false;
+    }
+    _imp->eraseFreeExtent(extent.slab, it);
+    if (extent.offset > freeOffset) {
+        _imp->insertFreeExtent(extent.slab, freeOffset, extent.offset - freeOffset);
+    }
+    if (freeEnd > end) {
+        _imp->insertFreeExtent(extent.slab, end, freeEnd - end);
+    }
+
+    return true;
+}
+
+void
+MemoryFileSlabAllocator::releaseFreeSlabs()
+{
+    QMutexLocker k(&_imp->lock);
+    for (std::size_t i = 0; i < _imp->slabs.size(); ++i) {
+        MemoryFileSlab & slab = _imp->slabs[i];
+        if ( !slab.registered || (slab.freeExtents.size() != 1) ) {
+            continue;
+        }
+        std::map<U64,U64>::iterator it = slab.freeExtents.begin();
+        if ( (it->first != 0) || (it->second != slab.size) ) {
+            continue;
+        }
+        _imp->eraseFreeExtent(i, it);
+        slab.registered = false;
+        slab.size = 0;
+        ::remove( _imp->getSlabFilePath(i).c_str() );
+    }
+}
+
+void
+MemoryFileSlabAllocator::removeUnregisteredSlabs()
+{
+    QDir dir( _imp->directory.c_str() );
+    QStringList filters;
+    filters << "slab_*." NATRON_CACHE_FILE_EXT;
+    QStringList files = dir.entryList(filters, QDir::Files);
+    QString extension("." NATRON_CACHE_FILE_EXT);
+
+    QMutexLocker k(&_imp->lock);
+    for (QStringList::iterator it = files.begin(); it != files.end(); ++it) {
+        bool ok;
+        int index = it->mid(5, it->size() - 5 - extension.size()).toInt(&ok);
+        if ( !ok || (index < 0) ) {
+            continue;
+        }
+        if ( ( index < (int)_imp->slabs.size() ) && _imp->slabs[index].registered ) {
+            continue;
+        }
+        dir.remove(*it);
+    }
+}
+
+std::string
+MemoryFileSlabAllocator::getSlabFilePath(int slab) const
+{
+    return _imp->getSlabFilePath(slab);
+}
+
+bool
+MemoryFileSlabAllocator::sync()
+{
+    std::vector<std::string> paths;
+    {
+        QMutexLocker k(&_imp->lock);
+        for (std::size_t i = 0; i < _imp->slabs.size(); ++i) {
+            if (_imp->slabs[i].registered) {
+                paths.push_back( _imp->getSlabFilePath(i) );
+            }
+        }
+    }
+    bool ok = true;
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        ok &= syncFile(paths[i]);
+    }
+
+    return ok;
+}
+
@@ -79,11 +79,28 @@ public:
                size_t size,
                FileOpenModeEnum open_mode);
 
+    /**
+     * @brief Maps the region [offset, offset + size) of an existing file, typically an extent of a slab
+     * allocated by MemoryFileSlabAllocator. The offset must be a multiple of getMappingAlignment().
+     * The file is not resized and the mapping cannot be resized. On Unix the file descriptor is closed
+     * as soon as the mapping is created, so mapped regions do not count against the limit of opened files.
+     * The constructor might throw an exception upon failure to open the file or to create the mapping.
+     **/
+    MemoryFile(const std::string & filepath,
+               U64 offset,
+               size_t size);
+
     /**
      * @brief The destructor closes the mapping, effectively removing the RAM portion but not the file.
      **/
     ~MemoryFile();
 
+    /**
+     * @brief The alignment of the offsets that may be given to the region constructor.
+     * This is a multiple of the page size and of the allocation granularity of Windows.
+     **/
+    static size_t getMappingAlignment();
+
     /**
      * @brief Attemps to create the file if the file didn't exist already.
      * If the file did exist, this function will also map the file to memory and the data
@@ -118,10 +135,22 @@ public:
      **/
     size_t size() const;
 
+    enum FlushTypeEnum
+    {
+        eFlushTypeAsync = 0, //< schedule the write-back of the modified pages and return immediately
+        eFlushTypeSync //< wait until the modified pages are written to the backing file
+    };
+
     /**
      * @brief Ensures that the backing file is in sync. with the data in memory
      **/
-    bool flush();
+    bool flush(FlushTypeEnum type = eFlushTypeSync);
+
+    /**
+     * @brief Hints the system that the whole mapping is about to be read sequentially, so that it is read
+     * ahead in large chunks instead of being page-faulted in one page at a time.
+     **/
+    void prefetch();
 
     /**
      * @brief Returns the filepath of the backing file.
@@ -131,6 +160,7 @@ public:
     /**
      * @brief Removes the backing file and closes the mapping to the virtual memory.
      * After that you could re-use the object calling the open(...) function again.
+     * If only a region of the file is mapped, the file is not removed.
      **/
     void remove();
 
@@ -139,5 +169,96 @@ private:
     MemoryFilePrivate* _imp;
 };
 
+struct MemoryFileSlabAllocatorPrivate;
+
+/**
+ * @brief Packs many memory files into a few large preallocated files ("slabs") instead of creating one file per
+ * memory file: an extent of a slab is allocated for each one and mapped with the region constructor of MemoryFile.
+ * This keeps the number of files and of opened file descriptors low.
+ * Slabs are only created by this allocator (never shared with another process) or registered back with reserve()
+ * when restoring their extents from a previous session.
+ * This is MT-safe.
+ **/
+class MemoryFileSlabAllocator
+{
+public:
+
+    struct Extent
+    {
+        int slab; //< index of the slab, -1 if this extent is invalid
+        U64 offset; //< offset of the extent in the slab file, a multiple of MemoryFile::getMappingAlignment()
+        U64 size; //< the requested size in bytes
+
+        Extent()
+        : slab(-1)
+        , offset(0)
+        , size(0)
+        {
+        }
+
+        bool isValid() const
+        {
+            return slab >= 0;
+        }
+    };
+
+    /**
+     * @param directory The directory where the slab files are created, it must exist.
+     * @param slabSize The size of each slab file. An extent larger than this gets a slab of its own.
+     **/
+    MemoryFileSlabAllocator(const std::string & directory,
+                            U64 slabSize);
+
+    ~MemoryFileSlabAllocator();
+
+    /**
+     * @brief Allocates an extent of at least size bytes, creating a new slab if none has enough contiguous free space.
+     * Returns false if the allocation failed, e.g: because the disk is full.
+     **/
+    bool allocate(U64 size,Extent* extent);
+
+    /**
+     * @brief Gives back an extent returned by allocate() or reserve(). The slab files are kept for further allocations.
+     **/
+    void free(const Extent & extent);
+
+    /**
+     * @brief Marks the given extent of an existing slab as used, this is used when restoring the extents allocated
+     * in a previous session. Returns false if the slab file does not exist or if the extent is not free.
+     **/
+    bool reserve(const Extent & extent);
+
+    /**
+     * @brief Removes the files of the slabs that have no extent in use to give their disk space back.
+     * This is called when the cache is cleared and when the application quits.
+     **/
+    void releaseFreeSlabs();
+
+    /**
+     * @brief Removes the slab files of the directory which were not registered with reserve(). This is called once the
+     * extents of the previous session were restored: the other slabs are left-overs that no entry references anymore.
+     **/
+    void removeUnregisteredSlabs();
+
+    /**
+     * @brief Returns the path of the file of the given slab.
+     **/
+    std::string getSlabFilePath(int slab) const;
+
+    /**
+     * @brief Writes back all the modified pages of all slabs and waits for completion. Memory files only schedule an
+     * asynchronous write-back when they are flushed: this must be called before relying on the content of the slabs
+     * from another session.
+     **/
+    bool sync();
+
+private:
+
+    MemoryFileSlabAllocator(const MemoryFileSlabAllocator &);
+    MemoryFileSlabAllocator& operator=(const MemoryFileSlabAllocator &);
+
+    MemoryFileSlabAllocatorPrivate* _imp;
+};
+
 
 #endif /* defined(NATRON_ENGINE_MEMORYFILE_H_) */
@@ -38,6 +38,23 @@ EffectWrapper::~EffectWrapper()
 // Target ---------------------------------------------------------
 
 extern "C" {
+// Begin code injection
+static PyObject* Sbk_Effect_getattro(PyObject* self, PyObject* name)
+{
+    PyObject* attr = PyObject_GenericGetAttr(self, name);
+    if (attr || !PyErr_ExceptionMatches(PyExc_AttributeError) || !Shiboken::Object::isValid(self, false)) {
+        return attr;
+    }
+    // The nodes of a group loaded on demand are declared as attributes of the group when they are created
+    ::Effect* cppSelf = ((::Effect*)Shiboken::Conversions::cppPointer(SbkNatronEngineTypes[SBK_EFFECT_IDX], (SbkObject*)self));
+    if (!loadPendingChildrenForAttribute(cppSelf)) {
+        return 0;
+    }
+    PyErr_Clear();
+    return PyObject_GenericGetAttr(self, name);
+}
+// End of code injection
+
 static PyObject* Sbk_EffectFunc_beginChanges(PyObject* self)
 {
     ::Effect* cppSelf = 0;
@@ -1367,5 +1384,10 @@ void init_Effect(PyObject* module)
     Shiboken::ObjectType::setTypeDiscoveryFunctionV2(&Sbk_Effect_Type, &Sbk_Effect_typeDiscovery);
 
 
+    // Begin code injection
+    Sbk_Effect_Type.super.ht_type.tp_getattro = Sbk_Effect_getattro;
+    // End of code injection
+
+
     EffectWrapper::pysideInitQtMetaTypes();
 }
@@ -17,6 +17,7 @@
 
 #include <limits>
 #include <locale>
+#include <set>
 
 #include <QtCore/QDebug>
 #include <QtCore/QReadWriteLock>
@@ -732,12 +733,8 @@ Node::getHashValue() const
 }
 
 void
-Node::computeHashInternal(std::list<Natron::Node*>& marked)
+Node::computeHashNoRecursion()
 {
-    if (std::find(marked.begin(), marked.end(), this) != marked.end()) {
-        return;
-    }
-    
     ///Always called in the main thread
     assert( QThread::currentThread() == qApp->thread() );
     if (!_imp->inputsInitialized) {
@@ -798,6 +795,18 @@ Node::computeHashInternal(std::list<Natron::Node*>& marked)
         _imp->hash.computeHash();
     }
     
+    _imp->liveInstance->onNodeHashChanged(getHashValue());
+}
+
+void
+Node::computeHashInternal(std::list<Natron::Node*>& marked)
+{
+    if (std::find(marked.begin(), marked.end(), this) != marked.end()) {
+        return;
+    }
+    
+    computeHashNoRecursion();
+    
     marked.push_back(this);
     
     ///call it on all the outputs
@@ -808,8 +817,6 @@ Node::computeHashInternal(std::list<Natron::Node*>& marked)
         (*it)->computeHashInternal(marked);
     }
     
-    _imp->liveInstance->onNodeHashChanged(getHashValue());
-    
     ///If the node is a group, call it on all nodes in the group
     ///Also force a change to their hash
     NodeGroup* group = dynamic_cast<NodeGroup*>(getLiveInstance());
@@ -1292,6 +1299,69 @@ Node::setKnobsAge(U64 newAge)
 
 void
 Node::incrementKnobsAge()
+{
+    incrementKnobsAgeNoHash();
+    computeHash();
+}
+
+namespace {
+    
+///Appends to sorted the node and all the nodes downstream (or inside if it is a group) after their inputs
+void
+sortNodesDownstream(Natron::Node* node,
+                    std::set<Natron::Node*>& visited,
+                    std::list<Natron::Node*>* sorted)
+{
+    if ( !visited.insert(node).second ) {
+        return;
+    }
+    std::list<Natron::Node*> outputs;
+    node->getOutputsWithGroupRedirection(outputs);
+    NodeGroup* group = dynamic_cast<NodeGroup*>( node->getLiveInstance() );
+    if (group) {
+        NodeList nodes = group->getNodes();
+        for (NodeList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+            outputs.push_back( it->get() );
+        }
+    }
+    for (std::list<Natron::Node*>::iterator it = outputs.begin(); it != outputs.end(); ++it) {
+        assert(*it);
+        sortNodesDownstream(*it, visited, sorted);
+    }
+    ///Depth-first post-order: the node must come before everything that was appended downstream of it
+    sorted->push_front(node);
+}
+    
+}
+
+void
+Node::incrementKnobsAgeOfNodes(const std::list<Natron::Node*>& nodes)
+{
+    ///Always called in the main thread
+    assert( QThread::currentThread() == qApp->thread() );
+    
+    std::set<Natron::Node*> visited;
+    std::list<Natron::Node*> sorted;
+    for (std::list<Natron::Node*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        (*it)->incrementKnobsAgeNoHash();
+        sortNodesDownstream(*it, visited, &sorted);
+    }
+    
+    for (std::list<Natron::Node*>::iterator it = sorted.begin(); it != sorted.end(); ++it) {
+        ///The nodes inside a group are forced to change their hash, see computeHashInternal
+        NodeGroup* group = dynamic_cast<NodeGroup*>( (*it)->getLiveInstance() );
+        if (group) {
+            NodeList children = group->getNodes();
+            for (NodeList::iterator it2 = children.begin(); it2 != children.end(); ++it2) {
+                (*it2)->incrementKnobsAgeNoHash();
+            }
+        }
+        (*it)->computeHashNoRecursion();
+    }
+}
+
+void
+Node::incrementKnobsAgeNoHash()
 {
     U32 newAge;
     {
@@ -1307,8 +1377,6 @@ Node::incrementKnobsAge()
         newAge = _imp->knobsAge;
     }
     Q_EMIT knobsAgeChanged(newAge);
-    
-    computeHash();
 }
 
 U64
@@ -1677,6 +1745,7 @@ Node::setLabel(const std::string& label)
         QMutexLocker k(&_imp->nameMutex);
         _imp->label = label;
     }
+    getApp()->getProject()->markNodeModified(shared_from_this());
     boost::shared_ptr<NodeCollection> collection = getGroup();
     if (collection) {
         collection->notifyNodeNameChanged(shared_from_this());
@@ -1724,8 +1793,14 @@ Node::setNameInternal(const std::string& name)
         ///Set the label at the same time
         _imp->label = newName;
     }
+    if (collection) {
+        collection->onNodeScriptNameChanged(shared_from_this(), oldName, newName);
+    }
     
     if (collection) {
+        ///Other nodes of the project may refer to this node by its name
+        getApp()->getProject()->markStructureModified();
+        
         std::string fullySpecifiedName = getFullyQualifiedName();
         if (!oldName.empty()) {
             
@@ -2826,6 +2901,11 @@ Node::connectInput(const boost::shared_ptr<Node> & input,
     ///Get notified when the input name has changed
     QObject::connect( input.get(), SIGNAL( labelChanged(QString) ), this, SLOT( onInputLabelChanged(QString) ) );
     
+    ///The groups loaded on demand that are upstream are now needed by this node
+    if ( !getApp()->getProject()->isLoadingProject() ) {
+        NodeGroup::loadPendingGroupsUpstream( input.get() );
+    }
+    
     ///Notify the GUI
     Q_EMIT inputChanged(inputNumber);
     
@@ -2907,6 +2987,11 @@ Node::replaceInput(const boost::shared_ptr<Node>& input,int inputNumber)
     ///Get notified when the input name has changed
     QObject::connect( input.get(), SIGNAL( labelChanged(QString) ), this, SLOT( onInputLabelChanged(QString) ) );
     
+    ///The groups loaded on demand that are upstream are now needed by this node
+    if ( !getApp()->getProject()->isLoadingProject() ) {
+        NodeGroup::loadPendingGroupsUpstream( input.get() );
+    }
+    
     ///Notify the GUI
     Q_EMIT inputChanged(inputNumber);
     
@@ -3217,6 +3302,9 @@ Node::deactivate(const std::list< Node* > & outputsToDisconnect,
     //first tell the gui to clear any persistent message linked to this node
     clearPersistentMessage(false);
     
+    ///Deactivated nodes are no longer saved
+    getApp()->getProject()->markStructureModified();
+    
     boost::shared_ptr<NodeCollection> parentCol = getGroup();
     assert(parentCol);
     NodeGroup* isParentGroup = dynamic_cast<NodeGroup*>(parentCol.get());
@@ -3414,6 +3502,8 @@ Node::activate(const std::list< Node* > & outputsToRestore,
     }
 
     
+    getApp()->getProject()->markStructureModified();
+    
     ///No need to lock, guiInputs is only written to by the main-thread
     
     ///for all inputs, reconnect their output to this node
@@ -3632,8 +3722,15 @@ Node::makePreviewImage(SequenceTime time,
         return false;
     }
     assert( !rod.isNull() );
-    double yZoomFactor = (double)*height / (double)rod.height();
-    double xZoomFactor = (double)*width / (double)rod.width();
+    
+    ///The mipmap level is derived from the project format rather than from the region of definition of the node so
+    ///that all previews are rendered at the same level: the images of the nodes upstream rendered for a preview are then
+    ///found in the cache by the previews of these nodes.
+    Format projectFormat;
+    getApp()->getProject()->getProjectDefaultFormat(&projectFormat);
+    RectD sizeRef = projectFormat.isNull() ? rod : projectFormat.toCanonicalFormat();
+    double yZoomFactor = (double)*height / (double)sizeRef.height();
+    double xZoomFactor = (double)*width / (double)sizeRef.width();
     double closestPowerOf2X = xZoomFactor >= 1 ? 1 : std::pow( 2,-std::ceil( std::log(xZoomFactor) / std::log(2.) ) );
     double closestPowerOf2Y = yZoomFactor >= 1 ? 1 : std::pow( 2,-std::ceil( std::log(yZoomFactor) / std::log(2.) ) );
     int closestPowerOf2 = std::max(closestPowerOf2X,closestPowerOf2Y);
@@ -3647,17 +3744,22 @@ Node::makePreviewImage(SequenceTime time,
     RectI renderWindow;
     rod.toPixelEnclosing(mipMapLevel, par, &renderWindow);
     
+    ///The preview is aborted as soon as it is stale, that is if a parameter changes or the timeline moves
+    bool canAbort = time == getApp()->getTimeLine()->currentFrame();
     ParallelRenderArgsSetter frameRenderArgs(getApp()->getProject().get(),
                                              time,
                                              0, //< preview only renders view 0 (left)
                                              true, //<isRenderUserInteraction
                                              false, //isSequential
-                                             false, //can abort
+                                             canAbort, //can abort
                                              0, //render Age
                                              0, // viewer requester
                                              0, //texture index
                                              getApp()->getTimeLine().get(),
-                                             false);
+                                             false,
+                                             Natron::eRenderPriorityPreview,
+                                             true, // is a frame rendered ?
+                                             false); // is this one of the frames of a sequence rendered in parallel ?
     
     std::list<ImageComponents> requestedComps;
     requestedComps.push_back(ImageComponents::getRGBComponents());
@@ -4472,6 +4574,7 @@ Node::onInputChanged(int inputNb)
         return;
     }
     assert( QThread::currentThread() == qApp->thread() );
+    getApp()->getProject()->markNodeModified(shared_from_this());
     _imp->duringInputChangedAction = true;
     std::map<int,MaskSelector>::iterator found = _imp->maskSelectors.find(inputNb);
     if ( found != _imp->maskSelectors.end() ) {
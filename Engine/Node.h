@@ -657,6 +657,12 @@ public:
     void refreshPreviewsRecursivelyUpstream(int time);
 
     void incrementKnobsAge();
+    
+    /**
+     * @brief Same as calling incrementKnobsAge() on each node, except that the hash of every node affected is
+     * recomputed only once, after the hash of all its inputs.
+     **/
+    static void incrementKnobsAgeOfNodes(const std::list<Natron::Node*>& nodes);
 
     U64 getKnobsAge() const;
 
@@ -1029,6 +1035,11 @@ private:
     
     void computeHashInternal(std::list<Natron::Node*>& marked);
     
+    ///Recompute the hash of this node only, assuming the hash of its inputs is up to date
+    void computeHashNoRecursion();
+    
+    void incrementKnobsAgeNoHash();
+    
     void declareRotoPythonField();
 
     
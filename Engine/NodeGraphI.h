@@ -25,6 +25,11 @@ public:
     
     virtual void onNodesCleared() = 0;
     
+    /**
+     * @brief Called when the nodes of a group loaded on demand were created, see NodeGroup::loadPendingChildren
+     **/
+    virtual void onPendingNodesLoaded() = 0;
+    
 };
 
 #endif // NODEGRAPHI_H
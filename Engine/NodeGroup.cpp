@@ -18,12 +18,17 @@
 #include <set>
 #include <locale>
 #include <cfloat>
+
+#include <boost/unordered_map.hpp>
+
 #include <QThreadPool>
 #include <QCoreApplication>
 #include <QTextStream>
+#include <QDebug>
 
 #include "Engine/AppInstance.h"
 #include "Engine/Node.h"
+#include "Engine/NumaPlacement.h"
 #include "Engine/OutputSchedulerThread.h"
 #include "Engine/Project.h"
 #include "Engine/KnobTypes.h"
@@ -36,6 +41,8 @@
 #include "Engine/Curve.h"
 #include "Engine/NodeGraphI.h"
 #include "Engine/RotoContext.h"
+#include "Engine/NodeGroupSerialization.h"
+#include "Engine/Timer.h"
 
 #define NATRON_PYPLUG_EXPORTER_VERSION 1
 
@@ -50,18 +57,75 @@ struct NodeCollectionPrivate
     mutable QMutex nodesMutex;
     NodeList nodes;
     
+    ///Index of the nodes by script name, kept up to date by addNode, removeNode and onNodeScriptNameChanged.
+    ///Nodes being created are indexed with an empty name until they are given one.
+    typedef boost::unordered_multimap<std::string,NodePtr> NodesByNameMap;
+    NodesByNameMap nodesByName;
+    
+    ///For a base name passed to setNodeName, all the names made of the base name followed by a number
+    ///lower than the hint are taken. Cleared whenever a name is freed.
+    std::map<std::string,int> nameDigitHints;
+    
     NodeCollectionPrivate(AppInstance* app)
     : app(app)
     , graph(0)
     , nodesMutex()
     , nodes()
+    , nodesByName()
+    , nameDigitHints()
     {
         
     }
     
     NodePtr findNodeInternal(const std::string& name,const std::string& recurseName) const;
+    
+    ///Must be called with nodesMutex locked. Returns the node of the collection with the given script name
+    ///other than the caller, if any.
+    NodePtr findNodeByName_locked(const std::string& name,const Natron::Node* caller = 0) const;
+    
+    ///Must be called with nodesMutex locked. Returns false if the node was not indexed under this name.
+    bool unindexNode(const std::string& name,const Natron::Node* node);
 };
 
+NodePtr
+NodeCollectionPrivate::findNodeByName_locked(const std::string& name,const Natron::Node* caller) const
+{
+    std::pair<NodesByNameMap::const_iterator,NodesByNameMap::const_iterator> range = nodesByName.equal_range(name);
+    NodePtr ret;
+    int nFound = 0;
+    for (NodesByNameMap::const_iterator it = range.first; it != range.second; ++it) {
+        if (it->second.get() != caller) {
+            ret = it->second;
+            ++nFound;
+        }
+    }
+    if (nFound <= 1) {
+        return ret;
+    }
+    
+    ///Several nodes have the same name (this can happen with Node::setScriptName_no_error_check):
+    ///return the first one that was added to the collection.
+    for (NodeList::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        if (it->get() != caller && (*it)->getScriptName_mt_safe() == name) {
+            return *it;
+        }
+    }
+    return ret;
+}
+
+bool
+NodeCollectionPrivate::unindexNode(const std::string& name,const Natron::Node* node)
+{
+    std::pair<NodesByNameMap::iterator,NodesByNameMap::iterator> range = nodesByName.equal_range(name);
+    for (NodesByNameMap::iterator it = range.first; it != range.second; ++it) {
+        if (it->second.get() == node) {
+            nodesByName.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
 NodeCollection::NodeCollection(AppInstance* app)
 : _imp(new NodeCollectionPrivate(app))
 {
@@ -132,17 +196,53 @@ NodeCollection::addNode(const NodePtr& node)
     {
         QMutexLocker k(&_imp->nodesMutex);
         _imp->nodes.push_back(node);
+        _imp->nodesByName.insert( std::make_pair(node->getScriptName_mt_safe(), node) );
+    }
+    notifyStructureModified();
+}
+
+void
+NodeCollection::notifyStructureModified()
+{
+    boost::shared_ptr<Natron::Project> project = getApplication()->getProject();
+    if (project) {
+        project->markStructureModified();
     }
 }
 
 
 void
 NodeCollection::removeNode(const NodePtr& node)
+{
+    {
+        QMutexLocker k(&_imp->nodesMutex);
+        NodeList::iterator found = std::find(_imp->nodes.begin(), _imp->nodes.end(), node);
+        if (found != _imp->nodes.end()) {
+            _imp->nodes.erase(found);
+            if ( !_imp->unindexNode(node->getScriptName_mt_safe(), node.get()) ) {
+                for (NodeCollectionPrivate::NodesByNameMap::iterator it = _imp->nodesByName.begin(); it != _imp->nodesByName.end(); ++it) {
+                    if (it->second == node) {
+                        _imp->nodesByName.erase(it);
+                        break;
+                    }
+                }
+            }
+            _imp->nameDigitHints.clear();
+        }
+    }
+    notifyStructureModified();
+}
+
+void
+NodeCollection::onNodeScriptNameChanged(const NodePtr& node,const std::string& oldName,const std::string& newName)
 {
     QMutexLocker k(&_imp->nodesMutex);
-    NodeList::iterator found = std::find(_imp->nodes.begin(), _imp->nodes.end(), node);
-    if (found != _imp->nodes.end()) {
-        _imp->nodes.erase(found);
+    ///The node may not belong to this collection yet
+    if ( _imp->unindexNode(oldName, node.get()) ) {
+        _imp->nodesByName.insert( std::make_pair(newName, node) );
+        if ( !oldName.empty() ) {
+            _imp->nameDigitHints.clear();
+        }
     }
 }
 
@@ -364,6 +464,8 @@ NodeCollection::clearNodes(bool emitSignal)
     {
         QMutexLocker l(&_imp->nodesMutex);
         _imp->nodes.clear();
+        _imp->nodesByName.clear();
+        _imp->nameDigitHints.clear();
     }
     
     nodesToDelete.clear();
@@ -385,6 +487,14 @@ NodeCollection::setNodeName(const std::string& baseName,bool appendDigit,bool er
     bool foundNodeWithName = false;
     int no = 1;
 
+    QMutexLocker l(&_imp->nodesMutex);
+    if (appendDigit) {
+        ///Skip the numbers we already know are taken
+        std::map<std::string,int>::iterator foundHint = _imp->nameDigitHints.find(cpy);
+        if ( foundHint != _imp->nameDigitHints.end() ) {
+            no = foundHint->second;
+        }
+    }
     {
         std::stringstream ss;
         ss << cpy;
@@ -394,14 +504,7 @@ NodeCollection::setNodeName(const std::string& baseName,bool appendDigit,bool er
         *nodeName = ss.str();
     }
     do {
-        foundNodeWithName = false;
-        QMutexLocker l(&_imp->nodesMutex);
-        for (NodeList::iterator it = _imp->nodes.begin(); it != _imp->nodes.end(); ++it) {
-            if ((*it)->getScriptName_mt_safe() == *nodeName) {
-                foundNodeWithName = true;
-                break;
-            }
-        }
+        foundNodeWithName = _imp->nodesByName.find(*nodeName) != _imp->nodesByName.end();
         if (foundNodeWithName) {
             if (errorIfExists || !appendDigit) {
                 return false;
@@ -414,6 +517,9 @@ NodeCollection::setNodeName(const std::string& baseName,bool appendDigit,bool er
             }
         }
     } while (foundNodeWithName);
+    if (appendDigit) {
+        _imp->nameDigitHints[cpy] = no;
+    }
     return true;
 }
 
@@ -619,25 +725,25 @@ NodeCollection::autoConnectNodes(const NodePtr& selected,const NodePtr& created)
 NodePtr
 NodeCollectionPrivate::findNodeInternal(const std::string& name,const std::string& recurseName) const
 {
-    QMutexLocker k(&nodesMutex);
-    for (NodeList::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
-        if ((*it)->getScriptName_mt_safe() == name) {
-            if (!recurseName.empty()) {
-                NodeGroup* isGrp = dynamic_cast<NodeGroup*>((*it)->getLiveInstance());
-                if (isGrp) {
-                    return isGrp->getNodeByFullySpecifiedName(recurseName);
-                } else {
-                    std::list<NodePtr> children;
-                    (*it)->getChildrenMultiInstance(&children);
-                    for (std::list<NodePtr>::iterator it2 = children.begin(); it2 != children.end(); ++it2) {
-                        if ((*it2)->getScriptName_mt_safe() == recurseName) {
-                            return *it2;
-                        }
-                    }
-                }
-            } else {
-                return *it;
-            }
+    NodePtr found;
+    {
+        QMutexLocker k(&nodesMutex);
+        found = findNodeByName_locked(name);
+    }
+    if (!found || recurseName.empty()) {
+        return found;
+    }
+    
+    ///Each level of the path is looked-up in the index of the corresponding group
+    NodeGroup* isGrp = dynamic_cast<NodeGroup*>(found->getLiveInstance());
+    if (isGrp) {
+        return isGrp->getNodeByFullySpecifiedName(recurseName);
+    }
+    std::list<NodePtr> children;
+    found->getChildrenMultiInstance(&children);
+    for (std::list<NodePtr>::iterator it = children.begin(); it != children.end(); ++it) {
+        if ((*it)->getScriptName_mt_safe() == recurseName) {
+            return *it;
         }
     }
     return NodePtr();
@@ -794,13 +900,7 @@ bool
 NodeCollection::checkIfNodeNameExists(const std::string & n,const Natron::Node* caller) const
 {
     QMutexLocker k(&_imp->nodesMutex);
-    for (NodeList::const_iterator it = _imp->nodes.begin(); it != _imp->nodes.end(); ++it) {
-        if ( (it->get() != caller) && ( (*it)->getScriptName_mt_safe() == n ) ) {
-            return true;
-        }
-    }
-    
-    return false;
+    return _imp->findNodeByName_locked(n, caller).get() != 0;
 }
 
 void
@@ -854,7 +954,9 @@ NodeCollection::setParallelRenderArgs(int time,
                                       Natron::OutputEffectInstance* renderRequester,
                                       int textureIndex,
                                       const TimeLine* timeline,
-                                      bool isAnalysis)
+                                      bool isAnalysis,
+                                      Natron::RenderPriorityEnum priority,
+                                      int numaNode)
 {
     NodeList nodes = getNodes();
     for (NodeList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
@@ -868,7 +970,7 @@ NodeCollection::setParallelRenderArgs(int time,
         }
         Natron::EffectInstance* liveInstance = (*it)->getLiveInstance();
         assert(liveInstance);
-        liveInstance->setParallelRenderArgsTLS(time, view, isRenderUserInteraction, isSequential, canAbort, (*it)->getHashValue(), rotoAge, renderAge,renderRequester,textureIndex, timeline, isAnalysis);
+        liveInstance->setParallelRenderArgsTLS(time, view, isRenderUserInteraction, isSequential, canAbort, (*it)->getHashValue(), rotoAge, renderAge,renderRequester,textureIndex, timeline, isAnalysis, priority, numaNode);
         
         if ((*it)->isMultiInstance()) {
             
@@ -880,7 +982,7 @@ NodeCollection::setParallelRenderArgs(int time,
                 assert(*it2);
                 Natron::EffectInstance* childLiveInstance = (*it2)->getLiveInstance();
                 assert(childLiveInstance);
-                childLiveInstance->setParallelRenderArgsTLS(time, view, isRenderUserInteraction, isSequential, canAbort, (*it2)->getHashValue(), rotoAge, renderAge,renderRequester, textureIndex, timeline, isAnalysis);
+                childLiveInstance->setParallelRenderArgsTLS(time, view, isRenderUserInteraction, isSequential, canAbort, (*it2)->getHashValue(), rotoAge, renderAge,renderRequester, textureIndex, timeline, isAnalysis, priority, numaNode);
                 
             }
         }
@@ -888,7 +990,7 @@ NodeCollection::setParallelRenderArgs(int time,
         
         NodeGroup* isGrp = dynamic_cast<NodeGroup*>((*it)->getLiveInstance());
         if (isGrp) {
-            isGrp->setParallelRenderArgs(time, view, isRenderUserInteraction, isSequential, canAbort,  renderAge, renderRequester, textureIndex, timeline, isAnalysis);
+            isGrp->setParallelRenderArgs(time, view, isRenderUserInteraction, isSequential, canAbort,  renderAge, renderRequester, textureIndex, timeline, isAnalysis, priority, numaNode);
         }
 
     }
@@ -968,16 +1070,29 @@ ParallelRenderArgsSetter::ParallelRenderArgsSetter(NodeCollection* n,
                                                    Natron::OutputEffectInstance* renderRequester,
                                                    int textureIndex,
                                                    const TimeLine* timeline,
-                                                   bool isAnalysis)
+                                                   bool isAnalysis,
+                                                   Natron::RenderPriorityEnum priority,
+                                                   bool isFrameRender,
+                                                   bool isParallelSequenceFrame)
 : collection(n)
 , argsMap()
+, priorityScope()
+, numaPlacement()
 {
-    collection->setParallelRenderArgs(time,view,isRenderUserInteraction,isSequential,canAbort,renderAge,renderRequester,textureIndex,timeline,isAnalysis);
+    assert(isFrameRender || !isParallelSequenceFrame);
+    numaPlacement.reset( new Natron::NumaFramePlacement(appPTR->getNumaPlacement(), isParallelSequenceFrame) );
+    collection->setParallelRenderArgs(time,view,isRenderUserInteraction,isSequential,canAbort,renderAge,renderRequester,textureIndex,timeline,isAnalysis,priority,
+                                      numaPlacement->getNode());
+    if (isFrameRender) {
+        priorityScope.reset( new Natron::RenderPriorityScope(appPTR->getRenderPriorityArbiter(), priority) );
+    }
 }
 
 ParallelRenderArgsSetter::ParallelRenderArgsSetter(const std::map<boost::shared_ptr<Natron::Node>,ParallelRenderArgs >& args)
 : collection(0)
 , argsMap(args)
+, priorityScope()
+, numaPlacement()
 {
     for (std::map<boost::shared_ptr<Natron::Node>,ParallelRenderArgs >::iterator it = argsMap.begin(); it != argsMap.end(); ++it) {
         it->first->getLiveInstance()->setParallelRenderArgsTLS(it->second);
@@ -1006,6 +1121,9 @@ struct NodeGroupPrivate
     bool isDeactivatingGroup;
     bool isActivatingGroup;
     
+    ///The serialization of the nodes not created yet when the group is loaded on demand, protected by nodesLock
+    std::list<boost::shared_ptr<NodeSerialization> > pendingChildren;
+    
     boost::shared_ptr<Button_Knob> exportAsTemplate;
     
     NodeGroupPrivate()
@@ -1014,6 +1132,7 @@ struct NodeGroupPrivate
     , outputs()
     , isDeactivatingGroup(false)
     , isActivatingGroup(false)
+    , pendingChildren()
     , exportAsTemplate()
     {
         
@@ -1056,6 +1175,137 @@ NodeGroup::setIsActivatingGroup(bool b)
     _imp->isActivatingGroup = b;
 }
 
+void
+NodeGroup::setPendingChildren(const std::list<boost::shared_ptr<NodeSerialization> >& children)
+{
+    QMutexLocker k(&_imp->nodesLock);
+    _imp->pendingChildren = children;
+}
+
+bool
+NodeGroup::hasPendingChildren() const
+{
+    QMutexLocker k(&_imp->nodesLock);
+    return !_imp->pendingChildren.empty();
+}
+
+void
+NodeGroup::getPendingChildren(std::list<boost::shared_ptr<NodeSerialization> >* children) const
+{
+    QMutexLocker k(&_imp->nodesLock);
+    children->insert(children->end(), _imp->pendingChildren.begin(), _imp->pendingChildren.end());
+}
+
+void
+NodeGroup::loadPendingChildren()
+{
+    assert(QThread::currentThread() == qApp->thread());
+    
+    std::list<boost::shared_ptr<NodeSerialization> > children;
+    {
+        QMutexLocker k(&_imp->nodesLock);
+        children.swap(_imp->pendingChildren);
+    }
+    if (children.empty()) {
+        return;
+    }
+    
+    boost::shared_ptr<Project> project = getApp()->getProject();
+    bool projectLoading = project->isLoadingProject();
+    TimeLapse timer;
+    
+    ///Sub-groups are deferred as well, only those needed by the output of this group are loaded below
+    NodesLoadContext context;
+    context.deferGroups = true;
+    context.addReferencedNames(children);
+    
+    boost::shared_ptr<NodeGroup> thisShared = boost::dynamic_pointer_cast<NodeGroup>( shared_from_this() );
+    std::map<std::string,bool> processedModules;
+    bool hasWriter = false;
+    bool ok;
+    project->beginLoadingGroupOnDemand();
+    try {
+        ok = NodeCollectionSerialization::restoreFromSerialization(children, thisShared, true, &processedModules, &hasWriter, &context);
+    } catch (...) {
+        project->endLoadingGroupOnDemand();
+        throw;
+    }
+    project->endLoadingGroupOnDemand();
+    if (!ok) {
+        appPTR->showOfxLog();
+    }
+    
+    NodePtr output = getOutputNode();
+    if (output) {
+        loadPendingGroupsUpstream( output.get() );
+    }
+    
+    ///When the nodes are created while the project is restored, the gui state of the project is not read yet
+    NodeGraphI* graph = getNodeGraph();
+    if ( graph && !project->isLoadingProjectInternal() ) {
+        graph->onPendingNodesLoaded();
+    }
+    
+    ///The project does it once all nodes are loaded
+    if (!projectLoading) {
+        project->forceGetClipPreferencesOnAllTrees();
+        getNode()->computeHash();
+    }
+    
+#ifdef DEBUG
+    qDebug() << "Loaded" << context.nCreatedNodes << "node(s) of" << getNode()->getFullyQualifiedName().c_str() << "on demand in"
+             << timer.getTimeSinceCreation() << "s (nodes creation" << context.creationTime << "s, links" << context.linksTime << "s)";
+#endif
+}
+
+static void
+loadPendingGroupsUpstreamRecursive(Natron::Node* node,
+                                   std::set<Natron::Node*>* visited)
+{
+    if ( !visited->insert(node).second ) {
+        return;
+    }
+    NodeGroup* isGrp = dynamic_cast<NodeGroup*>( node->getLiveInstance() );
+    if (isGrp) {
+        isGrp->loadPendingChildren();
+        ///The group may have been loaded before its sub-groups were needed
+        NodePtr output = isGrp->getOutputNode();
+        if (output) {
+            loadPendingGroupsUpstreamRecursive(output.get(), visited);
+        }
+    }
+    const std::vector<NodePtr> inputs = node->getInputs_copy();
+    for (std::vector<NodePtr>::const_iterator it = inputs.begin(); it != inputs.end(); ++it) {
+        if (*it) {
+            loadPendingGroupsUpstreamRecursive(it->get(), visited);
+        }
+    }
+}
+
+static void
+loadAllPendingChildren(NodeCollection* collection)
+{
+    NodeGroup* isGrp = dynamic_cast<NodeGroup*>(collection);
+    if (isGrp) {
+        isGrp->loadPendingChildren();
+    }
+    NodeList nodes = collection->getNodes();
+    for (NodeList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        NodeGroup* isSubGrp = dynamic_cast<NodeGroup*>( (*it)->getLiveInstance() );
+        if (isSubGrp) {
+            loadAllPendingChildren(isSubGrp);
+        }
+    }
+}
+
+void
+NodeGroup::loadPendingGroupsUpstream(Natron::Node* node)
+{
+    assert(QThread::currentThread() == qApp->thread());
+    std::set<Natron::Node*> visited;
+    loadPendingGroupsUpstreamRecursive(node, &visited);
+}
+
 NodeGroup::~NodeGroup()
 {
     
@@ -2286,6 +2536,9 @@ NodeCollection::exportGroupToPython(const QString& pluginID,
                                     const QString& pluginGrouping,
                                     QString& output)
 {
+    ///The script must contain all the nodes of the group, even those of groups loaded on demand
+    loadAllPendingChildren(this);
+    
     QTextStream ts(&output);
     // coding must be set in first or second line, see https://www.python.org/dev/peps/pep-0263/
     WRITE_STATIC_LINE("# -*- coding: utf-8 -*-");
@@ -32,11 +32,13 @@ typedef std::list<NodePtr> NodeList;
 namespace Natron {
 class Node;
 class OutputEffectInstance;
+class NumaFramePlacement;
 }
 class TimeLine;
 class NodeGraphI;
 class KnobI;
 class ViewerInstance;
+class NodeSerialization;
 struct NodeCollectionPrivate;
 class NodeCollection
 {
@@ -76,6 +78,11 @@ public:
      **/
     void removeNode(const NodePtr& node);
     
+    /**
+     * @brief Called by the node when its script name changed so that it can still be found by getNodeByName(). MT-safe.
+     **/
+    void onNodeScriptNameChanged(const NodePtr& node,const std::string& oldName,const std::string& newName);
+    
     /**
      * @brief Get the last node added with the given id
      **/
@@ -225,7 +232,9 @@ public:
                                Natron::OutputEffectInstance* renderRequester,
                                int textureIndex,
                                const TimeLine* timeline,
-                               bool isAnalysis);
+                               bool isAnalysis,
+                               Natron::RenderPriorityEnum priority,
+                               int numaNode);
     void invalidateParallelRenderArgs();
     
     void getParallelRenderArgs(std::map<boost::shared_ptr<Natron::Node>,ParallelRenderArgs >& argsMap) const;
@@ -268,6 +277,11 @@ public:
 
 private:
     
+    /**
+     * @brief Notifies the project that the next save must write all nodes.
+     **/
+    void notifyStructureModified();
+    
     boost::scoped_ptr<NodeCollectionPrivate> _imp;
 };
 
@@ -277,8 +291,20 @@ class ParallelRenderArgsSetter
     NodeCollection* collection;
     std::map<boost::shared_ptr<Natron::Node>,ParallelRenderArgs > argsMap;
     
+    ///Registers the frame render with the render priority arbiter while the args are set
+    boost::scoped_ptr<Natron::RenderPriorityScope> priorityScope;
+    
+    ///The NUMA node the frame render is placed on, and the placement of the thread rendering it
+    boost::scoped_ptr<Natron::NumaFramePlacement> numaPlacement;
+    
 public:
     
+    /**
+     * @brief isFrameRender is false when the args are only set to call actions such as getRegionOfDefinition or
+     * to look up the cache: the render priority arbiter only counts the setters that actually render a frame.
+     * isParallelSequenceFrame is set by the render schedulers when the frame is one of several frames of a sequence
+     * rendered at the same time: only those frames are placed on a NUMA node, see NumaFramePlacement.
+     **/
     ParallelRenderArgsSetter(NodeCollection* n,
                              int time,
                              int view,
@@ -289,7 +315,10 @@ public:
                              Natron::OutputEffectInstance* renderRequester,
                              int textureIndex,
                              const TimeLine* timeline,
-                             bool isAnalysis);
+                             bool isAnalysis,
+                             Natron::RenderPriorityEnum priority,
+                             bool isFrameRender,
+                             bool isParallelSequenceFrame);
     
     ParallelRenderArgsSetter(const std::map<boost::shared_ptr<Natron::Node>,ParallelRenderArgs >& args);
     
@@ -390,6 +419,33 @@ public:
     bool getIsActivatingGroup() const;
     void setIsActivatingGroup(bool b);
     
+    /**
+     * @brief When groups are loaded on demand, the nodes of the group other than its inputs are not created when the project
+     * is loaded: their serialization is kept until loadPendingChildren() is called.
+     **/
+    void setPendingChildren(const std::list<boost::shared_ptr<NodeSerialization> >& children);
+    
+    bool hasPendingChildren() const;
+    
+    /**
+     * @brief Appends the serialization of the nodes that are not created yet to children, so that saving the project
+     * or copying the group does not require to load it.
+     **/
+    void getPendingChildren(std::list<boost::shared_ptr<NodeSerialization> >* children) const;
+    
+    /**
+     * @brief Creates the nodes whose creation was deferred when the project was loaded, as well as the nodes of the
+     * sub-groups that are upstream of the output of the group. Does nothing if there are none.
+     * Must be called on the main-thread.
+     **/
+    void loadPendingChildren();
+    
+    /**
+     * @brief Loads the pending nodes of node if it is a group and of all the groups upstream of it.
+     * Must be called on the main-thread.
+     **/
+    static void loadPendingGroupsUpstream(Natron::Node* node);
+    
 private:
     
     virtual void initializeKnobs() OVERRIDE FINAL;
@@ -21,6 +21,8 @@
 #include "Engine/Settings.h"
 #include "Engine/AppInstance.h"
 #include "Engine/NodeGroup.h"
+#include "Engine/Plugin.h"
+#include "Engine/Timer.h"
 #include "Engine/ViewerInstance.h"
 
 void
@@ -39,12 +41,123 @@ NodeCollectionSerialization::initialize(const NodeCollection& group)
     }
 }
 
+namespace {
+
+///Splits an expression or a node name into the identifiers it is made of
+void
+addWords(const std::string & str,
+         std::set<std::string>* words)
+{
+    std::string word;
+    for (std::size_t i = 0; i <= str.size(); ++i) {
+        char c = i < str.size() ? str[i] : ' ';
+        if ( ( (c >= 'a') && (c <= 'z') ) || ( (c >= 'A') && (c <= 'Z') ) || ( (c >= '0') && (c <= '9') ) || (c == '_') ) {
+            word.push_back(c);
+        } else if ( !word.empty() ) {
+            words->insert(word);
+            word.clear();
+        }
+    }
+}
+
+void
+addKnobReferencedNames(const KnobSerializationBase* knob,
+                       std::set<std::string>* names)
+{
+    const KnobSerialization* isKnob = dynamic_cast<const KnobSerialization*>(knob);
+    if (isKnob) {
+        const std::list<MasterSerialization> & masters = isKnob->getMasters();
+        for (std::list<MasterSerialization>::const_iterator it = masters.begin(); it != masters.end(); ++it) {
+            if (it->masterDimension != -1) {
+                addWords(it->masterNodeName, names);
+            }
+        }
+        const std::vector<std::pair<std::string,bool> > & expressions = isKnob->getExpressions();
+        for (std::size_t i = 0; i < expressions.size(); ++i) {
+            addWords(expressions[i].first, names);
+        }
+        return;
+    }
+    const GroupKnobSerialization* isGroup = dynamic_cast<const GroupKnobSerialization*>(knob);
+    if (isGroup) {
+        const std::list<boost::shared_ptr<KnobSerializationBase> > & children = isGroup->getChildren();
+        for (std::list<boost::shared_ptr<KnobSerializationBase> >::const_iterator it = children.begin(); it != children.end(); ++it) {
+            addKnobReferencedNames(it->get(), names);
+        }
+    }
+}
+
+int
+countNodes(const std::list< boost::shared_ptr<NodeSerialization> > & serializedNodes)
+{
+    int ret = 0;
+    for (std::list< boost::shared_ptr<NodeSerialization> >::const_iterator it = serializedNodes.begin(); it != serializedNodes.end(); ++it) {
+        ret += 1 + countNodes( (*it)->getNodesCollection() );
+    }
+    return ret;
+}
+
+///Viewers and writers must exist as soon as the project is loaded: a group containing one is never deferred
+bool
+containsOutputNode(const std::list< boost::shared_ptr<NodeSerialization> > & serializedNodes)
+{
+    for (std::list< boost::shared_ptr<NodeSerialization> >::const_iterator it = serializedNodes.begin(); it != serializedNodes.end(); ++it) {
+        const std::string & pluginID = (*it)->getPluginID();
+        if ( (pluginID == PLUGINID_NATRON_VIEWER) || (pluginID == "Viewer") || (pluginID == PLUGINID_NATRON_DISKCACHE) ) {
+            return true;
+        }
+        try {
+            Natron::Plugin* plugin = appPTR->getPluginBinary( pluginID.c_str(), (*it)->getPluginMajorVersion(), (*it)->getPluginMinorVersion(), false );
+            if ( !plugin || plugin->isWriter() ) {
+                return true;
+            }
+        } catch (const std::exception &) {
+            ///Unknown plug-in: let the load of the group report it right away
+            return true;
+        }
+        if ( containsOutputNode( (*it)->getNodesCollection() ) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+canDeferGroupChildren(const NodeSerialization & group,
+                      const NodesLoadContext & context)
+{
+    if ( context.referencedNames.find( group.getNodeScriptName() ) != context.referencedNames.end() ) {
+        return false;
+    }
+    return !containsOutputNode( group.getNodesCollection() );
+}
+
+}
+
+void
+NodesLoadContext::addReferencedNames(const std::list< boost::shared_ptr<NodeSerialization> > & serializedNodes)
+{
+    for (std::list< boost::shared_ptr<NodeSerialization> >::const_iterator it = serializedNodes.begin(); it != serializedNodes.end(); ++it) {
+        addWords( (*it)->getMasterNodeName(), &referencedNames );
+        const NodeSerialization::KnobValues & knobs = (*it)->getKnobsValues();
+        for (NodeSerialization::KnobValues::const_iterator it2 = knobs.begin(); it2 != knobs.end(); ++it2) {
+            addKnobReferencedNames(it2->get(), &referencedNames);
+        }
+        const std::list<boost::shared_ptr<GroupKnobSerialization> > & userPages = (*it)->getUserPages();
+        for (std::list<boost::shared_ptr<GroupKnobSerialization> >::const_iterator it2 = userPages.begin(); it2 != userPages.end(); ++it2) {
+            addKnobReferencedNames(it2->get(), &referencedNames);
+        }
+        addReferencedNames( (*it)->getNodesCollection() );
+    }
+}
+
 bool
 NodeCollectionSerialization::restoreFromSerialization(const std::list< boost::shared_ptr<NodeSerialization> > & serializedNodes,
                                                       const boost::shared_ptr<NodeCollection>& group,
                                                       bool createNodes,
                                                       std::map<std::string,bool>* moduleUpdatesProcessed,
-                                                      bool* hasProjectAWriter)
+                                                      bool* hasProjectAWriter,
+                                                      NodesLoadContext* context)
 {
     
 
@@ -181,6 +294,8 @@ NodeCollectionSerialization::restoreFromSerialization(const std::list< boost::sh
             }
         }
         
+        TimeLapse creationTimer;
+        
         if (!createNodes) {
             ///We are in the case where we loaded a PyPlug: it probably created all the nodes in the group already but didn't
             ///load their serialization
@@ -206,6 +321,12 @@ NodeCollectionSerialization::restoreFromSerialization(const std::list< boost::sh
                                                                 ,majorVersion
                                                                 ,minorVersion,it->get(),false,group) );
         }
+        if (context) {
+            context->creationTime += creationTimer.getTimeSinceCreation();
+            if (n) {
+                ++context->nCreatedNodes;
+            }
+        }
         if (!n) {
             QString text( QObject::tr("The node ") );
             text.append( pluginID.c_str() );
@@ -225,10 +346,29 @@ NodeCollectionSerialization::restoreFromSerialization(const std::list< boost::sh
             if (isGrp) {
                 boost::shared_ptr<Natron::EffectInstance> sharedEffect = isGrp->shared_from_this();
                 boost::shared_ptr<NodeGroup> sharedGrp = boost::dynamic_pointer_cast<NodeGroup>(sharedEffect);
-                NodeCollectionSerialization::restoreFromSerialization(children, sharedGrp ,!usingPythonModule, moduleUpdatesProcessed, hasProjectAWriter);
+                if ( context && context->deferGroups && !usingPythonModule && canDeferGroupChildren(**it, *context) ) {
+                    ///Only create the inputs of the group, they define its inputs in the graph. The other nodes are created
+                    ///by NodeGroup::loadPendingChildren when the group is needed.
+                    std::list< boost::shared_ptr<NodeSerialization> > inputs, pending;
+                    for (std::list< boost::shared_ptr<NodeSerialization> >::const_iterator it2 = children.begin(); it2 != children.end(); ++it2) {
+                        if ( (*it2)->getPluginID() == PLUGINID_NATRON_INPUT ) {
+                            inputs.push_back(*it2);
+                        } else {
+                            pending.push_back(*it2);
+                        }
+                    }
+                    NodeCollectionSerialization::restoreFromSerialization(inputs, sharedGrp, true, moduleUpdatesProcessed, hasProjectAWriter, context);
+                    if ( !pending.empty() ) {
+                        isGrp->setPendingChildren(pending);
+                        ++context->nDeferredGroups;
+                        context->nDeferredNodes += countNodes(pending);
+                    }
+                } else {
+                    NodeCollectionSerialization::restoreFromSerialization(children, sharedGrp ,!usingPythonModule, moduleUpdatesProcessed, hasProjectAWriter, context);
+                }
             } else {
                 assert(n->isMultiInstance());
-                NodeCollectionSerialization::restoreFromSerialization(children, group, true, moduleUpdatesProcessed,  hasProjectAWriter);
+                NodeCollectionSerialization::restoreFromSerialization(children, group, true, moduleUpdatesProcessed,  hasProjectAWriter, context);
             }
         }
     }
@@ -236,6 +376,8 @@ NodeCollectionSerialization::restoreFromSerialization(const std::list< boost::sh
     
     group->getApplication()->updateProjectLoadStatus(QObject::tr("Restoring graph links in group: ") + groupName);
 
+    TimeLapse linksTimer;
+    
     NodeList nodes = group->getNodes();
     
     /// Connect the nodes together, and restore the slave/master links for all knobs.
@@ -346,5 +488,8 @@ NodeCollectionSerialization::restoreFromSerialization(const std::list< boost::sh
             }
         }
     }
+    if (context) {
+        context->linksTime += linksTimer.getTimeSinceCreation();
+    }
     return !mustShowErrorsLog;
 }
\ No newline at end of file
@@ -17,6 +17,9 @@
 // "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
 #include <Python.h>
 
+#include <set>
+#include <string>
+
 #include "Global/Macros.h"
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 CLANG_DIAG_OFF(unused-parameter)
@@ -38,6 +41,46 @@ CLANG_DIAG_ON(unused-parameter)
 
 #define NODE_GROUP_SERIALIZATION_VERSION 1
 
+/**
+ * @brief Passed to NodeCollectionSerialization::restoreFromSerialization when loading a project. It tells whether the creation
+ * of the nodes inside groups may be deferred until the group is needed (see NodeGroup::loadPendingChildren) and gathers the
+ * time spent in each phase of the load.
+ **/
+struct NodesLoadContext
+{
+    bool deferGroups;
+    
+    ///The words found in the expressions and links of all the serialized nodes: a group whose name is one of them
+    ///is referenced from elsewhere and its nodes must be created right away.
+    std::set<std::string> referencedNames;
+    
+    ///Seconds spent creating the nodes and restoring their parameters
+    double creationTime;
+    
+    ///Seconds spent restoring the links, expressions and connections
+    double linksTime;
+    
+    int nCreatedNodes;
+    int nDeferredGroups;
+    int nDeferredNodes;
+    
+    NodesLoadContext()
+    : deferGroups(false)
+    , referencedNames()
+    , creationTime(0.)
+    , linksTime(0.)
+    , nCreatedNodes(0)
+    , nDeferredGroups(0)
+    , nDeferredNodes(0)
+    {
+    }
+    
+    /**
+     * @brief Fills referencedNames from the given serializations and their children.
+     **/
+    void addReferencedNames(const std::list< boost::shared_ptr<NodeSerialization> > & serializedNodes);
+};
+
 class NodeCollectionSerialization
 {
     std::list< boost::shared_ptr<NodeSerialization> > _serializedNodes;
@@ -65,11 +108,21 @@ public:
         _serializedNodes.push_back(s);
     }
     
+    /**
+     * @brief Replaces the serialization of the node with the given fully qualified name.
+     * @returns False if no such node was serialized.
+     **/
+    bool replaceNodeSerialization(const std::string& fullyQualifiedName,const boost::shared_ptr<NodeSerialization>& s)
+    {
+        return NodeSerialization::replaceNodeSerialization(&_serializedNodes, fullyQualifiedName, s);
+    }
+    
     static bool restoreFromSerialization(const std::list< boost::shared_ptr<NodeSerialization> > & serializedNodes,
                                          const boost::shared_ptr<NodeCollection>& group,
                                          bool createNodes,
                                          std::map<std::string,bool>* moduleUpdatesProcessed,
-                                         bool* hasProjectAWriter);
+                                         bool* hasProjectAWriter,
+                                         NodesLoadContext* context = 0);
     
 private:
                                          
@@ -14,10 +14,62 @@
 
 #include "NodeGroupWrapper.h"
 
+#include <QThread>
+#include <QCoreApplication>
+
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
 #include "Engine/NodeWrapper.h"
 
+namespace {
+
+///Scripts see all the nodes: create the nodes of the groups loaded on demand on the way to the given node
+void
+loadPendingGroups(boost::shared_ptr<NodeCollection> collection,
+                  const std::string& fullySpecifiedName)
+{
+    if ( QThread::currentThread() != qApp->thread() ) {
+        return;
+    }
+    NodeGroup* isGrp = dynamic_cast<NodeGroup*>( collection.get() );
+    if (isGrp) {
+        isGrp->loadPendingChildren();
+    }
+    std::string remainder = fullySpecifiedName;
+    while ( collection && !remainder.empty() ) {
+        std::string name,next;
+        NodeCollection::getNodeNameAndRemainder_LeftToRight(remainder, name, next);
+        NodePtr node = collection->getNodeByName(name);
+        if (!node || next.empty()) {
+            return;
+        }
+        isGrp = dynamic_cast<NodeGroup*>( node->getLiveInstance() );
+        if (!isGrp) {
+            return;
+        }
+        isGrp->loadPendingChildren();
+        collection = boost::dynamic_pointer_cast<NodeGroup>( isGrp->shared_from_this() );
+        remainder = next;
+    }
+}
+
+}
+
+bool
+loadPendingChildrenForAttribute(Effect* effect)
+{
+    if ( !effect || (QThread::currentThread() != qApp->thread()) ) {
+        return false;
+    }
+    boost::shared_ptr<Natron::Node> node = effect->getInternalNode();
+    NodeGroup* isGrp = node ? dynamic_cast<NodeGroup*>( node->getLiveInstance() ) : 0;
+    if ( !isGrp || !isGrp->hasPendingChildren() ) {
+        return false;
+    }
+    isGrp->loadPendingChildren();
+    return true;
+}
+
 Group::Group()
 : _collection()
 {
@@ -41,6 +93,7 @@ Group::getNode(const std::string& fullySpecifiedName) const
     if (!_collection.lock()) {
         return 0;
     }
+    loadPendingGroups(_collection.lock(), fullySpecifiedName);
     boost::shared_ptr<Natron::Node> node = _collection.lock()->getNodeByFullySpecifiedName(fullySpecifiedName);
     if (node && node->isActivated()) {
         return new Effect(node);
@@ -57,6 +110,7 @@ Group::getChildren() const
         return ret;
     }
 
+    loadPendingGroups(_collection.lock(), std::string());
     NodeList nodes = _collection.lock()->getNodes();
     
     for (NodeList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
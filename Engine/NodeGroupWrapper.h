@@ -52,4 +52,13 @@ public:
 
 };
 
+#if !defined(SBK_RUN)
+/**
+ * @brief Called when a script reads an attribute that the Python object of effect does not have: the nodes of a group
+ * loaded on demand declare their attribute on their group when they are created.
+ * Returns true if the nodes of the group were created by this call.
+ **/
+bool loadPendingChildrenForAttribute(Effect* effect);
+#endif
+
 #endif // NODEGROUPWRAPPER_H
@@ -126,6 +126,9 @@ NodeSerialization::NodeSerialization(const boost::shared_ptr<Natron::Node> & n,b
                 _children.push_back(state);
             }
 
+            ///The nodes of a group loaded on demand that were not created yet
+            isGrp->getPendingChildren(&_children);
+
         }
 
          _multiInstanceParentName = n->getParentMultiInstanceName();
@@ -148,3 +151,24 @@ NodeSerialization::NodeSerialization(const boost::shared_ptr<Natron::Node> & n,b
         _isNull = false;
     }
 }
+
+bool
+NodeSerialization::replaceNodeSerialization(std::list< boost::shared_ptr<NodeSerialization> >* serializedNodes,
+                                            const std::string& fullyQualifiedName,
+                                            const boost::shared_ptr<NodeSerialization>& serialization)
+{
+    std::size_t foundDot = fullyQualifiedName.find('.');
+    std::string scriptName = foundDot == std::string::npos ? fullyQualifiedName : fullyQualifiedName.substr(0, foundDot);
+    
+    for (std::list< boost::shared_ptr<NodeSerialization> >::iterator it = serializedNodes->begin(); it != serializedNodes->end(); ++it) {
+        if ((*it)->getNodeScriptName() != scriptName) {
+            continue;
+        }
+        if (foundDot == std::string::npos) {
+            *it = serialization;
+            return true;
+        }
+        return replaceNodeSerialization(&(*it)->_children, fullyQualifiedName.substr(foundDot + 1), serialization);
+    }
+    return false;
+}
@@ -190,6 +190,15 @@ public:
         return _userComponents;
     }
     
+    /**
+     * @brief Replaces in the given list the serialization of the node with the given fully qualified name
+     * (e.g: "Group1.Blur1"), looking recursively into the children of groups and multi-instance nodes.
+     * @returns True if the node was found.
+     **/
+    static bool replaceNodeSerialization(std::list< boost::shared_ptr<NodeSerialization> >* serializedNodes,
+                                         const std::string& fullyQualifiedName,
+                                         const boost::shared_ptr<NodeSerialization>& serialization);
+    
 private:
 
     bool _isNull;
@@ -14,6 +14,9 @@
 
 #include "NodeWrapper.h"
 
+#include <QCoreApplication>
+#include <QThread>
+
 #include "Engine/Node.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobFile.h"
@@ -549,6 +552,10 @@ Effect::getRegionOfDefinition(int time,int view) const
     if (!_node || !_node->getLiveInstance()) {
         return rod;
     }
+    ///The knobs changed by the script are only evaluated on the next event loop iteration: the hash must reflect them
+    if ( QThread::currentThread() == qApp->thread() ) {
+        _node->getApp()->processPendingEvaluations();
+    }
     U64 hash = _node->getHashValue();
     RenderScale s;
     s.x = s.y = 1.;
@@ -0,0 +1,404 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include "NumaPlacement.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThreadStorage>
+
+using namespace Natron;
+
+namespace {
+///The node each thread is placed on, plus one: 0 means the thread may run on all cores
+QThreadStorage<int> gThreadNode;
+
+QAtomicInt gFirstTouchAllocation;
+
+#if defined(__linux__)
+bool
+readFirstLine(const std::string& path,
+              std::string* line)
+{
+    std::ifstream file( path.c_str() );
+    if ( !file || !std::getline(file, *line) ) {
+        return false;
+    }
+    return true;
+}
+
+void
+getNodesCoresFromSystem(std::vector<int>* allCores,
+                        std::vector<std::vector<int> >* nodesCores)
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return;
+    }
+    for (int i = 0; i < CPU_SETSIZE; ++i) {
+        if ( CPU_ISSET(i, &allowed) ) {
+            allCores->push_back(i);
+        }
+    }
+
+    ///Node numbers may have holes, e.g: nodes without any core or memory that were taken offline
+    std::string line;
+    std::vector<int> nodes;
+    if ( !readFirstLine("/sys/devices/system/node/online", &line) || !NumaPlacement::parseCoresList(line, &nodes) ) {
+        return;
+    }
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        std::stringstream ss;
+        ss << "/sys/devices/system/node/node" << nodes[i] << "/cpulist";
+        std::vector<int> cores;
+        if ( !readFirstLine(ss.str(), &line) || !NumaPlacement::parseCoresList(line, &cores) ) {
+            continue;
+        }
+
+        ///Only keep the cores the process may run on (e.g: when started with taskset or numactl)
+        std::vector<int> nodeCores;
+        for (std::size_t c = 0; c < cores.size(); ++c) {
+            if ( (cores[c] < CPU_SETSIZE) && CPU_ISSET(cores[c], &allowed) ) {
+                nodeCores.push_back(cores[c]);
+            }
+        }
+        if ( !nodeCores.empty() ) {
+            nodesCores->push_back(nodeCores);
+        }
+    }
+}
+
+bool
+setCurrentThreadCores(const std::vector<int>& cores)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (std::size_t i = 0; i < cores.size(); ++i) {
+        if (cores[i] < CPU_SETSIZE) {
+            CPU_SET(cores[i], &set);
+        }
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+#endif // __linux__
+}
+
+namespace Natron {
+struct NumaPlacementPrivate
+{
+    std::vector<std::vector<int> > nodesCores;
+    std::vector<int> allCores; //< the cores of all the nodes, where a thread that is not placed runs
+    QAtomicInt enabled;
+
+    mutable QMutex lock; //< protects all below
+    std::vector<int> nRunning; //< the number of frame renders running on each node
+    int nUnplacedRunning; //< the number of frame renders running on all cores
+    std::vector<U64> nPlaced; //< the number of frame renders placed on each node so far
+    U64 nUnplaced;
+
+    NumaPlacementPrivate()
+    : nodesCores()
+    , allCores()
+    , enabled()
+    , lock()
+    , nRunning()
+    , nUnplacedRunning(0)
+    , nPlaced()
+    , nUnplaced(0)
+    {
+        enabled = 1;
+    }
+
+    void initNodes()
+    {
+        ///Everything runs on a single node if the topology is unknown
+        if ( nodesCores.empty() ) {
+            nodesCores.push_back(allCores);
+        }
+        if ( allCores.empty() ) {
+            for (std::size_t i = 0; i < nodesCores.size(); ++i) {
+                allCores.insert( allCores.end(), nodesCores[i].begin(), nodesCores[i].end() );
+            }
+        }
+        nRunning.resize(nodesCores.size(), 0);
+        nPlaced.resize(nodesCores.size(), 0);
+    }
+};
+} // namespace Natron
+
+NumaPlacement::NumaPlacement()
+: _imp( new NumaPlacementPrivate() )
+{
+#if defined(__linux__)
+    getNodesCoresFromSystem(&_imp->allCores, &_imp->nodesCores);
+#endif
+    _imp->initNodes();
+}
+
+NumaPlacement::NumaPlacement(const std::vector<std::vector<int> >& nodesCores)
+: _imp( new NumaPlacementPrivate() )
+{
+    _imp->nodesCores = nodesCores;
+    _imp->initNodes();
+}
+
+NumaPlacement::~NumaPlacement()
+{
+}
+
+int
+NumaPlacement::getNodesCount() const
+{
+    return (int)_imp->nodesCores.size();
+}
+
+const std::vector<int>&
+NumaPlacement::getNodeCores(int node) const
+{
+    assert( node >= 0 && node < (int)_imp->nodesCores.size() );
+    return _imp->nodesCores[node];
+}
+
+void
+NumaPlacement::setEnabled(bool enabled)
+{
+    _imp->enabled = enabled ? 1 : 0;
+}
+
+bool
+NumaPlacement::isEnabled() const
+{
+    return (int)_imp->enabled != 0;
+}
+
+int
+NumaPlacement::acquireNode()
+{
+    QMutexLocker k(&_imp->lock);
+    int nNodes = (int)_imp->nodesCores.size();
+    int nFrames = _imp->nUnplacedRunning + 1;
+    for (int i = 0; i < nNodes; ++i) {
+        nFrames += _imp->nRunning[i];
+    }
+    if ( !isEnabled() || (nNodes < 2) || (nFrames < nNodes) ) {
+        ++_imp->nUnplacedRunning;
+        ++_imp->nUnplaced;
+        return -1;
+    }
+
+    int node = 0;
+    for (int i = 1; i < nNodes; ++i) {
+        if (_imp->nRunning[i] < _imp->nRunning[node]) {
+            node = i;
+        }
+    }
+    ++_imp->nRunning[node];
+    ++_imp->nPlaced[node];
+    return node;
+}
+
+void
+NumaPlacement::releaseNode(int node)
+{
+    QMutexLocker k(&_imp->lock);
+    if (node == -1) {
+        assert(_imp->nUnplacedRunning > 0);
+        --_imp->nUnplacedRunning;
+    } else {
+        assert( node >= 0 && node < (int)_imp->nRunning.size() && _imp->nRunning[node] > 0 );
+        --_imp->nRunning[node];
+    }
+}
+
+U64
+NumaPlacement::getPlacedFramesCount(int node) const
+{
+    QMutexLocker k(&_imp->lock);
+    if (node == -1) {
+        return _imp->nUnplaced;
+    }
+    assert( node >= 0 && node < (int)_imp->nPlaced.size() );
+    return _imp->nPlaced[node];
+}
+
+void
+NumaPlacement::placeCurrentThread(int node)
+{
+    assert( node >= -1 && node < (int)_imp->nodesCores.size() );
+    int & current = gThreadNode.localData();
+    if (current == node + 1) {
+        return;
+    }
+#if defined(__linux__)
+    if ( !setCurrentThreadCores(node == -1 ? _imp->allCores : _imp->nodesCores[node]) ) {
+        return;
+    }
+#endif
+    current = node + 1;
+}
+
+int
+NumaPlacement::getCurrentThreadNode() const
+{
+    return gThreadNode.localData() - 1;
+}
+
+void*
+NumaPlacement::allocateBuffer(std::size_t size,
+                              bool* mapped)
+{
+    *mapped = false;
+#if defined(__linux__)
+    if ( (size >= NATRON_NUMA_FIRST_TOUCH_MIN_SIZE) && isFirstTouchAllocationEnabled() ) {
+        void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data != MAP_FAILED) {
+            *mapped = true;
+            return data;
+        }
+    }
+#endif
+    return malloc(size);
+}
+
+void
+NumaPlacement::freeBuffer(void* data,
+                          std::size_t size,
+                          bool mapped)
+{
+    if (!data) {
+        return;
+    }
+#if defined(__linux__)
+    if (mapped) {
+        munmap(data, size);
+        return;
+    }
+#else
+    (void)size;
+    assert(!mapped);
+#endif
+    free(data);
+}
+
+void
+NumaPlacement::setFirstTouchAllocationEnabled(bool enabled)
+{
+    gFirstTouchAllocation = enabled ? 1 : 0;
+}
+
+bool
+NumaPlacement::isFirstTouchAllocationEnabled()
+{
+    return (int)gFirstTouchAllocation != 0;
+}
+
+bool
+NumaPlacement::parseCoresList(const std::string& str,
+                              std::vector<int>* cores)
+{
+    std::stringstream ss(str);
+    std::string range;
+    while ( std::getline(ss, range, ',') ) {
+        ///Ignore the trailing new line and spaces
+        std::size_t first = range.find_first_not_of(" \t\n");
+        if (first == std::string::npos) {
+            continue;
+        }
+        std::size_t last = range.find_last_not_of(" \t\n");
+        range = range.substr(first, last - first + 1);
+
+        int from, to;
+        char dash;
+        std::stringstream rs(range);
+        if ( !(rs >> from) || (from < 0) ) {
+            return false;
+        }
+        if (rs >> dash) {
+            if ( (dash != '-') || !(rs >> to) || (to < from) ) {
+                return false;
+            }
+        } else {
+            to = from;
+        }
+        for (int i = from; i <= to; ++i) {
+            cores->push_back(i);
+        }
+    }
+    return true;
+}
+
+NumaThreadPlacement::NumaThreadPlacement(NumaPlacement* placement,
+                                         int node)
+: _placement(placement)
+, _previousNode(-1)
+{
+    assert(_placement);
+    _previousNode = _placement->getCurrentThreadNode();
+    _placement->placeCurrentThread(node);
+}
+
+NumaThreadPlacement::~NumaThreadPlacement()
+{
+    _placement->placeCurrentThread(_previousNode);
+}
+
+NumaNodeScope::NumaNodeScope(NumaPlacement* placement)
+: _placement(placement)
+, _node(-1)
+{
+    assert(_placement);
+    _node = _placement->acquireNode();
+}
+
+NumaNodeScope::~NumaNodeScope()
+{
+    _placement->releaseNode(_node);
+}
+
+NumaFramePlacement::NumaFramePlacement(NumaPlacement* placement,
+                                       bool isParallelSequenceFrame)
+: _nodeScope()
+, _threadPlacement()
+{
+    assert(placement);
+    if (!isParallelSequenceFrame) {
+        return;
+    }
+    _nodeScope.reset( new NumaNodeScope(placement) );
+    int node = _nodeScope->getNode();
+    if (node != -1) {
+        _threadPlacement.reset( new NumaThreadPlacement(placement, node) );
+    }
+}
+
+NumaFramePlacement::~NumaFramePlacement()
+{
+    ///Restore the thread before the node may be given to another frame
+    _threadPlacement.reset();
+    _nodeScope.reset();
+}
+
+int
+NumaFramePlacement::getNode() const
+{
+    return _nodeScope ? _nodeScope->getNode() : -1;
+}
@@ -0,0 +1,183 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_NUMAPLACEMENT_H_
+#define NATRON_ENGINE_NUMAPLACEMENT_H_
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+
+#include "Global/GlobalDefines.h"
+
+///Buffers at least this large are mapped by allocateBuffer() when the first-touch allocation is enabled, so that
+///their pages are placed by the thread which writes them first. Smaller buffers are not worth a system call.
+#define NATRON_NUMA_FIRST_TOUCH_MIN_SIZE (1024 * 1024)
+
+namespace Natron {
+
+struct NumaPlacementPrivate;
+
+/**
+ * @brief The NUMA nodes of the computer (usually one per socket, each with its own memory controller) and the frame
+ * renders placed on each of them.
+ * On a NUMA computer, a page of memory is physically allocated in the memory of the node of the core which writes it
+ * first, and reading it from the cores of another node is much slower. A frame render placed on a node runs all its
+ * tiles on the cores of that node: the images it produces are written, hence allocated, in the memory of the node,
+ * and the tiles of the nodes downstream read them locally.
+ * Only Linux is supported, on other systems the computer is seen as a single node and nothing is ever placed.
+ * This class is thread-safe.
+ **/
+class NumaPlacement
+{
+public:
+
+    /**
+     * @brief Reads the topology of the computer, restricted to the cores the process may run on
+     **/
+    NumaPlacement();
+
+    /**
+     * @brief Uses the given topology instead: the cores of each node
+     **/
+    NumaPlacement(const std::vector<std::vector<int> >& nodesCores);
+
+    ~NumaPlacement();
+
+    int getNodesCount() const;
+
+    const std::vector<int>& getNodeCores(int node) const;
+
+    /**
+     * @brief When disabled, acquireNode() never places a frame
+     **/
+    void setEnabled(bool enabled);
+
+    bool isEnabled() const;
+
+    /**
+     * @brief Must be called when a frame render that can be placed starts, and be matched with a call to releaseNode().
+     * Returns the node with the fewest frame renders, or -1 if the frame should use all the cores: when disabled, on
+     * a single node computer, and while there are fewer frames rendering than nodes, in which case the frames would
+     * leave cores idle if they were restricted to a node.
+     **/
+    int acquireNode();
+
+    void releaseNode(int node);
+
+    /**
+     * @brief Returns the number of frame renders placed on the node so far, or that used all cores if node is -1
+     **/
+    U64 getPlacedFramesCount(int node) const;
+
+    /**
+     * @brief Restricts the calling thread to the cores of the given node, or lets it run on all cores if node is -1.
+     * The placement of each thread is remembered: this does not make a system call if the thread is already placed so.
+     **/
+    void placeCurrentThread(int node);
+
+    /**
+     * @brief Returns the node the calling thread was placed on with placeCurrentThread(), or -1
+     **/
+    int getCurrentThreadNode() const;
+
+    /**
+     * @brief Allocates a buffer of the given size. On a NUMA computer large buffers are mapped instead of being taken
+     * from the heap: their pages are only allocated when written, in the memory of the node of the writing thread,
+     * whereas a heap block may reuse pages in the memory of another node.
+     * mapped is set to whether the buffer must be freed with munmap: pass it back to freeBuffer().
+     * Returns NULL on failure.
+     **/
+    static void* allocateBuffer(std::size_t size,
+                                bool* mapped);
+
+    static void freeBuffer(void* data,
+                           std::size_t size,
+                           bool mapped);
+
+    /**
+     * @brief Whether allocateBuffer() maps large buffers. Off by default: it is only worth it on a NUMA computer
+     * whose frame renders are placed, mapping and releasing pages costs more than reusing heap blocks.
+     **/
+    static void setFirstTouchAllocationEnabled(bool enabled);
+
+    static bool isFirstTouchAllocationEnabled();
+
+    /**
+     * @brief Parses a list of cores such as "0-7,16-23" as found in /sys/devices/system/node/node*\/cpulist
+     **/
+    static bool parseCoresList(const std::string& str,
+                               std::vector<int>* cores);
+
+private:
+
+    boost::scoped_ptr<NumaPlacementPrivate> _imp;
+};
+
+/**
+ * @brief Places the calling thread on a node for the lifetime of the object, then restores its previous placement
+ **/
+class NumaThreadPlacement
+{
+    NumaPlacement* _placement;
+    int _previousNode;
+
+public:
+
+    NumaThreadPlacement(NumaPlacement* placement,
+                        int node);
+
+    ~NumaThreadPlacement();
+};
+
+/**
+ * @brief Acquires a node for a frame render for the lifetime of the object
+ **/
+class NumaNodeScope
+{
+    NumaPlacement* _placement;
+    int _node;
+
+public:
+
+    NumaNodeScope(NumaPlacement* placement);
+
+    ~NumaNodeScope();
+
+    int getNode() const
+    {
+        return _node;
+    }
+};
+
+/**
+ * @brief Places a frame render and the calling thread for the lifetime of the object.
+ * Only the frames of a sequence rendered in parallel (writers, viewer playback) are placed: they are the ones that run
+ * next to each other on the computer. Otherwise the object does nothing and the frame uses all the cores.
+ **/
+class NumaFramePlacement
+{
+    boost::scoped_ptr<NumaNodeScope> _nodeScope;
+    boost::scoped_ptr<NumaThreadPlacement> _threadPlacement;
+
+public:
+
+    NumaFramePlacement(NumaPlacement* placement,
+                       bool isParallelSequenceFrame);
+
+    ~NumaFramePlacement();
+
+    int getNode() const;
+};
+} // namespace Natron
+
+#endif // NATRON_ENGINE_NUMAPLACEMENT_H_
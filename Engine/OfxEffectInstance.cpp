@@ -934,7 +934,10 @@ OfxEffectInstance::onInputChanged(int inputNo)
                                              dynamic_cast<OutputEffectInstance*>(this),
                                              0, //texture index
                                              getApp()->getTimeLine().get(),
-                                             false);
+                                             false,
+                                             Natron::eRenderPriorityInteractive,
+                                             false, // is a frame rendered ?
+                                             false); // is this one of the frames of a sequence rendered in parallel ?
     
     ///Don't do clip preferences while loading a project, they will be refreshed globally once the project is loaded.
     
@@ -3170,6 +3173,49 @@ OfxEffectInstance::clearTransform(int inputNb)
 }
 
 
+Natron::StatusEnum
+OfxEffectInstance::getColorOperation(SequenceTime time,
+                                     const RenderScale& renderScale, //< the plug-in accepted scale
+                                     int view,
+                                     int* inputNb,
+                                     Natron::ColorOperation* op)
+{
+    const std::string field = kOfxImageFieldNone; // TODO: support interlaced data
+
+    std::string clipName;
+    OfxStatus stat;
+    {
+        bool skipDiscarding = false;
+        if (getRecursionLevel() > 1) {
+            skipDiscarding = true;
+        }
+        SET_CAN_SET_VALUE(false);
+
+        ClipsThreadStorageSetter clipSetter(effectInstance(),
+                                            skipDiscarding,
+                                            true, //< setView ?
+                                            view,
+                                            true,//< set mipmaplevel ?
+                                            Natron::Image::getLevelFromScale(renderScale.x));
+
+        stat = effectInstance()->getColorOperationAction((OfxTime)time, field, renderScale, view, clipName, op);
+    }
+    if (stat == kOfxStatReplyDefault) {
+        return Natron::eStatusReplyDefault;
+    } else if (stat != kOfxStatOK) {
+        return Natron::eStatusFailed;
+    }
+
+    OFX::Host::ImageEffect::ClipInstance* clip = effectInstance()->getClip(clipName);
+    OfxClipInstance* natronClip = dynamic_cast<OfxClipInstance*>(clip);
+    if ( !natronClip || natronClip->isOutput() ) {
+        return Natron::eStatusFailed;
+    }
+    *inputNb = natronClip->getInputNb();
+
+    return Natron::eStatusOK;
+}
+
 bool
 OfxEffectInstance::isFrameVarying() const
 {
@@ -280,6 +280,11 @@ public:
                                             Transform::Matrix3x3* transform) OVERRIDE FINAL WARN_UNUSED_RETURN;
     virtual void rerouteInputAndSetTransform(const std::list<EffectInstance::InputMatrix>& inputTransforms) OVERRIDE FINAL;
     virtual void clearTransform(int inputNb) OVERRIDE FINAL;
+    virtual Natron::StatusEnum getColorOperation(SequenceTime time,
+                                                 const RenderScale& renderScale,
+                                                 int view,
+                                                 int* inputNb,
+                                                 Natron::ColorOperation* op) OVERRIDE FINAL WARN_UNUSED_RETURN;
 
     virtual bool isFrameVarying() const OVERRIDE FINAL WARN_UNUSED_RETURN;
 
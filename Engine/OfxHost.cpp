@@ -20,18 +20,25 @@
 #include <stdexcept> // std::exception
 #include <cctype> // tolower
 #include <algorithm> // transform
+#include <list>
 #include <string>
+#include <vector>
 CLANG_DIAG_OFF(deprecated-register) //'register' storage class specifier is deprecated
 #include <QtCore/QDir>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QMutex>
+#include <QtCore/QThread>
 #include <QtCore/QThreadPool>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDebug>
+#include <QtConcurrentMap>
 CLANG_DIAG_ON(deprecated-register)
 #ifdef OFX_SUPPORTS_MULTITHREAD
-#include <QtCore/QThread>
 #include <QtCore/QThreadStorage>
-#include <QtConcurrentMap>
+#include <QtCore/QWaitCondition>
 #include <boost/bind.hpp>
 #endif
 
@@ -67,16 +74,24 @@ CLANG_DIAG_ON(deprecated-register)
 #include "Engine/StandardPaths.h"
 #include "Engine/Settings.h"
 #include "Engine/Node.h"
+#include "Engine/Timer.h"
 
 using namespace Natron;
 
 
 Natron::OfxHost::OfxHost()
     : _imageEffectPluginCache( new OFX::Host::ImageEffect::PluginCache(*this) )
+    , _ofxPluginsDeferred(0)
+    , _deferredPluginsLoadLock(new QMutex)
 #ifdef MULTI_THREAD_SUITE_USES_THREAD_SAFE_MUTEX_ALLOCATION
     , _pluginsMutexes()
     , _pluginsMutexesLock(new QMutex)
 #endif
+#ifdef OFX_SUPPORTS_MULTITHREAD
+    , _threadPool( new OfxThreadPool() )
+    , _multiThreadStatsLock(new QMutex)
+    , _multiThreadStats()
+#endif
 {
 }
 
@@ -86,9 +101,14 @@ Natron::OfxHost::~OfxHost()
     OFX::Host::PluginCache::clearPluginCache();
 
     delete _imageEffectPluginCache;
+    delete _deferredPluginsLoadLock;
 #ifdef MULTI_THREAD_SUITE_USES_THREAD_SAFE_MUTEX_ALLOCATION
     delete _pluginsMutexesLock;
 #endif
+#ifdef OFX_SUPPORTS_MULTITHREAD
+    _threadPool.reset();
+    delete _multiThreadStatsLock;
+#endif
 }
 
 void
@@ -431,6 +451,10 @@ Natron::OfxHost::createOfxEffect(boost::shared_ptr<Natron::Node> node,
     ContextEnum ctx;
     OFX::Host::ImageEffect::Descriptor* desc = natronPlugin->getOfxDesc(&ctx);
     OFX::Host::ImageEffect::ImageEffectPlugin* plugin = natronPlugin->getOfxPlugin();
+    if (!plugin || !desc) {
+        ///The bundle of a plug-in registered from the registry may have been removed since the startup
+        throw std::runtime_error(QObject::tr("Could not load the OpenFX plug-in ").toStdString() + natronPlugin->getPluginID().toStdString());
+    }
     assert(plugin && desc && ctx != eContextNone);
     
 
@@ -455,6 +479,317 @@ Natron::OfxHost::addPathToLoadOFXPlugins(const std::string path)
 const TCHAR * getStdOFXPluginPath(const std::string &hostId);
 #endif
 
+namespace {
+
+///Increment this when the content of the OFX plug-ins registry changes
+#define NATRON_OFX_REGISTRY_VERSION 1
+#define NATRON_OFX_REGISTRY_MAGIC 0x4f465852 // "OFXR"
+
+///The directory of an OFX bundle containing the binary for this architecture
+#if defined(__APPLE__)
+#define NATRON_OFX_BUNDLE_ARCH "MacOS"
+#elif defined(WINDOWS)
+#  if defined(_WIN64)
+#  define NATRON_OFX_BUNDLE_ARCH "Win64"
+#  else
+#  define NATRON_OFX_BUNDLE_ARCH "Win32"
+#  endif
+#elif defined(__FreeBSD__)
+#  if defined(__x86_64__) || defined(__LP64__)
+#  define NATRON_OFX_BUNDLE_ARCH "FreeBSD-x86-64"
+#  else
+#  define NATRON_OFX_BUNDLE_ARCH "FreeBSD-x86"
+#  endif
+#else
+#  if defined(__x86_64__) || defined(__LP64__)
+#  define NATRON_OFX_BUNDLE_ARCH "Linux-x86-64"
+#  else
+#  define NATRON_OFX_BUNDLE_ARCH "Linux-x86"
+#  endif
+#endif
+
+///The binary of a bundle found in the search paths, with the attributes telling whether it changed
+struct OfxBundleStamp
+{
+    QString binaryPath;
+    qint64 lastModified;
+    qint64 size;
+};
+
+bool
+operator==(const OfxBundleStamp& lhs,
+           const OfxBundleStamp& rhs)
+{
+    return lhs.binaryPath == rhs.binaryPath && lhs.lastModified == rhs.lastModified && lhs.size == rhs.size;
+}
+
+///What is needed to register an OpenFX plug-in to the application without loading its bundle
+struct OfxRegistryEntry
+{
+    QString openfxId;
+    QString label;
+    QString iconFilename;
+    QString groupIconFilename;
+    QStringList groups;
+    bool isReader;
+    bool isWriter;
+    bool renderUnsafe;
+    qint32 majorVersion;
+    qint32 minorVersion;
+    QStringList formats; //< lower case file extensions supported by a reader or writer
+    double evaluation;
+    OFX::Host::ImageEffect::ImageEffectPlugin* plugin; //< NULL if the entry was read from the registry
+
+    OfxRegistryEntry()
+    : isReader(false)
+    , isWriter(false)
+    , renderUnsafe(false)
+    , majorVersion(0)
+    , minorVersion(0)
+    , evaluation(0.)
+    , plugin(0)
+    {
+    }
+};
+
+///Same as the plugin cache, look for the bundles in the directory and its sub-directories
+void
+findOfxBundles(const QString& dirPath,
+               std::list<OfxBundleStamp>* bundles)
+{
+    QDir dir(dirPath);
+    if ( !dir.exists() ) {
+        return;
+    }
+    QStringList entries = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (QStringList::iterator it = entries.begin(); it != entries.end(); ++it) {
+        if ( it->endsWith(".ofx.bundle") ) {
+            QString barename = it->left(it->size() - 7); // remove ".bundle"
+            OfxBundleStamp b;
+            b.binaryPath = dir.absoluteFilePath(*it) + "/Contents/" NATRON_OFX_BUNDLE_ARCH "/" + barename;
+            QFileInfo info(b.binaryPath);
+            if ( info.exists() ) {
+                b.lastModified = info.lastModified().toTime_t();
+                b.size = info.size();
+            } else {
+                b.lastModified = -1;
+                b.size = -1;
+            }
+            bundles->push_back(b);
+        } else {
+            findOfxBundles(dir.absoluteFilePath(*it), bundles);
+        }
+    }
+}
+
+///Reads the whole file so that it is in the system cache when the plugin cache loads it
+void
+prefetchFile(const std::string& filename)
+{
+    std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+    if ( !ifs.is_open() ) {
+        return;
+    }
+    std::vector<char> buf(1024 * 1024);
+    while ( ifs.read(&buf.front(), buf.size()) ) {
+    }
+}
+
+OfxRegistryEntry
+makeRegistryEntry(OFX::Host::ImageEffect::ImageEffectPlugin* p)
+{
+    OfxRegistryEntry e;
+    e.plugin = p;
+
+    std::string openfxId = p->getIdentifier();
+    const std::string & grouping = p->getDescriptor().getPluginGrouping();
+    const std::string & bundlePath = p->getBinary()->getBundlePath();
+    std::string pluginLabel = OfxEffectInstance::makePluginLabel( p->getDescriptor().getShortLabel(),
+                                                                  p->getDescriptor().getLabel(),
+                                                                  p->getDescriptor().getLongLabel() );
+
+    QStringList groups = OfxEffectInstance::makePluginGrouping(p->getIdentifier(),
+                                                               p->getVersionMajor(), p->getVersionMinor(),
+                                                               pluginLabel, grouping);
+
+    assert( p->getBinary() );
+    QString iconFilename = QString( bundlePath.c_str() ) + "/Contents/Resources/";
+    std::string pngIcon;
+    try {
+        // kOfxPropIcon is normally only defined for parameter desctriptors
+        // (see <http://openfx.sourceforge.net/Documentation/1.3/ofxProgrammingReference.html#ParameterProperties>)
+        // but let's assume it may also be defained on the plugin descriptor.
+        pngIcon = p->getDescriptor().getProps().getStringProperty(kOfxPropIcon, 1); // dimension 1 is PNG icon
+    } catch (OFX::Host::Property::Exception) {
+    }
+    if (pngIcon.empty()) {
+        // no icon defined by kOfxPropIcon, use the default value
+        pngIcon = openfxId + ".png";
+    }
+    iconFilename.append( pngIcon.c_str() );
+    QString groupIconFilename;
+    if (groups.size() > 0) {
+        groupIconFilename = QString( p->getBinary()->getBundlePath().c_str() ) + "/Contents/Resources/";
+        // the plugin grouping has no descriptor, just try the default filename.
+        groupIconFilename.append(groups[0]);
+        groupIconFilename.append(".png");
+    } else {
+        //Use default Misc group when the plug-in doesn't belong to a group
+        groups.push_back(PLUGIN_GROUP_DEFAULT);
+    }
+
+    const std::set<std::string> & contexts = p->getContexts();
+
+    e.openfxId = openfxId.c_str();
+    e.label = pluginLabel.c_str();
+    e.iconFilename = iconFilename;
+    e.groupIconFilename = groupIconFilename;
+    e.groups = groups;
+    e.isReader = contexts.find(kOfxImageEffectContextReader) != contexts.end();
+    e.isWriter = contexts.find(kOfxImageEffectContextWriter) != contexts.end();
+    e.renderUnsafe = p->getDescriptor().getRenderThreadSafety() == kOfxImageEffectRenderUnsafe;
+    e.majorVersion = p->getVersionMajor();
+    e.minorVersion = p->getVersionMinor();
+
+    ///if this plugin's descriptor has the kTuttleOfxImageEffectPropSupportedExtensions property,
+    ///use it to fill the readersMap and writersMap
+    int formatsCount = p->getDescriptor().getProps().getDimension(kTuttleOfxImageEffectPropSupportedExtensions);
+    for (int k = 0; k < formatsCount; ++k) {
+        std::string format = p->getDescriptor().getProps().getStringProperty(kTuttleOfxImageEffectPropSupportedExtensions,k);
+        std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+        e.formats.push_back( format.c_str() );
+    }
+    e.evaluation = p->getDescriptor().getProps().getDoubleProperty(kTuttleOfxImageEffectPropEvaluation);
+
+    return e;
+}
+
+void
+addToFormatsMap(const QStringList& formats,
+                const std::string& openfxId,
+                double evaluation,
+                std::map<std::string,std::vector< std::pair<std::string,double> > >* formatsMap)
+{
+    for (int k = 0; k < formats.size(); ++k) {
+        std::string format = formats[k].toStdString();
+        std::map<std::string,std::vector< std::pair<std::string,double> > >::iterator it = formatsMap->find(format);
+
+        if ( it != formatsMap->end() ) {
+            it->second.push_back(std::make_pair(openfxId, evaluation));
+        } else {
+            std::vector<std::pair<std::string,double> > newVec(1);
+            newVec[0] = std::make_pair(openfxId,evaluation);
+            formatsMap->insert( std::make_pair(format, newVec) );
+        }
+    }
+}
+
+/**
+ * @brief Reads the registry written by writeOFXRegistry. Returns false if the registry is missing, corrupted, or if it
+ * was written for other search paths or bundles, in which case entries is left empty.
+ * previousBundles is filled with the bundles of the registry whenever it could be read.
+ **/
+bool
+readOFXRegistry(const QString& filename,
+                const QStringList& searchPaths,
+                const std::list<OfxBundleStamp>& bundles,
+                std::list<OfxBundleStamp>* previousBundles,
+                std::list<OfxRegistryEntry>* entries)
+{
+    QFile file(filename);
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_6);
+
+    quint32 magic = 0;
+    qint32 version = 0;
+    in >> magic >> version;
+    if ( (magic != NATRON_OFX_REGISTRY_MAGIC) || (version != NATRON_OFX_REGISTRY_VERSION) ) {
+        return false;
+    }
+
+    QString natronVersion;
+    QStringList registrySearchPaths;
+    quint32 nBundles = 0;
+    in >> natronVersion >> registrySearchPaths >> nBundles;
+    for (quint32 i = 0; i < nBundles && in.status() == QDataStream::Ok; ++i) {
+        OfxBundleStamp b;
+        in >> b.binaryPath >> b.lastModified >> b.size;
+        previousBundles->push_back(b);
+    }
+    if (in.status() != QDataStream::Ok) {
+        previousBundles->clear();
+        return false;
+    }
+
+    ///The labels and groupings are made by the application, they may change with its version
+    if ( (natronVersion != NATRON_VERSION_STRING) || (registrySearchPaths != searchPaths) || (*previousBundles != bundles) ) {
+        return false;
+    }
+
+    quint32 nPlugins = 0;
+    in >> nPlugins;
+    for (quint32 i = 0; i < nPlugins && in.status() == QDataStream::Ok; ++i) {
+        OfxRegistryEntry e;
+        in >> e.openfxId >> e.label >> e.iconFilename >> e.groupIconFilename >> e.groups
+           >> e.isReader >> e.isWriter >> e.renderUnsafe >> e.majorVersion >> e.minorVersion
+           >> e.formats >> e.evaluation;
+        entries->push_back(e);
+    }
+    if (in.status() != QDataStream::Ok) {
+        entries->clear();
+        return false;
+    }
+
+    return true;
+}
+
+void
+writeOFXRegistry(const QString& filename,
+                 const QStringList& searchPaths,
+                 const std::list<OfxBundleStamp>& bundles,
+                 const std::list<OfxRegistryEntry>& entries)
+{
+    QFile file(filename);
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        qDebug() << "Failed to write the OpenFX plug-ins registry" << filename;
+        return;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_4_6);
+
+    out << (quint32)NATRON_OFX_REGISTRY_MAGIC << (qint32)NATRON_OFX_REGISTRY_VERSION;
+    out << QString(NATRON_VERSION_STRING) << searchPaths << (quint32)bundles.size();
+    for (std::list<OfxBundleStamp>::const_iterator it = bundles.begin(); it != bundles.end(); ++it) {
+        out << it->binaryPath << it->lastModified << it->size;
+    }
+    out << (quint32)entries.size();
+    for (std::list<OfxRegistryEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        out << it->openfxId << it->label << it->iconFilename << it->groupIconFilename << it->groups
+            << it->isReader << it->isWriter << it->renderUnsafe << it->majorVersion << it->minorVersion
+            << it->formats << it->evaluation;
+    }
+}
+
+QString
+getOFXCacheFilePath(const char* filename)
+{
+    // The cache location depends on the OS.
+    // On OSX, it will be ~/Library/Caches/<organization>/<application>/
+    //on Linux ~/.cache/<organization>/<application>/
+    QString path = Natron::StandardPaths::writableLocation(Natron::StandardPaths::eStandardLocationCache);
+
+    QDir().mkpath(path);
+    path += QDir::separator();
+    path += filename;
+
+    return path;
+}
+
+}
+
 void
 Natron::OfxHost::loadOFXPlugins(std::map<std::string,std::vector< std::pair<std::string,double> > >* readersMap,
                                 std::map<std::string,std::vector< std::pair<std::string,double> > >* writersMap)
@@ -501,147 +836,152 @@ Natron::OfxHost::loadOFXPlugins(std::map<std::string,std::vector< std::pair<std:
         // ignore
     }
 
+    TimeLapse timer;
+
+    ///Find the bundles the plugin cache would scan, if none changed since the registry was written
+    ///the plug-ins can be registered without reading the plugin cache
+    QStringList searchPaths;
+    std::list<OfxBundleStamp> bundles;
+    const std::list<std::string> & pluginPath = OFX::Host::PluginCache::getPluginCache()->getPluginPath();
+    for (std::list<std::string>::const_iterator it = pluginPath.begin(); it != pluginPath.end(); ++it) {
+        searchPaths.push_back( it->c_str() );
+        findOfxBundles(it->c_str(), &bundles);
+    }
+
+    QString registryFilename = getOFXCacheFilePath("OFXRegistry.bin");
+    std::list<OfxBundleStamp> previousBundles;
+    std::list<OfxRegistryEntry> entries;
+    bool registryValid = QFile::exists( getOFXCacheFilePath("OFXCache.xml") ) &&
+                         readOFXRegistry(registryFilename, searchPaths, bundles, &previousBundles, &entries);
+    appPTR->addStartupTiming( "OpenFX plug-ins registry", timer.getTimeElapsedReset() );
+
+    if (registryValid) {
+        _ofxPluginsDeferred = 1;
+    } else {
+        ///Only the bundles that are not in the previous registry may have to be described
+        std::list<std::string> changedBinaries;
+        for (std::list<OfxBundleStamp>::iterator it = bundles.begin(); it != bundles.end(); ++it) {
+            if ( std::find(previousBundles.begin(), previousBundles.end(), *it) == previousBundles.end() ) {
+                changedBinaries.push_back( it->binaryPath.toStdString() );
+            }
+        }
+        loadOFXPluginCache(changedBinaries, true);
+        appPTR->addStartupTiming( "OpenFX plug-in cache", timer.getTimeElapsedReset() );
+
+        typedef std::map<OFX::Host::ImageEffect::MajorPlugin,OFX::Host::ImageEffect::ImageEffectPlugin *> PMap;
+        const PMap& ofxPlugins = _imageEffectPluginCache->getPluginsByIDMajor();
+        for (PMap::const_iterator it = ofxPlugins.begin(); it != ofxPlugins.end(); ++it) {
+            OFX::Host::ImageEffect::ImageEffectPlugin* p = it->second;
+            assert(p);
+            if (p->getContexts().size() == 0) {
+                continue;
+            }
+            entries.push_back( makeRegistryEntry(p) );
+        }
+        writeOFXRegistry(registryFilename, searchPaths, bundles, entries);
+    }
+
+    /*Filling node name list and plugin grouping*/
+    for (std::list<OfxRegistryEntry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        Natron::Plugin* natronPlugin = appPTR->registerPlugin( it->groups,
+                                                              it->openfxId,
+                                                              it->label,
+                                                              it->iconFilename,
+                                                              it->groupIconFilename,
+                                                              it->isReader,
+                                                              it->isWriter,
+                                                              new Natron::LibraryBinary(Natron::LibraryBinary::eLibraryTypeBuiltin),
+                                                              it->renderUnsafe,
+                                                              it->majorVersion, it->minorVersion );
+        if (it->plugin) {
+            natronPlugin->setOfxPlugin(it->plugin);
+        } else {
+            natronPlugin->setOfxPluginDeferred();
+        }
+
+        if ( it->formats.isEmpty() ) {
+            continue;
+        }
+        std::string openfxId = it->openfxId.toStdString();
+        if (it->isReader && readersMap) {
+            ///we're safe to assume that this plugin is a reader
+            addToFormatsMap(it->formats, openfxId, it->evaluation, readersMap);
+        } else if (it->isWriter && writersMap) {
+            ///we're safe to assume that this plugin is a writer.
+            addToFormatsMap(it->formats, openfxId, it->evaluation, writersMap);
+        }
+    }
+    appPTR->addStartupTiming( "OpenFX plug-ins registration", timer.getTimeElapsedReset() );
+} // loadOFXPlugins
+
+void
+Natron::OfxHost::loadOFXPluginCache(const std::list<std::string> & changedBinaries,
+                                    bool mustWriteCache)
+{
     /// now read an old cache
-    // The cache location depends on the OS.
-    // On OSX, it will be ~/Library/Caches/<organization>/<application>/OFXCache.xml
-    //on Linux ~/.cache/<organization>/<application>/OFXCache.xml
-    //on windows:
-    QString ofxcachename = Natron::StandardPaths::writableLocation(Natron::StandardPaths::eStandardLocationCache) + QDir::separator() + "OFXCache.xml";
+    QString ofxcachename = getOFXCacheFilePath("OFXCache.xml");
     std::ifstream ifs( ofxcachename.toStdString().c_str() );
     if ( ifs.is_open() ) {
         OFX::Host::PluginCache::getPluginCache()->readCache(ifs);
         ifs.close();
     }
+
+    ///The plugin cache loads and describes the changed bundles one after the other, most of the time being spent
+    ///waiting for the binaries to be read (especially from a network share): read them all in parallel beforehand
+    if (changedBinaries.size() > 1) {
+        std::vector<std::string> binaries( changedBinaries.begin(), changedBinaries.end() );
+        QtConcurrent::blockingMap(binaries, prefetchFile);
+    }
+
     OFX::Host::PluginCache::getPluginCache()->scanPluginFiles();
 
-    // write the cache NOW (it won't change anyway)
-    /// flush out the current cache
-    writeOFXCache();
+    if (mustWriteCache) {
+        /// flush out the current cache
+        writeOFXCache();
+    }
+}
 
-    /*Filling node name list and plugin grouping*/
+void
+Natron::OfxHost::loadDeferredOFXPlugins()
+{
+    if (!_ofxPluginsDeferred) {
+        return;
+    }
+    QMutexLocker k(_deferredPluginsLoadLock);
+    if (!_ofxPluginsDeferred) {
+        ///Loaded by another thread while we were waiting
+        return;
+    }
+
+    TimeLapse timer;
+    loadOFXPluginCache(std::list<std::string>(), false);
+
+    const PluginsMap & plugins = appPTR->getPluginsList();
     typedef std::map<OFX::Host::ImageEffect::MajorPlugin,OFX::Host::ImageEffect::ImageEffectPlugin *> PMap;
-    const PMap& ofxPlugins =
-    _imageEffectPluginCache->getPluginsByIDMajor();
-    
-    
-    for (PMap::const_iterator it = ofxPlugins.begin();
-         it != ofxPlugins.end(); ++it) {
+    const PMap& ofxPlugins = _imageEffectPluginCache->getPluginsByIDMajor();
+    for (PMap::const_iterator it = ofxPlugins.begin(); it != ofxPlugins.end(); ++it) {
         OFX::Host::ImageEffect::ImageEffectPlugin* p = it->second;
         assert(p);
-        if (p->getContexts().size() == 0) {
+        PluginsMap::const_iterator found = plugins.find( p->getIdentifier() );
+        if ( found == plugins.end() ) {
             continue;
         }
-
-        std::string openfxId = p->getIdentifier();
-        const std::string & grouping = p->getDescriptor().getPluginGrouping();
-        const std::string & bundlePath = p->getBinary()->getBundlePath();
-        std::string pluginLabel = OfxEffectInstance::makePluginLabel( p->getDescriptor().getShortLabel(),
-                                                                      p->getDescriptor().getLabel(),
-                                                                      p->getDescriptor().getLongLabel() );
-        
-        QStringList groups = OfxEffectInstance::makePluginGrouping(p->getIdentifier(),
-                                                                   p->getVersionMajor(), p->getVersionMinor(),
-                                                                   pluginLabel, grouping);
-
-        assert( p->getBinary() );
-        QString iconFilename = QString( bundlePath.c_str() ) + "/Contents/Resources/";
-        std::string pngIcon;
-        try {
-            // kOfxPropIcon is normally only defined for parameter desctriptors
-            // (see <http://openfx.sourceforge.net/Documentation/1.3/ofxProgrammingReference.html#ParameterProperties>)
-            // but let's assume it may also be defained on the plugin descriptor.
-            pngIcon = p->getDescriptor().getProps().getStringProperty(kOfxPropIcon, 1); // dimension 1 is PNG icon
-        } catch (OFX::Host::Property::Exception) {
-        }
-        if (pngIcon.empty()) {
-            // no icon defined by kOfxPropIcon, use the default value
-            pngIcon = openfxId + ".png";
-        }
-        iconFilename.append( pngIcon.c_str() );
-        QString groupIconFilename;
-        if (groups.size() > 0) {
-            groupIconFilename = QString( p->getBinary()->getBundlePath().c_str() ) + "/Contents/Resources/";
-            // the plugin grouping has no descriptor, just try the default filename.
-            groupIconFilename.append(groups[0]);
-            groupIconFilename.append(".png");
-        } else {
-            //Use default Misc group when the plug-in doesn't belong to a group
-            groups.push_back(PLUGIN_GROUP_DEFAULT);
-        }
-
-        
-        const std::set<std::string> & contexts = p->getContexts();
-        std::set<std::string>::const_iterator foundReader = contexts.find(kOfxImageEffectContextReader);
-        std::set<std::string>::const_iterator foundWriter = contexts.find(kOfxImageEffectContextWriter);
-        
-        Natron::Plugin* natronPlugin = appPTR->registerPlugin( groups,
-                                                              openfxId.c_str(),
-                                                              pluginLabel.c_str(),
-                                                              iconFilename,
-                                                              groupIconFilename,
-                                                              foundReader != contexts.end(),
-                                                              foundWriter != contexts.end(),
-                                                              new Natron::LibraryBinary(Natron::LibraryBinary::eLibraryTypeBuiltin),
-                                                              p->getDescriptor().getRenderThreadSafety() == kOfxImageEffectRenderUnsafe,
-                                                              p->getVersionMajor(), p->getVersionMinor() );
-        
-        natronPlugin->setOfxPlugin(p);
-        
-        ///if this plugin's descriptor has the kTuttleOfxImageEffectPropSupportedExtensions property,
-        ///use it to fill the readersMap and writersMap
-        int formatsCount = p->getDescriptor().getProps().getDimension(kTuttleOfxImageEffectPropSupportedExtensions);
-        std::vector<std::string> formats(formatsCount);
-        for (int k = 0; k < formatsCount; ++k) {
-            formats[k] = p->getDescriptor().getProps().getStringProperty(kTuttleOfxImageEffectPropSupportedExtensions,k);
-            std::transform(formats[k].begin(), formats[k].end(), formats[k].begin(), ::tolower);
-        }
-
-        double evaluation = p->getDescriptor().getProps().getDoubleProperty(kTuttleOfxImageEffectPropEvaluation);
-        
-        
-
-
-        if ( ( foundReader != contexts.end() ) && (formatsCount > 0) && readersMap ) {
-            ///we're safe to assume that this plugin is a reader
-            for (U32 k = 0; k < formats.size(); ++k) {
-                std::map<std::string,std::vector< std::pair<std::string,double> > >::iterator it;
-                it = readersMap->find(formats[k]);
-
-                if ( it != readersMap->end() ) {
-                    it->second.push_back(std::make_pair(openfxId, evaluation));
-                } else {
-                    std::vector<std::pair<std::string,double> > newVec(1);
-                    newVec[0] = std::make_pair(openfxId,evaluation);
-                    readersMap->insert( std::make_pair(formats[k], newVec) );
-                }
-            }
-        } else if ( ( foundWriter != contexts.end() ) && (formatsCount > 0) && writersMap ) {
-            ///we're safe to assume that this plugin is a writer.
-            for (U32 k = 0; k < formats.size(); ++k) {
-                std::map<std::string,std::vector< std::pair<std::string,double> > >::iterator it;
-                it = writersMap->find(formats[k]);
-
-                if ( it != writersMap->end() ) {
-                    it->second.push_back(std::make_pair(openfxId, evaluation));
-                } else {
-                    std::vector<std::pair<std::string,double> > newVec(1);
-                    newVec[0] = std::make_pair(openfxId,evaluation);
-                    writersMap->insert( std::make_pair(formats[k], newVec) );
-                }
+        for (PluginMajorsOrdered::const_iterator it2 = found->second.begin(); it2 != found->second.end(); ++it2) {
+            if ( (*it2)->getMajorVersion() == p->getVersionMajor() ) {
+                (*it2)->setOfxPlugin(p);
             }
         }
     }
-} // loadOFXPlugins
+    ///Only once every plug-in has its OpenFX plug-in, other threads may skip the lock
+    _ofxPluginsDeferred.fetchAndStoreRelease(0);
+    appPTR->addStartupTiming( "OpenFX plug-in cache (deferred)", timer.getTimeElapsedReset() );
+}
 
 void
 Natron::OfxHost::writeOFXCache()
 {
     /// and write a new cache, long version with everything in there
-    QString ofxcachename = Natron::StandardPaths::writableLocation(Natron::StandardPaths::eStandardLocationCache);
-
-    QDir().mkpath(ofxcachename);
-    ofxcachename +=  QDir::separator();
-    ofxcachename += "OFXCache.xml";
+    QString ofxcachename = getOFXCacheFilePath("OFXCache.xml");
     std::ofstream of( ofxcachename.toStdString().c_str() );
     assert( of.is_open() );
     assert( OFX::Host::PluginCache::getPluginCache() );
@@ -652,15 +992,16 @@ Natron::OfxHost::writeOFXCache()
 void
 Natron::OfxHost::clearPluginsLoadedCache()
 {
-    QString ofxcachename = Natron::StandardPaths::writableLocation(Natron::StandardPaths::eStandardLocationCache);
-
-    QDir().mkpath(ofxcachename);
-    ofxcachename +=  QDir::separator();
-    ofxcachename += "OFXCache.xml";
+    QString ofxcachename = getOFXCacheFilePath("OFXCache.xml");
 
     if ( QFile::exists(ofxcachename) ) {
         QFile::remove(ofxcachename);
     }
+
+    QString registryFilename = getOFXCacheFilePath("OFXRegistry.bin");
+    if ( QFile::exists(registryFilename) ) {
+        QFile::remove(registryFilename);
+    }
 }
 
 void
@@ -720,39 +1061,54 @@ Natron::OfxHost::newMemoryInstance(size_t nBytes)
 #ifdef OFX_SUPPORTS_MULTITHREAD
 
 
-///Stored as int, because we need -1; list because we need it recursive for the multiThread func
-static QThreadStorage<std::list<int> > gThreadIndex;
+struct OfxThreadIndex
+{
+    ///-1 for a thread calling an action, otherwise the index passed to the thread function
+    int index;
+    
+    ///The plug-in whose action or thread function is running
+    const OFX::Host::ImageEffect::ImageEffectPlugin* plugin;
+};
+
+///List because we need it recursive for the multiThread func
+static QThreadStorage<std::list<OfxThreadIndex> > gThreadIndex;
 
 
 void
-Natron::OfxHost::setThreadAsActionCaller(bool actionCaller)
+Natron::OfxHost::setThreadAsActionCaller(OfxImageEffectInstance* instance,
+                                         bool actionCaller)
 {
     if (actionCaller) {
-        gThreadIndex.localData().push_back(-1);
+        OfxThreadIndex i;
+        i.index = -1;
+        i.plugin = instance ? instance->getPlugin() : 0;
+        gThreadIndex.localData().push_back(i);
     } else {
-        std::list<int>& local = gThreadIndex.localData();
+        std::list<OfxThreadIndex>& local = gThreadIndex.localData();
         assert(!local.empty());
         local.pop_back();
     }
 }
 
 namespace {
-    
-///Using QtConcurrent doesn't work with The Foundry Furnace plug-ins because they expect fresh threads
-///to be created. As QtConcurrent's thread-pool recycles thread, it seems to make Furnace crash.
-///We think this is because Furnace must keep an internal thread-local state that becomes then dirty
-///if we re-use the same thread.
 
+///Runs the plug-in's thread function in the current thread, returns the time spent in it
 static OfxStatus
 threadFunctionWrapper(OfxThreadFunctionV1 func,
                       unsigned int threadIndex,
                       unsigned int threadMax,
-                      void *customArg)
+                      void *customArg,
+                      const OFX::Host::ImageEffect::ImageEffectPlugin* plugin,
+                      double* timeSpent)
 {
     assert(threadIndex < threadMax);
-    std::list<int>& localData = gThreadIndex.localData();
-    localData.push_back((int)threadIndex);
+    std::list<OfxThreadIndex>& localData = gThreadIndex.localData();
+    OfxThreadIndex i;
+    i.index = (int)threadIndex;
+    i.plugin = plugin;
+    localData.push_back(i);
 
+    TimeLapse timer;
     OfxStatus ret = kOfxStatOK;
     try {
         func(threadIndex, threadMax, customArg);
@@ -761,6 +1117,7 @@ threadFunctionWrapper(OfxThreadFunctionV1 func,
     } catch (...) {
         ret =  kOfxStatFailed;
     }
+    *timeSpent = timer.getTimeSinceCreation();
 
     ///reset back the index otherwise it could mess up the indexes if the same thread is re-used
     localData.pop_back();
@@ -769,8 +1126,11 @@ threadFunctionWrapper(OfxThreadFunctionV1 func,
 }
 
     
-
-    
+///Using QtConcurrent doesn't work with The Foundry Furnace plug-ins because they expect fresh threads
+///to be created. As QtConcurrent's thread-pool recycles thread, it seems to make Furnace crash.
+///We think this is because Furnace must keep an internal thread-local state that becomes then dirty
+///if we re-use the same thread.
+///This is used when the user disabled the thread pool in the preferences.
 class OfxThread
     : public QThread
 {
@@ -779,33 +1139,24 @@ public:
               unsigned int threadIndex,
               unsigned int threadMax,
               void *customArg,
-              OfxStatus *stat)
+              const OFX::Host::ImageEffect::ImageEffectPlugin* plugin,
+              OfxStatus *stat,
+              double* timeSpent)
         : _func(func)
           , _threadIndex(threadIndex)
           , _threadMax(threadMax)
           , _customArg(customArg)
+          , _plugin(plugin)
           , _stat(stat)
+          , _timeSpent(timeSpent)
     {
         setObjectName("Multi-thread suite");
     }
 
     void run() OVERRIDE
     {
-        assert(_threadIndex < _threadMax);
-        std::list<int>& localData = gThreadIndex.localData();
-        localData.push_back((int)_threadIndex);
-        
         assert(*_stat == kOfxStatFailed);
-        try {
-            _func(_threadIndex, _threadMax, _customArg);
-            *_stat = kOfxStatOK;
-        } catch (const std::bad_alloc & ba) {
-            *_stat = kOfxStatErrMemory;
-        } catch (...) {
-        }
-
-        ///reset back the index otherwise it could mess up the indexes if the same thread is re-used
-        localData.pop_back();
+        *_stat = threadFunctionWrapper(_func, _threadIndex, _threadMax, _customArg, _plugin, _timeSpent);
     }
 
 private:
@@ -813,11 +1164,207 @@ private:
     unsigned int _threadIndex;
     unsigned int _threadMax;
     void *_customArg;
+    const OFX::Host::ImageEffect::ImageEffectPlugin* _plugin;
     OfxStatus *_stat;
+    double* _timeSpent;
+};
+
+///A call to multiThread, all members are protected by the mutex of the pool
+struct OfxThreadBatch
+{
+    OfxThreadFunctionV1* func;
+    unsigned int nThreads;
+    void* customArg;
+    const OFX::Host::ImageEffect::ImageEffectPlugin* plugin;
+    
+    ///Neither the workers nor the calling thread start a call if there are already maxRunning calls running
+    unsigned int maxRunning;
+    unsigned int nextIndex; //< index of the next call to start
+    unsigned int nRunning,nFinished;
+    OfxStatus status; //< first error encountered
+    double threadsTime; //< sum of the time spent in each call
+    QWaitCondition finishedCond; //< signaled each time a call finishes
 };
 
 }
 
+namespace Natron {
+
+/**
+ * @brief Worker threads that live as long as the OFX host and run the calls of multiThread.
+ * The thread calling multiThread runs calls too, which makes nested calls to multiThread from a worker
+ * thread safe: the caller can always finish its own calls even if all the workers are busy.
+ **/
+class OfxThreadPool
+{
+    class Worker
+        : public QThread
+    {
+    public:
+        
+        Worker(OfxThreadPool* pool)
+        : QThread()
+        , _pool(pool)
+        {
+            setObjectName("Multi-thread suite");
+        }
+        
+    private:
+        
+        virtual void run() OVERRIDE FINAL
+        {
+            _pool->workerLoop();
+        }
+        
+        OfxThreadPool* _pool;
+    };
+    
+    QMutex _lock;
+    QWaitCondition _workCond;
+    std::list<OfxThreadBatch*> _batches; //< batches which still have calls to start
+    std::list<Worker*> _workers;
+    bool _mustQuit;
+    
+public:
+    
+    OfxThreadPool()
+    : _lock()
+    , _workCond()
+    , _batches()
+    , _workers()
+    , _mustQuit(false)
+    {
+    }
+    
+    ~OfxThreadPool()
+    {
+        {
+            QMutexLocker k(&_lock);
+            _mustQuit = true;
+            _workCond.wakeAll();
+        }
+        for (std::list<Worker*>::iterator it = _workers.begin(); it != _workers.end(); ++it) {
+            (*it)->wait();
+            delete *it;
+        }
+    }
+    
+    /**
+     * @brief Runs the nThreads calls of func with at most maxConcurrentThreads of them running at the same time
+     * and returns when they are all finished.
+     **/
+    OfxStatus run(OfxThreadFunctionV1 func,
+                  unsigned int nThreads,
+                  unsigned int maxConcurrentThreads,
+                  void* customArg,
+                  const OFX::Host::ImageEffect::ImageEffectPlugin* plugin,
+                  double* threadsTime)
+    {
+        OfxThreadBatch batch;
+        batch.func = func;
+        batch.nThreads = nThreads;
+        batch.customArg = customArg;
+        batch.plugin = plugin;
+        batch.maxRunning = maxConcurrentThreads;
+        batch.nextIndex = 0;
+        batch.nRunning = 0;
+        batch.nFinished = 0;
+        batch.status = kOfxStatOK;
+        batch.threadsTime = 0.;
+        
+        QMutexLocker k(&_lock);
+        
+        ///The calling thread is one of the maxConcurrentThreads, start the workers lazily
+        unsigned int nWorkersNeeded = std::min(nThreads, maxConcurrentThreads) - 1;
+        while (_workers.size() < nWorkersNeeded) {
+            Worker* w = new Worker(this);
+            _workers.push_back(w);
+            w->start();
+        }
+        _batches.push_back(&batch);
+        _workCond.wakeAll();
+        
+        ///Run calls in this thread too until they are all started
+        while (batch.nextIndex < batch.nThreads) {
+            if (batch.nRunning >= batch.maxRunning) {
+                batch.finishedCond.wait(&_lock);
+            } else {
+                runNextCall(&batch);
+            }
+        }
+        while (batch.nFinished < batch.nThreads) {
+            batch.finishedCond.wait(&_lock);
+        }
+        *threadsTime = batch.threadsTime;
+        
+        return batch.status;
+    }
+    
+private:
+    
+    ///Must be called with _lock locked, returns with it locked
+    void runNextCall(OfxThreadBatch* batch)
+    {
+        assert(batch->nextIndex < batch->nThreads);
+        unsigned int index = batch->nextIndex++;
+        ++batch->nRunning;
+        if (batch->nextIndex == batch->nThreads) {
+            std::list<OfxThreadBatch*>::iterator found = std::find(_batches.begin(), _batches.end(), batch);
+            assert( found != _batches.end() );
+            _batches.erase(found);
+        }
+        
+        _lock.unlock();
+        double timeSpent;
+        OfxStatus stat = threadFunctionWrapper(batch->func, index, batch->nThreads, batch->customArg, batch->plugin, &timeSpent);
+        _lock.lock();
+        
+        batch->threadsTime += timeSpent;
+        if ( (stat != kOfxStatOK) && (batch->status == kOfxStatOK) ) {
+            batch->status = stat;
+        }
+        --batch->nRunning;
+        ++batch->nFinished;
+        ///The calling thread may be waiting for a call to finish to start another one or to return
+        batch->finishedCond.wakeAll();
+        if (batch->nFinished < batch->nThreads) {
+            ///A call finished, a worker may start another one
+            _workCond.wakeOne();
+        }
+    }
+    
+    ///Must be called with _lock locked
+    OfxThreadBatch* getBatchToRun() const
+    {
+        for (std::list<OfxThreadBatch*>::const_iterator it = _batches.begin(); it != _batches.end(); ++it) {
+            if ( ( (*it)->nextIndex < (*it)->nThreads ) && ( (*it)->nRunning < (*it)->maxRunning ) ) {
+                return *it;
+            }
+        }
+        return 0;
+    }
+    
+    void workerLoop()
+    {
+        QMutexLocker k(&_lock);
+        for (;;) {
+            OfxThreadBatch* batch = 0;
+            while ( !_mustQuit && !(batch = getBatchToRun()) ) {
+                _workCond.wait(&_lock);
+            }
+            if (_mustQuit) {
+                return;
+            }
+            
+            ///The running threads count is used by multiThreadNumCPUS
+            appPTR->fetchAndAddNRunningThreads(1);
+            runNextCall(batch);
+            appPTR->fetchAndAddNRunningThreads(-1);
+        }
+    }
+};
+    
+}
 
 // Function to spawn SMP threads
 //  This function will spawn nThreads separate threads of computation (typically one per CPU) to allow something to perform symmetric multi processing. Each thread will call 'func' passing in the index of the thread and the number of threads actually launched.
@@ -857,38 +1404,37 @@ Natron::OfxHost::multiThread(OfxThreadFunctionV1 func,
             return kOfxStatFailed;
         }
     }
+    
+    ///The plug-in calling, either from an action or from a thread function for nested calls
+    const OFX::Host::ImageEffect::ImageEffectPlugin* plugin = 0;
+    if ( gThreadIndex.hasLocalData() ) {
+        const std::list<OfxThreadIndex>& localData = gThreadIndex.localData();
+        if ( !localData.empty() ) {
+            plugin = localData.back().plugin;
+        }
+    }
 
+    TimeLapse timer;
+    double threadsTime = 0.;
+    OfxStatus ret = kOfxStatOK;
     bool useThreadPool = appPTR->getUseThreadPool();
     
     if (useThreadPool) {
         
-        std::vector<unsigned int> threadIndexes(nThreads);
-        for (unsigned int i = 0; i < nThreads; ++i) {
-            threadIndexes[i] = i;
-        }
-        
-        /// DON'T set the maximum thread count, this is a global application setting, and see the documentation excerpt above
-        //QThreadPool::globalInstance()->setMaxThreadCount(nThreads);
-        QFuture<OfxStatus> future = QtConcurrent::mapped( threadIndexes, boost::bind(::threadFunctionWrapper,func, _1, nThreads, customArg) );
-        future.waitForFinished();
-        ///DON'T reset back to the original value the maximum thread count
-        //QThreadPool::globalInstance()->setMaxThreadCount(QThread::idealThreadCount());
-        
-        for (QFuture<OfxStatus>::const_iterator it = future.begin(); it != future.end(); ++it) {
-            OfxStatus stat = *it;
-            if (stat != kOfxStatOK) {
-                return stat;
-            }
-        }
+        ///Use our own worker threads rather than QtConcurrent: the global thread pool runs the tiles of the renders,
+        ///the calls of the plug-in would be queued behind them
+        ret = _threadPool->run(func, nThreads, maxConcurrentThread, customArg, plugin, &threadsTime);
 
     } else {
         QVector<OfxStatus> status(nThreads); // vector for the return status of each thread
         status.fill(kOfxStatFailed); // by default, a thread fails
+        QVector<double> timeSpent(nThreads);
+        timeSpent.fill(0.);
         {
             // at most maxConcurrentThread should be running at the same time
             QVector<OfxThread*> threads(nThreads);
             for (unsigned int i = 0; i < nThreads; ++i) {
-                threads[i] = new OfxThread(func, i, nThreads, customArg, &status[i]);
+                threads[i] = new OfxThread(func, i, nThreads, customArg, plugin, &status[i], &timeSpent[i]);
             }
             unsigned int i = 0; // index of next thread to launch
             unsigned int running = 0; // number of running threads
@@ -923,14 +1469,43 @@ Natron::OfxHost::multiThread(OfxThreadFunctionV1 func,
         for (QVector<OfxStatus>::const_iterator it = status.begin(); it != status.end(); ++it) {
             OfxStatus stat = *it;
             if (stat != kOfxStatOK) {
-                return stat;
+                ret = stat;
+                break;
             }
         }
+        for (QVector<double>::const_iterator it = timeSpent.begin(); it != timeSpent.end(); ++it) {
+            threadsTime += *it;
+        }
     } // useThreadPool
+    
+    double wallTime = timer.getTimeSinceCreation();
+    {
+        QMutexLocker k(_multiThreadStatsLock);
+        OfxMultiThreadStats& stats = _multiThreadStats[plugin];
+        ++stats.nCalls;
+        stats.wallTime += wallTime;
+        stats.threadsTime += threadsTime;
+        stats.availableTime += wallTime * std::min(nThreads, maxConcurrentThread);
+    }
 
-    return kOfxStatOK;
+    return ret;
 } // multiThread
 
+void
+Natron::OfxHost::getMultiThreadStats(std::map<std::string,OfxMultiThreadStats>* stats) const
+{
+    QMutexLocker k(_multiThreadStatsLock);
+    for (std::map<const OFX::Host::ImageEffect::ImageEffectPlugin*,OfxMultiThreadStats>::const_iterator it = _multiThreadStats.begin();
+         it != _multiThreadStats.end(); ++it) {
+        std::string pluginID = it->first ? it->first->getIdentifier() : std::string("Unknown");
+        OfxMultiThreadStats& s = (*stats)[pluginID];
+        s.nCalls += it->second.nCalls;
+        s.wallTime += it->second.wallTime;
+        s.threadsTime += it->second.threadsTime;
+        s.availableTime += it->second.availableTime;
+    }
+}
+
 // Function which indicates the number of CPUs available for SMP processing
 //  This value may be less than the actual number of CPUs on a machine, as the host may reserve other CPUs for itself.
 // http://openfx.sourceforge.net/Documentation/1.3/ofxProgrammingReference.html#OfxMultiThreadSuiteV1_multiThreadNumCPUs
@@ -999,9 +1574,9 @@ Natron::OfxHost::multiThreadIndex(unsigned int *threadIndex) const
     if (!gThreadIndex.hasLocalData()) {
         *threadIndex = 0;
     } else {
-        std::list<int>& localData = gThreadIndex.localData();
-        if (!localData.empty() && localData.back() != -1) {
-            *threadIndex = localData.back();
+        std::list<OfxThreadIndex>& localData = gThreadIndex.localData();
+        if (!localData.empty() && localData.back().index != -1) {
+            *threadIndex = localData.back().index;
         } else {
             *threadIndex = 0;
         }
@@ -1019,8 +1594,8 @@ Natron::OfxHost::multiThreadIsSpawnedThread() const
     if (!gThreadIndex.hasLocalData()) {
         return 0;
     } else {
-        std::list<int>& localData = gThreadIndex.localData();
-        return !localData.empty() && localData.back() != -1;
+        std::list<OfxThreadIndex>& localData = gThreadIndex.localData();
+        return !localData.empty() && localData.back().index != -1;
     }
 }
 
@@ -16,14 +16,19 @@
 #include <Python.h>
 
 #include <list>
+#include <map>
+#include <string>
+#include <QtCore/QAtomicInt>
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
 #endif
 #include <ofxhPluginCache.h>
 #include <ofxhImageEffectAPI.h>
 
 #include "Global/Macros.h"
 #include "Global/Enums.h"
+#include "Global/GlobalDefines.h"
 
 //#define MULTI_THREAD_SUITE_USES_THREAD_SAFE_MUTEX_ALLOCATION
 
@@ -35,6 +40,28 @@ class KnobSerialization;
 namespace Natron {
 class Node;
 class Plugin;
+class OfxThreadPool;
+class OfxImageEffectInstance;
+
+/**
+ * @brief Statistics about the calls made by a plug-in to the multi-thread suite
+ **/
+struct OfxMultiThreadStats
+{
+    U64 nCalls; //< number of calls to multiThread
+    double wallTime; //< seconds spent in multiThread
+    double threadsTime; //< seconds spent by all threads in the plug-in's thread function
+    double availableTime; //< seconds the threads that were allowed to run could have been working
+
+    OfxMultiThreadStats()
+    : nCalls(0)
+    , wallTime(0.)
+    , threadsTime(0.)
+    , availableTime(0.)
+    {
+    }
+};
+
 class OfxHost
     : public OFX::Host::ImageEffect::Host
 {
@@ -112,14 +139,29 @@ public:
 
     void addPathToLoadOFXPlugins(const std::string path);
 
-    /*Reads OFX plugin cache and scan plugins directories
-       to load them all.*/
+    /*Registers the OFX plug-ins found in the search paths. If none of the bundles changed since the last launch,
+       the plug-ins are registered from the binary plug-ins registry and the OFX plugin cache is only read
+       when a plug-in is first instantiated (see loadDeferredOFXPlugins), otherwise the OFX plugin cache is read,
+       the changed bundles are described and the registry is written again.*/
     void loadOFXPlugins(std::map<std::string,std::vector< std::pair<std::string,double> > >* readersMap,
                         std::map<std::string,std::vector< std::pair<std::string,double> > >* writersMap);
 
+    /**
+     * @brief If the plug-ins were registered from the binary registry, reads the OFX plugin cache and
+     * gives to each registered plug-in its OpenFX plug-in. Does nothing if it was already done.
+     * This is thread-safe: a render thread calling it while another thread loads the plug-ins waits for the end of the loading.
+     **/
+    void loadDeferredOFXPlugins();
+
     void clearPluginsLoadedCache();
 
-    void setThreadAsActionCaller(bool actionCaller);
+    void setThreadAsActionCaller(OfxImageEffectInstance* instance,bool actionCaller);
+    
+    /**
+     * @brief Returns for each plug-in ID the statistics about its use of the multi-thread suite.
+     * The SMP utilization of a plug-in is threadsTime / availableTime.
+     **/
+    void getMultiThreadStats(std::map<std::string,OfxMultiThreadStats>* stats) const;
     
     static OFX::Host::ImageEffect::Descriptor* getPluginContextAndDescribe(OFX::Host::ImageEffect::ImageEffectPlugin* plugin,
                                                                            Natron::ContextEnum* ctx);
@@ -131,6 +173,10 @@ private:
        the OFX plugin cache. (called by the destructor) */
     void writeOFXCache();
 
+    /*Reads the OFX plugin cache and describes the bundles that are not in the cache or that changed.
+      The cache is written back only if mustWriteCache is true.*/
+    void loadOFXPluginCache(const std::list<std::string> & changedBinaries,bool mustWriteCache);
+
     OFX::Host::ImageEffect::PluginCache* _imageEffectPluginCache;
 
 
@@ -155,11 +201,22 @@ private:
         {
         }
     };
+
+    QAtomicInt _ofxPluginsDeferred; //< 1 while the plug-ins registered from the registry have no OpenFX plug-in
+    QMutex* _deferredPluginsLoadLock; //< held while the deferred plug-ins are loaded
     
 #ifdef MULTI_THREAD_SUITE_USES_THREAD_SAFE_MUTEX_ALLOCATION
     std::list<QMutex*> _pluginsMutexes;
     QMutex* _pluginsMutexesLock; //<protects _pluginsMutexes
 #endif
+    
+#ifdef OFX_SUPPORTS_MULTITHREAD
+    ///Worker threads used by multiThread, see OfxThreadPool
+    boost::scoped_ptr<OfxThreadPool> _threadPool;
+    
+    mutable QMutex* _multiThreadStatsLock; //< protects _multiThreadStats
+    std::map<const OFX::Host::ImageEffect::ImageEffectPlugin*,OfxMultiThreadStats> _multiThreadStats;
+#endif
 };
 } // namespace Natron
 
@@ -15,7 +15,9 @@
 #include "OfxImageEffectInstance.h"
 
 #include <cassert>
+#include <cmath>
 #include <string>
+#include <vector>
 #include <map>
 #include <locale>
 
@@ -23,6 +25,7 @@
 
 //ofx extension
 #include <nuke/fnPublicOfxExtensions.h>
+#include <nuke/fnOfxExtensions.h>
 
 //for parametric params properties
 #include <ofxParametricParam.h>
@@ -45,6 +48,8 @@
 #include "Engine/ViewerInstance.h"
 #include "Engine/OfxOverlayInteract.h"
 #include "Engine/Project.h"
+#include "Engine/RenderProfiler.h"
+#include "Engine/ColorOperation.h"
 
 using namespace Natron;
 
@@ -65,16 +70,19 @@ OfxImageEffectInstance::~OfxImageEffectInstance()
 
 class ThreadIsActionCaller_RAII
 {
+    OfxImageEffectInstance* _instance;
+    
 public:
     
-    ThreadIsActionCaller_RAII()
+    ThreadIsActionCaller_RAII(OfxImageEffectInstance* instance)
+    : _instance(instance)
     {
-        appPTR->setThreadAsActionCaller(true);
+        appPTR->setThreadAsActionCaller(_instance, true);
     }
     
     ~ThreadIsActionCaller_RAII()
     {
-        appPTR->setThreadAsActionCaller(false);
+        appPTR->setThreadAsActionCaller(_instance, false);
     }
 };
 
@@ -84,7 +92,8 @@ OfxImageEffectInstance::mainEntry(const char *action,
                                   OFX::Host::Property::Set *inArgs,
                                   OFX::Host::Property::Set *outArgs)
 {
-    ThreadIsActionCaller_RAII t;
+    ThreadIsActionCaller_RAII t(this);
+    ProfilerScope profile(action, _ofxEffectInstance);
     return OFX::Host::ImageEffect::Instance::mainEntry(action, handle, inArgs, outArgs);
 }
 
@@ -1088,6 +1097,111 @@ OfxImageEffectInstance::getInputsHoldingTransform(std::list<int>* inputs) const
     return !inputs->empty();
 }
 
+/*
+ * Natron extension: lets colour effects describe the per-pixel operation they apply so that chains of colour effects
+ * are applied in a single pass, see EffectInstance::getColorOperation().
+ * The in arguments are the same as kFnOfxImageEffectActionGetTransform. The out arguments are:
+ * - kOfxPropName: the name of the input clip the operation is applied to
+ * - kNatronOfxPropColorOperationMatrix: 12 doubles, the rows of the 3x4 affine matrix applied to RGB (identity by default)
+ * - kNatronOfxPropColorOperationCurve: 3*n doubles, optional, the interleaved RGB samples of a curve applied after the matrix
+ * - kNatronOfxPropColorOperationLut3D: 3*size^3 doubles, optional, the interleaved RGB samples of a 3D LUT, red varying
+ *   the fastest. If set, the matrix and the curve are ignored.
+ * - kNatronOfxPropColorOperationDomain: 2 doubles, the input range sampled by the curve or the LUT ([0,1] by default)
+ * The action must only return kOfxStatOK if the output of the effect is entirely described by the operation with the
+ * current parameters (e.g: no mask, mix at 1), and kOfxStatReplyDefault otherwise.
+ */
+#ifndef kNatronOfxImageEffectActionGetColorOperation
+#define kNatronOfxImageEffectActionGetColorOperation "NatronOfxImageEffectActionGetColorOperation"
+#define kNatronOfxPropColorOperationMatrix "NatronOfxPropColorOperationMatrix"
+#define kNatronOfxPropColorOperationCurve "NatronOfxPropColorOperationCurve"
+#define kNatronOfxPropColorOperationLut3D "NatronOfxPropColorOperationLut3D"
+#define kNatronOfxPropColorOperationDomain "NatronOfxPropColorOperationDomain"
+#endif
+
+OfxStatus
+OfxImageEffectInstance::getColorOperationAction(OfxTime time,
+                                                const std::string & field,
+                                                const OfxPointD & renderScale,
+                                                int view,
+                                                std::string & clip,
+                                                Natron::ColorOperation* op)
+{
+    static const OFX::Host::Property::PropSpec inStuff[] = {
+        { kOfxPropTime, OFX::Host::Property::eDouble, 1, true, "0" },
+        { kOfxImageEffectPropFieldToRender, OFX::Host::Property::eString, 1, true, "" },
+        { kOfxImageEffectPropRenderScale, OFX::Host::Property::eDouble, 2, true, "0" },
+        { kFnOfxImageEffectPropView, OFX::Host::Property::eInt, 1, true, "0" },
+        OFX::Host::Property::propSpecEnd
+    };
+    static const OFX::Host::Property::PropSpec outStuff[] = {
+        { kOfxPropName, OFX::Host::Property::eString, 1, false, "" },
+        { kNatronOfxPropColorOperationMatrix, OFX::Host::Property::eDouble, 12, false, "0" },
+        { kNatronOfxPropColorOperationCurve, OFX::Host::Property::eDouble, 0, false, "" },
+        { kNatronOfxPropColorOperationLut3D, OFX::Host::Property::eDouble, 0, false, "" },
+        { kNatronOfxPropColorOperationDomain, OFX::Host::Property::eDouble, 2, false, "0" },
+        OFX::Host::Property::propSpecEnd
+    };
+    OFX::Host::Property::Set inArgs(inStuff);
+    OFX::Host::Property::Set outArgs(outStuff);
+
+    inArgs.setDoubleProperty(kOfxPropTime, time);
+    inArgs.setStringProperty(kOfxImageEffectPropFieldToRender, field);
+    inArgs.setDoubleProperty(kOfxImageEffectPropRenderScale, renderScale.x, 0);
+    inArgs.setDoubleProperty(kOfxImageEffectPropRenderScale, renderScale.y, 1);
+    inArgs.setIntProperty(kFnOfxImageEffectPropView, view);
+
+    ///Defaults: identity matrix on [0,1]
+    for (int i = 0; i < 12; ++i) {
+        outArgs.setDoubleProperty(kNatronOfxPropColorOperationMatrix, (i % 5 == 0) ? 1. : 0., i);
+    }
+    outArgs.setDoubleProperty(kNatronOfxPropColorOperationDomain, 0., 0);
+    outArgs.setDoubleProperty(kNatronOfxPropColorOperationDomain, 1., 1);
+
+    OfxStatus stat = mainEntry(kNatronOfxImageEffectActionGetColorOperation, this->getHandle(), &inArgs, &outArgs);
+    if (stat != kOfxStatOK) {
+        return stat;
+    }
+
+    clip = outArgs.getStringProperty(kOfxPropName);
+    double domainMin = outArgs.getDoubleProperty(kNatronOfxPropColorOperationDomain, 0);
+    double domainMax = outArgs.getDoubleProperty(kNatronOfxPropColorOperationDomain, 1);
+
+    int lutDim = outArgs.getDimension(kNatronOfxPropColorOperationLut3D);
+    if (lutDim > 0) {
+        int size = (int)( std::pow(lutDim / 3., 1. / 3.) + 0.5 );
+        if ( (size < 2) || (size * size * size * 3 != lutDim) || (domainMax <= domainMin) ) {
+            return kOfxStatFailed;
+        }
+        std::vector<float> samples(lutDim);
+        for (int i = 0; i < lutDim; ++i) {
+            samples[i] = (float)outArgs.getDoubleProperty(kNatronOfxPropColorOperationLut3D, i);
+        }
+        op->setLut3D(size, domainMin, domainMax, samples);
+
+        return kOfxStatOK;
+    }
+
+    double matrix[12];
+    for (int i = 0; i < 12; ++i) {
+        matrix[i] = outArgs.getDoubleProperty(kNatronOfxPropColorOperationMatrix, i);
+    }
+    op->setMatrix(matrix);
+
+    int curveDim = outArgs.getDimension(kNatronOfxPropColorOperationCurve);
+    if (curveDim > 0) {
+        if ( (curveDim < 6) || (curveDim % 3 != 0) || (domainMax <= domainMin) ) {
+            return kOfxStatFailed;
+        }
+        std::vector<float> samples(curveDim);
+        for (int i = 0; i < curveDim; ++i) {
+            samples[i] = (float)outArgs.getDoubleProperty(kNatronOfxPropColorOperationCurve, i);
+        }
+        op->setCurve(domainMin, domainMax, samples);
+    }
+
+    return kOfxStatOK;
+}
+
 bool
 OfxImageEffectInstance::isInAnalysis() const
 {
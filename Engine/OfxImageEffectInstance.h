@@ -40,6 +40,7 @@ namespace OFX {
 namespace Natron {
 class Image;
 class ImageComponents;
+class ColorOperation;
 class OfxImageEffectInstance
     : public OFX::Host::ImageEffect::Instance
 {
@@ -274,6 +275,18 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////////
 
     bool getInputsHoldingTransform(std::list<int>* inputs) const;
+
+    /**
+     * @brief Calls the Natron extension action describing the colour operation applied by the effect,
+     * see kNatronOfxImageEffectActionGetColorOperation.
+     * @param clip[out] The name of the input clip the operation is applied to
+     **/
+    OfxStatus getColorOperationAction(OfxTime time,
+                                      const std::string & field,
+                                      const OfxPointD & renderScale,
+                                      int view,
+                                      std::string & clip,
+                                      Natron::ColorOperation* op);
     
     const std::map<std::string,OFX::Host::ImageEffect::ClipInstance*>& getClips() const;
     
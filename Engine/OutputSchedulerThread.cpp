@@ -18,6 +18,11 @@
 #include <iostream>
 #include <set>
 #include <list>
+#include <map>
+#include <climits>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
 #include <QMetaType>
 #include <QMutex>
 #include <QWaitCondition>
@@ -34,6 +39,7 @@
 
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
+#include "Engine/DiskCacheNode.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Image.h"
 #include "Engine/Node.h"
@@ -47,6 +53,16 @@
 
 #define NATRON_FPS_REFRESH_RATE_SECONDS 1.5
 
+///Bounds of the number of frames read from the disk cache ahead of the render threads during playback
+#define NATRON_PREFETCH_MIN_FRAMES 4
+#define NATRON_PREFETCH_MAX_FRAMES 32
+
+///How long the renders must have been idle before the viewer prerenders the frames next to the current one
+#define NATRON_SPECULATIVE_RENDER_IDLE_DELAY_MS 150
+
+///The part of the RAM portion of the viewer cache the prerendered textures not displayed yet may take
+#define NATRON_SPECULATIVE_RENDER_CACHE_FRACTION 0.25
+
 
 using namespace Natron;
 
@@ -129,6 +145,158 @@ struct ProducedFrame
     RequestedFrame* request;
 };
 
+/**
+ * @brief Reads back into RAM the disk-cached frames that the render threads are about to ask for during playback,
+ * so they do not stall on page faults when fetching them from the cache.
+ * The look-ahead window follows the measured read bandwidth: the longer it takes to read a frame compared to
+ * displaying it, the more frames are read ahead.
+ **/
+class DiskCachePrefetcher : public QThread
+{
+public:
+    
+    DiskCachePrefetcher()
+    : QThread()
+    , lock()
+    , cond()
+    , treeVersions()
+    , requests()
+    , prefetched()
+    , bytesPerSecond(0)
+    , bytesPerFrame(0)
+    , mustQuit(false)
+    {
+        setObjectName("Disk cache prefetcher");
+    }
+    
+    virtual ~DiskCachePrefetcher()
+    {
+        quitThread();
+    }
+    
+    /**
+     * @brief Set the tree versions of the cached frames to read, i.e: the hash of the viewer and of the DiskCache nodes.
+     **/
+    void setTreeVersions(const std::list<U64>& versions)
+    {
+        QMutexLocker k(&lock);
+        treeVersions = versions;
+        requests.clear();
+        prefetched.clear();
+    }
+    
+    /**
+     * @brief The frames that will be rendered next, in order. It replaces the previous request.
+     **/
+    void requestFrames(const std::list<int>& frames)
+    {
+        QMutexLocker k(&lock);
+        if ( treeVersions.empty() ) {
+            return;
+        }
+        
+        ///Forget the frames that left the window so they can be read again if the playback loops
+        std::set<int> window(frames.begin(), frames.end());
+        std::set<int> stillInWindow;
+        std::set_intersection( prefetched.begin(), prefetched.end(), window.begin(), window.end(),
+                               std::inserter( stillInWindow, stillInWindow.begin() ) );
+        prefetched.swap(stillInWindow);
+        
+        requests.clear();
+        for (std::list<int>::const_iterator it = frames.begin(); it != frames.end(); ++it) {
+            if ( prefetched.find(*it) == prefetched.end() ) {
+                requests.push_back(*it);
+            }
+        }
+        if ( !requests.empty() ) {
+            cond.wakeOne();
+        }
+    }
+    
+    void clearRequests()
+    {
+        QMutexLocker k(&lock);
+        requests.clear();
+    }
+    
+    /**
+     * @brief Returns how many frames ahead of the render threads should be read at the given playback rate.
+     **/
+    int getLookAheadWindow(double fps) const
+    {
+        QMutexLocker k(&lock);
+        if ( (bytesPerSecond <= 0) || (fps <= 0) ) {
+            return NATRON_PREFETCH_MIN_FRAMES;
+        }
+        ///Number of frames displayed while one frame is read, doubled so the prefetcher stays ahead
+        double framesPerRead = fps * bytesPerFrame / bytesPerSecond;
+        int window = NATRON_PREFETCH_MIN_FRAMES + (int)std::ceil(2. * framesPerRead);
+        return std::min(window, NATRON_PREFETCH_MAX_FRAMES);
+    }
+    
+    void quitThread()
+    {
+        if ( !isRunning() ) {
+            return;
+        }
+        {
+            QMutexLocker k(&lock);
+            mustQuit = true;
+            cond.wakeOne();
+        }
+        wait();
+    }
+    
+private:
+    
+    virtual void run() OVERRIDE FINAL
+    {
+        for (;;) {
+            int time;
+            std::list<U64> versions;
+            {
+                QMutexLocker k(&lock);
+                while (!mustQuit && requests.empty()) {
+                    cond.wait(&lock);
+                }
+                if (mustQuit) {
+                    mustQuit = false;
+                    return;
+                }
+                time = requests.front();
+                requests.pop_front();
+                prefetched.insert(time);
+                versions = treeVersions;
+            }
+            
+            TimeLapse timer;
+            std::size_t bytes = appPTR->prefetchDiskCachedFrame(versions, time);
+            double elapsed = timer.getTimeElapsedReset();
+            
+            ///Frames that were already in RAM tell nothing about the bandwidth
+            if ( (bytes > 0) && (elapsed > 0) ) {
+                QMutexLocker k(&lock);
+                if (bytesPerSecond <= 0) {
+                    bytesPerSecond = bytes / elapsed;
+                    bytesPerFrame = bytes;
+                } else {
+                    bytesPerSecond = 0.8 * bytesPerSecond + 0.2 * (bytes / elapsed);
+                    bytesPerFrame = 0.8 * bytesPerFrame + 0.2 * bytes;
+                }
+            }
+        }
+    }
+    
+    mutable QMutex lock;
+    QWaitCondition cond;
+    std::list<U64> treeVersions;
+    std::list<int> requests; //< frames to read, in order
+    std::set<int> prefetched; //< frames of the window already read
+    double bytesPerSecond; //< measured read bandwidth, 0 until measured
+    double bytesPerFrame;
+    bool mustQuit;
+};
+
 struct OutputSchedulerThreadPrivate
 {
     
@@ -212,6 +380,9 @@ struct OutputSchedulerThreadPrivate
     QMutex runningCallbackMutex;
     QWaitCondition runningCallbackCond;
     
+    ///Reads ahead the disk-cached frames during playback
+    DiskCachePrefetcher prefetcher;
+    
     OutputSchedulerThreadPrivate(RenderEngine* engine,Natron::OutputEffectInstance* effect,OutputSchedulerThread::ProcessFrameModeEnum mode)
     : buf()
     , bufCondition()
@@ -256,6 +427,7 @@ struct OutputSchedulerThreadPrivate
     , runningCallback(false)
     , runningCallbackMutex()
     , runningCallbackCond()
+    , prefetcher()
     {
        
     }
@@ -454,6 +626,8 @@ OutputSchedulerThread::~OutputSchedulerThread()
 
     ///Make sure they are all gone, there will be a deadlock here if that's not the case.
     _imp->waitForRenderThreadsToQuit();
+    
+    _imp->prefetcher.quitThread();
 }
 
 
@@ -597,6 +771,8 @@ OutputSchedulerThread::pushFramesToRenderInternal(int startingFrame,int nThreads
         _imp->framesToRender.push_back(startingFrame);
         _imp->lastFramePushedIndex = startingFrame;
     } else {
+        bool canContinue = true;
+        
         ///Push 2x the count of threads to be sure no one will be waiting
         while ((int)_imp->framesToRender.size() < nThreads * 2) {
             _imp->framesToRender.push_back(startingFrame);
@@ -605,9 +781,24 @@ OutputSchedulerThread::pushFramesToRenderInternal(int startingFrame,int nThreads
             
             if (!OutputSchedulerThreadPrivate::getNextFrameInSequence(pMode, direction, startingFrame,
                                                                       firstFrame, lastFrame, &startingFrame, &direction)) {
+                canContinue = false;
                 break;
             }
         }
+        
+        ///Read from the disk cache the frames that will be pushed next
+        if (canContinue) {
+            std::list<int> framesToPrefetch;
+            int window = _imp->prefetcher.getLookAheadWindow( getDesiredFPS() );
+            for (int i = 0; i < window; ++i) {
+                framesToPrefetch.push_back(startingFrame);
+                if (!OutputSchedulerThreadPrivate::getNextFrameInSequence(pMode, direction, startingFrame,
+                                                                          firstFrame, lastFrame, &startingFrame, &direction)) {
+                    break;
+                }
+            }
+            _imp->prefetcher.requestFrames(framesToPrefetch);
+        }
     }
   
     ///Wake up render threads to notify them theres work to do
@@ -788,6 +979,15 @@ OutputSchedulerThread::startRender()
     
     aboutToStartRender();
     
+    {
+        std::list<U64> treeVersions;
+        getTreeVersionsToPrefetch(&treeVersions);
+        _imp->prefetcher.setTreeVersions(treeVersions);
+        if ( !treeVersions.empty() && !_imp->prefetcher.isRunning() ) {
+            _imp->prefetcher.start();
+        }
+    }
+    
     ///Notify everyone that the render is started
     _imp->engine->s_renderStarted(forward);
     
@@ -852,6 +1052,8 @@ OutputSchedulerThread::stopRender()
 {
     _imp->timer->playState = ePlayStatePause;
     
+    _imp->prefetcher.clearRequests();
+    
     ///Wait for all render threads to be done
     {
         QMutexLocker l(&_imp->renderThreadsMutex);
@@ -1480,7 +1682,7 @@ OutputSchedulerThread::quitThread()
     ///Make sure they are all gone, there will be a deadlock here if that's not the case.
     _imp->waitForRenderThreadsToQuit();
         
-    
+    _imp->prefetcher.quitThread();
     
     wait();
 }
@@ -1505,6 +1707,30 @@ OutputSchedulerThread::getDesiredFPS() const
     return _imp->timer->getDesiredFrameRate();
 }
 
+static void
+getUpstreamDiskCacheNodesHashes(Natron::EffectInstance* effect,
+                                std::set<Natron::EffectInstance*>* visited,
+                                std::list<U64>* hashes)
+{
+    if ( !effect || !visited->insert(effect).second ) {
+        return;
+    }
+    if ( dynamic_cast<DiskCacheNode*>(effect) ) {
+        hashes->push_back( effect->getHash() );
+    }
+    int maxInputs = effect->getMaxInputCount();
+    for (int i = 0; i < maxInputs; ++i) {
+        getUpstreamDiskCacheNodesHashes(effect->getInput(i), visited, hashes);
+    }
+}
+
+void
+OutputSchedulerThread::getTreeVersionsToPrefetch(std::list<U64>* treeVersions) const
+{
+    std::set<Natron::EffectInstance*> visited;
+    getUpstreamDiskCacheNodesHashes(_imp->outputEffect, &visited, treeVersions);
+}
+
 void
 OutputSchedulerThread::renderFrameRange(int firstFrame,int lastFrame,RenderDirectionEnum direction)
 {
@@ -1969,6 +2195,8 @@ private:
                     RectI renderWindow;
                     rod.toPixelEnclosing(scale, par, &renderWindow);
                     
+                    ///Each render thread of the scheduler renders a frame, be the frames written right away or in order
+                    ///by processFrame()
                     ParallelRenderArgsSetter frameRenderArgs(activeInputToRender->getApp()->getProject().get(),
                                                              time,
                                                              i,
@@ -1979,7 +2207,10 @@ private:
                                                              _imp->output, // viewer requester
                                                              0, //texture index
                                                              _imp->output->getApp()->getTimeLine().get(),
-                                                             false);
+                                                             false,
+                                                             Natron::eRenderPriorityBatch,
+                                                             true, // is a frame rendered ?
+                                                             true); // is this one of the frames of a sequence rendered in parallel ?
                     
                     RenderingFlagSetter flagIsRendering(activeInputToRender->getNode().get());
 
@@ -2063,6 +2294,7 @@ DefaultScheduler::processFrame(const BufferedFrames& frames)
         ignore_result(_effect->getRegionOfDefinition_public(hash,it->time, scale, it->view, &rod, &isProjectFormat));
         rod.toPixelEnclosing(0, par, &roi);
         
+        ///The frames are written one at a time by the scheduler thread
         ParallelRenderArgsSetter frameRenderArgs(_effect->getApp()->getProject().get(),
                                                  it->time,
                                                  it->view,
@@ -2073,7 +2305,10 @@ DefaultScheduler::processFrame(const BufferedFrames& frames)
                                                  _effect, //viewer
                                                  0, //texture index
                                                  _effect->getApp()->getTimeLine().get(),
-                                                 false);
+                                                 false,
+                                                 Natron::eRenderPriorityBatch,
+                                                 true, // is a frame rendered ?
+                                                 false); // is this one of the frames of a sequence rendered in parallel ?
         
         RenderingFlagSetter flagIsRendering(_effect->getNode().get());
         
@@ -2212,7 +2447,7 @@ DefaultScheduler::onRenderStopped(bool aborted)
     if (!isBackGround) {
         _effect->setKnobsFrozen(false);
     } else {
-        _effect->notifyRenderFinished();
+        _effect->notifyRenderFinished(aborted);
     }
     
     std::string cb = _effect->getNode()->getAfterRenderCallback();
@@ -2364,7 +2599,7 @@ private:
         
         for (int i = 0; i < 2; ++i) {
             args[i].reset(new ViewerInstance::ViewerArgs);
-            status[i] = _viewer->getRenderViewerArgsAndCheckCache(time, true, true, view, i, viewerHash, args[i].get());
+            status[i] = _viewer->getRenderViewerArgsAndCheckCache(time, true, true, view, i, viewerHash, false, args[i].get());
         }
        
         if (status[0] == eStatusFailed && status[1] == eStatusFailed) {
@@ -2432,6 +2667,14 @@ ViewerDisplayScheduler::onRenderStopped(bool /*/aborted*/)
     }
 }
 
+void
+ViewerDisplayScheduler::getTreeVersionsToPrefetch(std::list<U64>* treeVersions) const
+{
+    ///The textures of the viewer cache are indexed by the hash of the viewer
+    treeVersions->push_back( _viewer->getHash() );
+    OutputSchedulerThread::getTreeVersionsToPrefetch(treeVersions);
+}
+
 int
 ViewerDisplayScheduler::getLastRenderedTime() const
 {
@@ -2493,6 +2736,10 @@ RenderEngine::renderFrameRange(int firstFrame,int lastFrame,OutputSchedulerThrea
         }
     }
     
+    if (_imp->currentFrameScheduler) {
+        _imp->currentFrameScheduler->cancelSpeculativeRenders();
+    }
+    
     _imp->scheduler->renderFrameRange(firstFrame, lastFrame, forward);
 }
 
@@ -2507,6 +2754,10 @@ RenderEngine::renderFromCurrentFrame(OutputSchedulerThread::RenderDirectionEnum
         }
     }
     
+    if (_imp->currentFrameScheduler) {
+        _imp->currentFrameScheduler->cancelSpeculativeRenders();
+    }
+    
     _imp->scheduler->renderFromCurrentFrame(forward);
 }
 
@@ -2567,6 +2818,25 @@ RenderEngine::isSequentialRenderBeingAborted() const
     return _imp->scheduler->isBeingAborted();
 }
 
+bool
+RenderEngine::isSpeculativeRenderBeingAborted() const
+{
+    if (!_imp->currentFrameScheduler) {
+        return false;
+    }
+    return _imp->currentFrameScheduler->isSpeculativeRenderBeingAborted();
+}
+
+void
+RenderEngine::getSpeculativeRenderStats(SpeculativeRenderStats* stats) const
+{
+    if (!_imp->currentFrameScheduler) {
+        *stats = SpeculativeRenderStats();
+        return;
+    }
+    _imp->currentFrameScheduler->getSpeculativeRenderStats(stats);
+}
+
 bool
 RenderEngine::hasThreadsAlive() const
 {
@@ -2653,6 +2923,313 @@ ViewerRenderEngine::createScheduler(Natron::OutputEffectInstance* effect)
 
 
 
+/**
+ * @brief Prerenders in the viewer cache the frames that follow the one displayed by the viewer, in the direction
+ * the user is scrubbing the timeline, while no other render is running.
+ * The prerenders have the lowest priority and back off as soon as another render starts, see EffectInstance::aborted().
+ * The prerendered textures not displayed yet never take more than a part of the RAM portion of the viewer cache
+ * and never evict other textures.
+ **/
+class ViewerSpeculativeRenderer : public QThread
+{
+    ///A prerendered texture that was not requested by the viewer yet
+    struct PendingTexture
+    {
+        int time;
+        std::size_t bytes;
+    };
+    
+    ///Indexed by the hash of the key of the texture
+    typedef std::map<U64,PendingTexture> PendingTextures;
+    
+public:
+    
+    ViewerSpeculativeRenderer(ViewerInstance* viewer)
+    : QThread()
+    , viewer(viewer)
+    , lock()
+    , cond()
+    , requests()
+    , requestsAge(0)
+    , view(0)
+    , viewerHash(0)
+    , renderingTime(INT_MIN)
+    , abortRequested(0)
+    , pending()
+    , pendingBytes(0)
+    , stats()
+    , mustQuit(false)
+    {
+        setObjectName("Viewer speculative renderer");
+    }
+    
+    virtual ~ViewerSpeculativeRenderer()
+    {
+        quitThread();
+    }
+    
+    /**
+     * @brief Called on the main thread once the viewer displayed the given frame: the frames that follow it in the
+     * given direction are prerendered once the renders have been idle for a while. It replaces the previous request.
+     **/
+    void requestFrames(int frame,
+                       int direction,
+                       int requestView,
+                       U64 requestViewerHash)
+    {
+        assert(QThread::currentThread() == qApp->thread());
+        
+        int nFrames = appPTR->getCurrentSettings()->getNumberOfSpeculativeFrames();
+        if (appPTR->getCurrentSettings()->getNumberOfThreads() == -1) {
+            ///Everything is rendered on the main-thread
+            nFrames = 0;
+        }
+        int first,last;
+        viewer->getTimelineBounds(&first, &last);
+        
+        QMutexLocker k(&lock);
+        requests.clear();
+        ++requestsAge;
+        
+        if (requestViewerHash != viewerHash) {
+            ///The tree changed, the textures prerendered so far will never be displayed
+            stats.nWasted += pending.size();
+            pending.clear();
+            pendingBytes = 0;
+        }
+        view = requestView;
+        viewerHash = requestViewerHash;
+        
+        for (int i = 1; i <= nFrames; ++i) {
+            int time = frame + i * direction;
+            if ( (time < first) || (time > last) ) {
+                break;
+            }
+            requests.push_back(time);
+        }
+        
+        ///The textures that left the window are unlikely to be displayed, stop counting them in the budget
+        for (PendingTextures::iterator it = pending.begin(); it != pending.end();) {
+            if ( (it->second.time != frame) && ( std::find(requests.begin(), requests.end(), it->second.time) == requests.end() ) ) {
+                pendingBytes -= it->second.bytes;
+                ++stats.nWasted;
+                pending.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+        
+        if ( requests.empty() ) {
+            return;
+        }
+        if ( !isRunning() ) {
+            start(QThread::LowestPriority);
+        } else {
+            cond.wakeOne();
+        }
+    }
+    
+    /**
+     * @brief Forgets the requested frames. The prerender running is aborted, unless it renders the given frame:
+     * the viewer is then going to wait for it rather than render the frame again.
+     **/
+    void cancelRequests(int frameToKeep = INT_MIN)
+    {
+        QMutexLocker k(&lock);
+        requests.clear();
+        ++requestsAge;
+        if ( (renderingTime != INT_MIN) && (renderingTime != frameToKeep) ) {
+            abortRequested = 1;
+        }
+    }
+    
+    bool isAborted() const
+    {
+        QMutexLocker k(&lock);
+        return abortRequested != 0;
+    }
+    
+    /**
+     * @brief Called when the viewer requests a texture, fromCache is true if it was found in the cache
+     **/
+    void notifyTextureRequested(U64 keyHash,
+                                bool fromCache)
+    {
+        QMutexLocker k(&lock);
+        PendingTextures::iterator found = pending.find(keyHash);
+        if ( found == pending.end() ) {
+            return;
+        }
+        if (fromCache) {
+            ++stats.nHits;
+        } else {
+            ++stats.nEvicted;
+        }
+        pendingBytes -= found->second.bytes;
+        pending.erase(found);
+    }
+    
+    void getStats(SpeculativeRenderStats* ret) const
+    {
+        QMutexLocker k(&lock);
+        *ret = stats;
+    }
+    
+    void quitThread()
+    {
+        if ( !isRunning() ) {
+            return;
+        }
+        {
+            QMutexLocker k(&lock);
+            requests.clear();
+            abortRequested = 1;
+            mustQuit = true;
+            cond.wakeOne();
+        }
+        wait();
+    }
+    
+private:
+    
+    virtual void run() OVERRIDE FINAL
+    {
+        RenderPriorityArbiter* arbiter = appPTR->getRenderPriorityArbiter();
+        U64 servedAge = 0;
+        int servedActivity = arbiter->getHigherPriorityActivity(eRenderPrioritySpeculative);
+        for (;;) {
+            int time,renderView;
+            U64 renderViewerHash;
+            {
+                QMutexLocker k(&lock);
+                for (;;) {
+                    while (!mustQuit && requests.empty()) {
+                        cond.wait(&lock);
+                    }
+                    if (mustQuit) {
+                        mustQuit = false;
+                        return;
+                    }
+                    
+                    ///Wait for the renders to be idle for a while after a new request: a newer request or any render
+                    ///of a higher priority starting or ending in the meantime restarts the delay
+                    U64 age = requestsAge;
+                    int activity = arbiter->getHigherPriorityActivity(eRenderPrioritySpeculative);
+                    if ( (age != servedAge) || (activity != servedActivity) || arbiter->hasHigherPriorityRenders(eRenderPrioritySpeculative) ) {
+                        cond.wait(&lock, NATRON_SPECULATIVE_RENDER_IDLE_DELAY_MS);
+                        if ( mustQuit || (age != requestsAge) || (activity != arbiter->getHigherPriorityActivity(eRenderPrioritySpeculative)) ||
+                             arbiter->hasHigherPriorityRenders(eRenderPrioritySpeculative) ) {
+                            continue;
+                        }
+                    }
+                    if ( !requests.empty() ) {
+                        servedAge = age;
+                        servedActivity = activity;
+                        break;
+                    }
+                }
+                time = requests.front();
+                requests.pop_front();
+                renderView = view;
+                renderViewerHash = viewerHash;
+                renderingTime = time;
+                abortRequested = 0;
+            }
+            
+            renderFrame(time, renderView, renderViewerHash);
+            
+            QMutexLocker k(&lock);
+            renderingTime = INT_MIN;
+        }
+    }
+    
+    void renderFrame(int time,
+                     int renderView,
+                     U64 renderViewerHash)
+    {
+        boost::shared_ptr<ViewerInstance::ViewerArgs> args[2];
+        std::size_t bytes = 0;
+        for (int i = 0; i < 2; ++i) {
+            args[i].reset(new ViewerInstance::ViewerArgs);
+            StatusEnum stat = viewer->getRenderViewerArgsAndCheckCache(time, true, true, renderView, i, renderViewerHash, true, args[i].get());
+            if ( (stat != eStatusOK) || !args[i]->params ) {
+                args[i].reset();
+            } else {
+                bytes += args[i]->params->bytesCount;
+            }
+        }
+        OpenGLViewerI* uiContext = viewer->getUiContext();
+        if ( args[1] && ( !uiContext || (uiContext->getCompositingOperator() == eViewerCompositingOperatorNone) ) ) {
+            ///The second texture is not displayed, see ViewerInstance::renderViewer
+            bytes -= args[1]->params->bytesCount;
+            args[1].reset();
+        }
+        if (!args[0] && !args[1]) {
+            ///Nothing to prerender: the frame is already in the cache or cannot be rendered
+            return;
+        }
+        
+        std::size_t cacheSize,cacheMaxSize;
+        appPTR->getViewerCacheMemoryUsage(&cacheSize, &cacheMaxSize);
+        {
+            QMutexLocker k(&lock);
+            if ( (pendingBytes + bytes > cacheMaxSize * NATRON_SPECULATIVE_RENDER_CACHE_FRACTION) ||
+                 (cacheSize + bytes > cacheMaxSize) ) {
+                ///The textures of the next frames would not fit either
+                ++stats.nOverBudget;
+                requests.clear();
+                return;
+            }
+            if (abortRequested) {
+                return;
+            }
+        }
+        
+        bool hadArgs[2] = { args[0].get() != NULL, args[1].get() != NULL };
+        StatusEnum stat;
+        try {
+            stat = viewer->renderViewer(renderView, true, true, renderViewerHash, true, args);
+        } catch (...) {
+            stat = eStatusFailed;
+        }
+        
+        QMutexLocker k(&lock);
+        for (int i = 0; i < 2; ++i) {
+            if (!hadArgs[i]) {
+                continue;
+            }
+            ///renderViewer() releases the arguments of the textures that were not rendered
+            if ( (stat == eStatusFailed) || !args[i] || !args[i]->params || !args[i]->params->ramBuffer ) {
+                ++stats.nAborted;
+                continue;
+            }
+            PendingTexture p;
+            p.time = time;
+            p.bytes = args[i]->params->bytesCount;
+            std::pair<PendingTextures::iterator,bool> ret = pending.insert( std::make_pair(args[i]->key->getHash(), p) );
+            if (ret.second) {
+                pendingBytes += p.bytes;
+                ++stats.nRendered;
+            }
+        }
+    }
+    
+    ViewerInstance* viewer;
+    
+    mutable QMutex lock;
+    QWaitCondition cond;
+    std::list<int> requests; //< frames to prerender, in order
+    U64 requestsAge; //< incremented for each request
+    int view;
+    U64 viewerHash;
+    int renderingTime; //< the frame being prerendered or INT_MIN
+    int abortRequested;
+    PendingTextures pending;
+    std::size_t pendingBytes; //< memory taken by the pending textures, bounded by the budget
+    SpeculativeRenderStats stats;
+    bool mustQuit;
+};
+
 struct ViewerCurrentFrameRequestSchedulerPrivate
 {
     
@@ -2677,6 +3254,13 @@ struct ViewerCurrentFrameRequestSchedulerPrivate
     
     int abortRequested;
     QMutex abortRequestedMutex;
+    
+    ///Only accessed on the main-thread
+    int lastRequestedFrame;
+    int scrubDirection; //< 1 or -1
+    int lastRequestedView;
+    U64 lastRequestedViewerHash;
+    ViewerSpeculativeRenderer speculativeRenderer;
 
     
     ViewerCurrentFrameRequestSchedulerPrivate(ViewerInstance* viewer)
@@ -2695,10 +3279,20 @@ struct ViewerCurrentFrameRequestSchedulerPrivate
     , mustQuitCond()
     , abortRequested(0)
     , abortRequestedMutex()
+    , lastRequestedFrame(INT_MIN)
+    , scrubDirection(1)
+    , lastRequestedView(0)
+    , lastRequestedViewerHash(0)
+    , speculativeRenderer(viewer)
     {
         
     }
     
+    void requestSpeculativeFrames()
+    {
+        speculativeRenderer.requestFrames(lastRequestedFrame, scrubDirection, lastRequestedView, lastRequestedViewerHash);
+    }
+    
     bool checkForExit()
     {
         QMutexLocker k(&mustQuitMutex);
@@ -2904,6 +3498,10 @@ ViewerCurrentFrameRequestSchedulerPrivate::processProducedFrame(const Bufferable
         }
     }
     
+    if ( !frames.empty() ) {
+        requestSpeculativeFrames();
+    }
+    
     
     ///At least redraw the viewer, we might be here when the user removed a node upstream of the viewer.
     //if (hasDoneSomething) {
@@ -2921,6 +3519,8 @@ ViewerCurrentFrameRequestSchedulerPrivate::processProducedFrame(const Bufferable
 void
 ViewerCurrentFrameRequestScheduler::abortRendering()
 {
+    _imp->speculativeRenderer.cancelRequests();
+    
     if (!isRunning()) {
         return;
     }
@@ -2940,6 +3540,18 @@ ViewerCurrentFrameRequestScheduler::abortRendering()
 void
 ViewerCurrentFrameRequestScheduler::quitThread()
 {
+    _imp->speculativeRenderer.quitThread();
+    
+#ifdef DEBUG
+    SpeculativeRenderStats stats;
+    _imp->speculativeRenderer.getStats(&stats);
+    if (stats.nRendered > 0) {
+        qDebug() << _imp->viewer->getScriptName_mt_safe().c_str() << "prerendered" << stats.nRendered << "textures while idle:"
+                 << stats.nHits << "displayed (" << 100. * stats.nHits / stats.nRendered << "% hit rate)," << stats.nEvicted << "evicted before being displayed,"
+                 << stats.nWasted << "never displayed," << stats.nAborted << "aborted," << stats.nOverBudget << "skipped over the memory budget";
+    }
+#endif
+    
     if (!isRunning()) {
         return;
     }
@@ -2977,6 +3589,24 @@ ViewerCurrentFrameRequestScheduler::hasThreadsWorking() const
     return _imp->requestsQueue.size() > 0;
 }
 
+void
+ViewerCurrentFrameRequestScheduler::cancelSpeculativeRenders()
+{
+    _imp->speculativeRenderer.cancelRequests();
+}
+
+bool
+ViewerCurrentFrameRequestScheduler::isSpeculativeRenderBeingAborted() const
+{
+    return _imp->speculativeRenderer.isAborted();
+}
+
+void
+ViewerCurrentFrameRequestScheduler::getSpeculativeRenderStats(SpeculativeRenderStats* stats) const
+{
+    _imp->speculativeRenderer.getStats(stats);
+}
+
 void
 ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool canAbort)
 {
@@ -2991,10 +3621,23 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool canAbort)
     if (!_imp->viewer->getUiContext() || _imp->viewer->getApp()->isCreatingNode()) {
         return;
     }
+    
+    ///Prerender the next frames in the direction the user is scrubbing the timeline
+    if (frame != _imp->lastRequestedFrame) {
+        _imp->scrubDirection = frame < _imp->lastRequestedFrame ? -1 : 1;
+        _imp->lastRequestedFrame = frame;
+    }
+    _imp->lastRequestedView = view;
+    _imp->lastRequestedViewerHash = viewerHash;
+    _imp->speculativeRenderer.cancelRequests(frame);
+    
     boost::shared_ptr<ViewerInstance::ViewerArgs> args[2];
     for (int i = 0; i < 2; ++i) {
         args[i].reset(new ViewerInstance::ViewerArgs);
-        status[i] = _imp->viewer->getRenderViewerArgsAndCheckCache(frame, false, canAbort, view, i, viewerHash, args[i].get());
+        status[i] = _imp->viewer->getRenderViewerArgsAndCheckCache(frame, false, canAbort, view, i, viewerHash, false, args[i].get());
+        if (args[i]->key) {
+            _imp->speculativeRenderer.notifyTextureRequested( args[i]->key->getHash(), args[i]->params && args[i]->params->ramBuffer );
+        }
     }
     
     if (status[0] == eStatusFailed && status[1] == eStatusFailed) {
@@ -3015,6 +3658,7 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool canAbort)
         (!args[0] && status[0] == eStatusOK && args[1] && status[1] == eStatusFailed) ||
         (!args[1] && status[1] == eStatusOK && args[0] && status[0] == eStatusFailed)) {
         _imp->viewer->redrawViewer();
+        _imp->requestSpeculativeFrames();
     } else {
         
         CurrentFrameFunctorArgs functorArgs;
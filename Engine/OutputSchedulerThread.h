@@ -375,6 +375,12 @@ protected:
      **/
     virtual void onRenderStopped(bool /*aborted*/) {}
     
+    /**
+     * @brief Returns the tree versions of the disk-cached images read during playback, so they can be
+     * read ahead of the render threads. By default these are the hashes of the DiskCache nodes upstream.
+     **/
+    virtual void getTreeVersionsToPrefetch(std::list<U64>* treeVersions) const;
+    
     RenderEngine* getEngine() const;
     
     void runCallback(const QString& callback);
@@ -496,9 +502,34 @@ private:
     
     virtual void onRenderStopped(bool aborted) OVERRIDE FINAL;
     
+    virtual void getTreeVersionsToPrefetch(std::list<U64>* treeVersions) const OVERRIDE FINAL;
+    
     ViewerInstance* _viewer;
 };
 
+/**
+ * @brief Statistics of the textures prerendered by a viewer while the renders were idle
+ **/
+struct SpeculativeRenderStats
+{
+    U64 nRendered; //< textures prerendered in the viewer cache
+    U64 nHits; //< prerendered textures later displayed from the cache
+    U64 nEvicted; //< prerendered textures that had left the cache when they were requested
+    U64 nWasted; //< prerendered textures never requested: the user went elsewhere or the tree changed
+    U64 nAborted; //< prerenders that backed off for another render
+    U64 nOverBudget; //< prerenders skipped because the textures would not have fit in the memory budget
+    
+    SpeculativeRenderStats()
+    : nRendered(0)
+    , nHits(0)
+    , nEvicted(0)
+    , nWasted(0)
+    , nAborted(0)
+    , nOverBudget(0)
+    {
+    }
+};
+
 /**
  * @brief The OutputSchedulerThread class (and its derivatives) are meant to be used for playback/render on disk and regulates the output ordering.
  * This class achieves kinda the same goal: it provides the ability to give it a work queue and process the work queue in the same order.
@@ -528,6 +559,15 @@ public:
     
     bool hasThreadsWorking() const;
     
+    /**
+     * @brief Stops prerendering the frames next to the current one, until the viewer displays a frame again
+     **/
+    void cancelSpeculativeRenders();
+    
+    bool isSpeculativeRenderBeingAborted() const;
+    
+    void getSpeculativeRenderStats(SpeculativeRenderStats* stats) const;
+    
 public Q_SLOTS:
     
     void doProcessProducedFrameOnMainThread(const BufferableObjectList& frames);
@@ -614,6 +654,16 @@ public:
      **/
     bool isSequentialRenderBeingAborted() const;
     
+    /**
+     * @brief Returns true if the frames prerendered by the viewer while idle are being aborted
+     **/
+    bool isSpeculativeRenderBeingAborted() const;
+    
+    /**
+     * @brief Returns the statistics of the frames prerendered by the viewer while idle
+     **/
+    void getSpeculativeRenderStats(SpeculativeRenderStats* stats) const;
+    
 public Q_SLOTS:
 
     
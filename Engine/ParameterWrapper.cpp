@@ -13,9 +13,85 @@
 #include <Python.h>
 
 #include "ParameterWrapper.h"
+
+#include <cmath>
+#include <cstring>
+
 #include "Engine/EffectInstance.h"
 #include "Engine/Node.h"
 
+template <typename T>
+static void
+bufferToDoubles(const Py_buffer& view,std::vector<double>* values)
+{
+    const char* data = (const char*)view.buf;
+    Py_ssize_t n = view.len / view.itemsize;
+    values->resize(n);
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        T v;
+        std::memcpy(&v, data + i * view.itemsize, sizeof(T));
+        (*values)[i] = (double)v;
+    }
+}
+
+bool
+pyObjectToDoubles(PyObject* obj,std::vector<double>* values)
+{
+    values->clear();
+    if ( PyObject_CheckBuffer(obj) ) {
+        Py_buffer view;
+        if (PyObject_GetBuffer(obj, &view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) == 0) {
+            ///Skip the byte order character, only native data is supported
+            const char* format = view.format ? view.format : "B";
+            if ( (*format == '@') || (*format == '=') ) {
+                ++format;
+            }
+            bool ok = true;
+            if ( (std::strlen(format) != 1) || (view.ndim > 1) ) {
+                ok = false;
+            } else if ( (*format == 'd') && (view.itemsize == sizeof(double)) ) {
+                bufferToDoubles<double>(view, values);
+            } else if ( (*format == 'f') && (view.itemsize == sizeof(float)) ) {
+                bufferToDoubles<float>(view, values);
+            } else if ( (*format == 'i') && (view.itemsize == sizeof(int)) ) {
+                bufferToDoubles<int>(view, values);
+            } else if ( (*format == 'l') && (view.itemsize == sizeof(long)) ) {
+                bufferToDoubles<long>(view, values);
+            } else if ( (*format == 'q') && (view.itemsize == sizeof(long long)) ) {
+                bufferToDoubles<long long>(view, values);
+            } else {
+                ok = false;
+            }
+            PyBuffer_Release(&view);
+            if (ok) {
+                return true;
+            }
+        } else {
+            PyErr_Clear();
+        }
+    }
+    
+    ///Not a buffer of numbers, fallback on the sequence protocol
+    PyObject* seq = PySequence_Fast(obj, "expected a sequence of numbers");
+    if (!seq) {
+        return false;
+    }
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    PyObject** items = PySequence_Fast_ITEMS(seq);
+    values->resize(n);
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        double v = PyFloat_AsDouble(items[i]);
+        if ( (v == -1.) && PyErr_Occurred() ) {
+            Py_DECREF(seq);
+            values->clear();
+            return false;
+        }
+        (*values)[i] = v;
+    }
+    Py_DECREF(seq);
+    return true;
+}
+
 Param::Param(const boost::shared_ptr<KnobI>& knob)
 : _knob(knob)
 {
@@ -294,6 +370,55 @@ AnimatedParam::removeAnimation(int dimension)
     getInternalKnob()->removeAnimation(dimension);
 }
 
+void
+AnimatedParam::setValuesAtTimes(const std::vector<double>& times,const std::vector<double>& values,int dimension)
+{
+    boost::shared_ptr<KnobI> knob = getInternalKnob();
+    std::vector<int> frames( times.size() );
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        frames[i] = (int)std::floor(times[i] + 0.5);
+    }
+    
+    Knob<double>* isDouble = dynamic_cast<Knob<double>*>( knob.get() );
+    Knob<int>* isInt = dynamic_cast<Knob<int>*>( knob.get() );
+    Knob<bool>* isBool = dynamic_cast<Knob<bool>*>( knob.get() );
+    if (isDouble) {
+        isDouble->setValuesAtTimes(frames, values, dimension, Natron::eValueChangedReasonNatronInternalEdited);
+    } else if (isInt) {
+        std::vector<int> intValues( values.size() );
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            intValues[i] = (int)values[i];
+        }
+        isInt->setValuesAtTimes(frames, intValues, dimension, Natron::eValueChangedReasonNatronInternalEdited);
+    } else if (isBool) {
+        std::vector<bool> boolValues( values.size() );
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            boolValues[i] = values[i] != 0.;
+        }
+        isBool->setValuesAtTimes(frames, boolValues, dimension, Natron::eValueChangedReasonNatronInternalEdited);
+    }
+}
+
+void
+AnimatedParam::getValuesAtTimes(const std::vector<double>& times,int dimension,std::vector<double>* values) const
+{
+    boost::shared_ptr<KnobI> knob = getInternalKnob();
+    Knob<double>* isDouble = dynamic_cast<Knob<double>*>( knob.get() );
+    Knob<int>* isInt = dynamic_cast<Knob<int>*>( knob.get() );
+    Knob<bool>* isBool = dynamic_cast<Knob<bool>*>( knob.get() );
+    if (isDouble) {
+        isDouble->getValuesAtTimes(times, dimension, values);
+    } else if (isInt) {
+        std::vector<int> intValues;
+        isInt->getValuesAtTimes(times, dimension, &intValues);
+        values->assign( intValues.begin(), intValues.end() );
+    } else if (isBool) {
+        std::vector<bool> boolValues;
+        isBool->getValuesAtTimes(times, dimension, &boolValues);
+        values->assign( boolValues.begin(), boolValues.end() );
+    }
+}
+
 double
 AnimatedParam::getDerivativeAtTime(double time, int dimension) const
 {
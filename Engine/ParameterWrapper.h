@@ -25,9 +25,18 @@
 #include <boost/weak_ptr.hpp>
 #endif
 
+#include <vector>
+
 #include "Engine/KnobTypes.h"
 #include "Engine/KnobFile.h"
 
+/**
+ * @brief Converts a Python object to a vector of doubles. Objects supporting the buffer protocol (array.array, numpy arrays, ...)
+ * are read directly, otherwise the object must be a sequence of numbers.
+ * @returns False and sets the Python error indicator if the object could not be converted.
+ **/
+bool pyObjectToDoubles(PyObject* obj,std::vector<double>* values);
+
 class Param
 {
     
@@ -215,6 +224,18 @@ public:
      **/
     void removeAnimation(int dimension = 0);
     
+    /**
+     * @brief Set a keyframe at each of the given times with the value at the same index for the given dimension.
+     * Unlike calling setValueAtTime for each keyframe, the keyframes are all set at once and the change is notified once.
+     * Times are rounded to the nearest frame.
+     **/
+    void setValuesAtTimes(const std::vector<double>& times,const std::vector<double>& values,int dimension = 0);
+    
+    /**
+     * @brief Returns in values the value of the given dimension at each of the given times.
+     **/
+    void getValuesAtTimes(const std::vector<double>& times,int dimension,std::vector<double>* values) const;
+    
     /**
      * @brief Compute the derivative at time as a double
      **/
@@ -17,6 +17,7 @@
 
 #include <QMutex>
 
+#include "Engine/AppManager.h"
 #include "Engine/LibraryBinary.h"
 
 using namespace Natron;
@@ -196,11 +197,21 @@ void
 Plugin::setOfxPlugin(OFX::Host::ImageEffect::ImageEffectPlugin* p)
 {
     _ofxPlugin = p;
+    _ofxPluginDeferred.fetchAndStoreRelease(0);
+}
+
+void
+Plugin::setOfxPluginDeferred()
+{
+    _ofxPluginDeferred = 1;
 }
 
 OFX::Host::ImageEffect::ImageEffectPlugin*
 Plugin::getOfxPlugin() const
 {
+    if (_ofxPluginDeferred && appPTR) {
+        appPTR->loadDeferredOFXPlugins();
+    }
     return _ofxPlugin;
 }
 
@@ -21,6 +21,7 @@
 #include <map>
 #include <QString>
 #include <QStringList>
+#include <QAtomicInt>
 
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
@@ -161,6 +162,7 @@ class Plugin
     bool _isReader,_isWriter;
     QString _pythonModule;
     OFX::Host::ImageEffect::ImageEffectPlugin* _ofxPlugin;
+    QAtomicInt _ofxPluginDeferred; //< registered from the OFX plug-ins registry, _ofxPlugin is set when first needed
     OFX::Host::ImageEffect::Descriptor* _ofxDescriptor;
     ContextEnum _ofxContext;
     
@@ -182,6 +184,7 @@ public:
     , _isWriter(false)
     , _pythonModule()
     , _ofxPlugin(0)
+    , _ofxPluginDeferred(0)
     , _ofxDescriptor(0)
     , _ofxContext(eContextNone)
     {
@@ -212,6 +215,7 @@ public:
           , _isReader(isReader)
           , _isWriter(isWriter)
           , _ofxPlugin(0)
+          , _ofxPluginDeferred(0)
           , _ofxDescriptor(0)
           , _ofxContext(eContextNone)
     {
@@ -271,6 +275,12 @@ public:
     
     void setOfxPlugin(OFX::Host::ImageEffect::ImageEffectPlugin* p);
     
+    /**
+     * @brief The OpenFX plug-in will be given by the OfxHost when the OFX plugin cache is read, which
+     * getOfxPlugin() triggers.
+     **/
+    void setOfxPluginDeferred();
+    
     OFX::Host::ImageEffect::ImageEffectPlugin* getOfxPlugin() const;
     
     OFX::Host::ImageEffect::Descriptor* getOfxDesc(ContextEnum* ctx) const;
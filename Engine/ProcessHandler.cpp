@@ -14,6 +14,9 @@
 
 #include "ProcessHandler.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include <QProcess>
 #include <QLocalServer>
 #include <QLocalSocket>
@@ -22,16 +25,53 @@
 #include <QWaitCondition>
 #include <QMutex>
 #include <QDir>
+#include <QDateTime>
 #include <QDebug>
+#include <QTimer>
 
 #include "Engine/AppInstance.h"
 #include "Engine/AppManager.h"
 #include "Engine/Node.h"
 #include "Engine/EffectInstance.h"
 
+namespace {
+
+///Returns the number of NUMA nodes of the machine, 1 if it is unknown
+int
+getNumaNodesCount()
+{
+#ifdef __NATRON_LINUX__
+    QDir nodesDir("/sys/devices/system/node");
+    int nNodes = nodesDir.entryList(QStringList("node*"), QDir::Dirs | QDir::NoDotAndDotDot).size();
+
+    return std::max(1, nNodes);
+#else
+
+    return 1;
+#endif
+}
+
+bool
+hasNumactl()
+{
+    QStringList paths = QString( qgetenv("PATH") ).split(':', QString::SkipEmptyParts);
+    for (int i = 0; i < paths.size(); ++i) {
+        if ( QFile::exists(paths[i] + "/numactl") ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
+
 ProcessHandler::ProcessHandler(AppInstance* app,
                                const QString & projectPath,
-                               Natron::OutputEffectInstance* writer)
+                               Natron::OutputEffectInstance* writer,
+                               int firstFrame,
+                               int lastFrame,
+                               int nProcesses)
     : _app(app)
       ,_process(new QProcess)
       ,_writer(writer)
@@ -41,7 +81,65 @@ ProcessHandler::ProcessHandler(AppInstance* app,
       ,_earlyCancel(false)
       ,_processLog()
       ,_processArgs()
+      ,_projectPath(projectPath)
+      ,_firstFrame(firstFrame)
+      ,_lastFrame(lastFrame)
+      ,_workers()
+      ,_idleWorkers()
+      ,_pendingChunks()
+      ,_failures()
+      ,_framesRendered()
+      ,_nFramesRendered(0)
+      ,_canceled(false)
+      ,_finished(false)
+      ,_startTime(0)
 {
+    int nFrames = lastFrame - firstFrame + 1;
+    nProcesses = std::min(nProcesses, nFrames);
+    
+    ///A writer that renders sequentially (e.g: a movie file) writes a single file: several processes writing
+    ///their chunk in it would corrupt it
+    if (nProcesses > 1) {
+        std::string sequentialNode;
+        if ( (writer->getSequentialPreference() == Natron::eSequentialPreferenceOnlySequential) ||
+             writer->getNode()->hasSequentialOnlyNodeUpstream(sequentialNode) ) {
+            nProcesses = 1;
+        }
+    }
+    if (nProcesses > 1) {
+        ///Small chunks so that the processes finish at about the same time, but not too small since each chunk is a new job
+        int chunkSize = std::max(1, nFrames / (nProcesses * 4));
+        for (int f = firstFrame; f <= lastFrame; f += chunkSize) {
+            RenderChunk c;
+            c.firstFrame = f;
+            c.lastFrame = std::min(lastFrame, f + chunkSize - 1);
+            c.nAttempts = 0;
+            _pendingChunks.push_back(c);
+        }
+
+        int nNumaNodes = getNumaNodesCount();
+        bool bindToNumaNodes = nNumaNodes > 1 && hasNumactl();
+        for (int i = 0; i < nProcesses; ++i) {
+            RenderWorkerProcess* worker = new RenderWorkerProcess(i, bindToNumaNodes ? i % nNumaNodes : -1);
+            QObject::connect( worker, SIGNAL( ready(RenderWorkerProcess*) ), this, SLOT( onWorkerReady(RenderWorkerProcess*) ) );
+            QObject::connect( worker, SIGNAL( frameRendered(RenderWorkerProcess*,int) ), this, SLOT( onWorkerFrameRendered(RenderWorkerProcess*,int) ) );
+            QObject::connect( worker, SIGNAL( chunkFailed(RenderWorkerProcess*,QString) ), this, SLOT( onWorkerChunkFailed(RenderWorkerProcess*,QString) ) );
+            QObject::connect( worker, SIGNAL( ended(RenderWorkerProcess*,bool) ), this, SLOT( onWorkerEnded(RenderWorkerProcess*,bool) ) );
+            QObject::connect( worker, SIGNAL( message(QString) ), this, SLOT( onWorkerMessage(QString) ) );
+            _workers.push_back(worker);
+        }
+
+        _processLog.push_back( QString("Splitting frames %1-%2 of %3 in %4 chunks rendered by %5 processes")
+                               .arg(firstFrame).arg(lastFrame).arg( writer->getScriptName_mt_safe().c_str() )
+                               .arg( _pendingChunks.size() ).arg(nProcesses) );
+        if (bindToNumaNodes) {
+            _processLog.push_back( QString(", bound to %1 NUMA nodes").arg(nNumaNodes) );
+        }
+        _processLog.push_back('\n');
+
+        return;
+    }
+
     ///setup the server used to listen the output of the background process
     _ipcServer = new QLocalServer();
     QObject::connect( _ipcServer,SIGNAL( newConnection() ),this,SLOT( onNewConnectionPending() ) );
@@ -78,8 +176,15 @@ ProcessHandler::~ProcessHandler()
 {
     Q_EMIT deleted();
 
-    _ipcServer->close();
-    _bgProcessInputSocket->close();
+    for (std::size_t i = 0; i < _workers.size(); ++i) {
+        delete _workers[i];
+    }
+    if (_ipcServer) {
+        _ipcServer->close();
+    }
+    if (_bgProcessInputSocket) {
+        _bgProcessInputSocket->close();
+    }
     _process->close();
     delete _process;
     delete _ipcServer;
@@ -89,6 +194,14 @@ ProcessHandler::~ProcessHandler()
 void
 ProcessHandler::startProcess()
 {
+    if ( isSplittingFrameRange() ) {
+        _startTime = QDateTime::currentMSecsSinceEpoch();
+        for (std::size_t i = 0; i < _workers.size(); ++i) {
+            _workers[i]->start();
+        }
+
+        return;
+    }
      _process->start(QCoreApplication::applicationFilePath(),_processArgs);
 }
 
@@ -182,6 +295,17 @@ ProcessHandler::onProcessCanceled()
 {
     Q_EMIT processCanceled();
 
+    if ( isSplittingFrameRange() ) {
+        ///The render servers only read their socket between chunks
+        _canceled = true;
+        _pendingChunks.clear();
+        for (std::size_t i = 0; i < _workers.size(); ++i) {
+            _workers[i]->kill();
+        }
+
+        return;
+    }
+
     if (!_bgProcessInputSocket) {
         _earlyCancel = true;
     } else {
@@ -214,6 +338,377 @@ ProcessHandler::onProcessEnd(int exitCode,
     Q_EMIT processFinished(returnCode);
 }
 
+void
+ProcessHandler::onWorkerReady(RenderWorkerProcess* worker)
+{
+    if (_canceled || _finished) {
+        return;
+    }
+    giveNextChunk(worker);
+}
+
+void
+ProcessHandler::giveNextChunk(RenderWorkerProcess* worker)
+{
+    if ( _pendingChunks.empty() ) {
+        _idleWorkers.push_back(worker);
+        checkWorkersFinished();
+
+        return;
+    }
+    RenderChunk c = _pendingChunks.front();
+    _pendingChunks.pop_front();
+    _processLog.append( QString("Process %1: rendering frames %2-%3\n").arg( worker->getIndex() ).arg(c.firstFrame).arg(c.lastFrame) );
+    worker->renderChunk(_projectPath, _writer->getScriptName_mt_safe().c_str(), c.firstFrame, c.lastFrame, c.nAttempts);
+}
+
+void
+ProcessHandler::onWorkerFrameRendered(RenderWorkerProcess* /*worker*/,
+                                      int frame)
+{
+    if ( !_framesRendered.insert(frame).second ) {
+        return;
+    }
+    ++_nFramesRendered;
+    Q_EMIT frameRendered(frame);
+}
+
+void
+ProcessHandler::onWorkerChunkFailed(RenderWorkerProcess* worker,
+                                    const QString & error)
+{
+    _processLog.append( QString("Process %1: failed to render frames %2-%3: ").arg( worker->getIndex() )
+                        .arg( worker->getChunkFirstFrame() ).arg( worker->getChunkLastFrame() ) + error + '\n' );
+    if (_canceled || _finished) {
+        return;
+    }
+    retryChunk(worker, error);
+}
+
+void
+ProcessHandler::retryChunk(RenderWorkerProcess* worker,
+                           const QString & error)
+{
+    RenderChunk c;
+    c.firstFrame = worker->getChunkFirstFrame();
+    c.lastFrame = worker->getChunkLastFrame();
+    c.nAttempts = worker->getChunkAttempts() + 1;
+    ///Give the chunk to another process, once: a chunk failing twice is likely to fail in any process
+    if (c.nAttempts <= 1) {
+        _pendingChunks.push_front(c);
+        if ( !_idleWorkers.empty() ) {
+            RenderWorkerProcess* idle = _idleWorkers.front();
+            _idleWorkers.pop_front();
+            giveNextChunk(idle);
+        }
+    } else {
+        _failures.push_back( QString("Frames %1-%2: %3").arg(c.firstFrame).arg(c.lastFrame).arg(error) );
+    }
+}
+
+void
+ProcessHandler::onWorkerEnded(RenderWorkerProcess* worker,
+                              bool crashed)
+{
+    _idleWorkers.remove(worker);
+    if (crashed && !_canceled && !_finished) {
+        _processLog.append( QString("Process %1: ended unexpectedly\n").arg( worker->getIndex() ) );
+    }
+    if ( worker->isBusy() && !_canceled && !_finished ) {
+        retryChunk( worker, tr("The render process ended while rendering these frames") );
+    }
+    checkWorkersFinished();
+}
+
+void
+ProcessHandler::onWorkerMessage(const QString & message)
+{
+    _processLog.append(message + '\n');
+}
+
+void
+ProcessHandler::checkWorkersFinished()
+{
+    if (_finished) {
+        return;
+    }
+    bool hasRunningWorker = false;
+    bool hasBusyWorker = false;
+    for (std::size_t i = 0; i < _workers.size(); ++i) {
+        if ( _workers[i]->isRunning() ) {
+            hasRunningWorker = true;
+            if ( _workers[i]->isBusy() ) {
+                hasBusyWorker = true;
+            }
+        }
+    }
+    if ( hasRunningWorker && ( hasBusyWorker || !_pendingChunks.empty() ) ) {
+        return;
+    }
+
+    _finished = true;
+    if (!_canceled) {
+        for (std::list<RenderChunk>::iterator it = _pendingChunks.begin(); it != _pendingChunks.end(); ++it) {
+            _failures.push_back( QString("Frames %1-%2: no render process left to render them").arg(it->firstFrame).arg(it->lastFrame) );
+        }
+    }
+    _pendingChunks.clear();
+    _idleWorkers.clear();
+    for (std::size_t i = 0; i < _workers.size(); ++i) {
+        if ( _workers[i]->isRunning() ) {
+            _workers[i]->quit();
+        }
+    }
+
+    ///The report of the whole render
+    double elapsed = (QDateTime::currentMSecsSinceEpoch() - _startTime) / 1000.;
+    _processLog.append( QString("\nRender report: %1 of %2 frames rendered in %3s by %4 processes\n")
+                        .arg(_nFramesRendered).arg(_lastFrame - _firstFrame + 1).arg(elapsed).arg( _workers.size() ) );
+    for (std::size_t i = 0; i < _workers.size(); ++i) {
+        RenderWorkerProcess* w = _workers[i];
+        _processLog.append( QString("Process %1").arg( w->getIndex() ) );
+        if (w->getNumaNode() != -1) {
+            _processLog.append( QString(" (NUMA node %1)").arg( w->getNumaNode() ) );
+        }
+        _processLog.append( QString(": %1 chunks, %2 frames, %3s rendering\n")
+                            .arg( w->getNChunksRendered() ).arg( w->getNFramesRendered() ).arg( w->getTimeRendering() ) );
+    }
+    if (_canceled) {
+        _processLog.append("The render was canceled.\n");
+    }
+    for (int i = 0; i < _failures.size(); ++i) {
+        _processLog.append("Error: " + _failures[i] + '\n');
+    }
+
+    Q_EMIT processFinished( (_canceled || !_failures.empty()) ? 1 : 0 );
+}
+
+RenderWorkerProcess::RenderWorkerProcess(int index,
+                                         int numaNode)
+    : QObject()
+      ,_index(index)
+      ,_numaNode(numaNode)
+      ,_process(new QProcess)
+      ,_serverName()
+      ,_socket(0)
+      ,_connectingSocket(0)
+      ,_nConnectAttempts(0)
+      ,_busy(false)
+      ,_endNotified(false)
+      ,_chunkFirst(0)
+      ,_chunkLast(0)
+      ,_chunkAttempts(0)
+      ,_chunkFramesRendered()
+      ,_nFramesRendered(0)
+      ,_nChunksRendered(0)
+      ,_timeRendering(0.)
+{
+    {
+        QTemporaryFile tmpf( QString(NATRON_APPLICATION_NAME "_RENDER_WORKER_%1_").arg(index) );
+        tmpf.open();
+        _serverName = tmpf.fileName();
+        tmpf.remove();
+    }
+
+    ///The render servers print their progress, let it go to our own output
+    _process->setProcessChannelMode(QProcess::ForwardedChannels);
+    QObject::connect( _process,SIGNAL( error(QProcess::ProcessError) ),this,SLOT( onProcessError(QProcess::ProcessError) ) );
+    QObject::connect( _process,SIGNAL( finished(int,QProcess::ExitStatus) ),this,SLOT( onProcessEnd(int,QProcess::ExitStatus) ) );
+}
+
+RenderWorkerProcess::~RenderWorkerProcess()
+{
+    if (_socket) {
+        _socket->close();
+        delete _socket;
+    }
+    delete _connectingSocket;
+    if ( _process->state() != QProcess::NotRunning ) {
+        _process->kill();
+        _process->waitForFinished(1000);
+    }
+    delete _process;
+}
+
+void
+RenderWorkerProcess::start()
+{
+    QString program = QCoreApplication::applicationFilePath();
+    QStringList args;
+
+    args << "--server" << _serverName;
+    if (_numaNode != -1) {
+        ///Keep the threads of the process and the memory they allocate on the same node
+        args.prepend(program);
+        args.prepend( QString("--membind=%1").arg(_numaNode) );
+        args.prepend( QString("--cpunodebind=%1").arg(_numaNode) );
+        program = "numactl";
+    }
+    Q_EMIT message( QString("Process %1: starting ").arg(_index) + program + ' ' + args.join(" ") );
+    _process->start(program,args);
+
+    ///The server is listening once the process is done loading the plug-ins
+    QTimer::singleShot( 100, this, SLOT( tryConnect() ) );
+}
+
+void
+RenderWorkerProcess::tryConnect()
+{
+    if ( _endNotified || _socket || _connectingSocket ) {
+        return;
+    }
+    
+    ///Do not wait for the connection, this runs in the main thread: onSocketConnected or onSocketConnectionError is called
+    _connectingSocket = new QLocalSocket();
+    QObject::connect( _connectingSocket, SIGNAL( connected() ), this, SLOT( onSocketConnected() ) );
+    QObject::connect( _connectingSocket, SIGNAL( error(QLocalSocket::LocalSocketError) ), this, SLOT( onSocketConnectionError() ) );
+    _connectingSocket->connectToServer(_serverName,QLocalSocket::ReadWrite);
+}
+
+void
+RenderWorkerProcess::onSocketConnected()
+{
+    if (!_connectingSocket) {
+        return;
+    }
+    _socket = _connectingSocket;
+    _connectingSocket = 0;
+    QObject::disconnect( _socket, SIGNAL( error(QLocalSocket::LocalSocketError) ), this, SLOT( onSocketConnectionError() ) );
+    QObject::connect( _socket, SIGNAL( readyRead() ), this, SLOT( onDataWrittenToSocket() ) );
+    Q_EMIT ready(this);
+}
+
+void
+RenderWorkerProcess::onSocketConnectionError()
+{
+    if (!_connectingSocket) {
+        return;
+    }
+    ///The error may be reported from within connectToServer
+    _connectingSocket->deleteLater();
+    _connectingSocket = 0;
+    if (_endNotified) {
+        return;
+    }
+
+    ///Give up after about a minute
+    if (++_nConnectAttempts >= 300) {
+        Q_EMIT message( QString("Process %1: unable to connect to the render server ").arg(_index) + _serverName );
+        kill();
+
+        return;
+    }
+    QTimer::singleShot( 100, this, SLOT( tryConnect() ) );
+}
+
+void
+RenderWorkerProcess::renderChunk(const QString & projectPath,
+                                 const QString & writerName,
+                                 int firstFrame,
+                                 int lastFrame,
+                                 int nAttempts)
+{
+    assert(_socket && !_busy);
+    _busy = true;
+    _chunkFirst = firstFrame;
+    _chunkLast = lastFrame;
+    _chunkAttempts = nAttempts;
+    _chunkFramesRendered.clear();
+
+    QString job = QString(kRenderServerJobShort) + '\t' + projectPath + '\t' + writerName + '\t'
+                  + QString::number(firstFrame) + '\t' + QString::number(lastFrame) + '\n';
+    _socket->write( job.toUtf8() );
+    _socket->flush();
+}
+
+void
+RenderWorkerProcess::quit()
+{
+    if (!_socket) {
+        kill();
+
+        return;
+    }
+    _socket->write( (QString(kRenderServerQuitShort) + '\n').toUtf8() );
+    _socket->flush();
+}
+
+void
+RenderWorkerProcess::kill()
+{
+    if ( _process->state() != QProcess::NotRunning ) {
+        _process->kill();
+    }
+}
+
+bool
+RenderWorkerProcess::isRunning() const
+{
+    return !_endNotified;
+}
+
+void
+RenderWorkerProcess::onDataWrittenToSocket()
+{
+    ///always running in the main thread
+    assert( QThread::currentThread() == qApp->thread() );
+
+    while ( _socket->canReadLine() ) {
+        QString str = QString::fromUtf8( _socket->readLine() );
+        while ( str.endsWith('\n') ) {
+            str.chop(1);
+        }
+        if ( str.startsWith(kRenderServerJobFinishedShort) ) {
+            str = str.mid( std::strlen(kRenderServerJobFinishedShort) ).trimmed();
+            _timeRendering += str.toDouble();
+            _busy = false;
+            ///Do not trust the job status alone: all the frames of the chunk must have been reported
+            int nFrames = _chunkLast - _chunkFirst + 1;
+            if ( (int)_chunkFramesRendered.size() < nFrames ) {
+                Q_EMIT chunkFailed( this, QString("Only %1 of the %2 frames were rendered").arg( _chunkFramesRendered.size() ).arg(nFrames) );
+            } else {
+                ++_nChunksRendered;
+            }
+            Q_EMIT ready(this);
+        } else if ( str.startsWith(kRenderServerJobFailedShort) ) {
+            str = str.mid( std::strlen(kRenderServerJobFailedShort) ).trimmed();
+            Q_EMIT chunkFailed(this,str);
+            _busy = false;
+            Q_EMIT ready(this);
+        } else if ( str.startsWith(kFrameRenderedStringShort) ) {
+            ///The render server appends the time spent on the frame
+            str = str.mid( std::strlen(kFrameRenderedStringShort) ).section(' ',0,0);
+            bool ok;
+            int frame = str.toInt(&ok);
+            if ( !ok || (frame < _chunkFirst) || (frame > _chunkLast) || !_chunkFramesRendered.insert(frame).second ) {
+                continue;
+            }
+            ++_nFramesRendered;
+            Q_EMIT frameRendered(this, frame);
+        }
+    }
+}
+
+void
+RenderWorkerProcess::onProcessEnd(int exitCode,
+                                  QProcess::ExitStatus stat)
+{
+    if (_endNotified) {
+        return;
+    }
+    _endNotified = true;
+    Q_EMIT ended(this, stat == QProcess::CrashExit || exitCode != 0);
+}
+
+void
+RenderWorkerProcess::onProcessError(QProcess::ProcessError err)
+{
+    if (err == QProcess::FailedToStart) {
+        Q_EMIT message( QString("Process %1: failed to start").arg(_index) );
+        onProcessEnd(1, QProcess::CrashExit);
+    }
+}
+
 ProcessInputChannel::ProcessInputChannel(const QString & mainProcessServerName)
     : QThread()
       , _mainProcessServerName(mainProcessServerName)
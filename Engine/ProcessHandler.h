@@ -15,6 +15,10 @@
 // "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
 #include <Python.h>
 
+#include <list>
+#include <set>
+#include <vector>
+
 #include "Global/Macros.h"
 CLANG_DIAG_OFF(deprecated)
 #include <QProcess>
@@ -35,6 +39,7 @@ class QLocalServer;
 class QLocalSocket;
 class QMutex;
 class QWaitCondition;
+class RenderWorkerProcess;
 
 /**
  * @brief This class represents a background render process. It starts a render and reports progress via a
@@ -91,16 +96,43 @@ class ProcessHandler
     bool _earlyCancel; //< true if the user pressed cancel but the _bgProcessInput socket was not created yet
     QString _processLog; //< used to record the log of the process
     QStringList _processArgs;
+
+    ///A part of the frame range rendered by one of the workers
+    struct RenderChunk
+    {
+        int firstFrame,lastFrame;
+        int nAttempts; //< a chunk is given to another worker once if its worker crashed or failed to render it
+    };
+
+    ///When the frame range is split across several processes, these are the workers rendering the chunks.
+    ///Each of them is a NatronRenderer --server (see RenderServer) so it renders chunk after chunk without
+    ///loading the project again.
+    QString _projectPath;
+    int _firstFrame,_lastFrame;
+    std::vector<RenderWorkerProcess*> _workers;
+    std::list<RenderWorkerProcess*> _idleWorkers; //< connected workers waiting for a chunk
+    std::list<RenderChunk> _pendingChunks;
+    QStringList _failures; //< the errors of the chunks that failed
+    std::set<int> _framesRendered; //< a frame rendered again when its chunk is retried is counted once
+    int _nFramesRendered;
+    bool _canceled;
+    bool _finished;
+    qint64 _startTime; //< msecs since epoch when the processes were started
     
 public:
 
     /**
      * @brief Starts a new process which will load the project specified by "projectPath".
      * The process will render using the effect specified by writer.
+     * If nProcesses is greater than 1, the frame range is instead split in chunks rendered by nProcesses
+     * processes, a process being given the next chunk whenever it finishes one.
      **/
     ProcessHandler(AppInstance* app,
                    const QString & projectPath,
-                   Natron::OutputEffectInstance* writer);
+                   Natron::OutputEffectInstance* writer,
+                   int firstFrame,
+                   int lastFrame,
+                   int nProcesses);
 
     virtual ~ProcessHandler();
 
@@ -157,6 +189,22 @@ public Q_SLOTS:
      **/
     void startProcess();
 
+    /**
+     * @brief Called when a worker is connected or finished its chunk, it gives it the next chunk.
+     **/
+    void onWorkerReady(RenderWorkerProcess* worker);
+
+    void onWorkerFrameRendered(RenderWorkerProcess* worker,int frame);
+
+    void onWorkerChunkFailed(RenderWorkerProcess* worker,const QString & error);
+
+    /**
+     * @brief Called when the process of a worker ends, the chunk it was rendering is given to another worker.
+     **/
+    void onWorkerEnded(RenderWorkerProcess* worker,bool crashed);
+
+    void onWorkerMessage(const QString & message);
+
 Q_SIGNALS:
 
     void deleted();
@@ -174,6 +222,160 @@ Q_SIGNALS:
      * 2: Crash.
      **/
     void processFinished(int);
+
+private:
+
+    bool isSplittingFrameRange() const
+    {
+        return !_workers.empty();
+    }
+
+    void giveNextChunk(RenderWorkerProcess* worker);
+
+    /**
+     * @brief Gives the chunk of the worker to the next worker, or records it as failed with the given error
+     * if it was already retried.
+     **/
+    void retryChunk(RenderWorkerProcess* worker,const QString & error);
+
+    /**
+     * @brief When all the chunks are rendered or no worker is left, writes the report to the log and
+     * emits processFinished
+     **/
+    void checkWorkersFinished();
+};
+
+/**
+ * @brief A NatronRenderer --server process rendering the chunks of the frame range given by a ProcessHandler.
+ * The worker connects to the server of the process once it is started and forwards the messages of
+ * the render server.
+ **/
+class RenderWorkerProcess
+    : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * @param numaNode If not -1, the process is bound to this NUMA node with numactl
+     **/
+    RenderWorkerProcess(int index,
+                        int numaNode);
+
+    virtual ~RenderWorkerProcess();
+
+    void start();
+
+    /**
+     * @brief Sends a job for the given frames to the process, see RenderServer
+     * @param nAttempts The number of times the chunk was given to a worker before
+     **/
+    void renderChunk(const QString & projectPath,const QString & writerName,int firstFrame,int lastFrame,int nAttempts);
+
+    /**
+     * @brief Asks the process to exit once it is done with its chunk
+     **/
+    void quit();
+
+    void kill();
+
+    bool isRunning() const;
+
+    int getIndex() const
+    {
+        return _index;
+    }
+
+    int getNumaNode() const
+    {
+        return _numaNode;
+    }
+
+    bool isBusy() const
+    {
+        return _busy;
+    }
+
+    ///The chunk given with renderChunk
+    int getChunkFirstFrame() const
+    {
+        return _chunkFirst;
+    }
+
+    int getChunkLastFrame() const
+    {
+        return _chunkLast;
+    }
+
+    int getChunkAttempts() const
+    {
+        return _chunkAttempts;
+    }
+
+    int getNFramesRendered() const
+    {
+        return _nFramesRendered;
+    }
+
+    int getNChunksRendered() const
+    {
+        return _nChunksRendered;
+    }
+
+    double getTimeRendering() const
+    {
+        return _timeRendering;
+    }
+
+public Q_SLOTS:
+
+    /**
+     * @brief Connects to the render server of the process, retrying until the process is done loading.
+     **/
+    void tryConnect();
+
+    void onSocketConnected();
+
+    void onSocketConnectionError();
+
+    void onDataWrittenToSocket();
+
+    void onProcessEnd(int exitCode,QProcess::ExitStatus stat);
+
+    void onProcessError(QProcess::ProcessError err);
+
+Q_SIGNALS:
+
+    void ready(RenderWorkerProcess*);
+
+    ///Emitted once for each frame of the chunk
+    void frameRendered(RenderWorkerProcess*,int);
+
+    ///Emitted if the render server failed the job or did not render all the frames of the chunk
+    void chunkFailed(RenderWorkerProcess*,QString);
+
+    void ended(RenderWorkerProcess*,bool);
+
+    void message(QString);
+
+private:
+
+    int _index;
+    int _numaNode;
+    QProcess* _process;
+    QString _serverName;
+    QLocalSocket* _socket;
+    QLocalSocket* _connectingSocket; //< the socket while it is connecting, see tryConnect
+    int _nConnectAttempts;
+    bool _busy;
+    bool _endNotified;
+    int _chunkFirst,_chunkLast;
+    int _chunkAttempts;
+    std::set<int> _chunkFramesRendered;
+    int _nFramesRendered;
+    int _nChunksRendered;
+    double _timeRendering; //< seconds spent on the chunks, as reported by the render server
 };
 
 /**
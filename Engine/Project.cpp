@@ -15,6 +15,7 @@
 #include "Project.h"
 
 #include <fstream>
+#include <sstream>
 #include <algorithm>
 #include <ios>
 #include <cstdlib> // strtoul
@@ -27,6 +28,7 @@
 #define snprintf _snprintf
 #elif defined(__NATRON_UNIX__)
 #include <pwd.h> //for getpwuid
+#include <unistd.h> //for fsync
 #endif
 
 #include <QtConcurrentRun>
@@ -39,6 +41,8 @@
 #include <QFileInfo>
 #include <QDebug>
 
+#include <boost/bind.hpp>
+
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
 #include "Engine/ProjectPrivate.h"
@@ -51,6 +55,7 @@
 #include "Engine/KnobFile.h"
 #include "Engine/StandardPaths.h"
 #include "Engine/OutputSchedulerThread.h"
+#include "Engine/Timer.h"
 
 using std::cout; using std::endl;
 using std::make_pair;
@@ -70,6 +75,62 @@ static std::string getUserName()
 #endif
 }
 
+///Each record of the journal is preceded by a line "NatronJournalRecord <size in bytes>"
+#define NATRON_PROJECT_JOURNAL_RECORD_TAG "NatronJournalRecord"
+
+/**
+ * @brief Applies to obj all the records of the journal in order. The xml of the last record is returned
+ * in lastRecord as it holds the most recent gui state. A truncated trailing record (e.g: the application crashed
+ * while writing it) is ignored.
+ * @returns The number of records applied.
+ **/
+static int
+applyProjectJournal(const QString& journalFilePath,
+                    ProjectSerialization* obj,
+                    std::string* lastRecord)
+{
+    std::ifstream ifile(journalFilePath.toStdString().c_str(),std::ifstream::in | std::ifstream::binary);
+    if ( !ifile.good() ) {
+        return 0;
+    }
+    
+    int nRecords = 0;
+    std::string header;
+    while ( std::getline(ifile, header) ) {
+        std::istringstream headerStream(header);
+        std::string tag;
+        std::size_t size = 0;
+        headerStream >> tag >> size;
+        if (tag != NATRON_PROJECT_JOURNAL_RECORD_TAG || size == 0) {
+            qDebug() << "Invalid record in" << journalFilePath << ", ignoring the rest of the journal";
+            break;
+        }
+        std::string data(size,'\0');
+        ifile.read(&data[0], size);
+        if ( (std::size_t)ifile.gcount() != size ) {
+            qDebug() << "Truncated record in" << journalFilePath << ", ignoring it";
+            break;
+        }
+        ProjectJournalRecordSerialization record;
+        try {
+            std::istringstream recordStream(data);
+            boost::archive::xml_iarchive iArchive(recordStream);
+            bool bgProject;
+            iArchive >> boost::serialization::make_nvp("Background_project", bgProject);
+            iArchive >> boost::serialization::make_nvp("Record", record);
+        } catch (const std::exception & e) {
+            qDebug() << "Failed to read a record of" << journalFilePath << ":" << e.what();
+            break;
+        }
+        if ( !record.applyTo(obj) ) {
+            qDebug() << "Some nodes of the record" << nRecords << "of" << journalFilePath << "could not be found in the project";
+        }
+        *lastRecord = data;
+        ++nRecords;
+    }
+    return nRecords;
+}
+
 static std::string generateGUIUserName()
 {
     return getUserName() + '@' + QHostInfo::localHostName().toStdString();
@@ -104,8 +165,8 @@ Project::Project(AppInstance* appInstance)
 Project::~Project()
 {
     ///wait for all autosaves to finish
-    for (std::list<boost::shared_ptr<QFutureWatcher<void> > >::iterator it = _imp->autoSaveFutures.begin(); it != _imp->autoSaveFutures.end(); ++it) {
-        (*it)->waitForFinished();
+    for (std::list<AutoSaveTask>::iterator it = _imp->autoSaveFutures.begin(); it != _imp->autoSaveFutures.end(); ++it) {
+        it->watcher->waitForFinished();
     }
     
     ///Don't clear autosaves if the program is shutting down by user request.
@@ -270,22 +331,68 @@ Project::loadProjectInternal(const QString & path,
     
     LoadProjectSplashScreen_RAII __raii_splashscreen__(getApp(),name);
     
+    int journalRecords = 0;
+    _imp->loadTimings.clear();
+    TimeLapse loadTimer;
     try {
         bool bgProject;
         boost::archive::xml_iarchive iArchive(ifile);
+        std::string lastJournalRecord;
         {
             FlagSetter __raii_loadingProjectInternal__(true,&_imp->isLoadingProjectInternal,&_imp->isLoadingProjectMutex);
             
             iArchive >> boost::serialization::make_nvp("Background_project", bgProject);
             ProjectSerialization projectSerializationObj( getApp() );
             iArchive >> boost::serialization::make_nvp("Project", projectSerializationObj);
+            _imp->addLoadTiming( "parsing", loadTimer.getTimeElapsedReset() );
+            
+            ///Replay the changes written by incremental saves since the last full save
+            if (!isAutoSave) {
+                journalRecords = applyProjectJournal(getJournalFilePath(filePath), &projectSerializationObj, &lastJournalRecord);
+#ifdef DEBUG
+                if (journalRecords > 0) {
+                    qDebug() << "Applied" << journalRecords << "journal record(s) to" << filePath;
+                }
+#endif
+                _imp->addLoadTiming( "journal", loadTimer.getTimeElapsedReset() );
+            }
             
             ret = load(projectSerializationObj,name,path, mustSave);
+            
+            ///The time not spent in the phases recorded by restoreFromSerialization
+            double restoreTime = loadTimer.getTimeElapsedReset();
+            for (std::list<std::pair<std::string,double> >::const_iterator it = _imp->loadTimings.begin(); it != _imp->loadTimings.end(); ++it) {
+                if ( (it->first != "parsing") && (it->first != "journal") ) {
+                    restoreTime -= it->second;
+                }
+            }
+            _imp->addLoadTiming( "project settings", std::max(0., restoreTime) );
         } // __raii_loadingProjectInternal__
         
-        if (!bgProject) {
+        if ( !lastJournalRecord.empty() ) {
+            ///The gui state is the one of the most recent record
+            std::istringstream recordStream(lastJournalRecord);
+            boost::archive::xml_iarchive recordArchive(recordStream);
+            ProjectJournalRecordSerialization record;
+            recordArchive >> boost::serialization::make_nvp("Background_project", bgProject);
+            recordArchive >> boost::serialization::make_nvp("Record", record);
+            if (!bgProject) {
+                getApp()->loadProjectGui(recordArchive);
+            }
+        } else if (!bgProject) {
             getApp()->loadProjectGui(iArchive);
         }
+        _imp->addLoadTiming( "gui", loadTimer.getTimeElapsedReset() );
+        
+#ifdef DEBUG
+        QString timings;
+        double total = 0.;
+        for (std::list<std::pair<std::string,double> >::const_iterator it = _imp->loadTimings.begin(); it != _imp->loadTimings.end(); ++it) {
+            timings.append( QString("%1%2 %3s").arg(timings.isEmpty() ? "" : ", ").arg( it->first.c_str() ).arg(it->second) );
+            total += it->second;
+        }
+        qDebug() << "Loaded" << filePath << "in" << total << "s:" << timings;
+#endif
     } catch (const boost::archive::archive_exception & e) {
         ifile.close();
         throw std::runtime_error( e.what() );
@@ -304,6 +411,9 @@ Project::loadProjectInternal(const QString & path,
 
     ifile.close();
     
+    ///Nodes restored from an auto-save were not saved by the user yet
+    _imp->resetModifications(isAutoSave ? QString() : filePath, journalRecords);
+    
     Format f;
     getProjectDefaultFormat(&f);
     Q_EMIT formatChanged(f);
@@ -428,21 +538,35 @@ fileCopy(const QString & source,
     success &= sourceFile.open( QFile::ReadOnly );
     success &= destFile.open( QFile::WriteOnly | QFile::Truncate );
     success &= destFile.write( sourceFile.readAll() ) >= 0;
+    success &= destFile.flush();
+#ifdef __NATRON_UNIX__
+    ///Make sure the file is on disk before the temporary file gets removed
+    if (success) {
+        success &= fsync( destFile.handle() ) == 0;
+    }
+#endif
     sourceFile.close();
     destFile.close();
 
     return success;
 }
 
-QString
-Project::saveProjectInternal(const QString & path,
-                             const QString & name,
-                             bool autoSave)
+boost::shared_ptr<ProjectSaveSnapshot>
+Project::takeSaveSnapshot(const QString & path,
+                          const QString & name,
+                          bool autoSave)
 {
+    assert( QThread::currentThread() == qApp->thread() );
     
-    bool isRenderSave = name.contains("RENDER_SAVE");
-    QDateTime time = QDateTime::currentDateTime();
-    QString timeStr = time.toString();
+    TimeLapse timer;
+    boost::shared_ptr<ProjectSaveSnapshot> snapshot(new ProjectSaveSnapshot);
+    snapshot->app = getApp();
+    snapshot->path = path;
+    snapshot->name = name;
+    snapshot->autoSave = autoSave;
+    snapshot->isRenderSave = name.contains("RENDER_SAVE");
+    snapshot->time = QDateTime::currentDateTime();
+    QString timeStr = snapshot->time.toString();
 
     QString filePath;
     if (autoSave) {
@@ -459,7 +583,7 @@ Project::saveProjectInternal(const QString & path,
         filePath.append("/");
         filePath.append(name);
         filePath.append(".autosave");
-        if (!isRenderSave) {
+        if (!snapshot->isRenderSave) {
             if (appendTimeHash) {
                 Hash64 timeHash;
                 
@@ -481,28 +605,35 @@ Project::saveProjectInternal(const QString & path,
     }
     
     std::string newFilePath = _imp->runOnProjectSaveCallback(filePath.toStdString(), autoSave);
-    filePath = QString(newFilePath.c_str());
+    snapshot->filePath = QString(newFilePath.c_str());
+    
+    ///A user save can only append to the journal of the project file that was last saved or loaded,
+    ///as long as no node was added, removed or renamed since then.
+    std::list<boost::shared_ptr<Natron::Node> > modifiedNodes;
+    bool incremental = false;
+    if ( !autoSave && appPTR->getCurrentSettings()->isIncrementalSaveEnabled() && QFile::exists(snapshot->filePath) ) {
+        int maxRecords = appPTR->getCurrentSettings()->getMaxJournalRecords();
+        QMutexLocker k(&_imp->modificationsMutex);
+        incremental = !_imp->structureModified && _imp->journalBaseFilePath == snapshot->filePath &&
+        _imp->journalRecordsCount < maxRecords;
+        for (std::map<Natron::Node*,boost::weak_ptr<Natron::Node> >::iterator it = _imp->modifiedNodes.begin();
+             incremental && it != _imp->modifiedNodes.end(); ++it) {
+            boost::shared_ptr<Natron::Node> node = it->second.lock();
+            if ( !node || !node->isActivated() ) {
+                incremental = false;
+            } else {
+                modifiedNodes.push_back(node);
+            }
+        }
+    }
     
     ///Use a temporary file to save, so if Natron crashes it doesn't corrupt the user save.
-    QString tmpFilename = StandardPaths::writableLocation(StandardPaths::eStandardLocationTemp);
-    tmpFilename.append( QDir::separator() );
-    tmpFilename.append( QString::number( time.toMSecsSinceEpoch() ) );
-
-    std::ofstream ofile;
-    try {
-        ofile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        ofile.open(tmpFilename.toStdString().c_str(),std::ofstream::out);
-    } catch (const std::ofstream::failure & e) {
-        throw std::runtime_error( std::string("Exception occured when opening file ") + tmpFilename.toStdString() + ": " + e.what() );
-    }
-
-    if ( !ofile.good() ) {
-        qDebug() << "Failed to open file " << tmpFilename.toStdString().c_str();
-        throw std::runtime_error( "Failed to open file " + tmpFilename.toStdString() );
-    }
+    snapshot->tmpFilePath = StandardPaths::writableLocation(StandardPaths::eStandardLocationTemp);
+    snapshot->tmpFilePath.append( QDir::separator() );
+    snapshot->tmpFilePath.append( QString::number( snapshot->time.toMSecsSinceEpoch() ) );
 
     ///Fix file paths before saving.
-    QString oldProjectPath(_imp->getProjectPath().c_str());
+    snapshot->oldProjectPath = QString(_imp->getProjectPath().c_str());
    
     if (!autoSave) {
         _imp->autoSetProjectDirectory(path);
@@ -511,37 +642,197 @@ Project::saveProjectInternal(const QString & path,
         _imp->natronVersion->setValue(generateUserFriendlyNatronVersionName(),0);
     }
     
+    snapshot->bgProject = appPTR->isBackground();
     try {
-        boost::archive::xml_oarchive oArchive(ofile);
-        bool bgProject = appPTR->isBackground();
-        oArchive << boost::serialization::make_nvp("Background_project",bgProject);
-        ProjectSerialization projectSerializationObj( getApp() );
-        save(&projectSerializationObj);
-        oArchive << boost::serialization::make_nvp("Project",projectSerializationObj);
-        if (!bgProject) {
-            getApp()->saveProjectGui(oArchive);
+        if (incremental) {
+            snapshot->journalRecord.reset(new ProjectJournalRecordSerialization);
+            snapshot->journalRecord->initialize(this, modifiedNodes);
+            snapshot->journalFilePath = getJournalFilePath(snapshot->filePath);
+        } else {
+            snapshot->projectSerialization.reset( new ProjectSerialization( getApp() ) );
+            save( snapshot->projectSerialization.get() );
+        }
+        if (!snapshot->bgProject) {
+            snapshot->guiSerialization = getApp()->takeProjectGuiSnapshot();
         }
     } catch (...) {
-        ofile.close();
         if (!autoSave) {
             ///Reset the old project path in case of failure.
-            _imp->autoSetProjectDirectory(oldProjectPath);
+            _imp->autoSetProjectDirectory(snapshot->oldProjectPath);
         }
         throw;
     }
+    
+    snapshot->snapshotTime = timer.getTimeElapsedReset();
+    return snapshot;
+}
+
+void
+Project::writeSaveSnapshot(ProjectSaveSnapshot* snapshot)
+{
+    assert(snapshot);
+    if (snapshot->journalRecord) {
+        writeJournalRecord(snapshot);
+        return;
+    }
+    TimeLapse timer;
+    
+    std::ofstream ofile;
+    try {
+        ofile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        ofile.open(snapshot->tmpFilePath.toStdString().c_str(),std::ofstream::out);
+    } catch (const std::ofstream::failure & e) {
+        snapshot->error = std::string("Exception occured when opening file ") + snapshot->tmpFilePath.toStdString() + ": " + e.what();
+        return;
+    }
+
+    if ( !ofile.good() ) {
+        qDebug() << "Failed to open file " << snapshot->tmpFilePath.toStdString().c_str();
+        snapshot->error = "Failed to open file " + snapshot->tmpFilePath.toStdString();
+        return;
+    }
+
+    try {
+        boost::archive::xml_oarchive oArchive(ofile);
+        bool bgProject = snapshot->bgProject;
+        oArchive << boost::serialization::make_nvp("Background_project",bgProject);
+        oArchive << boost::serialization::make_nvp("Project",*snapshot->projectSerialization);
+        if (!bgProject) {
+            snapshot->app->saveProjectGui(oArchive, snapshot->guiSerialization);
+        }
+    } catch (const std::exception & e) {
+        ofile.close();
+        QFile::remove(snapshot->tmpFilePath);
+        snapshot->error = e.what();
+        return;
+    } catch (...) {
+        ofile.close();
+        QFile::remove(snapshot->tmpFilePath);
+        snapshot->error = "Failed to write the project file";
+        return;
+    }
 
     ofile.close();
+    snapshot->encodeTime = timer.getTimeElapsedReset();
 
-    QFile::remove(filePath);
+    ///Copy the save next to the project file, then swap it with the old file: the old file and its journal
+    ///are only removed once the new file is in place
+    QString newFilePath = snapshot->filePath + ".new";
+    QFile::remove(newFilePath);
     int nAttemps = 0;
-
-    while ( nAttemps < 10 && !fileCopy(tmpFilename, filePath) ) {
+    bool copied = false;
+    while ( nAttemps < 10 && !( copied = fileCopy(snapshot->tmpFilePath, newFilePath) ) ) {
         ++nAttemps;
     }
+    QFile::remove(snapshot->tmpFilePath);
+    if (!copied) {
+        QFile::remove(newFilePath);
+        snapshot->error = "Failed to write " + newFilePath.toStdString();
+        return;
+    }
 
-    QFile::remove(tmpFilename);
+    QString oldFilePath = snapshot->filePath + ".old";
+    bool hasOldFile = QFile::exists(snapshot->filePath);
+    if (hasOldFile) {
+        QFile::remove(oldFilePath);
+        if ( !QFile::rename(snapshot->filePath, oldFilePath) ) {
+            QFile::remove(newFilePath);
+            snapshot->error = "Failed to replace " + snapshot->filePath.toStdString();
+            return;
+        }
+    }
+    if ( !QFile::rename(newFilePath, snapshot->filePath) ) {
+        if (hasOldFile) {
+            QFile::rename(oldFilePath, snapshot->filePath);
+        }
+        QFile::remove(newFilePath);
+        snapshot->error = "Failed to replace " + snapshot->filePath.toStdString();
+        return;
+    }
+    if (hasOldFile) {
+        QFile::remove(oldFilePath);
+    }
+
+    if (!snapshot->autoSave) {
+        ///The full save contains all changes of the journal which no longer applies
+        QFile::remove( getJournalFilePath(snapshot->filePath) );
+    }
+    snapshot->syncTime = timer.getTimeElapsedReset();
+}
+
+void
+Project::writeJournalRecord(ProjectSaveSnapshot* snapshot)
+{
+    assert(snapshot && snapshot->journalRecord);
+    TimeLapse timer;
     
-    if (!autoSave) {
+    ///Each record is a complete archive so that it can be read on its own
+    std::ostringstream recordStream;
+    try {
+        boost::archive::xml_oarchive oArchive(recordStream);
+        bool bgProject = snapshot->bgProject;
+        oArchive << boost::serialization::make_nvp("Background_project",bgProject);
+        oArchive << boost::serialization::make_nvp("Record",*snapshot->journalRecord);
+        if (!bgProject) {
+            snapshot->app->saveProjectGui(oArchive, snapshot->guiSerialization);
+        }
+    } catch (const std::exception & e) {
+        snapshot->error = e.what();
+        return;
+    } catch (...) {
+        snapshot->error = "Failed to write the project journal";
+        return;
+    }
+    
+    std::string data = recordStream.str();
+    std::ostringstream headerStream;
+    headerStream << NATRON_PROJECT_JOURNAL_RECORD_TAG << ' ' << data.size() << '\n';
+    std::string header = headerStream.str();
+    snapshot->encodeTime = timer.getTimeElapsedReset();
+    
+    QFile journal(snapshot->journalFilePath);
+    bool success = journal.open(QIODevice::WriteOnly | QIODevice::Append);
+    if (success) {
+        success &= journal.write( header.c_str(), header.size() ) == (qint64)header.size();
+        success &= journal.write( data.c_str(), data.size() ) == (qint64)data.size();
+        success &= journal.flush();
+#ifdef __NATRON_UNIX__
+        if (success) {
+            success &= fsync( journal.handle() ) == 0;
+        }
+#endif
+        journal.close();
+    }
+    if (!success) {
+        snapshot->error = "Failed to write the project journal " + snapshot->journalFilePath.toStdString();
+    }
+    snapshot->syncTime = timer.getTimeElapsedReset();
+}
+
+QString
+Project::getJournalFilePath(const QString& projectFilePath)
+{
+    return projectFilePath + ".journal";
+}
+
+void
+Project::markNodeModified(const boost::shared_ptr<Natron::Node>& node)
+{
+    QMutexLocker k(&_imp->modificationsMutex);
+    _imp->modifiedNodes[node.get()] = node;
+}
+
+void
+Project::markStructureModified()
+{
+    QMutexLocker k(&_imp->modificationsMutex);
+    _imp->structureModified = true;
+}
+
+void
+Project::onSaveSnapshotWritten(const ProjectSaveSnapshot & snapshot)
+{
+    if (!snapshot.autoSave) {
         
         QString lockFilePath = getLockAbsoluteFilePath();
         if (QFile::exists(lockFilePath)) {
@@ -549,27 +840,66 @@ Project::saveProjectInternal(const QString & path,
             removeLockFile();
         }
         {
-            _imp->setProjectFilename(name.toStdString());
-            _imp->setProjectPath(path.toStdString());
+            _imp->setProjectFilename(snapshot.name.toStdString());
+            _imp->setProjectPath(snapshot.path.toStdString());
             QMutexLocker l(&_imp->projectLock);
             _imp->hasProjectBeenSavedByUser = true;
-            _imp->ageSinceLastSave = time;
+            _imp->ageSinceLastSave = snapshot.time;
         }
-        Q_EMIT projectNameChanged(name); //< notify the gui so it can update the title
+        Q_EMIT projectNameChanged(snapshot.name); //< notify the gui so it can update the title
+        
+        int journalRecords = 0;
+        if (snapshot.journalRecord) {
+            QMutexLocker k(&_imp->modificationsMutex);
+            journalRecords = _imp->journalRecordsCount + 1;
+        }
+        _imp->resetModifications(snapshot.filePath, journalRecords);
 
         //Create the lock file corresponding to the project
         createLockFile();
     } else {
-        if (!isRenderSave) {
+        if (!snapshot.isRenderSave) {
             QString projectName(_imp->getProjectFilename().c_str());
             Q_EMIT projectNameChanged(projectName + " (*)");
         }
     }
-    _imp->lastAutoSave = time;
+    _imp->lastAutoSave = snapshot.time;
+}
 
-    return filePath;
+QString
+Project::saveProjectInternal(const QString & path,
+                             const QString & name,
+                             bool autoSave)
+{
+    boost::shared_ptr<ProjectSaveSnapshot> snapshot = takeSaveSnapshot(path, name, autoSave);
+    
+    writeSaveSnapshot( snapshot.get() );
+    if ( !snapshot->error.empty() ) {
+        if (snapshot->journalRecord) {
+            ///The journal may end with a partial record: do not append to it anymore
+            markStructureModified();
+        }
+        if (!autoSave) {
+            ///Reset the old project path in case of failure.
+            _imp->autoSetProjectDirectory(snapshot->oldProjectPath);
+        }
+        throw std::runtime_error(snapshot->error);
+    }
+    
+    onSaveSnapshotWritten(*snapshot);
+
+    return snapshot->filePath;
 } // saveProjectInternal
 
+void
+Project::writeAutoSaveSnapshot(ProjectSaveSnapshot* snapshot)
+{
+    Project::writeSaveSnapshot(snapshot);
+    
+    ///Save caches ToC
+    appPTR->saveCaches();
+}
+
 void
 Project::autoSave()
 {
@@ -616,10 +946,42 @@ Project::onAutoSaveTimerTriggered()
     bool canAutoSave = !hasNodeRendering() && !getApp()->isShowingDialog();
 
     if (canAutoSave) {
-        boost::shared_ptr<QFutureWatcher<void> > watcher(new QFutureWatcher<void>);
-        QObject::connect(watcher.get(), SIGNAL(finished()), this, SLOT(onAutoSaveFutureFinished()));
-        watcher->setFuture(QtConcurrent::run(this,&Project::autoSave));
-        _imp->autoSaveFutures.push_back(watcher);
+        {
+            QMutexLocker l(&_imp->isLoadingProjectMutex);
+            if (_imp->isLoadingProject) {
+                return;
+            }
+        }
+        {
+            QMutexLocker l(&_imp->isSavingProjectMutex);
+            if (_imp->isSavingProject) {
+                ///Another save is in progress, try again a bit later
+                _imp->autoSaveTimer->start(2000);
+                return;
+            }
+            _imp->isSavingProject = true;
+        }
+        
+        ///Replace the last auto-save with a more recent one
+        removeLastAutosave();
+        
+        ///Only copy the project on the main-thread, the (expensive) encoding
+        ///and writing to disk is done by another thread.
+        AutoSaveTask task;
+        try {
+            task.snapshot = takeSaveSnapshot(QString(_imp->getProjectPath().c_str()), QString(_imp->getProjectFilename().c_str()), true);
+        } catch (const std::exception & e) {
+            qDebug() << "Save failure: " << e.what();
+            QMutexLocker l(&_imp->isSavingProjectMutex);
+            _imp->isSavingProject = false;
+            return;
+        }
+        ///The watcher is released by onAutoSaveFutureFinished() while it emits finished()
+        task.watcher.reset( new QFutureWatcher<void>, boost::bind(&QObject::deleteLater, _1) );
+        QObject::connect(task.watcher.get(), SIGNAL(finished()), this, SLOT(onAutoSaveFutureFinished()));
+        ///Only pass a raw pointer: the worker must not hold the last reference to the snapshot
+        task.watcher->setFuture( QtConcurrent::run( &Project::writeAutoSaveSnapshot, task.snapshot.get() ) );
+        _imp->autoSaveFutures.push_back(task);
     } else {
         ///If the auto-save failed because a render is in progress, try every 2 seconds to auto-save.
         ///We don't use the user-provided timeout interval here because it could be an inapropriate value.
@@ -631,12 +993,32 @@ void Project::onAutoSaveFutureFinished()
 {
     QFutureWatcherBase* future = qobject_cast<QFutureWatcherBase*>(sender());
     assert(future);
-    for (std::list<boost::shared_ptr<QFutureWatcher<void> > >::iterator it = _imp->autoSaveFutures.begin(); it != _imp->autoSaveFutures.end(); ++it) {
-        if (it->get() == future) {
+    boost::shared_ptr<ProjectSaveSnapshot> snapshot;
+    for (std::list<AutoSaveTask>::iterator it = _imp->autoSaveFutures.begin(); it != _imp->autoSaveFutures.end(); ++it) {
+        if (it->watcher.get() == future) {
+            snapshot = it->snapshot;
             _imp->autoSaveFutures.erase(it);
             break;
         }
     }
+    if (!snapshot) {
+        return;
+    }
+    
+    if ( !snapshot->error.empty() ) {
+        qDebug() << "Save failure: " << snapshot->error.c_str();
+    } else {
+        onSaveSnapshotWritten(*snapshot);
+#ifdef DEBUG
+        qDebug() << "Auto-save" << snapshot->filePath << ": snapshot" << snapshot->snapshotTime * 1000. << "ms (main-thread), encoding"
+        << snapshot->encodeTime * 1000. << "ms, writing to disk" << snapshot->syncTime * 1000. << "ms";
+#endif
+    }
+    
+    {
+        QMutexLocker l(&_imp->isSavingProjectMutex);
+        _imp->isSavingProject = false;
+    }
 }
     
 bool Project::findAutoSaveForProject(const QString& projectPath,const QString& projectName,QString* autoSaveFileName)
@@ -1220,7 +1602,24 @@ Project::isLoadingProject() const
 {
     QMutexLocker l(&_imp->isLoadingProjectMutex);
 
-    return _imp->isLoadingProject;
+    return _imp->isLoadingProject || _imp->nGroupsLoadingOnDemand > 0;
+}
+
+void
+Project::beginLoadingGroupOnDemand()
+{
+    QMutexLocker l(&_imp->isLoadingProjectMutex);
+    
+    ++_imp->nGroupsLoadingOnDemand;
+}
+
+void
+Project::endLoadingGroupOnDemand()
+{
+    QMutexLocker l(&_imp->isLoadingProjectMutex);
+    
+    assert(_imp->nGroupsLoadingOnDemand > 0);
+    --_imp->nGroupsLoadingOnDemand;
 }
     
 bool
@@ -1433,6 +1832,7 @@ Project::reset()
     
     Q_EMIT projectNameChanged(NATRON_PROJECT_UNTITLED);
     clearNodes(true);
+    _imp->resetModifications(QString(), 0);
     const std::vector<boost::shared_ptr<KnobI> > & knobs = getKnobs();
     
     beginChanges();
@@ -47,6 +47,7 @@ namespace Natron {
 class Node;
 class OutputEffectInstance;
 struct ProjectPrivate;
+struct ProjectSaveSnapshot;
 
 class Project
     :  public KnobHolder, public NodeCollection,  public boost::noncopyable, public boost::enable_shared_from_this<Natron::Project>
@@ -78,9 +79,26 @@ public:
     void autoSave();
 
     /**
-     * @brief Same as autoSave() but the auto-save is run in a separate thread instead.
+     * @brief Starts the auto-save timer. When it times out, a snapshot of the project is taken
+     * on the main-thread and written to disk by a separate thread (see onAutoSaveTimerTriggered()).
      **/
     void triggerAutoSave();
+    
+    /**
+     * @brief Notifies that the state of the given node changed and must be written by the next save.
+     * When incremental saves are enabled, only the nodes marked this way are written to the journal.
+     **/
+    void markNodeModified(const boost::shared_ptr<Natron::Node>& node);
+    
+    /**
+     * @brief Notifies that nodes were added, removed or renamed: the next save will be a full save.
+     **/
+    void markStructureModified();
+    
+    /**
+     * @brief Returns the path of the journal written by incremental saves next to the given project file.
+     **/
+    static QString getJournalFilePath(const QString& projectFilePath);
 
     /**
      * @brief Returns the path to where the auto save files are stored on disk.
@@ -96,6 +114,13 @@ public:
      **/
     bool isLoadingProject() const;
     
+    /**
+     * @brief Called by NodeGroup::loadPendingChildren around the creation of the nodes of a group loaded on demand:
+     * in-between, isLoadingProject() returns true so that the nodes are restored the same way as when loading the project.
+     **/
+    void beginLoadingGroupOnDemand();
+    void endLoadingGroupOnDemand();
+    
     bool isLoadingProjectInternal() const;
 
     QString getProjectName() const WARN_UNUSED_RETURN;
@@ -318,6 +343,35 @@ private:
 
     QString saveProjectInternal(const QString & path,const QString & name,bool autosave = false);
 
+    /**
+     * @brief Copies everything needed to write the project file. Must be called on the main-thread.
+     * The returned snapshot can be written by writeSaveSnapshot() on any thread.
+     **/
+    boost::shared_ptr<ProjectSaveSnapshot> takeSaveSnapshot(const QString & path,const QString & name,bool autoSave);
+
+    /**
+     * @brief Writes the archive of the given snapshot to disk. It does not access the project and
+     * can be called from any thread. On failure, snapshot->error is set.
+     **/
+    static void writeSaveSnapshot(ProjectSaveSnapshot* snapshot);
+    
+    /**
+     * @brief Appends the journal record of the given snapshot to its journal file. Can be called from any thread.
+     * On failure, snapshot->error is set.
+     **/
+    static void writeJournalRecord(ProjectSaveSnapshot* snapshot);
+
+    /**
+     * @brief Run by a separate thread for auto-saves: only the snapshot is accessed, not the project.
+     * The snapshot is owned by the main thread, which releases its knobs and serialization objects once it is written.
+     **/
+    static void writeAutoSaveSnapshot(ProjectSaveSnapshot* snapshot);
+
+    /**
+     * @brief Updates the project state once the snapshot has been written successfully.
+     **/
+    void onSaveSnapshotWritten(const ProjectSaveSnapshot & snapshot);
+
     
     
 
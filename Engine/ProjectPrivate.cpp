@@ -31,6 +31,8 @@
 #include "Engine/AppManager.h"
 #include "Engine/ViewerInstance.h"
 #include "Engine/Settings.h"
+#include "Engine/Timer.h"
+#include "Engine/NodeGroup.h"
 
 namespace Natron {
 ProjectPrivate::ProjectPrivate(Natron::Project* project)
@@ -68,11 +70,17 @@ ProjectPrivate::ProjectPrivate(Natron::Project* project)
     , isLoadingProjectMutex()
     , isLoadingProject(false)
     , isLoadingProjectInternal(false)
+    , nGroupsLoadingOnDemand(0)
+    , loadTimings()
     , isSavingProjectMutex()
     , isSavingProject(false)
     , autoSaveTimer( new QTimer() )
     , projectClosing(false)
-    
+    , modificationsMutex()
+    , modifiedNodes()
+    , structureModified(false)
+    , journalBaseFilePath()
+    , journalRecordsCount(0)
 {
     
     autoSaveTimer->setSingleShot(true);
@@ -165,8 +173,17 @@ ProjectPrivate::restoreFromSerialization(const ProjectSerialization & obj,
     bool hasProjectAWriter = false;
     
     std::map<std::string,bool> processedModules;
-    bool ok = NodeCollectionSerialization::restoreFromSerialization(obj.getNodesSerialization().getNodesSerialization(),
-                                                                    _publicInterface->shared_from_this(),true, &processedModules, &hasProjectAWriter);
+    const std::list< boost::shared_ptr<NodeSerialization> > & serializedNodes = obj.getNodesSerialization().getNodesSerialization();
+    NodesLoadContext loadContext;
+    loadContext.deferGroups = !appPTR->isBackground() && appPTR->getCurrentSettings()->isLoadGroupsOnDemandEnabled();
+    if (loadContext.deferGroups) {
+        loadContext.addReferencedNames(serializedNodes);
+    }
+    bool ok = NodeCollectionSerialization::restoreFromSerialization(serializedNodes,
+                                                                    _publicInterface->shared_from_this(),true, &processedModules, &hasProjectAWriter,
+                                                                    &loadContext);
+    addLoadTiming("nodes creation", loadContext.creationTime);
+    addLoadTiming("links", loadContext.linksTime);
     for (std::map<std::string,bool>::iterator it = processedModules.begin(); it!=processedModules.end(); ++it) {
         if (it->second) {
             *mustSave = true;
@@ -180,12 +197,34 @@ ProjectPrivate::restoreFromSerialization(const ProjectSerialization & obj,
     }
 
     
+    if (loadContext.nDeferredGroups > 0) {
+        ///The groups that are upstream of a viewer or a writer are needed right away
+        TimeLapse timer;
+        std::list<ViewerInstance*> viewers;
+        _publicInterface->getViewers(&viewers);
+        for (std::list<ViewerInstance*>::iterator it = viewers.begin(); it != viewers.end(); ++it) {
+            NodeGroup::loadPendingGroupsUpstream( (*it)->getNode().get() );
+        }
+        std::list<Natron::OutputEffectInstance*> writers;
+        _publicInterface->getWriters(&writers);
+        for (std::list<Natron::OutputEffectInstance*>::iterator it = writers.begin(); it != writers.end(); ++it) {
+            NodeGroup::loadPendingGroupsUpstream( (*it)->getNode().get() );
+        }
+        addLoadTiming("groups upstream of outputs", timer.getTimeElapsedReset());
+#ifdef DEBUG
+        qDebug() << "Deferred the creation of" << loadContext.nDeferredNodes << "node(s) in" << loadContext.nDeferredGroups
+                 << "group(s), created" << loadContext.nCreatedNodes << "node(s)";
+#endif
+    }
+    
     _publicInterface->getApp()->updateProjectLoadStatus(QObject::tr("Restoring graph stream preferences"));
     
-   
+    TimeLapse clipPreferencesTimer;
     
     _publicInterface->forceGetClipPreferencesOnAllTrees();
     
+    addLoadTiming("clip preferences", clipPreferencesTimer.getTimeElapsedReset());
+    
     QDateTime time = QDateTime::currentDateTime();
     autoSetProjectFormat = false;
     hasProjectBeenSavedByUser = true;
@@ -453,4 +492,14 @@ ProjectPrivate::getProjectPath() const
     return projectPath->getValue();
 }
     
+void
+ProjectPrivate::resetModifications(const QString& baseFilePath,int journalRecords)
+{
+    QMutexLocker k(&modificationsMutex);
+    modifiedNodes.clear();
+    structureModified = false;
+    journalBaseFilePath = baseFilePath;
+    journalRecordsCount = journalRecords;
+}
+    
 } // namespace Natron
@@ -36,8 +36,11 @@ CLANG_DIAG_ON(uninitialized)
 
 class QTimer;
 class TimeLine;
+class AppInstance;
 class NodeSerialization;
 class ProjectSerialization;
+class ProjectJournalRecordSerialization;
+class ProjectGuiSerialization;
 class File_Knob;
 namespace Natron {
 class Node;
@@ -60,6 +63,63 @@ generateStringFromFormat(const Format & f)
     return formatStr;
 }
 
+/**
+ * @brief A copy of the state of the project taken on the main-thread by Project::takeSaveSnapshot().
+ * It holds everything needed to write the project file so that it can be written afterwards by any
+ * thread, without locking the project and while the user keeps on editing the graph.
+ **/
+struct ProjectSaveSnapshot
+{
+    AppInstance* app;
+    QString path,name; //< as passed to saveProject
+    QString filePath; //< the final location of the file
+    QString tmpFilePath; //< the file is first written there so a crash doesn't corrupt the user save
+    QString oldProjectPath; //< the project path before saving, restored if saving fails
+    QDateTime time;
+    bool autoSave;
+    bool isRenderSave;
+    bool bgProject;
+    boost::shared_ptr<ProjectSerialization> projectSerialization;
+    boost::shared_ptr<ProjectJournalRecordSerialization> journalRecord; //< if set, appended to the journal instead of a full save
+    QString journalFilePath;
+    boost::shared_ptr<ProjectGuiSerialization> guiSerialization;
+    
+    ///Timings, in seconds
+    double snapshotTime; //< time spent on the main-thread copying the project
+    double encodeTime; //< time spent writing the xml archive
+    double syncTime; //< time spent copying the file to its final location and flushing it to disk
+    
+    std::string error; //< non empty if the write failed
+    
+    ProjectSaveSnapshot()
+    : app(0)
+    , path()
+    , name()
+    , filePath()
+    , tmpFilePath()
+    , oldProjectPath()
+    , time()
+    , autoSave(false)
+    , isRenderSave(false)
+    , bgProject(false)
+    , projectSerialization()
+    , journalRecord()
+    , journalFilePath()
+    , guiSerialization()
+    , snapshotTime(0.)
+    , encodeTime(0.)
+    , syncTime(0.)
+    , error()
+    {
+    }
+};
+
+struct AutoSaveTask
+{
+    boost::shared_ptr<QFutureWatcher<void> > watcher;
+    boost::shared_ptr<ProjectSaveSnapshot> snapshot;
+};
+
 struct ProjectPrivate
 {
     Natron::Project* _publicInterface;
@@ -108,15 +168,31 @@ struct ProjectPrivate
     mutable QMutex isLoadingProjectMutex;
     bool isLoadingProject; //< true when the project is loading
     bool isLoadingProjectInternal; //< true when loading the internal project (not gui)
+    int nGroupsLoadingOnDemand; //< number of groups whose pending nodes are being created, see NodeGroup::loadPendingChildren
+    
+    ///The phases of the last project load and the seconds spent in each of them, see addLoadTiming
+    std::list<std::pair<std::string,double> > loadTimings;
     mutable QMutex isSavingProjectMutex;
     bool isSavingProject; //< true when the project is saving
     boost::shared_ptr<QTimer> autoSaveTimer;
-    std::list<boost::shared_ptr<QFutureWatcher<void> > > autoSaveFutures;
+    std::list<AutoSaveTask> autoSaveFutures; //< auto-saves being written by another thread
     bool projectClosing;
     
+    ///Book-keeping for incremental saves
+    mutable QMutex modificationsMutex; //< protects the fields below
+    std::map<Natron::Node*,boost::weak_ptr<Natron::Node> > modifiedNodes; //< nodes modified since the last user save
+    bool structureModified; //< nodes were added, removed or renamed since the last user save
+    QString journalBaseFilePath; //< the project file the journal applies to, empty if the next save must be a full save
+    int journalRecordsCount; //< number of records in the journal of journalBaseFilePath
+    
     ProjectPrivate(Natron::Project* project);
 
     bool restoreFromSerialization(const ProjectSerialization & obj,const QString& name,const QString& path, bool* mustSave);
+    
+    void addLoadTiming(const std::string& phase,double seconds)
+    {
+        loadTimings.push_back( std::make_pair(phase, seconds) );
+    }
 
     bool findFormat(int index,Format* format) const;
     
@@ -136,6 +212,12 @@ struct ProjectPrivate
     
     void setProjectPath(const std::string& path);
     std::string getProjectPath() const;
+    
+    /**
+     * @brief Forgets about all modifications: the project file at baseFilePath (with its journal
+     * made of journalRecords entries) is up to date. An empty baseFilePath forces the next save to be a full save.
+     **/
+    void resetModifications(const QString& baseFilePath,int journalRecords);
 };
 }
 
@@ -18,6 +18,7 @@
 #include "Engine/TimeLine.h"
 #include "Engine/Project.h"
 #include "Engine/AppManager.h"
+#include "Engine/Node.h"
 
 
 void
@@ -29,6 +30,17 @@ ProjectSerialization::initialize(const Natron::Project* project)
     
     project->getAdditionalFormats(&_additionalFormats);
 
+    serializeProjectKnobs(project, &_projectKnobs);
+
+    _timelineCurrent = project->currentFrame();
+
+    _creationDate = project->getProjectCreationTime();
+}
+
+void
+ProjectSerialization::serializeProjectKnobs(const Natron::Project* project,
+                                            std::list< boost::shared_ptr<KnobSerialization> >* knobsSerialization)
+{
     std::vector< boost::shared_ptr<KnobI> > knobs = project->getKnobs_mt_safe();
     for (U32 i = 0; i < knobs.size(); ++i) {
         Group_Knob* isGroup = dynamic_cast<Group_Knob*>( knobs[i].get() );
@@ -36,12 +48,40 @@ ProjectSerialization::initialize(const Natron::Project* project)
         Button_Knob* isButton = dynamic_cast<Button_Knob*>( knobs[i].get() );
         if (knobs[i]->getIsPersistant() && !isGroup && !isPage && !isButton) {
             boost::shared_ptr<KnobSerialization> newKnobSer( new KnobSerialization(knobs[i]) );
-            _projectKnobs.push_back(newKnobSer);
+            knobsSerialization->push_back(newKnobSer);
         }
     }
+}
 
+void
+ProjectJournalRecordSerialization::initialize(const Natron::Project* project,
+                                              const std::list<boost::shared_ptr<Natron::Node> >& modifiedNodes)
+{
+    for (std::list<boost::shared_ptr<Natron::Node> >::const_iterator it = modifiedNodes.begin(); it != modifiedNodes.end(); ++it) {
+        boost::shared_ptr<NodeSerialization> state(new NodeSerialization(*it));
+        _nodes.push_back(std::make_pair((*it)->getFullyQualifiedName(), state));
+    }
+    
+    project->getAdditionalFormats(&_additionalFormats);
+    
+    ProjectSerialization::serializeProjectKnobs(project, &_projectKnobs);
+    
     _timelineCurrent = project->currentFrame();
+}
 
-    _creationDate = project->getProjectCreationTime();
+bool
+ProjectJournalRecordSerialization::applyTo(ProjectSerialization* obj) const
+{
+    bool ret = true;
+    for (std::list< std::pair<std::string, boost::shared_ptr<NodeSerialization> > >::const_iterator it = _nodes.begin();
+         it != _nodes.end(); ++it) {
+        if (!obj->_nodes.replaceNodeSerialization(it->first, it->second)) {
+            ret = false;
+        }
+    }
+    obj->_additionalFormats = _additionalFormats;
+    obj->_projectKnobs = _projectKnobs;
+    obj->_timelineCurrent = _timelineCurrent;
+    return ret;
 }
 
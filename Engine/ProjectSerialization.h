@@ -49,8 +49,11 @@ CLANG_DIAG_ON(unused-parameter)
 #define PROJECT_SERIALIZATION_VERSION PROJECT_SERIALIZATION_INTRODUCES_GROUPS
 
 class AppInstance;
+class ProjectJournalRecordSerialization;
 class ProjectSerialization
 {
+    friend class ProjectJournalRecordSerialization;
+    
     NodeCollectionSerialization _nodes;
     std::list<Format> _additionalFormats;
     std::list< boost::shared_ptr<KnobSerialization> > _projectKnobs;
@@ -80,6 +83,9 @@ public:
     }
     
     void initialize(const Natron::Project* project);
+    
+    static void serializeProjectKnobs(const Natron::Project* project,
+                                      std::list< boost::shared_ptr<KnobSerialization> >* knobsSerialization);
 
     SequenceTime getCurrentTime() const
     {
@@ -219,4 +225,97 @@ public:
 
 BOOST_CLASS_VERSION(ProjectSerialization,PROJECT_SERIALIZATION_VERSION)
 
+#define PROJECT_JOURNAL_RECORD_VERSION 1
+
+/**
+ * @brief An entry of the journal written by incremental saves. It holds the state of the nodes
+ * that were modified since the previous save along with the project settings, which are cheap to save.
+ * Applying all the records of the journal in order to the project file gives back the project
+ * as a full save would have written it.
+ **/
+class ProjectJournalRecordSerialization
+{
+    ///The modified nodes, keyed by their fully qualified name
+    std::list< std::pair<std::string, boost::shared_ptr<NodeSerialization> > > _nodes;
+    std::list<Format> _additionalFormats;
+    std::list< boost::shared_ptr<KnobSerialization> > _projectKnobs;
+    SequenceTime _timelineCurrent;
+    
+public:
+    
+    ProjectJournalRecordSerialization()
+    : _nodes()
+    , _additionalFormats()
+    , _projectKnobs()
+    , _timelineCurrent(0)
+    {
+    }
+    
+    void initialize(const Natron::Project* project,const std::list<boost::shared_ptr<Natron::Node> >& modifiedNodes);
+    
+    /**
+     * @brief Replaces in obj the state of the nodes and settings contained in this record.
+     * @returns False if a node of the record could not be found in obj.
+     **/
+    bool applyTo(ProjectSerialization* obj) const;
+    
+    std::size_t getNodesCount() const
+    {
+        return _nodes.size();
+    }
+    
+    friend class boost::serialization::access;
+    template<class Archive>
+    void save(Archive & ar,
+              const unsigned int /*version*/) const
+    {
+        int nodesCount = (int)_nodes.size();
+        ar & boost::serialization::make_nvp("NodesCount",nodesCount);
+        for (std::list< std::pair<std::string, boost::shared_ptr<NodeSerialization> > >::const_iterator it = _nodes.begin();
+             it != _nodes.end(); ++it) {
+            ar & boost::serialization::make_nvp("FullName",it->first);
+            ar & boost::serialization::make_nvp("item",*it->second);
+        }
+        
+        int knobsCount = _projectKnobs.size();
+        ar & boost::serialization::make_nvp("ProjectKnobsCount",knobsCount);
+        for (std::list< boost::shared_ptr<KnobSerialization> >::const_iterator it = _projectKnobs.begin();
+             it != _projectKnobs.end();
+             ++it) {
+            ar & boost::serialization::make_nvp( "item",*(*it) );
+        }
+        ar & boost::serialization::make_nvp("AdditionalFormats", _additionalFormats);
+        ar & boost::serialization::make_nvp("Timeline_current_time", _timelineCurrent);
+    }
+    
+    template<class Archive>
+    void load(Archive & ar,
+              const unsigned int /*version*/)
+    {
+        int nodesCount;
+        ar & boost::serialization::make_nvp("NodesCount",nodesCount);
+        for (int i = 0; i < nodesCount; ++i) {
+            std::string fullName;
+            ar & boost::serialization::make_nvp("FullName",fullName);
+            boost::shared_ptr<NodeSerialization> ns(new NodeSerialization);
+            ar & boost::serialization::make_nvp("item",*ns);
+            _nodes.push_back(std::make_pair(fullName, ns));
+        }
+        
+        int knobsCount;
+        ar & boost::serialization::make_nvp("ProjectKnobsCount",knobsCount);
+        for (int i = 0; i < knobsCount; ++i) {
+            boost::shared_ptr<KnobSerialization> ks(new KnobSerialization);
+            ar & boost::serialization::make_nvp("item",*ks);
+            _projectKnobs.push_back(ks);
+        }
+        ar & boost::serialization::make_nvp("AdditionalFormats", _additionalFormats);
+        ar & boost::serialization::make_nvp("Timeline_current_time", _timelineCurrent);
+    }
+    
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+};
+
+BOOST_CLASS_VERSION(ProjectJournalRecordSerialization,PROJECT_JOURNAL_RECORD_VERSION)
+
 #endif // PROJECTSERIALIZATION_H
@@ -0,0 +1,221 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include "RenderPriority.h"
+
+#include <algorithm>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
+
+#include "Engine/Timer.h"
+
+using namespace Natron;
+
+namespace Natron {
+struct RenderPriorityArbiterPrivate
+{
+    ///The number of frame renders running in each priority class
+    QAtomicInt nRunning[NATRON_RENDER_PRIORITIES_COUNT];
+    ///The number of frame renders started or finished in each priority class
+    QAtomicInt activity[NATRON_RENDER_PRIORITIES_COUNT];
+    QAtomicInt enabled;
+    QAtomicInt nWaiting; //< threads blocked in yieldToHigherPriorities, incremented with lock held
+
+    mutable QMutex lock; //< protects stats
+    QWaitCondition renderFinished; //< woken up whenever a frame render ends
+    RenderPriorityStats stats[NATRON_RENDER_PRIORITIES_COUNT];
+
+    RenderPriorityArbiterPrivate()
+    : enabled()
+    , nWaiting()
+    , lock()
+    , renderFinished()
+    {
+        for (int i = 0; i < NATRON_RENDER_PRIORITIES_COUNT; ++i) {
+            nRunning[i] = 0;
+            activity[i] = 0;
+        }
+        enabled = 1;
+        nWaiting = 0;
+    }
+};
+} // namespace Natron
+
+RenderPriorityArbiter::RenderPriorityArbiter()
+: _imp( new RenderPriorityArbiterPrivate() )
+{
+}
+
+RenderPriorityArbiter::~RenderPriorityArbiter()
+{
+}
+
+void
+RenderPriorityArbiter::setEnabled(bool enabled)
+{
+    _imp->enabled = enabled ? 1 : 0;
+
+    ///Release the tiles currently waiting
+    QMutexLocker k(&_imp->lock);
+    _imp->renderFinished.wakeAll();
+}
+
+bool
+RenderPriorityArbiter::isEnabled() const
+{
+    return (int)_imp->enabled != 0;
+}
+
+void
+RenderPriorityArbiter::beginRender(Natron::RenderPriorityEnum priority)
+{
+    assert(priority >= 0 && priority < NATRON_RENDER_PRIORITIES_COUNT);
+    _imp->nRunning[priority].ref();
+    _imp->activity[priority].ref();
+}
+
+void
+RenderPriorityArbiter::endRender(Natron::RenderPriorityEnum priority,
+                                 double latency)
+{
+    assert(priority >= 0 && priority < NATRON_RENDER_PRIORITIES_COUNT);
+    _imp->nRunning[priority].deref();
+    _imp->activity[priority].ref();
+
+    QMutexLocker k(&_imp->lock);
+    RenderPriorityStats & stats = _imp->stats[priority];
+    ++stats.nRenders;
+    stats.totalLatency += latency;
+    stats.maxLatency = std::max(stats.maxLatency, latency);
+    _imp->renderFinished.wakeAll();
+}
+
+bool
+RenderPriorityArbiter::hasHigherPriorityRenders(Natron::RenderPriorityEnum priority) const
+{
+    for (int i = 0; i < (int)priority; ++i) {
+        if ( (int)_imp->nRunning[i] > 0 ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int
+RenderPriorityArbiter::getHigherPriorityActivity(Natron::RenderPriorityEnum priority) const
+{
+    int ret = 0;
+    for (int i = 0; i < (int)priority; ++i) {
+        ret += (int)_imp->activity[i];
+    }
+    return ret;
+}
+
+double
+RenderPriorityArbiter::yieldToHigherPriorities(Natron::RenderPriorityEnum priority,
+                                               int maxWaitMS)
+{
+    if ( !isEnabled() || !hasHigherPriorityRenders(priority) ) {
+        return 0.;
+    }
+
+    ///Never block the main-thread, some renders (e.g: previews) may be done on it
+    if ( QCoreApplication::instance() && ( QThread::currentThread() == QCoreApplication::instance()->thread() ) ) {
+        return 0.;
+    }
+
+    TimeLapse timer;
+
+    ///The thread does not use its core while it waits: let the pool start another task in the meantime
+    QThreadPool::globalInstance()->releaseThread();
+    {
+        QMutexLocker k(&_imp->lock);
+        _imp->nWaiting.ref();
+        int elapsedMS = 0;
+        while ( isEnabled() && hasHigherPriorityRenders(priority) && elapsedMS < maxWaitMS ) {
+            _imp->renderFinished.wait( &_imp->lock, (unsigned long)(maxWaitMS - elapsedMS) );
+            elapsedMS = (int)(timer.getTimeSinceCreation() * 1000.);
+        }
+        _imp->nWaiting.deref();
+    }
+    QThreadPool::globalInstance()->reserveThread();
+
+    double waited = timer.getTimeSinceCreation();
+
+    QMutexLocker k(&_imp->lock);
+    RenderPriorityStats & stats = _imp->stats[priority];
+    ++stats.nPreemptions;
+    stats.preemptedTime += waited;
+
+    return waited;
+}
+
+int
+RenderPriorityArbiter::getWaitingThreadsCount() const
+{
+    return (int)_imp->nWaiting;
+}
+
+void
+RenderPriorityArbiter::getStats(Natron::RenderPriorityEnum priority,
+                                RenderPriorityStats* stats) const
+{
+    assert(priority >= 0 && priority < NATRON_RENDER_PRIORITIES_COUNT);
+    QMutexLocker k(&_imp->lock);
+    *stats = _imp->stats[priority];
+}
+
+void
+RenderPriorityArbiter::resetStats()
+{
+    QMutexLocker k(&_imp->lock);
+    for (int i = 0; i < NATRON_RENDER_PRIORITIES_COUNT; ++i) {
+        _imp->stats[i] = RenderPriorityStats();
+    }
+}
+
+const char*
+RenderPriorityArbiter::getPriorityName(Natron::RenderPriorityEnum priority)
+{
+    switch (priority) {
+    case eRenderPriorityInteractive:
+        return "Interactive";
+    case eRenderPriorityPlayback:
+        return "Playback";
+    case eRenderPriorityPreview:
+        return "Preview";
+    case eRenderPriorityBatch:
+        return "Batch";
+    case eRenderPrioritySpeculative:
+        return "Speculative";
+    }
+    return "";
+}
+
+RenderPriorityScope::RenderPriorityScope(RenderPriorityArbiter* arbiter,
+                                         Natron::RenderPriorityEnum priority)
+: _priority(priority)
+, _arbiter(arbiter)
+, _timer( new TimeLapse() )
+{
+    assert(_arbiter);
+    _arbiter->beginRender(_priority);
+}
+
+RenderPriorityScope::~RenderPriorityScope()
+{
+    _arbiter->endRender( _priority, _timer->getTimeSinceCreation() );
+}
@@ -0,0 +1,151 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_RENDERPRIORITY_H_
+#define NATRON_ENGINE_RENDERPRIORITY_H_
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include "Global/GlobalDefines.h"
+
+class TimeLapse;
+
+///The longest a tile waits for the renders of a higher priority before being rendered anyway.
+///A render of a higher priority may be waiting for an image rendered by a render of a lower priority: this
+///bounds the time it can be slowed down by the preemption.
+#define NATRON_RENDER_PREEMPTION_MAX_WAIT_MS 100
+
+namespace Natron {
+
+/**
+ * @brief The priority classes of renders, from the highest to the lowest.
+ * The tiles of a render yield the cores to the renders of a higher priority class, see RenderPriorityArbiter.
+ **/
+enum RenderPriorityEnum
+{
+    eRenderPriorityInteractive = 0, //< viewer renders in response to a user interaction: parameter change, timeline seek...
+    eRenderPriorityPlayback, //< viewer playback and tracking
+    eRenderPriorityPreview, //< node previews
+    eRenderPriorityBatch, //< writers rendering a sequence
+    eRenderPrioritySpeculative //< viewer frames prerendered while the renders are idle, aborted as soon as another render starts
+};
+
+#define NATRON_RENDER_PRIORITIES_COUNT 5
+
+/**
+ * @brief Accumulated statistics of the renders of a priority class
+ **/
+struct RenderPriorityStats
+{
+    U64 nRenders; //< number of frame renders finished
+    double totalLatency; //< the seconds spent rendering them, from the moment they were started
+    double maxLatency;
+    U64 nPreemptions; //< number of tiles that waited for the renders of a higher priority
+    double preemptedTime; //< the seconds they waited
+
+    RenderPriorityStats()
+    : nRenders(0)
+    , totalLatency(0.)
+    , maxLatency(0.)
+    , nPreemptions(0)
+    , preemptedTime(0.)
+    {
+    }
+};
+
+struct RenderPriorityArbiterPrivate;
+
+/**
+ * @brief Keeps track of the frame renders running in each priority class, so that the tiles of a render can give
+ * their core to the renders of a higher priority. All renders share the global thread-pool: while a tile waits,
+ * its thread is released from the pool so that the pool can start the tiles of the higher priority renders instead.
+ * This class is thread-safe.
+ **/
+class RenderPriorityArbiter
+{
+public:
+
+    RenderPriorityArbiter();
+
+    ~RenderPriorityArbiter();
+
+    /**
+     * @brief When disabled, yieldToHigherPriorities() returns immediately. Renders are still counted.
+     **/
+    void setEnabled(bool enabled);
+
+    bool isEnabled() const;
+
+    /**
+     * @brief Must be called when a frame render of the given priority starts, and be matched with a call to endRender()
+     **/
+    void beginRender(Natron::RenderPriorityEnum priority);
+
+    /**
+     * @brief Ends a frame render started with beginRender(), latency is the number of seconds since it was started
+     **/
+    void endRender(Natron::RenderPriorityEnum priority,
+                   double latency);
+
+    /**
+     * @brief Returns true if a frame render of a higher priority than the given one is running.
+     * This does not lock any mutex, it can be called for each tile.
+     **/
+    bool hasHigherPriorityRenders(Natron::RenderPriorityEnum priority) const;
+
+    /**
+     * @brief Returns a counter incremented whenever a frame render of a higher priority than the given one starts or
+     * ends: the caller can tell whether such renders ran in-between two calls, even if none is running anymore.
+     **/
+    int getHigherPriorityActivity(Natron::RenderPriorityEnum priority) const;
+
+    /**
+     * @brief Preemption point: blocks the calling thread while renders of a higher priority than the given one are
+     * running, for at most maxWaitMS milliseconds. Returns the number of seconds waited.
+     **/
+    double yieldToHigherPriorities(Natron::RenderPriorityEnum priority,
+                                   int maxWaitMS = NATRON_RENDER_PREEMPTION_MAX_WAIT_MS);
+
+    /**
+     * @brief Returns the number of threads currently blocked in yieldToHigherPriorities()
+     **/
+    int getWaitingThreadsCount() const;
+
+    void getStats(Natron::RenderPriorityEnum priority,
+                  RenderPriorityStats* stats) const;
+
+    void resetStats();
+
+    static const char* getPriorityName(Natron::RenderPriorityEnum priority);
+
+private:
+
+    boost::scoped_ptr<RenderPriorityArbiterPrivate> _imp;
+};
+
+/**
+ * @brief Registers a frame render with the arbiter of the application for the lifetime of the object
+ **/
+class RenderPriorityScope
+{
+    Natron::RenderPriorityEnum _priority;
+    RenderPriorityArbiter* _arbiter;
+    boost::scoped_ptr<TimeLapse> _timer;
+
+public:
+
+    RenderPriorityScope(RenderPriorityArbiter* arbiter,
+                        Natron::RenderPriorityEnum priority);
+
+    ~RenderPriorityScope();
+};
+} // namespace Natron
+
+#endif // NATRON_ENGINE_RENDERPRIORITY_H_
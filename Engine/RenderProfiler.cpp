@@ -0,0 +1,288 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include "RenderProfiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <vector>
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QThreadStorage>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Engine/EffectInstance.h"
+#include "Engine/Timer.h"
+
+///Number of spans kept for each thread, older spans are overwritten
+#define NATRON_PROFILER_SPANS_PER_THREAD 16384
+
+///Node names longer than this are truncated in the spans
+#define NATRON_PROFILER_NODE_NAME_MAX 48
+
+///When more buffers than this are registered, the buffers of the threads that finished are released
+#define NATRON_PROFILER_MAX_THREAD_BUFFERS 256
+
+using namespace Natron;
+
+namespace {
+
+struct ProfilerSpan
+{
+    const char* name;
+    char node[NATRON_PROFILER_NODE_NAME_MAX];
+    U64 startTime;
+    U64 endTime;
+};
+
+///Written only by its thread, read when exporting
+struct ProfilerThreadBuffer
+{
+    int threadID;
+    std::string threadName;
+    std::vector<ProfilerSpan> spans;
+    QAtomicInt nWritten;
+};
+
+typedef boost::shared_ptr<ProfilerThreadBuffer> ProfilerThreadBufferPtr;
+
+timeval
+getCurrentTimeOfDay()
+{
+    timeval t;
+    gettimeofday(&t, 0);
+    return t;
+}
+
+const timeval gTimeOrigin = getCurrentTimeOfDay();
+QAtomicInt gEnabled(0);
+QAtomicInt gNextThreadID(0);
+
+///Spans started before this time were cleared
+QMutex gClearTimeMutex;
+U64 gClearTime = 0;
+
+///Protects gBuffers, only locked when a thread records its first span and when exporting
+QMutex gBuffersMutex;
+std::list<ProfilerThreadBufferPtr> gBuffers;
+
+QThreadStorage<ProfilerThreadBufferPtr> gThreadBuffer;
+
+ProfilerThreadBuffer*
+getThreadBuffer()
+{
+    ProfilerThreadBufferPtr& buffer = gThreadBuffer.localData();
+    if (buffer) {
+        return buffer.get();
+    }
+    
+    buffer.reset(new ProfilerThreadBuffer);
+    buffer->threadID = gNextThreadID.fetchAndAddRelaxed(1);
+    QThread* thread = QThread::currentThread();
+    if ( qApp && (thread == qApp->thread()) ) {
+        buffer->threadName = "Main thread";
+    } else if ( !thread->objectName().isEmpty() ) {
+        buffer->threadName = thread->objectName().toStdString();
+    } else {
+        buffer->threadName = QString("Thread %1").arg(buffer->threadID).toStdString();
+    }
+    buffer->spans.resize(NATRON_PROFILER_SPANS_PER_THREAD);
+    
+    QMutexLocker k(&gBuffersMutex);
+    if (gBuffers.size() >= NATRON_PROFILER_MAX_THREAD_BUFFERS) {
+        ///Buffers only referenced by the list belong to threads that are done
+        for (std::list<ProfilerThreadBufferPtr>::iterator it = gBuffers.begin(); it != gBuffers.end();) {
+            if ( it->unique() ) {
+                it = gBuffers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    gBuffers.push_back(buffer);
+    
+    return buffer.get();
+}
+
+void
+writeJSONString(std::ostream& os,
+                const char* str)
+{
+    os << '"';
+    for (const char* c = str; *c; ++c) {
+        switch (*c) {
+            case '"':
+                os << "\\\"";
+                break;
+            case '\\':
+                os << "\\\\";
+                break;
+            case '\n':
+                os << "\\n";
+                break;
+            default:
+                if ( (unsigned char)*c >= 0x20 ) {
+                    os << *c;
+                }
+                break;
+        }
+    }
+    os << '"';
+}
+
+}
+
+void
+RenderProfiler::setEnabled(bool enabled)
+{
+    int wasEnabled = gEnabled.fetchAndStoreRelease(enabled ? 1 : 0);
+    
+    ///Each time the profiler is enabled a new recording starts
+    if (enabled && !wasEnabled) {
+        clear();
+    }
+}
+
+bool
+RenderProfiler::isEnabled()
+{
+    return (int)gEnabled != 0;
+}
+
+U64
+RenderProfiler::getTime()
+{
+    timeval now;
+    gettimeofday(&now, 0);
+    
+    return (U64)(now.tv_sec - gTimeOrigin.tv_sec) * 1000000 + now.tv_usec - gTimeOrigin.tv_usec;
+}
+
+void
+RenderProfiler::addSpan(const char* name,
+                        const std::string& node,
+                        U64 startTime,
+                        U64 endTime)
+{
+    ProfilerThreadBuffer* buffer = getThreadBuffer();
+    int n = buffer->nWritten;
+    ProfilerSpan& span = buffer->spans[(unsigned int)n % NATRON_PROFILER_SPANS_PER_THREAD];
+    span.name = name;
+    std::size_t len = std::min( node.size(), (std::size_t)NATRON_PROFILER_NODE_NAME_MAX - 1 );
+    std::memcpy(span.node, node.c_str(), len);
+    span.node[len] = '\0';
+    span.startTime = startTime;
+    span.endTime = endTime;
+    
+    ///Publish the span once it is entirely written
+    buffer->nWritten.fetchAndStoreRelease(n + 1);
+}
+
+void
+RenderProfiler::clear()
+{
+    QMutexLocker k(&gClearTimeMutex);
+    gClearTime = getTime();
+}
+
+bool
+RenderProfiler::exportChromeTrace(const std::string& filename,
+                                  std::string* error)
+{
+    std::ofstream ofile(filename.c_str(), std::ofstream::out);
+    if ( !ofile.good() ) {
+        *error = QObject::tr("Failed to open %1").arg( filename.c_str() ).toStdString();
+        return false;
+    }
+    
+    U64 clearTime;
+    {
+        QMutexLocker k(&gClearTimeMutex);
+        clearTime = gClearTime;
+    }
+    std::list<ProfilerThreadBufferPtr> buffers;
+    {
+        QMutexLocker k(&gBuffersMutex);
+        buffers = gBuffers;
+    }
+    
+    ofile << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (std::list<ProfilerThreadBufferPtr>::iterator it = buffers.begin(); it != buffers.end(); ++it) {
+        int n = (*it)->nWritten.fetchAndAddAcquire(0);
+        if (n == 0) {
+            continue;
+        }
+        
+        if (!first) {
+            ofile << ",\n";
+        }
+        first = false;
+        ofile << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << (*it)->threadID << ",\"args\":{\"name\":";
+        writeJSONString( ofile, (*it)->threadName.c_str() );
+        ofile << "}}";
+        
+        unsigned int nSpans = std::min( (unsigned int)n, (unsigned int)NATRON_PROFILER_SPANS_PER_THREAD );
+        for (unsigned int i = (unsigned int)n - nSpans; i != (unsigned int)n; ++i) {
+            ///Copy the span: the thread may overwrite it meanwhile if it is still rendering
+            ProfilerSpan span = (*it)->spans[i % NATRON_PROFILER_SPANS_PER_THREAD];
+            span.node[NATRON_PROFILER_NODE_NAME_MAX - 1] = '\0';
+            if ( !span.name || (span.startTime < clearTime) || (span.endTime < span.startTime) ) {
+                continue;
+            }
+            ofile << ",\n{\"name\":";
+            writeJSONString(ofile, span.name);
+            ofile << ",\"cat\":\"render\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (*it)->threadID
+                  << ",\"ts\":" << span.startTime << ",\"dur\":" << span.endTime - span.startTime;
+            if (span.node[0] != '\0') {
+                ofile << ",\"args\":{\"node\":";
+                writeJSONString(ofile, span.node);
+                ofile << "}";
+            }
+            ofile << "}";
+        }
+    }
+    ofile << "\n]}\n";
+    
+    if ( !ofile.good() ) {
+        *error = QObject::tr("Failed to write %1").arg( filename.c_str() ).toStdString();
+        return false;
+    }
+    return true;
+}
+
+ProfilerScope::ProfilerScope(const char* name,
+                             const Natron::EffectInstance* effect)
+: _name(name)
+, _effect(effect)
+, _startTime(0)
+, _enabled( RenderProfiler::isEnabled() )
+{
+    if (_enabled) {
+        _startTime = RenderProfiler::getTime();
+    }
+}
+
+ProfilerScope::~ProfilerScope()
+{
+    if (_enabled) {
+        U64 endTime = RenderProfiler::getTime();
+        RenderProfiler::addSpan(_name, _effect ? _effect->getScriptName_mt_safe() : std::string(), _startTime, endTime);
+    }
+}
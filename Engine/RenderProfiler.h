@@ -0,0 +1,83 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_RENDERPROFILER_H_
+#define NATRON_ENGINE_RENDERPROFILER_H_
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include <string>
+
+#include "Global/GlobalDefines.h"
+
+namespace Natron {
+class EffectInstance;
+
+/**
+ * @brief Records where the time goes during renders: each thread records spans (e.g: the render action of a node,
+ * a cache lookup, a format conversion) in its own ring buffer, without locking, so that profiling can stay enabled
+ * while rendering. Only the latest spans of each thread are kept.
+ * The spans can be exported to a Chrome trace file which can be opened in chrome://tracing.
+ **/
+class RenderProfiler
+{
+public:
+    
+    /**
+     * @brief Enabling the profiler clears the spans recorded while it was previously enabled
+     **/
+    static void setEnabled(bool enabled);
+    
+    static bool isEnabled();
+    
+    /**
+     * @brief Returns the time in microseconds since the profiler was first used
+     **/
+    static U64 getTime();
+    
+    /**
+     * @brief Records a span on the calling thread. name must be a string literal (or live as long as the application)
+     * and node is the script-name of the node which is rendering, if any.
+     **/
+    static void addSpan(const char* name,const std::string& node,U64 startTime,U64 endTime);
+    
+    /**
+     * @brief Forgets all the spans recorded so far
+     **/
+    static void clear();
+    
+    /**
+     * @brief Writes the spans recorded so far to the given file in the Chrome trace event format (JSON).
+     * @returns False if the file could not be written, in which case error is set
+     **/
+    static bool exportChromeTrace(const std::string& filename,std::string* error);
+};
+
+/**
+ * @brief Records a span from its creation to its destruction if the profiler is enabled.
+ **/
+class ProfilerScope
+{
+public:
+    
+    ProfilerScope(const char* name,
+                  const Natron::EffectInstance* effect);
+    
+    ~ProfilerScope();
+    
+private:
+    
+    const char* _name;
+    const Natron::EffectInstance* _effect;
+    U64 _startTime;
+    bool _enabled;
+};
+
+} // namespace Natron
+
+#endif // NATRON_ENGINE_RENDERPROFILER_H_
@@ -0,0 +1,325 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include "RenderServer.h"
+
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <stdexcept>
+
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <QtConcurrentRun>
+
+#include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/Project.h"
+#include "Engine/Timer.h"
+
+namespace {
+
+///Set by RenderServer::quit(), which may be called from a signal handler
+QAtomicInt gMustQuit(0);
+
+int
+parseFrame(const QString & str,
+           int defaultValue)
+{
+    if ( str.isEmpty() ) {
+        return defaultValue;
+    }
+    bool ok;
+    int frame = str.toInt(&ok);
+    if (!ok) {
+        throw std::invalid_argument( QObject::tr("Invalid frame: ").toStdString() + str.toStdString() );
+    }
+
+    return frame;
+}
+
+///The renders of a job, run on a thread of the pool so that the server thread can write the messages of the render threads
+struct JobRender
+{
+    AppInstance* app;
+    std::list<AppInstance::RenderRequest> requests;
+    bool succeeded;
+    std::string error;
+};
+
+void
+renderJob(JobRender* job)
+{
+    try {
+        job->succeeded = job->app->startWritersRendering(job->requests);
+        if (!job->succeeded) {
+            job->error = QObject::tr("The render was aborted or failed.").toStdString();
+        }
+    } catch (const std::exception & e) {
+        job->succeeded = false;
+        job->error = e.what();
+    }
+}
+
+}
+
+struct RenderServerPrivate
+{
+    AppInstance* app;
+    QString serverName;
+    QLocalServer* server;
+
+    QMutex clientMutex; //< protects client, pendingLines and the timers
+    QLocalSocket* client; //< the client of the job being rendered
+    QStringList pendingLines; //< lines written by other threads than the one of client, see onClientMessagesQueued()
+    boost::scoped_ptr<TimeLapse> jobTimer;
+    boost::scoped_ptr<TimeLapse> frameTimer;
+
+    QString loadedProject; //< absolute file path of the project loaded by the last job
+    QDateTime loadedProjectLastModified;
+    bool loadedProjectChanged; //< true if Python lines were run on the loaded project
+
+    RenderServerPrivate(AppInstance* app,
+                        const QString & serverName)
+    : app(app)
+    , serverName(serverName)
+    , server(0)
+    , clientMutex()
+    , client(0)
+    , pendingLines()
+    , jobTimer()
+    , frameTimer()
+    , loadedProject()
+    , loadedProjectLastModified()
+    , loadedProjectChanged(false)
+    {
+    }
+};
+
+RenderServer::RenderServer(AppInstance* app,
+                           const QString & serverName)
+: QObject()
+, _imp( new RenderServerPrivate(app,serverName) )
+{
+}
+
+RenderServer::~RenderServer()
+{
+    if (_imp->server) {
+        _imp->server->close();
+        delete _imp->server;
+    }
+}
+
+bool
+RenderServer::listen(std::string* error)
+{
+    assert(!_imp->server);
+    _imp->server = new QLocalServer();
+
+    ///A server that crashed may have left its socket file behind
+    QLocalServer::removeServer(_imp->serverName);
+    if ( !_imp->server->listen(_imp->serverName) ) {
+        *error = _imp->server->errorString().toStdString();
+
+        return false;
+    }
+    std::cout << QObject::tr("Render server listening on ").toStdString() << _imp->server->fullServerName().toStdString() << std::endl;
+
+    return true;
+}
+
+void
+RenderServer::exec()
+{
+    assert(_imp->server);
+    while (!gMustQuit) {
+        if ( !_imp->server->waitForNewConnection(100) ) {
+            continue;
+        }
+        QLocalSocket* socket = _imp->server->nextPendingConnection();
+        if (!socket) {
+            continue;
+        }
+        serveClient(socket);
+        socket->close();
+        delete socket;
+    }
+}
+
+void
+RenderServer::quit()
+{
+    gMustQuit = 1;
+}
+
+void
+RenderServer::serveClient(QLocalSocket* socket)
+{
+    while ( !gMustQuit && socket->state() == QLocalSocket::ConnectedState ) {
+        if ( !socket->canReadLine() && !socket->waitForReadyRead(100) ) {
+            continue;
+        }
+        while ( socket->canReadLine() ) {
+            QString str = QString::fromUtf8( socket->readLine() );
+            while ( str.endsWith('\n') || str.endsWith('\r') ) {
+                str.chop(1);
+            }
+            if ( str.startsWith(kRenderServerQuitShort) ) {
+                quit();
+
+                return;
+            } else if ( str.startsWith(kRenderServerJobShort) ) {
+                {
+                    QMutexLocker k(&_imp->clientMutex);
+                    _imp->client = socket;
+                    _imp->jobTimer.reset(new TimeLapse);
+                    _imp->frameTimer.reset(new TimeLapse);
+                }
+                processJob( str.mid( std::strlen(kRenderServerJobShort) ) );
+                {
+                    QMutexLocker k(&_imp->clientMutex);
+                    _imp->client = 0;
+                }
+            } else if ( !str.isEmpty() ) {
+                socket->write( ( QString(kRenderServerJobFailedShort) + ' ' + QObject::tr("Unable to interpret message: ") + str + '\n' ).toUtf8() );
+                socket->flush();
+            }
+        }
+    }
+}
+
+void
+RenderServer::processJob(const QString & job)
+{
+    try {
+        QStringList fields = job.split('\t');
+        ///fields[0] is what was between kRenderServerJobShort and the first tab
+        if (fields.size() < 5) {
+            throw std::invalid_argument( QObject::tr("Malformed job: ").toStdString() + job.toStdString() );
+        }
+
+        QFileInfo info(fields[1]);
+        if ( !info.exists() ) {
+            throw std::invalid_argument( QObject::tr("Specified file does not exist").toStdString() );
+        }
+        QString projectFile = info.absoluteFilePath();
+        if ( (projectFile != _imp->loadedProject) || (info.lastModified() != _imp->loadedProjectLastModified) || _imp->loadedProjectChanged ) {
+            _imp->loadedProject.clear();
+            if ( !_imp->app->getProject()->loadProject( info.absolutePath(), info.fileName() ) ) {
+                throw std::invalid_argument( QObject::tr("Project file loading failed.").toStdString() );
+            }
+            _imp->loadedProject = projectFile;
+            _imp->loadedProjectLastModified = info.lastModified();
+            _imp->loadedProjectChanged = false;
+        }
+
+        for (int i = 5; i < fields.size(); ++i) {
+            if ( fields[i].isEmpty() ) {
+                continue;
+            }
+            _imp->loadedProjectChanged = true;
+            std::string err;
+            if ( !Natron::interpretPythonScript(fields[i].toStdString() + '\n', &err, 0) ) {
+                throw std::runtime_error(err);
+            }
+        }
+
+        JobRender render;
+        render.app = _imp->app;
+        render.succeeded = false;
+        if ( !fields[2].isEmpty() ) {
+            AppInstance::RenderRequest r;
+            r.writerName = fields[2];
+            r.firstFrame = parseFrame(fields[3], INT_MIN);
+            r.lastFrame = parseFrame(fields[4], INT_MAX);
+            render.requests.push_back(r);
+        }
+
+        ///Make sure the hash of the nodes reflects the Python lines run above, this has to be done on the main thread
+        _imp->app->processPendingEvaluations();
+
+        ///The render threads queue their messages to this thread: run the event loop until the render is done
+        QFutureWatcher<void> watcher;
+        QEventLoop loop;
+        QObject::connect( &watcher, SIGNAL( finished() ), &loop, SLOT( quit() ) );
+        watcher.setFuture( QtConcurrent::run(renderJob, &render) );
+        loop.exec();
+        if (!render.succeeded) {
+            throw std::runtime_error(render.error);
+        }
+    } catch (const std::exception & e) {
+        writeToClient( QString(kRenderServerJobFailedShort) + ' ' + QString( e.what() ).replace('\n', ' ') );
+
+        return;
+    }
+
+    QMutexLocker k(&_imp->clientMutex);
+    double elapsed = _imp->jobTimer->getTimeSinceCreation();
+    k.unlock();
+    writeToClient( QString(kRenderServerJobFinishedShort) + ' ' + QString::number(elapsed) );
+}
+
+bool
+RenderServer::writeToClient(const QString & message)
+{
+    QMutexLocker k(&_imp->clientMutex);
+
+    if (!_imp->client) {
+        return false;
+    }
+    QString line = message;
+    if ( message.startsWith(kFrameRenderedStringShort) ) {
+        line += ' ' + QString::number( _imp->frameTimer->getTimeElapsedReset() );
+    }
+    if ( QThread::currentThread() != _imp->client->thread() ) {
+        _imp->pendingLines.push_back(line);
+        QMetaObject::invokeMethod(this, "onClientMessagesQueued", Qt::QueuedConnection);
+
+        return true;
+    }
+    ///Keep the order of the messages: the ones queued by the render threads were written before this one
+    _imp->pendingLines.push_back(line);
+    writePendingLines();
+
+    return true;
+}
+
+void
+RenderServer::onClientMessagesQueued()
+{
+    QMutexLocker k(&_imp->clientMutex);
+
+    writePendingLines();
+}
+
+void
+RenderServer::writePendingLines()
+{
+    if (!_imp->client) {
+        _imp->pendingLines.clear();
+
+        return;
+    }
+    for (QStringList::const_iterator it = _imp->pendingLines.begin(); it != _imp->pendingLines.end(); ++it) {
+        _imp->client->write( (*it + '\n').toUtf8() );
+    }
+    _imp->pendingLines.clear();
+    _imp->client->flush();
+}
@@ -0,0 +1,97 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_RENDERSERVER_H_
+#define NATRON_ENGINE_RENDERSERVER_H_
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include <string>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+#include <QObject>
+#include <QString>
+
+#include "Global/Macros.h"
+
+class AppInstance;
+class QLocalSocket;
+
+/**
+ * @brief Keeps a background app resident to render the jobs sent by clients over a local socket (NatronRenderer --server <name>),
+ * so that the plug-ins, Python and the image cache are loaded once for all the jobs.
+ *
+ * As for the ProcessHandler, each message is exactly 1 line.
+ * Client to server:
+ * - kRenderServerJobShort followed by tab separated fields: the project file path, the script-name of the writer to render
+ * (empty to render all the writers of the project with their own frame range), the first and last frames (empty to use the
+ * frame range of the writer) then any number of Python lines to run once the project is loaded, e.g: app.Blur1.size.set(5)
+ * - kRenderServerQuitShort to stop the server
+ * Server to client, while a job renders:
+ * - kRenderingStartedShort, then kFrameRenderedStringShort followed by the frame and the seconds elapsed since the previous
+ * frame, kRenderingFinishedStringShort for each writer
+ * - kRenderServerJobFinishedShort followed by the seconds spent on the job, or kRenderServerJobFailedShort followed by the error
+ * if the job could not be started or the render of a writer was aborted or failed.
+ *
+ * The project of the last job stays loaded: it is not read again for a job on the same unmodified file, unless Python lines
+ * were run on it. The images cached by the previous jobs are kept.
+ **/
+struct RenderServerPrivate;
+class RenderServer
+    : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    RenderServer(AppInstance* app,
+                 const QString & serverName);
+
+    ~RenderServer();
+
+    /**
+     * @brief Creates the local server, returns false and sets error if it could not be created.
+     **/
+    bool listen(std::string* error);
+
+    /**
+     * @brief Serves the clients one after the other until one of them sends kRenderServerQuitShort or quit() is called.
+     **/
+    void exec();
+
+    /**
+     * @brief Makes exec() return, this can be called from a signal handler.
+     **/
+    static void quit();
+
+    /**
+     * @brief Sends a message to the client of the job being rendered, this is thread-safe: the messages of the render
+     * threads are queued to the thread of the socket. Returns false if no job is being rendered.
+     **/
+    bool writeToClient(const QString & message);
+
+private Q_SLOTS:
+
+    ///Writes the messages queued by writeToClient() on the thread of the socket
+    void onClientMessagesQueued();
+
+private:
+
+    void serveClient(QLocalSocket* socket);
+
+    void processJob(const QString & job);
+
+    ///Writes the lines of pendingLines to the client, clientMutex must be locked
+    void writePendingLines();
+
+    boost::scoped_ptr<RenderServerPrivate> _imp;
+};
+
+#endif // NATRON_ENGINE_RENDERSERVER_H_
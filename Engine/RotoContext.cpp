@@ -5356,6 +5356,8 @@ RotoContext::selectInternal(const boost::shared_ptr<RotoItem> & item)
                     
                     QObject::connect((*it)->getSignalSlotHandler().get(), SIGNAL(keyFrameSet(SequenceTime,int,int,bool)),
                                      this, SLOT(onSelectedKnobCurveChanged()));
+                    QObject::connect((*it)->getSignalSlotHandler().get(), SIGNAL(multipleKeyFramesSet(std::list<SequenceTime>,int,int)),
+                                     this, SLOT(onSelectedKnobCurveChanged()));
                     QObject::connect((*it)->getSignalSlotHandler().get(), SIGNAL(keyFrameRemoved(SequenceTime,int,int)),
                                      this, SLOT(onSelectedKnobCurveChanged()));
                     QObject::connect((*it)->getSignalSlotHandler().get(), SIGNAL(keyFrameMoved(int,int,int)),
@@ -5468,6 +5470,8 @@ RotoContext::deselectInternal(boost::shared_ptr<RotoItem> b)
                     
                     QObject::disconnect((*it)->getSignalSlotHandler().get(), SIGNAL(keyFrameSet(SequenceTime,int,int,bool)),
                                      this, SLOT(onSelectedKnobCurveChanged()));
+                    QObject::disconnect((*it)->getSignalSlotHandler().get(), SIGNAL(multipleKeyFramesSet(std::list<SequenceTime>,int,int)),
+                                     this, SLOT(onSelectedKnobCurveChanged()));
                     QObject::disconnect((*it)->getSignalSlotHandler().get(), SIGNAL(keyFrameRemoved(SequenceTime,int,int)),
                                      this, SLOT(onSelectedKnobCurveChanged()));
                     QObject::disconnect((*it)->getSignalSlotHandler().get(), SIGNAL(keyFrameMoved(int,int,int)),
@@ -5877,7 +5881,9 @@ void
 RotoContext::evaluateChange()
 {
     _imp->incrementRotoAge();
-    getNode()->getLiveInstance()->evaluate_public(NULL, true,Natron::eValueChangedReasonUserEdited);
+    boost::shared_ptr<Natron::Node> node = getNode();
+    node->getApp()->getProject()->markNodeModified(node);
+    node->getLiveInstance()->evaluate_public(NULL, true,Natron::eValueChangedReasonUserEdited);
 }
 
 U64
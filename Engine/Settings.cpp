@@ -30,6 +30,7 @@
 #include "Engine/Project.h"
 #include "Engine/Plugin.h"
 #include "Engine/Node.h"
+#include "Engine/RenderPriority.h"
 #include "Engine/ViewerInstance.h"
 #include "Engine/StandardPaths.h"
 #include "SequenceParsing.h"
@@ -111,6 +112,26 @@ Settings::initializeKnobs()
                                    " auto-saving. Note that if a render is in progress, " NATRON_APPLICATION_NAME " will "
                                    " wait until it is done to actually auto-save.");
     _generalTab->addKnob(_autoSaveDelay);
+    
+    _incrementalSaves = Natron::createKnob<Bool_Knob>(this, "Incremental saves");
+    _incrementalSaves->setName("incrementalSaves");
+    _incrementalSaves->setAnimationEnabled(false);
+    _incrementalSaves->setHintToolTip("When checked, saving a project that was already saved only appends the nodes "
+                                      "that were modified since the last save to a journal file next to the project file, "
+                                      "instead of rewriting the whole project. The journal is merged back into the project "
+                                      "file when it gets too long, or when nodes are created, removed or renamed. "
+                                      "Auto-saves are not affected by this option.");
+    _generalTab->addKnob(_incrementalSaves);
+    
+    _maxJournalRecords = Natron::createKnob<Int_Knob>(this, "Max. journal entries");
+    _maxJournalRecords->setName("maxJournalRecords");
+    _maxJournalRecords->setAnimationEnabled(false);
+    _maxJournalRecords->disableSlider();
+    _maxJournalRecords->setMinimum(1);
+    _maxJournalRecords->setMaximum(1000);
+    _maxJournalRecords->setHintToolTip("When incremental saves are enabled, this is the number of incremental saves after which "
+                                       "the whole project is saved again and the journal file is removed.");
+    _generalTab->addKnob(_maxJournalRecords);
 
 
     _linearPickers = Natron::createKnob<Bool_Knob>(this, "Linear color pickers");
@@ -172,6 +193,37 @@ Settings::initializeKnobs()
     _nThreadsPerEffect->setMinimum(0);
     _nThreadsPerEffect->disableSlider();
     _generalTab->addKnob(_nThreadsPerEffect);
+    
+    _renderPriorities = Natron::createKnob<Bool_Knob>(this, "Viewer renders have priority");
+    _renderPriorities->setName("renderPriorities");
+    _renderPriorities->setAnimationEnabled(false);
+    _renderPriorities->setHintToolTip("When checked, renders are given a priority: interactive viewer renders first, then "
+                                      "playback, previews and finally writers. While a render of a higher priority is running, "
+                                      "renders of a lower priority wait before rendering each tile so that it can use "
+                                      "the cores of the computer. This keeps the viewer responsive while a writer is rendering.");
+    _generalTab->addKnob(_renderPriorities);
+    
+    _numaAwareRendering = Natron::createKnob<Bool_Knob>(this, "NUMA-aware rendering");
+    _numaAwareRendering->setName("numaAwareRendering");
+    _numaAwareRendering->setAnimationEnabled(false);
+    _numaAwareRendering->setHintToolTip("On computers with several processor sockets (NUMA nodes), each frame of a "
+                                        "playback or of a writer render is rendered on the cores of a single socket, "
+                                        "and the images it renders are allocated in the memory attached to that socket. "
+                                        "This avoids reading images through the slower link between the sockets. "
+                                        "This has no effect on computers with a single socket and is only supported on Linux.");
+    _generalTab->addKnob(_numaAwareRendering);
+    
+    _speculativeFrames = Natron::createKnob<Int_Knob>(this, "Frames prerendered while idle");
+    _speculativeFrames->setName("speculativeFrames");
+    _speculativeFrames->setAnimationEnabled(false);
+    _speculativeFrames->setHintToolTip("When the viewer is idle, the frames that follow the current frame in the direction "
+                                       "the timeline was last moved are rendered in the viewer cache, so that they are "
+                                       "displayed immediately when stepping to them. These renders stop as soon as another "
+                                       "render starts. This is the number of frames rendered ahead, 0 disables it.");
+    _speculativeFrames->setMinimum(0);
+    _speculativeFrames->setMaximum(16);
+    _speculativeFrames->disableSlider();
+    _generalTab->addKnob(_speculativeFrames);
 
     _renderInSeparateProcess = Natron::createKnob<Bool_Knob>(this, "Render in a separate process");
     _renderInSeparateProcess->setName("renderNewProcess");
@@ -180,6 +232,16 @@ Settings::initializeKnobs()
                                              "a separate process so that if the main application crashes, the render goes on.");
     _generalTab->addKnob(_renderInSeparateProcess);
 
+    _numberOfRenderProcesses = Natron::createKnob<Int_Knob>(this, "Number of render processes");
+    _numberOfRenderProcesses->setName("nRenderProcesses");
+    _numberOfRenderProcesses->setAnimationEnabled(false);
+    _numberOfRenderProcesses->setHintToolTip("When rendering in a separate process, the frame range of a writer is split in chunks "
+                                             "rendered by this many processes. A process is given a new chunk whenever it finishes one. "
+                                             "On Linux, when numactl is installed, each process is bound to a NUMA node.");
+    _numberOfRenderProcesses->setMinimum(1);
+    _numberOfRenderProcesses->disableSlider();
+    _generalTab->addKnob(_numberOfRenderProcesses);
+
     _autoPreviewEnabledForNewProjects = Natron::createKnob<Bool_Knob>(this, "Auto-preview enabled by default for new projects");
     _autoPreviewEnabledForNewProjects->setName("enableAutoPreviewNewProjects");
     _autoPreviewEnabledForNewProjects->setAnimationEnabled(false);
@@ -202,6 +264,15 @@ Settings::initializeKnobs()
     _fixPathsOnProjectPathChanged->setName("autoFixRelativePaths");
     _generalTab->addKnob(_fixPathsOnProjectPathChanged);
     
+    _loadGroupsOnDemand = Natron::createKnob<Bool_Knob>(this, "Load groups on demand");
+    _loadGroupsOnDemand->setAnimationEnabled(false);
+    _loadGroupsOnDemand->setHintToolTip("If checked, when a project is opened the nodes inside of groups are only created when the group "
+                                        "is opened, edited or needed to render a viewer or a writer. This speeds up the loading of projects "
+                                        "containing many groups. Groups referenced by expressions or links and groups containing viewers or "
+                                        "writers are always loaded.");
+    _loadGroupsOnDemand->setName("loadGroupsOnDemand");
+    _generalTab->addKnob(_loadGroupsOnDemand);
+    
     _maxPanelsOpened = Natron::createKnob<Int_Knob>(this, "Maximum number of open settings panels (0=\"unlimited\")");
     _maxPanelsOpened->setName("maxPanels");
     _maxPanelsOpened->setHintToolTip("This property holds the maximum number of settings panels that can be "
@@ -257,6 +328,17 @@ Settings::initializeKnobs()
     _activateTransformConcatenationSupport->setAnimationEnabled(false);
     _activateTransformConcatenationSupport->setName("transformCatSupport");
     _generalTab->addKnob(_activateTransformConcatenationSupport);
+
+    _activateColorConcatenationSupport = Natron::createKnob<Bool_Knob>(this, "Color operations concatenation support");
+    _activateColorConcatenationSupport->setHintToolTip("When checked " NATRON_APPLICATION_NAME " is able to concatenate color effects "
+                                                       "that describe their operation when they are chained in the compositing tree. "
+                                                       "Their operations are merged together and applied in a single pass over the input "
+                                                       "instead of rendering an image for each of them. Only enable this if "
+                                                       "the color plug-ins you use support it: otherwise it only adds an action "
+                                                       "call to each render.");
+    _activateColorConcatenationSupport->setAnimationEnabled(false);
+    _activateColorConcatenationSupport->setName("colorCatSupport");
+    _generalTab->addKnob(_activateColorConcatenationSupport);
     
     
     _hostName = Natron::createKnob<String_Knob>(this, "Host name");
@@ -838,6 +920,36 @@ Settings::initializeKnobs()
     _maxDiskCacheNodeGB->setHintToolTip("The maximum size that may be used by the DiskCache node on disk (in GiB)");
     _cachingTab->addKnob(_maxDiskCacheNodeGB);
 
+    _diskCacheCodec = Natron::createKnob<Choice_Knob>(this, "Disk cache compression");
+    _diskCacheCodec->setName("diskCacheCompression");
+    _diskCacheCodec->setAnimationEnabled(false);
+    std::vector<std::string> codecs;
+    std::vector<std::string> helpStringsCodecs;
+    codecs.push_back("None");
+    helpStringsCodecs.push_back("Images are written to disk as is. This is the fastest to write but uses the most disk space "
+                                "and disk bandwidth.");
+    codecs.push_back("LZ4");
+    helpStringsCodecs.push_back("Images are compressed with LZ4, which is fast enough to decode that reading back cached frames "
+                                "is usually faster than reading them uncompressed.");
+    codecs.push_back("Deflate");
+    helpStringsCodecs.push_back("Images are compressed with zlib. They are smaller than with LZ4 but slower to decode.");
+    _diskCacheCodec->populateChoices(codecs,helpStringsCodecs);
+    _diskCacheCodec->setHintToolTip("How the images are compressed when they are written to the disk portion of the caches "
+                                    "(the playback cache and the DiskCache node). The compression is lossless. "
+                                    "The images already on disk are not affected by a change of this parameter. "
+                                    "The compression statistics are shown with the cache size in the node graph.");
+    _cachingTab->addKnob(_diskCacheCodec);
+
+    _diskCacheHalfFloat = Natron::createKnob<Bool_Knob>(this, "Store 32-bit playback frames as half-float");
+    _diskCacheHalfFloat->setName("diskCacheHalfFloat");
+    _diskCacheHalfFloat->setAnimationEnabled(false);
+    _diskCacheHalfFloat->setHintToolTip("When checked and disk cache compression is enabled, the 32-bit floating-point viewer "
+                                        "textures written to the disk portion of the playback cache are stored as 16-bit "
+                                        "half-floats. This halves their size but loses precision: the textures are only "
+                                        "displayed, so this is not visible unless the viewer gain or gamma is pushed far. "
+                                        "Images cached by the DiskCache node are never converted.");
+    _cachingTab->addKnob(_diskCacheHalfFloat);
+
 
     _diskCachePath = Natron::createKnob<Path_Knob>(this, "Disk cache path (empty = default)");
     _diskCachePath->setName("diskCachePath");
@@ -1008,6 +1120,8 @@ Settings::setDefaultValues()
     _checkForUpdates->setDefaultValue(false);
     _notifyOnFileChange->setDefaultValue(true);
     _autoSaveDelay->setDefaultValue(5, 0);
+    _incrementalSaves->setDefaultValue(false);
+    _maxJournalRecords->setDefaultValue(50, 0);
     _maxUndoRedoNodeGraph->setDefaultValue(20, 0);
     _linearPickers->setDefaultValue(true,0);
     _snapNodesToConnections->setDefaultValue(true);
@@ -1017,15 +1131,21 @@ Settings::setDefaultValues()
     _numberOfParallelRenders->setDefaultValue(0,0);
     _useThreadPool->setDefaultValue(true);
     _nThreadsPerEffect->setDefaultValue(0);
+    _renderPriorities->setDefaultValue(true);
+    _numaAwareRendering->setDefaultValue(true);
+    _speculativeFrames->setDefaultValue(2,0);
     _renderInSeparateProcess->setDefaultValue(false,0);
+    _numberOfRenderProcesses->setDefaultValue(1,0);
     _autoPreviewEnabledForNewProjects->setDefaultValue(true,0);
     _firstReadSetProjectFormat->setDefaultValue(true);
     _fixPathsOnProjectPathChanged->setDefaultValue(true);
+    _loadGroupsOnDemand->setDefaultValue(false);
     _maxPanelsOpened->setDefaultValue(10,0);
     _useCursorPositionIncrements->setDefaultValue(true);
     _renderOnEditingFinished->setDefaultValue(false);
     _activateRGBSupport->setDefaultValue(true);
     _activateTransformConcatenationSupport->setDefaultValue(true);
+    _activateColorConcatenationSupport->setDefaultValue(false);
     _extraPluginPaths->setDefaultValue("",0);
     _preferBundledPlugins->setDefaultValue(true);
     _loadBundledPlugins->setDefaultValue(true);
@@ -1051,6 +1171,8 @@ Settings::setDefaultValues()
     _unreachableRAMPercent->setDefaultValue(5);
     _maxViewerDiskCacheGB->setDefaultValue(5,0);
     _maxDiskCacheNodeGB->setDefaultValue(10,0);
+    _diskCacheCodec->setDefaultValue(0,0);
+    _diskCacheHalfFloat->setDefaultValue(false);
     setCachingLabels();
     _autoTurbo->setDefaultValue(false);
     _usePluginIconsInNodeGraph->setDefaultValue(true);
@@ -1454,6 +1576,8 @@ Settings::restoreSettings()
         appPTR->setNThreadsPerEffect(getNumberOfThreadsPerEffect());
         appPTR->setNThreadsToRender(getNumberOfThreads());
         appPTR->setUseThreadPool(_useThreadPool->getValue());
+        appPTR->getRenderPriorityArbiter()->setEnabled( _renderPriorities->getValue() );
+        appPTR->setNumaAwareRenderingEnabled( _numaAwareRendering->getValue() );
     } catch (std::logic_error) {
         // ignore
     }
@@ -1553,6 +1677,10 @@ Settings::onKnobValueChanged(KnobI* k,
         if (!_restoringSettings) {
             appPTR->setApplicationsCachesMaximumDiskSpace(getMaximumDiskCacheNodeSize());
         }
+    } else if ( ( k == _diskCacheCodec.get() ) || ( k == _diskCacheHalfFloat.get() ) ) {
+        if (!_restoringSettings) {
+            appPTR->setApplicationsCachesCompression( getDiskCacheCodec(), isPlaybackDiskCacheHalfFloatEnabled() );
+        }
     } else if ( k == _maxRAMPercent.get() ) {
         if (!_restoringSettings) {
             appPTR->setApplicationsCachesMaximumMemoryPercent( getRamMaximumPercent() );
@@ -1589,6 +1717,10 @@ Settings::onKnobValueChanged(KnobI* k,
     } else if ( k == _useThreadPool.get() ) {
         bool useTP = _useThreadPool->getValue();
         appPTR->setUseThreadPool(useTP);
+    } else if ( k == _renderPriorities.get() ) {
+        appPTR->getRenderPriorityArbiter()->setEnabled( _renderPriorities->getValue() );
+    } else if ( k == _numaAwareRendering.get() ) {
+        appPTR->setNumaAwareRenderingEnabled( _numaAwareRendering->getValue() );
     } else if ( k == _customOcioConfigFile.get() ) {
         if (_customOcioConfigFile->isEnabled(0)) {
             tryLoadOpenColorIOConfig();
@@ -1669,6 +1801,18 @@ Settings::getMaximumDiskCacheNodeSize() const
     return (U64)( _maxDiskCacheNodeGB->getValue() ) * std::pow(1024.,3.);
 }
 
+Natron::CacheCodecEnum
+Settings::getDiskCacheCodec() const
+{
+    return (Natron::CacheCodecEnum)_diskCacheCodec->getValue();
+}
+
+bool
+Settings::isPlaybackDiskCacheHalfFloatEnabled() const
+{
+    return _diskCacheHalfFloat->getValue();
+}
+
 double
 Settings::getUnreachableRamPercent() const
 {
@@ -1687,6 +1831,24 @@ Settings::getNumberOfThreadsPerEffect() const
     return _nThreadsPerEffect->getValue();
 }
 
+bool
+Settings::isRenderPrioritiesEnabled() const
+{
+    return _renderPriorities->getValue();
+}
+
+bool
+Settings::isNumaAwareRenderingEnabled() const
+{
+    return _numaAwareRendering->getValue();
+}
+
+int
+Settings::getNumberOfSpeculativeFrames() const
+{
+    return _speculativeFrames->getValue();
+}
+
 int
 Settings::getNumberOfThreads() const
 {
@@ -2119,6 +2281,12 @@ Settings::isRenderInSeparatedProcessEnabled() const
     return _renderInSeparateProcess->getValue();
 }
 
+int
+Settings::getNumberOfRenderProcesses() const
+{
+    return _numberOfRenderProcesses->getValue();
+}
+
 int
 Settings::getMaximumUndoRedoNodeGraph() const
 {
@@ -2131,6 +2299,18 @@ Settings::getAutoSaveDelayMS() const
     return _autoSaveDelay->getValue() * 1000;
 }
 
+bool
+Settings::isIncrementalSaveEnabled() const
+{
+    return _incrementalSaves->getValue();
+}
+
+int
+Settings::getMaxJournalRecords() const
+{
+    return _maxJournalRecords->getValue();
+}
+
 bool
 Settings::isSnapToNodeEnabled() const
 {
@@ -2390,6 +2570,12 @@ Settings::isAutoFixRelativeFilePathEnabled() const
     return _fixPathsOnProjectPathChanged->getValue();
 }
 
+bool
+Settings::isLoadGroupsOnDemandEnabled() const
+{
+    return _loadGroupsOnDemand->getValue();
+}
+
 int
 Settings::getCheckerboardTileSize() const
 {
@@ -2438,6 +2624,12 @@ Settings::isTransformConcatenationEnabled() const
     return _activateTransformConcatenationSupport->getValue();
 }
 
+bool
+Settings::isColorConcatenationEnabled() const
+{
+    return _activateColorConcatenationSupport->getValue();
+}
+
 bool
 Settings::useGlobalThreadPool() const
 {
@@ -23,6 +23,7 @@
 #include "Global/Macros.h"
 #include "Global/GlobalDefines.h"
 
+#include "Engine/CacheCodec.h"
 #include "Engine/Knob.h"
 
 #define kQSettingsSoftwareMajorVersionSettingName "SoftwareVersionMajor"
@@ -84,6 +85,10 @@ public:
     
     U64 getMaximumDiskCacheNodeSize() const;
 
+    Natron::CacheCodecEnum getDiskCacheCodec() const;
+
+    bool isPlaybackDiskCacheHalfFloatEnabled() const;
+
     double getUnreachableRamPercent() const;
 
     bool getColorPickerLinear() const;
@@ -98,6 +103,12 @@ public:
     
     int getNumberOfThreadsPerEffect() const;
     
+    bool isRenderPrioritiesEnabled() const;
+    
+    bool isNumaAwareRenderingEnabled() const;
+    
+    int getNumberOfSpeculativeFrames() const;
+    
     bool useGlobalThreadPool() const;
     
     void setUseGlobalThreadPool(bool use) ;
@@ -140,11 +151,17 @@ public:
 
     bool isRenderInSeparatedProcessEnabled() const;
 
+    int getNumberOfRenderProcesses() const;
+
     void restoreDefault();
 
     int getMaximumUndoRedoNodeGraph() const;
 
     int getAutoSaveDelayMS() const;
+    
+    bool isIncrementalSaveEnabled() const;
+    
+    int getMaxJournalRecords() const;
 
     bool isSnapToNodeEnabled() const;
 
@@ -198,6 +215,8 @@ public:
     
     bool isAutoFixRelativeFilePathEnabled() const;
     
+    bool isLoadGroupsOnDemandEnabled() const;
+    
     int getCheckerboardTileSize() const;
     void getCheckerboardColor1(double* r,double* g,double* b,double* a) const;
     void getCheckerboardColor2(double* r,double* g,double* b,double* a) const;
@@ -205,6 +224,8 @@ public:
     bool areRGBPixelComponentsSupported() const;
     
     bool isTransformConcatenationEnabled() const;
+
+    bool isColorConcatenationEnabled() const;
     
     bool isMergeAutoConnectingToAInput() const;
     
@@ -297,21 +318,29 @@ private:
     boost::shared_ptr<Bool_Knob> _checkForUpdates;
     boost::shared_ptr<Bool_Knob> _notifyOnFileChange;
     boost::shared_ptr<Int_Knob> _autoSaveDelay;
+    boost::shared_ptr<Bool_Knob> _incrementalSaves;
+    boost::shared_ptr<Int_Knob> _maxJournalRecords;
     boost::shared_ptr<Bool_Knob> _linearPickers;
     boost::shared_ptr<Int_Knob> _numberOfThreads;
     boost::shared_ptr<Int_Knob> _numberOfParallelRenders;
     boost::shared_ptr<Bool_Knob> _useThreadPool;
     boost::shared_ptr<Int_Knob> _nThreadsPerEffect;
+    boost::shared_ptr<Bool_Knob> _renderPriorities;
+    boost::shared_ptr<Bool_Knob> _numaAwareRendering;
+    boost::shared_ptr<Int_Knob> _speculativeFrames;
     boost::shared_ptr<Bool_Knob> _renderInSeparateProcess;
+    boost::shared_ptr<Int_Knob> _numberOfRenderProcesses;
     boost::shared_ptr<Bool_Knob> _autoPreviewEnabledForNewProjects;
     boost::shared_ptr<Bool_Knob> _firstReadSetProjectFormat;
     boost::shared_ptr<Bool_Knob> _fixPathsOnProjectPathChanged;
+    boost::shared_ptr<Bool_Knob> _loadGroupsOnDemand;
     boost::shared_ptr<Int_Knob> _maxPanelsOpened;
     boost::shared_ptr<Bool_Knob> _useCursorPositionIncrements;
     boost::shared_ptr<File_Knob> _defaultLayoutFile;
     boost::shared_ptr<Bool_Knob> _renderOnEditingFinished;
     boost::shared_ptr<Bool_Knob> _activateRGBSupport;
     boost::shared_ptr<Bool_Knob> _activateTransformConcatenationSupport;
+    boost::shared_ptr<Bool_Knob> _activateColorConcatenationSupport;
     boost::shared_ptr<String_Knob> _hostName;
     boost::shared_ptr<Choice_Knob> _ocioConfigKnob;
     boost::shared_ptr<Bool_Knob> _warnOcioConfigKnobChanged;
@@ -342,6 +371,8 @@ private:
     boost::shared_ptr<Int_Knob> _maxViewerDiskCacheGB;
     boost::shared_ptr<Int_Knob> _maxDiskCacheNodeGB;
     boost::shared_ptr<Path_Knob> _diskCachePath;
+    boost::shared_ptr<Choice_Knob> _diskCacheCodec;
+    boost::shared_ptr<Bool_Knob> _diskCacheHalfFloat;
     
     boost::shared_ptr<Page_Knob> _viewersTab;
     boost::shared_ptr<Choice_Knob> _texturesMode;
@@ -26,6 +26,8 @@
 TimeLine::TimeLine(Natron::Project* project)
 : _currentFrame(1)
 , _keyframes()
+, _keyframesChangesBracket(0)
+, _keyframesChangedInBracket(false)
 , _project(project)
 {
 }
@@ -108,6 +110,38 @@ TimeLine::onFrameChanged(SequenceTime frame)
     }
 }
 
+void
+TimeLine::notifyKeyframeIndicatorsChanged()
+{
+    if (_keyframesChangesBracket > 0) {
+        _keyframesChangedInBracket = true;
+    } else {
+        Q_EMIT keyframeIndicatorsChanged();
+    }
+}
+
+void
+TimeLine::beginKeyframeIndicatorsChanges()
+{
+    ///runs only in the main thread
+    assert( QThread::currentThread() == qApp->thread() );
+
+    ++_keyframesChangesBracket;
+}
+
+void
+TimeLine::endKeyframeIndicatorsChanges()
+{
+    ///runs only in the main thread
+    assert( QThread::currentThread() == qApp->thread() );
+    assert(_keyframesChangesBracket > 0);
+
+    if (--_keyframesChangesBracket == 0 && _keyframesChangedInBracket) {
+        _keyframesChangedInBracket = false;
+        Q_EMIT keyframeIndicatorsChanged();
+    }
+}
+
 void
 TimeLine::removeAllKeyframesIndicators()
 {
@@ -117,7 +151,7 @@ TimeLine::removeAllKeyframesIndicators()
     bool wasEmpty = _keyframes.empty();
     _keyframes.clear();
     if (!wasEmpty) {
-        Q_EMIT keyframeIndicatorsChanged();
+        notifyKeyframeIndicatorsChanged();
     }
 }
 
@@ -127,8 +161,8 @@ TimeLine::addKeyframeIndicator(SequenceTime time)
     ///runs only in the main thread
     assert( QThread::currentThread() == qApp->thread() );
 
-    _keyframes.push_back(time);
-    Q_EMIT keyframeIndicatorsChanged();
+    ++_keyframes[time];
+    notifyKeyframeIndicatorsChanged();
 }
 
 void
@@ -138,9 +172,14 @@ TimeLine::addMultipleKeyframeIndicatorsAdded(const std::list<SequenceTime> & key
     ///runs only in the main thread
     assert( QThread::currentThread() == qApp->thread() );
 
-    _keyframes.insert( _keyframes.begin(),keys.begin(),keys.end() );
+    ///Keys are mostly given in increasing order, hint the insertion with the previous position
+    KeyframeIndicators::iterator hint = _keyframes.begin();
+    for (std::list<SequenceTime>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        hint = _keyframes.insert( hint, std::make_pair(*it, 0) );
+        ++hint->second;
+    }
     if (!keys.empty() && emitSignal) {
-        Q_EMIT keyframeIndicatorsChanged();
+        notifyKeyframeIndicatorsChanged();
     }
 }
 
@@ -150,10 +189,12 @@ TimeLine::removeKeyFrameIndicator(SequenceTime time)
     ///runs only in the main thread
     assert( QThread::currentThread() == qApp->thread() );
 
-    std::list<SequenceTime>::iterator it = std::find(_keyframes.begin(), _keyframes.end(), time);
+    KeyframeIndicators::iterator it = _keyframes.find(time);
     if ( it != _keyframes.end() ) {
-        _keyframes.erase(it);
-        Q_EMIT keyframeIndicatorsChanged();
+        if (--it->second == 0) {
+            _keyframes.erase(it);
+        }
+        notifyKeyframeIndicatorsChanged();
     }
 }
 
@@ -165,13 +206,15 @@ TimeLine::removeMultipleKeyframeIndicator(const std::list<SequenceTime> & keys,
     assert( QThread::currentThread() == qApp->thread() );
 
     for (std::list<SequenceTime>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
-        std::list<SequenceTime>::iterator it2 = std::find(_keyframes.begin(), _keyframes.end(), *it);
+        KeyframeIndicators::iterator it2 = _keyframes.find(*it);
         if ( it2 != _keyframes.end() ) {
-            _keyframes.erase(it2);
+            if (--it2->second == 0) {
+                _keyframes.erase(it2);
+            }
         }
     }
     if (!keys.empty() && emitSignal) {
-        Q_EMIT keyframeIndicatorsChanged();
+        notifyKeyframeIndicatorsChanged();
     }
 }
 
@@ -181,18 +224,11 @@ TimeLine::addNodesKeyframesToTimeline(const std::list<Natron::Node*> & nodes)
     ///runs only in the main thread
     assert( QThread::currentThread() == qApp->thread() );
 
-    std::list<Natron::Node*>::const_iterator next = nodes.begin();
-    if (next != nodes.end()) {
-        ++next;
-    }
+    beginKeyframeIndicatorsChanges();
     for (std::list<Natron::Node*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
-        (*it)->showKeyframesOnTimeline( next == nodes.end() );
-
-        // increment for next iteration
-        if (next != nodes.end()) {
-            ++next;
-        }
-    } // for()
+        (*it)->showKeyframesOnTimeline(true);
+    }
+    endKeyframeIndicatorsChanges();
 }
 
 void
@@ -210,18 +246,11 @@ TimeLine::removeNodesKeyframesFromTimeline(const std::list<Natron::Node*> & node
     ///runs only in the main thread
     assert( QThread::currentThread() == qApp->thread() );
 
-    std::list<Natron::Node*>::const_iterator next = nodes.begin();
-    if (next != nodes.end()) {
-        ++next;
-    }
+    beginKeyframeIndicatorsChanges();
     for (std::list<Natron::Node*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
-        (*it)->hideKeyframesFromTimeline( next == nodes.end() );
-
-        // increment for next iteration
-        if (next != nodes.end()) {
-            ++next;
-        }
-    } // for(it)
+        (*it)->hideKeyframesFromTimeline(true);
+    }
+    endKeyframeIndicatorsChanges();
 }
 
 void
@@ -239,7 +268,19 @@ TimeLine::getKeyframes(std::list<SequenceTime>* keys) const
     ///runs only in the main thread
     assert( QThread::currentThread() == qApp->thread() );
 
-    *keys = _keyframes;
+    keys->clear();
+    for (KeyframeIndicators::const_iterator it = _keyframes.begin(); it != _keyframes.end(); ++it) {
+        keys->push_back(it->first);
+    }
+}
+
+bool
+TimeLine::hasKeyframeIndicator(SequenceTime time) const
+{
+    ///runs only in the main thread
+    assert( QThread::currentThread() == qApp->thread() );
+
+    return _keyframes.find(time) != _keyframes.end();
 }
 
 void
@@ -248,11 +289,10 @@ TimeLine::goToPreviousKeyframe()
     ///runs only in the main thread
     assert( QThread::currentThread() == qApp->thread() );
 
-    _keyframes.sort();
-    std::list<SequenceTime>::iterator lowerBound = std::lower_bound(_keyframes.begin(), _keyframes.end(), _currentFrame);
+    KeyframeIndicators::iterator lowerBound = _keyframes.lower_bound( currentFrame() );
     if ( lowerBound != _keyframes.begin() ) {
         --lowerBound;
-        seekFrame(*lowerBound, true, NULL, Natron::eTimelineChangeReasonPlaybackSeek);
+        seekFrame(lowerBound->first, true, NULL, Natron::eTimelineChangeReasonPlaybackSeek);
     }
 }
 
@@ -262,10 +302,9 @@ TimeLine::goToNextKeyframe()
     ///runs only in the main thread
     assert( QThread::currentThread() == qApp->thread() );
 
-    _keyframes.sort();
-    std::list<SequenceTime>::iterator upperBound = std::upper_bound(_keyframes.begin(), _keyframes.end(), _currentFrame);
+    KeyframeIndicators::iterator upperBound = _keyframes.upper_bound( currentFrame() );
     if ( upperBound != _keyframes.end() ) {
-        seekFrame(*upperBound, true, NULL, Natron::eTimelineChangeReasonPlaybackSeek);
+        seekFrame(upperBound->first, true, NULL, Natron::eTimelineChangeReasonPlaybackSeek);
     }
 }
 
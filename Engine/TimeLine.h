@@ -14,6 +14,7 @@
 #include <Python.h>
 
 #include <list>
+#include <map>
 #include "Global/Macros.h"
 CLANG_DIAG_OFF(deprecated)
 #include <QtCore/QMutex>
@@ -68,6 +69,14 @@ public:
 
     void removeMultipleKeyframeIndicator(const std::list<SequenceTime> & keys,bool emitSignal);
 
+    /**
+     * @brief Between these calls, the keyframeIndicatorsChanged signal is emitted only once, when the last
+     * endKeyframeIndicatorsChanges() is called, if the indicators changed. Calls can be nested.
+     **/
+    void beginKeyframeIndicatorsChanges();
+
+    void endKeyframeIndicatorsChanges();
+
     /**
      * @brief Show keyframe markers for the given nodes on the timeline. The signal to refresh the gui
      * will be emitted only once.
@@ -90,8 +99,13 @@ public:
      **/
     void removeNodeKeyframesFromTimeline(Natron::Node* node);
 
+    /**
+     * @brief Returns the times having at least one keyframe indicator, sorted and without duplicates.
+     **/
     void getKeyframes(std::list<SequenceTime>* keys) const;
 
+    bool hasKeyframeIndicator(SequenceTime time) const;
+
 public Q_SLOTS:
 
 
@@ -111,11 +125,17 @@ Q_SIGNALS:
 
 private:
     
+    void notifyKeyframeIndicatorsChanged();
+    
     mutable QMutex _lock; // protects the following SequenceTime members
     SequenceTime _currentFrame;
     
     // not MT-safe
-    std::list<SequenceTime> _keyframes;
+    ///Number of keyframe indicators at each time: several knobs may have a keyframe at the same time
+    typedef std::map<SequenceTime,int> KeyframeIndicators;
+    KeyframeIndicators _keyframes;
+    int _keyframesChangesBracket;
+    bool _keyframesChangedInBracket;
     Natron::Project* _project;
 };
 
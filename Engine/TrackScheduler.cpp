@@ -0,0 +1,598 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include "TrackScheduler.h"
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+CLANG_DIAG_OFF(deprecated)
+CLANG_DIAG_OFF(uninitialized)
+#include <QCoreApplication>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QtConcurrentRun>
+CLANG_DIAG_ON(deprecated)
+CLANG_DIAG_ON(uninitialized)
+
+#include <ofxNatron.h>
+
+#include "Engine/AppInstance.h"
+#include "Engine/AppManager.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Image.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
+#include "Engine/Project.h"
+#include "Engine/TimeLine.h"
+#include "Engine/Timer.h"
+
+///The maximum number of frames the images of the tracked clip are rendered ahead of the slowest track
+#define NATRON_TRACKER_RENDER_AHEAD 8
+
+using namespace Natron;
+
+namespace {
+
+struct TrackArgs
+{
+    int start,end;
+    bool forward;
+    std::list<Button_Knob*> instances;
+};
+
+struct TrackInstance
+{
+    Button_Knob* button;
+    std::string name;
+
+    ///Protected by trackMutex
+    int framesDone;
+    bool finished;
+    double fps;
+
+    TrackInstance()
+    : button(0)
+    , name()
+    , framesDone(0)
+    , finished(false)
+    , fps(0.)
+    {
+    }
+};
+
+}
+
+struct TrackSchedulerPrivate
+{
+    AppInstance* app;
+    const TrackerParamsProvider* provider;
+
+    QMutex argsMutex;
+    TrackArgs requestedArgs;
+
+    mutable QMutex mustQuitMutex;
+    bool mustQuit;
+    QWaitCondition mustQuitCond;
+
+    mutable QMutex abortRequestedMutex;
+    int abortRequested;
+    QWaitCondition abortRequestedCond;
+
+    QMutex startRequesstMutex;
+    int startRequests;
+    QWaitCondition startRequestsCond;
+
+    mutable QMutex isWorkingMutex;
+    bool isWorking;
+
+    ///Protects the progress of the tracks of the current tracking
+    QMutex trackMutex;
+    QWaitCondition trackCond;
+
+    mutable QMutex frameRatesMutex;
+    std::list<std::pair<std::string,double> > lastFrameRates;
+
+    TrackSchedulerPrivate(AppInstance* app,
+                          const TrackerParamsProvider* provider)
+    : app(app)
+    , provider(provider)
+    , argsMutex()
+    , requestedArgs()
+    , mustQuitMutex()
+    , mustQuit(false)
+    , mustQuitCond()
+    , abortRequestedMutex()
+    , abortRequested(0)
+    , abortRequestedCond()
+    , startRequesstMutex()
+    , startRequests(0)
+    , startRequestsCond()
+    , isWorkingMutex()
+    , isWorking(false)
+    , trackMutex()
+    , trackCond()
+    , frameRatesMutex()
+    , lastFrameRates()
+    {
+    }
+
+    bool checkForExit()
+    {
+        QMutexLocker k(&mustQuitMutex);
+        if (mustQuit) {
+            mustQuit = false;
+            mustQuitCond.wakeAll();
+            return true;
+        }
+        return false;
+    }
+
+    bool isAbortRequested() const
+    {
+        QMutexLocker k(&abortRequestedMutex);
+        return abortRequested > 0;
+    }
+
+    /**
+     * @brief Tracks the given instance from start to end, independently of the other tracks.
+     * This is run in a thread of the global thread pool.
+     **/
+    void trackInstance(TrackInstance* track,int start,int end,bool forward);
+
+    /**
+     * @brief Renders the image of the given input at the given time so that it is in the cache when the tracks
+     * need it.
+     **/
+    void renderInputImage(const boost::shared_ptr<Node>& input,const EffectInstance* tracker,int time);
+};
+
+void
+TrackSchedulerPrivate::trackInstance(TrackInstance* track,
+                                     int start,
+                                     int end,
+                                     bool forward)
+{
+    TimeLapse timer;
+    int cur = start;
+    int framesDone = 0;
+
+    while (cur != end) {
+        if ( isAbortRequested() ) {
+            break;
+        }
+
+        track->button->getHolder()->onKnobValueChanged_public(track->button,eValueChangedReasonNatronInternalEdited,cur,
+                                                              true);
+        if (forward) {
+            ++cur;
+        } else {
+            --cur;
+        }
+        ++framesDone;
+
+        QMutexLocker k(&trackMutex);
+        track->framesDone = framesDone;
+        trackCond.wakeAll();
+    }
+
+    double elapsed = timer.getTimeSinceCreation();
+
+    QMutexLocker k(&trackMutex);
+    track->fps = elapsed > 0. ? framesDone / elapsed : 0.;
+    track->finished = true;
+    trackCond.wakeAll();
+}
+
+void
+TrackSchedulerPrivate::renderInputImage(const boost::shared_ptr<Node>& input,
+                                        const EffectInstance* tracker,
+                                        int time)
+{
+    EffectInstance* effect = input->getLiveInstance();
+    if (!effect) {
+        return;
+    }
+
+    RectD rod;
+    bool isProjectFormat;
+    RenderScale scale;
+    scale.x = scale.y = 1.;
+    StatusEnum stat = effect->getRegionOfDefinition_public(input->getHashValue(), time, scale, 0, &rod, &isProjectFormat);
+    if ( (stat == eStatusFailed) || rod.isNull() ) {
+        return;
+    }
+
+    RectI roi;
+    rod.toPixelEnclosing(0, effect->getPreferredAspectRatio(), &roi);
+
+    ///Request the images the way the tracker fetches them so that they are found in the cache
+    std::list<ImageComponents> comps;
+    ImageBitDepthEnum depth;
+    tracker->getPreferredDepthAndComponents(0, &comps, &depth);
+    assert( !comps.empty() );
+
+    ParallelRenderArgsSetter frameRenderArgs(app->getProject().get(),
+                                             time,
+                                             0, /*view*/
+                                             true,
+                                             false,
+                                             false,
+                                             0,
+                                             0,
+                                             0, //texture index
+                                             app->getTimeLine().get(),
+                                             true,
+                                             Natron::eRenderPriorityPlayback,
+                                             true, // is a frame rendered ?
+                                             false); // is this one of the frames of a sequence rendered in parallel ?
+    RenderingFlagSetter flagIsRendering( input.get() );
+
+    ///The tracks render the image themselves if it could not be pre-rendered
+    ImageList planes;
+    try {
+        (void)effect->renderRoI(EffectInstance::RenderRoIArgs(time,
+                                                              scale,
+                                                              0,
+                                                              0,
+                                                              false,
+                                                              roi,
+                                                              rod,
+                                                              comps,
+                                                              depth),&planes);
+    } catch (...) {
+    }
+}
+
+TrackScheduler::TrackScheduler(AppInstance* app,
+                               const TrackerParamsProvider* provider)
+: QThread()
+, _imp(new TrackSchedulerPrivate(app,provider))
+{
+    setObjectName("TrackScheduler");
+}
+
+TrackScheduler::~TrackScheduler()
+{
+}
+
+bool
+TrackScheduler::isWorking() const
+{
+    QMutexLocker k(&_imp->isWorkingMutex);
+    return _imp->isWorking;
+}
+
+void
+TrackScheduler::getTrackButtons(const boost::shared_ptr<Natron::Node>& node,
+                                bool forward,
+                                std::list<Button_Knob*>* buttons)
+{
+    const char* buttonName = forward ? kNatronParamTrackingNext : kNatronParamTrackingPrevious;
+    std::list<boost::shared_ptr<Node> > instances;
+
+    if ( node->isMultiInstance() ) {
+        node->getChildrenMultiInstance(&instances);
+    } else {
+        instances.push_back(node);
+    }
+    for (std::list<boost::shared_ptr<Node> >::iterator it = instances.begin(); it != instances.end(); ++it) {
+        if ( !(*it)->getLiveInstance() || (*it)->isNodeDisabled() ) {
+            continue;
+        }
+        Button_Knob* button = dynamic_cast<Button_Knob*>( (*it)->getKnobByName(buttonName).get() );
+        if (button) {
+            buttons->push_back(button);
+        }
+    }
+}
+
+void
+TrackScheduler::getLastTrackingFrameRates(std::list<std::pair<std::string,double> >* frameRates) const
+{
+    QMutexLocker k(&_imp->frameRatesMutex);
+    *frameRates = _imp->lastFrameRates;
+}
+
+void
+TrackScheduler::run()
+{
+    for (;;) {
+
+        ///Check for exit of the thread
+        if ( _imp->checkForExit() ) {
+            return;
+        }
+
+        trackInternal();
+
+        ///Sleep or restart if we've requests in the queue
+        {
+            QMutexLocker k(&_imp->startRequesstMutex);
+            while (_imp->startRequests <= 0) {
+                _imp->startRequestsCond.wait(&_imp->startRequesstMutex);
+            }
+            _imp->startRequests = 0;
+        }
+
+    }
+}
+
+void
+TrackScheduler::trackInternal()
+{
+    ///Flag that we're working
+    {
+        QMutexLocker k(&_imp->isWorkingMutex);
+        _imp->isWorking = true;
+    }
+
+    ///Copy the requested args to the args used for processing
+    TrackArgs args;
+    {
+        QMutexLocker k(&_imp->argsMutex);
+        args = _imp->requestedArgs;
+    }
+
+    boost::shared_ptr<TimeLine> timeline = _imp->app->getTimeLine();
+
+    const int start = args.start;
+    const int framesCount = args.forward ? (args.end - start) : (start - args.end);
+    const int dir = args.forward ? 1 : -1;
+
+    bool reportProgress = args.instances.size() > 1 || framesCount > 1;
+    if (reportProgress) {
+        Q_EMIT trackingStarted();
+    }
+
+    ///Find the clips the tracks are tracking, tracks of the same tracker share the same source
+    std::vector<std::pair<boost::shared_ptr<Node>,const EffectInstance*> > inputs;
+    std::vector<TrackInstance> tracks( args.instances.size() );
+    {
+        int i = 0;
+        for (std::list<Button_Knob*>::const_iterator it = args.instances.begin(); it != args.instances.end(); ++it, ++i) {
+            tracks[i].button = *it;
+            const EffectInstance* effect = dynamic_cast<const EffectInstance*>( (*it)->getHolder() );
+            if (!effect) {
+                continue;
+            }
+            tracks[i].name = effect->getNode()->getScriptName();
+            boost::shared_ptr<Node> input = effect->getNode()->getInput(0);
+            if (!input) {
+                continue;
+            }
+            bool found = false;
+            for (std::size_t j = 0; j < inputs.size(); ++j) {
+                if (inputs[j].first == input) {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                inputs.push_back( std::make_pair(input, effect) );
+            }
+        }
+    }
+
+    ///Each track proceeds on its own in the global thread pool: a track which converges quickly does not wait
+    ///for the others before tracking the next frame
+    std::list<QFuture<void> > futures;
+    for (std::size_t i = 0; i < tracks.size(); ++i) {
+        futures.push_back( QtConcurrent::run(_imp.get(),&TrackSchedulerPrivate::trackInstance,&tracks[i],start,args.end,args.forward) );
+    }
+
+    ///Meanwhile, render the images of the next frames upstream so that the tracks find them in the cache.
+    ///Offsets are expressed in frames from the start, tracking the frame at offset i needs the images at i and i + 1.
+    int nextOffsetToRender = 0;
+    int lastFramesDone = 0;
+    int lastSlowestDone = 0;
+    const int totalFrames = framesCount * (int)tracks.size();
+    for (;;) {
+        int framesDone = 0;
+        int slowestDone = framesCount;
+        bool allFinished = true;
+        bool renderNext = false;
+        {
+            QMutexLocker k(&_imp->trackMutex);
+            for (;;) {
+                framesDone = 0;
+                slowestDone = framesCount;
+                int fastestDone = 0;
+                allFinished = true;
+                for (std::size_t i = 0; i < tracks.size(); ++i) {
+                    framesDone += tracks[i].framesDone;
+                    if (!tracks[i].finished) {
+                        allFinished = false;
+                        slowestDone = std::min(slowestDone, tracks[i].framesDone);
+                    }
+                    fastestDone = std::max(fastestDone, tracks[i].framesDone);
+                }
+
+                ///The fastest track is already fetching the images up to fastestDone + 1
+                nextOffsetToRender = std::max(nextOffsetToRender, fastestDone + 2);
+                renderNext = !allFinished && !inputs.empty() && nextOffsetToRender <= framesCount &&
+                             nextOffsetToRender - slowestDone <= NATRON_TRACKER_RENDER_AHEAD && !_imp->isAbortRequested();
+
+                if ( renderNext || allFinished || (framesDone != lastFramesDone) ) {
+                    break;
+                }
+                _imp->trackCond.wait(&_imp->trackMutex);
+            }
+        }
+
+        if (framesDone != lastFramesDone) {
+            lastFramesDone = framesDone;
+            if (reportProgress && totalFrames > 0) {
+                ///Notify we progressed
+                Q_EMIT progressUpdate( (double)framesDone / totalFrames );
+            }
+        }
+
+        ///Refresh the viewer with the last frame all tracks are done with
+        if ( !allFinished && (slowestDone != lastSlowestDone) ) {
+            lastSlowestDone = slowestDone;
+            if ( _imp->provider && _imp->provider->isUpdateViewerOnTrackingEnabled() ) {
+                timeline->seekFrame(start + dir * slowestDone, true, 0, Natron::eTimelineChangeReasonPlaybackSeek);
+            }
+        }
+
+        if (allFinished) {
+            break;
+        }
+
+        if (renderNext) {
+            for (std::size_t i = 0; i < inputs.size(); ++i) {
+                _imp->renderInputImage(inputs[i].first, inputs[i].second, start + dir * nextOffsetToRender);
+            }
+            ++nextOffsetToRender;
+        }
+    }
+
+    for (std::list<QFuture<void> >::iterator it = futures.begin(); it != futures.end(); ++it) {
+        it->waitForFinished();
+    }
+
+    int trackedFrames = 0;
+    for (std::size_t i = 0; i < tracks.size(); ++i) {
+        trackedFrames = std::max(trackedFrames, tracks[i].framesDone);
+    }
+    if ( _imp->provider && _imp->provider->isUpdateViewerOnTrackingEnabled() ) {
+        timeline->seekFrame(start + dir * trackedFrames, true, 0, Natron::eTimelineChangeReasonPlaybackSeek);
+    }
+
+    {
+        QMutexLocker k(&_imp->frameRatesMutex);
+        _imp->lastFrameRates.clear();
+        for (std::size_t i = 0; i < tracks.size(); ++i) {
+            _imp->lastFrameRates.push_back( std::make_pair(tracks[i].name, tracks[i].fps) );
+        }
+    }
+    if ( appPTR->isBackground() ) {
+        for (std::size_t i = 0; i < tracks.size(); ++i) {
+            std::cout << tracks[i].name << ": " << tracks[i].framesDone << " frames tracked at "
+                      << tracks[i].fps << " fps" << std::endl;
+        }
+    }
+
+    if (reportProgress) {
+        Q_EMIT trackingFinished();
+    }
+
+    ///Flag that we're no longer working
+    {
+        QMutexLocker k(&_imp->isWorkingMutex);
+        _imp->isWorking = false;
+    }
+
+    ///Make sure we really reset the abort flag
+    {
+        QMutexLocker k(&_imp->abortRequestedMutex);
+        if (_imp->abortRequested > 0) {
+            _imp->abortRequested = 0;
+            _imp->abortRequestedCond.wakeAll();
+        }
+    }
+} // trackInternal
+
+void
+TrackScheduler::track(int startingFrame,int end,bool forward, const std::list<Button_Knob*> & selectedInstances)
+{
+    if ((forward && startingFrame >= end) || (!forward && startingFrame <= end)) {
+        Q_EMIT trackingFinished();
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->argsMutex);
+        _imp->requestedArgs.start = startingFrame;
+        _imp->requestedArgs.end = end;
+        _imp->requestedArgs.forward = forward;
+        _imp->requestedArgs.instances = selectedInstances;
+    }
+    ///The hash of the nodes upstream must reflect the latest changes made to their knobs
+    if ( QThread::currentThread() == qApp->thread() ) {
+        _imp->app->processPendingEvaluations();
+    }
+    if (isRunning()) {
+        QMutexLocker k(&_imp->startRequesstMutex);
+        ++_imp->startRequests;
+        _imp->startRequestsCond.wakeAll();
+    } else {
+        start();
+    }
+}
+
+void
+TrackScheduler::trackBlocking(int startingFrame,int end,bool forward, const std::list<Button_Knob*> & selectedInstances)
+{
+    ///The thread must not be tracking at the same time
+    assert( !isWorking() );
+    if ((forward && startingFrame >= end) || (!forward && startingFrame <= end)) {
+        Q_EMIT trackingFinished();
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->argsMutex);
+        _imp->requestedArgs.start = startingFrame;
+        _imp->requestedArgs.end = end;
+        _imp->requestedArgs.forward = forward;
+        _imp->requestedArgs.instances = selectedInstances;
+    }
+    ///The hash of the nodes upstream must reflect the latest changes made to their knobs
+    if ( QThread::currentThread() == qApp->thread() ) {
+        _imp->app->processPendingEvaluations();
+    }
+    trackInternal();
+}
+
+void TrackScheduler::abortTracking()
+{
+    if ( !isWorking() ) {
+        return;
+    }
+
+    {
+        QMutexLocker k(&_imp->abortRequestedMutex);
+        ++_imp->abortRequested;
+        _imp->abortRequestedCond.wakeAll();
+    }
+    ///Wake-up the scheduler so it stops rendering ahead
+    QMutexLocker k(&_imp->trackMutex);
+    _imp->trackCond.wakeAll();
+}
+
+void
+TrackScheduler::quitThread()
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    abortTracking();
+
+    {
+        QMutexLocker k(&_imp->mustQuitMutex);
+        _imp->mustQuit = true;
+
+        {
+            QMutexLocker k(&_imp->startRequesstMutex);
+            ++_imp->startRequests;
+            _imp->startRequestsCond.wakeAll();
+        }
+
+        while (_imp->mustQuit) {
+            _imp->mustQuitCond.wait(&_imp->mustQuitMutex);
+        }
+
+    }
+
+    wait();
+}
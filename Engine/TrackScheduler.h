@@ -0,0 +1,113 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_ENGINE_TRACKSCHEDULER_H_
+#define NATRON_ENGINE_TRACKSCHEDULER_H_
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include <list>
+#include <string>
+#include <utility>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#endif
+#include <QThread>
+
+#include "Global/GlobalDefines.h"
+
+class AppInstance;
+class Button_Knob;
+namespace Natron {
+class Node;
+}
+
+/**
+ * @brief Gives the tracking parameters that can change while tracking, e.g: the tracker panel in the GUI.
+ **/
+class TrackerParamsProvider
+{
+public:
+
+    TrackerParamsProvider() {}
+
+    virtual ~TrackerParamsProvider() {}
+
+    /**
+     * @brief If true, the timeline is moved to the last frame tracked by all tracks so the viewer displays it
+     **/
+    virtual bool isUpdateViewerOnTrackingEnabled() const = 0;
+};
+
+struct TrackSchedulerPrivate;
+class TrackScheduler : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * @param provider Can be NULL when there is no GUI, in which case the viewer is never updated
+     **/
+    TrackScheduler(AppInstance* app,
+                   const TrackerParamsProvider* provider);
+
+    virtual ~TrackScheduler();
+
+    /**
+     * @brief Track the selectedInstances, calling the instance change action on each button (either the previous or
+     * next button) in a separate thread.
+     * Each track proceeds on its own, while the images of the frames ahead are rendered upstream.
+     * @param start the first frame to track, if forward is true then start < end
+     * @param end the next frame after the last frame to track (a la STL iterators), if forward is true then end > start
+     **/
+    void track(int start,int end,bool forward,const std::list<Button_Knob*> & selectedInstances);
+
+    /**
+     * @brief Same as track() but the tracking is done in the calling thread and this function returns once
+     * it is finished. This is what is used by Python and in background mode.
+     **/
+    void trackBlocking(int start,int end,bool forward,const std::list<Button_Knob*> & selectedInstances);
+
+    /**
+     * @brief Returns the buttons to trigger to track the given node in the given direction: if the node is the main
+     * instance of a tracker, the buttons of all its enabled tracks, otherwise the button of the node itself.
+     **/
+    static void getTrackButtons(const boost::shared_ptr<Natron::Node>& node,bool forward,std::list<Button_Knob*>* buttons);
+
+    /**
+     * @brief Returns for each track of the last tracking its script-name and the number of frames tracked per second.
+     **/
+    void getLastTrackingFrameRates(std::list<std::pair<std::string,double> >* frameRates) const;
+
+    void abortTracking();
+
+    void quitThread();
+
+    bool isWorking() const;
+
+Q_SIGNALS:
+
+    void trackingStarted();
+
+    void trackingFinished();
+
+    void progressUpdate(double progress);
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    void trackInternal();
+
+    boost::scoped_ptr<TrackSchedulerPrivate> _imp;
+};
+
+#endif // NATRON_ENGINE_TRACKSCHEDULER_H_
@@ -70,6 +70,18 @@ static void renderFunctor(std::pair<int,int> yRange,
                           const RenderViewerArgs & args,
                           ViewerInstance* viewer,
                           void *buffer);
+static std::pair<double, double>
+findAutoContrastVminVmaxForRows(boost::shared_ptr<const Natron::Image> inputImage,
+                                Natron::DisplayChannelsEnum channels,
+                                const RectI & rect,
+                                std::pair<int,int> yRange);
+static std::pair<double, double>
+reduceAutoContrastVminVmax(const QList<std::pair<double,double> > & results);
+static std::pair<double, double>
+renderFunctorWithAutoContrast(std::pair<int,int> yRange,
+                              const RenderViewerArgs & args,
+                              ViewerInstance* viewer,
+                              void *buffer);
 
 /**
  *@brief Actually converting to ARGB... but it is called BGRA by
@@ -116,10 +128,10 @@ class ViewerRenderingStarted_RAII
     bool _didEmit;
 public:
     
-    ViewerRenderingStarted_RAII(ViewerInstance* node)
+    ViewerRenderingStarted_RAII(ViewerInstance* node,bool notify)
     : _node(node)
     {
-        _didEmit = node->getNode()->notifyRenderingStarted();
+        _didEmit = notify && node->getNode()->notifyRenderingStarted();
         if (_didEmit) {
             _node->s_viewerRenderingStarted();
         }
@@ -365,9 +377,14 @@ ViewerInstance::getRenderViewerArgsAndCheckCache(SequenceTime time,
                                                  bool isSequential,
                                                  bool canAbort,
                                                  int view, int textureIndex, U64 viewerHash,
+                                                 bool isSpeculative,
                                                  ViewerArgs* outArgs)
 {
-    U64 renderAge = _imp->getRenderAge(textureIndex);
+    assert(!isSpeculative || (isSequential && canAbort));
+    outArgs->isSpeculative = isSpeculative;
+    
+    ///Speculative renders are never displayed, they do not take part in the render ages
+    U64 renderAge = isSpeculative ? 0 : _imp->getRenderAge(textureIndex);
     
     
     if (textureIndex == 0) {
@@ -386,17 +403,27 @@ ViewerInstance::getRenderViewerArgsAndCheckCache(SequenceTime time,
     }
     
     if (!upstreamInput || !outArgs->activeInputToRender || !checkTreeCanRender(outArgs->activeInputToRender->getNode().get())) {
-        Q_EMIT disconnectTextureRequest(textureIndex);
-        //if (!isSequential) {
-            _imp->checkAndUpdateDisplayAge(textureIndex,renderAge);
-        //}
+        if (!isSpeculative) {
+            Q_EMIT disconnectTextureRequest(textureIndex);
+            //if (!isSequential) {
+                _imp->checkAndUpdateDisplayAge(textureIndex,renderAge);
+            //}
+        }
         return eStatusFailed;
     }
     
     {
         QMutexLocker forceRenderLocker(&_imp->forceRenderMutex);
-        outArgs->forceRender = _imp->forceRender;
-        _imp->forceRender = false;
+        if (isSpeculative) {
+            ///The next render of the viewer by-passes the cache anyway, leave the flag to it
+            if (_imp->forceRender) {
+                return eStatusReplyDefault;
+            }
+            outArgs->forceRender = false;
+        } else {
+            outArgs->forceRender = _imp->forceRender;
+            _imp->forceRender = false;
+        }
     }
     
     ///instead of calling getRegionOfDefinition on the active input, check the image cache
@@ -447,6 +474,13 @@ ViewerInstance::getRenderViewerArgsAndCheckCache(SequenceTime time,
     
    
     
+    Natron::RenderPriorityEnum priority;
+    if (isSpeculative) {
+        priority = Natron::eRenderPrioritySpeculative;
+    } else {
+        priority = isSequential ? Natron::eRenderPriorityPlayback : Natron::eRenderPriorityInteractive;
+    }
+    
     ///need to set TLS for getROD()
     ParallelRenderArgsSetter frameArgs(getApp()->getProject().get(),
                                        time,
@@ -458,7 +492,10 @@ ViewerInstance::getRenderViewerArgsAndCheckCache(SequenceTime time,
                                        this,
                                        textureIndex,
                                        getTimeline().get(),
-                                       false);
+                                       false,
+                                       priority,
+                                       false, // is a frame rendered ?
+                                       false); // is this one of the frames of a sequence rendered in parallel ?
     
     /**
      * @brief Start flagging that we're rendering for as long as the viewer is active.
@@ -471,10 +508,12 @@ ViewerInstance::getRenderViewerArgsAndCheckCache(SequenceTime time,
                                                                                  supportsRS ==  eSupportsNo ? scaleOne : scale,
                                                                                  view, &rod, &isRodProjectFormat);
     if (stat == eStatusFailed) {
-        Q_EMIT disconnectTextureRequest(textureIndex);
-        //if (!isSequential) {
-            _imp->checkAndUpdateDisplayAge(textureIndex,renderAge);
-        //}
+        if (!isSpeculative) {
+            Q_EMIT disconnectTextureRequest(textureIndex);
+            //if (!isSequential) {
+                _imp->checkAndUpdateDisplayAge(textureIndex,renderAge);
+            //}
+        }
 
         return stat;
     }
@@ -497,6 +536,12 @@ ViewerInstance::getRenderViewerArgsAndCheckCache(SequenceTime time,
         autoContrast = _imp->viewerParamsAutoContrast;
         channels = _imp->viewerParamsChannels;
     }
+    
+    ///These textures are never cached: there is nothing to prerender
+    if ( isSpeculative && (autoContrast || _imp->uiContext->isUserRegionOfInterestEnabled()) ) {
+        return eStatusReplyDefault;
+    }
+    
     /*computing the RoI*/
     
     ////Texrect is the coordinates of the 4 corners of the texture in the bounds with the current zoom
@@ -505,11 +550,13 @@ ViewerInstance::getRenderViewerArgsAndCheckCache(SequenceTime time,
     _imp->uiContext->getImageRectangleDisplayedRoundedToTileSize(rod, par, mipMapLevel);
     
     if ( (roi.width() == 0) || (roi.height() == 0) ) {
-        Q_EMIT disconnectTextureRequest(textureIndex);
         outArgs->params.reset();
-        //if (!isSequential) {
-            _imp->checkAndUpdateDisplayAge(textureIndex,renderAge);
-        //}
+        if (!isSpeculative) {
+            Q_EMIT disconnectTextureRequest(textureIndex);
+            //if (!isSequential) {
+                _imp->checkAndUpdateDisplayAge(textureIndex,renderAge);
+            //}
+        }
         return eStatusReplyDefault;
     }
     
@@ -605,7 +652,8 @@ ViewerInstance::getRenderViewerArgsAndCheckCache(SequenceTime time,
             lastRenderHash = _imp->lastRenderedHash;
             lastRenderedHashValid = _imp->lastRenderedHashValid;
         }
-        if ( lastRenderedHashValid && (lastRenderHash != viewerHash) ) {
+        ///A speculative render may be using the hash of the tree before the change
+        if ( !isSpeculative && lastRenderedHashValid && (lastRenderHash != viewerHash) ) {
             appPTR->removeAllTexturesFromCacheWithMatchingKey(lastRenderHash);
             {
                 QMutexLocker l(&_imp->lastRenderedHashMutex);
@@ -616,6 +664,12 @@ ViewerInstance::getRenderViewerArgsAndCheckCache(SequenceTime time,
     
     if (isCached) {
         
+        ///The frame was already rendered, there is nothing to prerender
+        if (isSpeculative) {
+            outArgs->params->cachedFrame.reset();
+            return eStatusReplyDefault;
+        }
+        
         /// make sure we have the lock on the texture because it may be in the cache already
         ///but not yet allocated.
         FrameEntryLocker entryLocker(_imp.get());
@@ -725,11 +779,16 @@ ViewerInstance::renderViewer_internal(int view,
         return eStatusReplyDefault;
     }
     
-    ///Notify the gui we're rendering.
-    ViewerRenderingStarted_RAII renderingNotifier(this);
+    ///A speculative render is useless once the tree changed
+    if ( inArgs.isSpeculative && (inArgs.activeInputToRender->getHash() != inArgs.activeInputHash) ) {
+        return eStatusReplyDefault;
+    }
+    
+    ///Notify the gui we're rendering, unless the frame is not going to be displayed
+    ViewerRenderingStarted_RAII renderingNotifier(this, !inArgs.isSpeculative);
     
     ///Don't allow different threads to write the texture entry
-    FrameEntryLocker entryLocker(_imp.get());
+    FrameEntryLocker entryLocker(inArgs.isSpeculative ? &_imp->speculativeTextureLocks : _imp.get());
     
     ///If the user RoI is enabled, the odds that we find a texture containing exactly the same portion
     ///is very low, we better render again (and let the NodeCache do the work) rather than just
@@ -754,6 +813,9 @@ ViewerInstance::renderViewer_internal(int view,
         Natron::getTextureFromCacheOrCreate(*(inArgs.key), cachedFrameParams,
                                                                    &inArgs.params->cachedFrame);
         if (!inArgs.params->cachedFrame) {
+            if (inArgs.isSpeculative) {
+                return eStatusReplyDefault;
+            }
             std::stringstream ss;
             ss << "Failed to allocate a texture of ";
             ss << printAsRAM( cachedFrameParams->getElementsCount() * sizeof(FrameEntry::data_t) ).toStdString();
@@ -767,7 +829,33 @@ ViewerInstance::renderViewer_internal(int view,
             return eStatusFailed;
         }
         
-        if (!entryLocker.tryLock(inArgs.params->cachedFrame)) {
+        bool locked = entryLocker.tryLock(inArgs.params->cachedFrame);
+        if ( !locked && !inArgs.isSpeculative && _imp->isTextureRenderedSpeculatively(inArgs.params->cachedFrame) ) {
+            
+            ///The frame is being prerendered: wait for it, it either completes the texture or backs off quickly
+            entryLocker.lock(inArgs.params->cachedFrame);
+            if ( !inArgs.params->cachedFrame->getAborted() ) {
+                if (!isSequentialRender && canAbort && !_imp->removeOngoingRender(inArgs.params->textureIndex, inArgs.params->renderAge)) {
+                    inArgs.params.reset();
+                    return eStatusReplyDefault;
+                }
+                inArgs.params->ramBuffer = inArgs.params->cachedFrame->data();
+                {
+                    QMutexLocker l(&_imp->lastRenderedHashMutex);
+                    _imp->lastRenderedHashValid = true;
+                    _imp->lastRenderedHash = viewerHash;
+                }
+                return eStatusOK;
+            }
+            
+            ///The speculative render was aborted and removed the texture from the cache, make a new one
+            entryLocker.unlock();
+            inArgs.params->cachedFrame.reset();
+            Natron::getTextureFromCacheOrCreate(*(inArgs.key), cachedFrameParams,
+                                                &inArgs.params->cachedFrame);
+            locked = inArgs.params->cachedFrame && entryLocker.tryLock(inArgs.params->cachedFrame);
+        }
+        if (!locked) {
             ///Another thread is rendering it, just return it is not useful to keep this thread waiting.
             if (!isSequentialRender && canAbort) {
                 _imp->removeOngoingRender(inArgs.params->textureIndex, inArgs.params->renderAge);
@@ -838,7 +926,9 @@ ViewerInstance::renderViewer_internal(int view,
         if (!isSequentialRender && canAbort) {
             _imp->removeOngoingRender(inArgs.params->textureIndex, inArgs.params->renderAge);
         }
-        Q_EMIT disconnectTextureRequest(inArgs.params->textureIndex);
+        if (!inArgs.isSpeculative) {
+            Q_EMIT disconnectTextureRequest(inArgs.params->textureIndex);
+        }
         inArgs.params.reset();
 
         return eStatusReplyDefault;
@@ -848,7 +938,10 @@ ViewerInstance::renderViewer_internal(int view,
     
     {
         
-        EffectInstance::NotifyInputNRenderingStarted_RAII inputNIsRendering_RAII(getNode().get(),inArgs.activeInputIndex);
+        boost::scoped_ptr<EffectInstance::NotifyInputNRenderingStarted_RAII> inputNIsRendering_RAII;
+        if (!inArgs.isSpeculative) {
+            inputNIsRendering_RAII.reset( new EffectInstance::NotifyInputNRenderingStarted_RAII(getNode().get(),inArgs.activeInputIndex) );
+        }
         
         EffectInstance* upstreamInput = getInput(inArgs.activeInputIndex);
         NodePtr inputToSetRenderArgs;
@@ -858,6 +951,13 @@ ViewerInstance::renderViewer_internal(int view,
             inputToSetRenderArgs = inArgs.activeInputToRender->getNode();
         }
         
+        Natron::RenderPriorityEnum priority;
+        if (inArgs.isSpeculative) {
+            priority = Natron::eRenderPrioritySpeculative;
+        } else {
+            priority = isSequentialRender ? Natron::eRenderPriorityPlayback : Natron::eRenderPriorityInteractive;
+        }
+        
         ///Make sure the parallel render args are set on the thread and die when rendering is finished
         ParallelRenderArgsSetter frameArgs(getApp()->getProject().get(),
                                            inArgs.params->time,
@@ -869,7 +969,10 @@ ViewerInstance::renderViewer_internal(int view,
                                            this,
                                            inArgs.params->textureIndex,
                                            getTimeline().get(),
-                                           false);
+                                           false,
+                                           priority,
+                                           true, // is a frame rendered ?
+                                           isSequentialRender && !inArgs.isSpeculative); // is this one of the frames of a sequence rendered in parallel ?
 
 
         
@@ -904,7 +1007,7 @@ ViewerInstance::renderViewer_internal(int view,
                 if (!isSequentialRender && canAbort) {
                     _imp->removeOngoingRender(inArgs.params->textureIndex, inArgs.params->renderAge);
                 }
-                if (retCode != EffectInstance::eRenderRoIRetCodeAborted) {
+                if ( (retCode != EffectInstance::eRenderRoIRetCodeAborted) && !inArgs.isSpeculative ) {
                     Q_EMIT disconnectTextureRequest(inArgs.params->textureIndex);
                 }
 
@@ -928,7 +1031,7 @@ ViewerInstance::renderViewer_internal(int view,
    
     ///We check that the render age is still OK and that no other renders were triggered, in which case we should not need to
     ///refresh the viewer.
-    if (!_imp->checkAgeNoUpdate(inArgs.params->textureIndex,inArgs.params->renderAge)) {
+    if ( !inArgs.isSpeculative && !_imp->checkAgeNoUpdate(inArgs.params->textureIndex,inArgs.params->renderAge) ) {
         if (inArgs.params->cachedFrame) {
             inArgs.params->cachedFrame->setAborted(true);
             appPTR->removeFromViewerCache(inArgs.params->cachedFrame);
@@ -956,129 +1059,113 @@ ViewerInstance::renderViewer_internal(int view,
     
     assert(alphaChannelIndex < (int)inArgs.params->image->getComponentsCount());
     
-    if (singleThreaded) {
-        if (autoContrast) {
-            double vmin, vmax;
+    const int textureIndex = inArgs.params->textureIndex;
+    
+    ///With float textures, the gain and offset are applied by the shader: the texture does not depend on the
+    ///auto-contrast range, which can then be computed while filling the texture, reading the image only once.
+    const bool linearTexture = inArgs.key->getBitDepth() == OpenGLViewerI::eBitDepthFloat ||
+                               inArgs.key->getBitDepth() == OpenGLViewerI::eBitDepthHalf;
+    double vmin = 0.,vmax = 0.;
+    bool hasAutoContrastRange = false;
+    if (autoContrast) {
+        hasAutoContrastRange = _imp->getCachedAutoContrastRange(textureIndex, inArgs.params->image, roi, channels, &vmin, &vmax);
+    }
+    const bool fuseAutoContrast = autoContrast && !hasAutoContrastRange && linearTexture;
+    
+    int rowsPerThread = std::ceil( (double)(roi.x2 - roi.x1) / appPTR->getHardwareIdealThreadCount() );
+    bool runInCurrentThread = singleThreaded ||
+    QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount();
+    
+    // group of group of rows where first is image coordinate, second is texture coordinate
+    QList< std::pair<int, int> > splitRows;
+    if (!runInCurrentThread) {
+        int k = roi.y1;
+        while (k < roi.y2) {
+            int top = k + rowsPerThread;
+            int realTop = top > roi.y2 ? roi.y2 : top;
+            splitRows.push_back( std::make_pair(k,realTop) );
+            k += rowsPerThread;
+        }
+    }
+    
+    ///if autoContrast is enabled, find out the vmin/vmax before rendering and mapping against new values
+    if (autoContrast && !hasAutoContrastRange && !fuseAutoContrast) {
+        if (!runInCurrentThread) {
+            QFuture<std::pair<double,double> > future = QtConcurrent::mapped( splitRows,
+                                                                             boost::bind(findAutoContrastVminVmaxForRows,
+                                                                                         inArgs.params->image,
+                                                                                         channels,
+                                                                                         roi,
+                                                                                         _1) );
+            future.waitForFinished();
+            std::pair<double,double> vMinMax = reduceAutoContrastVminVmax( future.results() );
+            vmin = vMinMax.first;
+            vmax = vMinMax.second;
+        } else {
             std::pair<double,double> vMinMax = findAutoContrastVminVmax(inArgs.params->image, channels, roi);
             vmin = vMinMax.first;
             vmax = vMinMax.second;
-            
-            ///if vmax - vmin is greater than 1 the gain will be really small and we won't see
-            ///anything in the image
-            if (vmin == vmax) {
-                vmin = vmax - 1.;
-            }
-            inArgs.params->gain = 1 / (vmax - vmin);
-            inArgs.params->offset = -vmin / ( vmax - vmin);
         }
-        
-        const RenderViewerArgs args(inArgs.params->image,
-                                    inArgs.params->textureRect,
-                                    channels,
-                                    inArgs.params->srcPremult,
-                                    inArgs.key->getBitDepth(),
-                                    inArgs.params->gain,
-                                    inArgs.params->gamma == 0. ? 0. : 1. / inArgs.params->gamma,
-                                    inArgs.params->offset,
-                                    lutFromColorspace(srcColorSpace),
-                                    lutFromColorspace(inArgs.params->lut),
-                                    alphaChannelIndex);
-        
+        _imp->setCachedAutoContrastRange(textureIndex, inArgs.params->image, roi, channels, vmin, vmax);
+        hasAutoContrastRange = true;
+    }
+    
+    if (hasAutoContrastRange) {
+        ///if vmax - vmin is greater than 1 the gain will be really small and we won't see
+        ///anything in the image
+        if (vmin == vmax) {
+            vmin = vmax - 1.;
+        }
+        inArgs.params->gain = 1 / (vmax - vmin);
+        inArgs.params->offset = -vmin / (vmax - vmin);
+    }
+    
+    const RenderViewerArgs args(inArgs.params->image,
+                                inArgs.params->textureRect,
+                                channels,
+                                inArgs.params->srcPremult,
+                                inArgs.key->getBitDepth(),
+                                inArgs.params->gain,
+                                inArgs.params->gamma == 0. ? 0. : 1. / inArgs.params->gamma,
+                                inArgs.params->offset,
+                                lutFromColorspace(srcColorSpace),
+                                lutFromColorspace(inArgs.params->lut),
+                                alphaChannelIndex);
+    
+    if (fuseAutoContrast) {
+        std::pair<double,double> vMinMax;
+        if (runInCurrentThread) {
+            vMinMax = renderFunctorWithAutoContrast(std::make_pair(roi.y1,roi.y2), args, this, inArgs.params->ramBuffer);
+        } else {
+            QFuture<std::pair<double,double> > future = QtConcurrent::mapped( splitRows,
+                                                                             boost::bind(&renderFunctorWithAutoContrast,
+                                                                                         _1,
+                                                                                         args,
+                                                                                         this,
+                                                                                         inArgs.params->ramBuffer) );
+            future.waitForFinished();
+            vMinMax = reduceAutoContrastVminVmax( future.results() );
+        }
+        vmin = vMinMax.first;
+        vmax = vMinMax.second;
+        _imp->setCachedAutoContrastRange(textureIndex, inArgs.params->image, roi, channels, vmin, vmax);
+        if (vmin == vmax) {
+            vmin = vmax - 1.;
+        }
+        inArgs.params->gain = 1 / (vmax - vmin);
+        inArgs.params->offset = -vmin / (vmax - vmin);
+    } else if (runInCurrentThread) {
         renderFunctor(std::make_pair(roi.y1,roi.y2),
                       args,
                       this,
                       inArgs.params->ramBuffer);
     } else {
-        
-        int rowsPerThread = std::ceil( (double)(roi.x2 - roi.x1) / appPTR->getHardwareIdealThreadCount() );
-        // group of group of rows where first is image coordinate, second is texture coordinate
-        QList< std::pair<int, int> > splitRows;
-        
-        bool runInCurrentThread = QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount();
-        
-        if (!runInCurrentThread) {
-            int k = roi.y1;
-            while (k < roi.y2) {
-                int top = k + rowsPerThread;
-                int realTop = top > roi.y2 ? roi.y2 : top;
-                splitRows.push_back( std::make_pair(k,realTop) );
-                k += rowsPerThread;
-            }
-        }
-        
-        ///if autoContrast is enabled, find out the vmin/vmax before rendering and mapping against new values
-        if (autoContrast) {
-            rowsPerThread = std::ceil( (double)( roi.width() ) / (double)appPTR->getHardwareIdealThreadCount() );
-            
-            std::vector<RectI> splitRects;
-            
-            double vmin = std::numeric_limits<double>::infinity();
-            double vmax = -std::numeric_limits<double>::infinity();
-            
-            if (!runInCurrentThread) {
-                int k = roi.y1;
-                while (k < roi.y2) {
-                    int top = k + rowsPerThread;
-                    int realTop = top > roi.top() ? roi.top() : top;
-                    splitRects.push_back( RectI(roi.left(), k, roi.right(), realTop) );
-                    k += rowsPerThread;
-                }
-                
-                
-                QFuture<std::pair<double,double> > future = QtConcurrent::mapped( splitRects,
-                                                                                 boost::bind(findAutoContrastVminVmax,
-                                                                                             inArgs.params->image,
-                                                                                             channels,
-                                                                                             _1) );
-                future.waitForFinished();
-                
-                std::pair<double,double> vMinMax;
-                Q_FOREACH ( vMinMax, future.results() ) {
-                    if (vMinMax.first < vmin) {
-                        vmin = vMinMax.first;
-                    }
-                    if (vMinMax.second > vmax) {
-                        vmax = vMinMax.second;
-                    }
-                }
-            } else { //!runInCurrentThread
-                std::pair<double,double> vMinMax = findAutoContrastVminVmax(inArgs.params->image, channels, roi);
-                vmin = vMinMax.first;
-                vmax = vMinMax.second;
-            }
-            
-            if (vmax == vmin) {
-                vmin = vmax - 1.;
-            }
-            
-            inArgs.params->gain = 1 / (vmax - vmin);
-            inArgs.params->offset =  -vmin / (vmax - vmin);
-        }
-        
-        const RenderViewerArgs args(inArgs.params->image,
-                                    inArgs.params->textureRect,
-                                    channels,
-                                    inArgs.params->srcPremult,
-                                    inArgs.key->getBitDepth(),
-                                    inArgs.params->gain,
-                                    inArgs.params->gamma == 0. ? 0. : 1. / inArgs.params->gamma,
-                                    inArgs.params->offset,
-                                    lutFromColorspace(srcColorSpace),
-                                    lutFromColorspace(inArgs.params->lut),
-                                    alphaChannelIndex);
-        if (runInCurrentThread) {
-            renderFunctor(std::make_pair(inArgs.params->textureRect.y1,inArgs.params->textureRect.y2),
-                          args, this, inArgs.params->ramBuffer);
-        } else {
-            QtConcurrent::map( splitRows,
-                              boost::bind(&renderFunctor,
-                                          _1,
-                                          args,
-                                          this,
-                                          inArgs.params->ramBuffer) ).waitForFinished();
-        }
-        
-        
+        QtConcurrent::map( splitRows,
+                          boost::bind(&renderFunctor,
+                                      _1,
+                                      args,
+                                      this,
+                                      inArgs.params->ramBuffer) ).waitForFinished();
     }
 
     return eStatusOK;
@@ -1108,116 +1195,221 @@ renderFunctor(std::pair<int,int> yRange,
     }
 }
 
-inline
+/**
+ * @brief Returns the values of the pixel used to compute the auto-contrast range for the given channels.
+ **/
+template <int nComps,Natron::DisplayChannelsEnum channels>
+static inline void
+getAutoContrastPixelMinMax(const float* pix,
+                           float* mini,
+                           float* maxi)
+{
+    float r,g,b,a;
+    switch (nComps) {
+        case 4:
+            r = pix[0];
+            g = pix[1];
+            b = pix[2];
+            a = pix[3];
+            break;
+        case 3:
+            r = pix[0];
+            g = pix[1];
+            b = pix[2];
+            a = 1.f;
+            break;
+        case 1:
+            a = pix[0];
+            r = g = b = 0.f;
+            break;
+        default:
+            r = g = b = a = 0.f;
+    }
+    switch (channels) {
+        case Natron::eDisplayChannelsRGB:
+            *mini = std::min(std::min(r,g),b);
+            *maxi = std::max(std::max(r,g),b);
+            break;
+        case Natron::eDisplayChannelsY:
+            *mini = *maxi = 0.299f * r + 0.587f * g + 0.114f * b;
+            break;
+        case Natron::eDisplayChannelsR:
+            *mini = *maxi = r;
+            break;
+        case Natron::eDisplayChannelsG:
+            *mini = *maxi = g;
+            break;
+        case Natron::eDisplayChannelsB:
+            *mini = *maxi = b;
+            break;
+        case Natron::eDisplayChannelsA:
+            *mini = *maxi = a;
+            break;
+        default:
+            *mini = *maxi = 0.f;
+            break;
+    }
+}
+
+/**
+ * @brief Min/max reduction over a scan-line. Both the number of components and the channels are template parameters
+ * so that the loop has no branch and can be vectorized by the compiler.
+ **/
+template <int nComps,Natron::DisplayChannelsEnum channels>
+static void
+findAutoContrastVminVmaxForScanLine(const float* src_pixels,
+                                    int width,
+                                    float* vmin,
+                                    float* vmax)
+{
+    float localVmin = *vmin;
+    float localVmax = *vmax;
+    for (int x = 0; x < width; ++x) {
+        float mini,maxi;
+        getAutoContrastPixelMinMax<nComps,channels>(src_pixels, &mini, &maxi);
+        localVmin = std::min(localVmin, mini);
+        localVmax = std::max(localVmax, maxi);
+        src_pixels += nComps;
+    }
+    *vmin = localVmin;
+    *vmax = localVmax;
+}
+
+template <int nComps>
+static void
+findAutoContrastVminVmaxForScanLine_channels(Natron::DisplayChannelsEnum channels,
+                                             const float* src_pixels,
+                                             int width,
+                                             float* vmin,
+                                             float* vmax)
+{
+    switch (channels) {
+        case Natron::eDisplayChannelsRGB:
+            findAutoContrastVminVmaxForScanLine<nComps,Natron::eDisplayChannelsRGB>(src_pixels, width, vmin, vmax);
+            break;
+        case Natron::eDisplayChannelsY:
+            findAutoContrastVminVmaxForScanLine<nComps,Natron::eDisplayChannelsY>(src_pixels, width, vmin, vmax);
+            break;
+        case Natron::eDisplayChannelsR:
+            findAutoContrastVminVmaxForScanLine<nComps,Natron::eDisplayChannelsR>(src_pixels, width, vmin, vmax);
+            break;
+        case Natron::eDisplayChannelsG:
+            findAutoContrastVminVmaxForScanLine<nComps,Natron::eDisplayChannelsG>(src_pixels, width, vmin, vmax);
+            break;
+        case Natron::eDisplayChannelsB:
+            findAutoContrastVminVmaxForScanLine<nComps,Natron::eDisplayChannelsB>(src_pixels, width, vmin, vmax);
+            break;
+        case Natron::eDisplayChannelsA:
+            findAutoContrastVminVmaxForScanLine<nComps,Natron::eDisplayChannelsA>(src_pixels, width, vmin, vmax);
+            break;
+        default:
+            *vmin = std::min(*vmin, 0.f);
+            *vmax = std::max(*vmax, 0.f);
+            break;
+    }
+}
+
+static void
+findAutoContrastVminVmaxForScanLine(int nComps,
+                                    Natron::DisplayChannelsEnum channels,
+                                    const float* src_pixels,
+                                    int width,
+                                    float* vmin,
+                                    float* vmax)
+{
+    switch (nComps) {
+        case 4:
+            findAutoContrastVminVmaxForScanLine_channels<4>(channels, src_pixels, width, vmin, vmax);
+            break;
+        case 3:
+            findAutoContrastVminVmaxForScanLine_channels<3>(channels, src_pixels, width, vmin, vmax);
+            break;
+        case 1:
+            findAutoContrastVminVmaxForScanLine_channels<1>(channels, src_pixels, width, vmin, vmax);
+            break;
+        default:
+            if (width > 0) {
+                *vmin = std::min(*vmin, 0.f);
+                *vmax = std::max(*vmax, 0.f);
+            }
+            break;
+    }
+}
+
 std::pair<double, double>
-findAutoContrastVminVmax_generic(boost::shared_ptr<const Natron::Image> inputImage,
-                                 int nComps,
-                                 Natron::DisplayChannelsEnum channels,
-                                 const RectI & rect)
+findAutoContrastVminVmaxForRows(boost::shared_ptr<const Natron::Image> inputImage,
+                                Natron::DisplayChannelsEnum channels,
+                                const RectI & rect,
+                                std::pair<int,int> yRange)
 {
-    double localVmin = std::numeric_limits<double>::infinity();
-    double localVmax = -std::numeric_limits<double>::infinity();
+    float vmin = std::numeric_limits<float>::infinity();
+    float vmax = -std::numeric_limits<float>::infinity();
+    int nComps = inputImage->getComponents().getNumComponents();
     
     Natron::Image::ReadAccess acc = inputImage->getReadRights();
     
-    for (int y = rect.bottom(); y < rect.top(); ++y) {
+    for (int y = yRange.first; y < yRange.second; ++y) {
         const float* src_pixels = (const float*)acc.pixelAt(rect.left(),y);
-        ///we fill the scan-line with all the pixels of the input image
-        for (int x = rect.left(); x < rect.right(); ++x) {
-            
-            double r,g,b,a;
-            switch (nComps) {
-                case 4:
-                    r = src_pixels[0];
-                    g = src_pixels[1];
-                    b = src_pixels[2];
-                    a = src_pixels[3];
-                    break;
-                case 3:
-                    r = src_pixels[0];
-                    g = src_pixels[1];
-                    b = src_pixels[2];
-                    a = 1.;
-                    break;
-                case 1:
-                    a = src_pixels[0];
-                    r = g = b = 0.;
-                    break;
-                default:
-                    r = g = b = a = 0.;
-            }
-            
-            double mini, maxi;
-            switch (channels) {
-                case Natron::eDisplayChannelsRGB:
-                    mini = std::min(std::min(r,g),b);
-                    maxi = std::max(std::max(r,g),b);
-                    break;
-                case Natron::eDisplayChannelsY:
-                    mini = r = 0.299 * r + 0.587 * g + 0.114 * b;
-                    maxi = mini;
-                    break;
-                case Natron::eDisplayChannelsR:
-                    mini = r;
-                    maxi = mini;
-                    break;
-                case Natron::eDisplayChannelsG:
-                    mini = g;
-                    maxi = mini;
-                    break;
-                case Natron::eDisplayChannelsB:
-                    mini = b;
-                    maxi = mini;
-                    break;
-                case Natron::eDisplayChannelsA:
-                    mini = a;
-                    maxi = mini;
-                    break;
-                default:
-                    mini = 0.;
-                    maxi = 0.;
-                    break;
-            }
-            if (mini < localVmin) {
-                localVmin = mini;
-            }
-            if (maxi > localVmax) {
-                localVmax = maxi;
-            }
-            
-            src_pixels += nComps;
-        }
+        findAutoContrastVminVmaxForScanLine(nComps, channels, src_pixels, rect.width(), &vmin, &vmax);
     }
     
-    return std::make_pair(localVmin, localVmax);
+    return std::make_pair(vmin, vmax);
 }
 
-template <int nComps>
 std::pair<double, double>
-findAutoContrastVminVmax_internal(boost::shared_ptr<const Natron::Image> inputImage,
-                                  Natron::DisplayChannelsEnum channels,
-                                  const RectI & rect)
+findAutoContrastVminVmax(boost::shared_ptr<const Natron::Image> inputImage,
+                         Natron::DisplayChannelsEnum channels,
+                         const RectI & rect)
 {
-    return findAutoContrastVminVmax_generic(inputImage, nComps, channels, rect);
+    return findAutoContrastVminVmaxForRows(inputImage, channels, rect, std::make_pair(rect.bottom(), rect.top()));
+} // findAutoContrastVminVmax
+
+std::pair<double, double>
+reduceAutoContrastVminVmax(const QList<std::pair<double,double> > & results)
+{
+    double vmin = std::numeric_limits<double>::infinity();
+    double vmax = -std::numeric_limits<double>::infinity();
+    std::pair<double,double> vMinMax;
+    Q_FOREACH ( vMinMax, results ) {
+        if (vMinMax.first < vmin) {
+            vmin = vMinMax.first;
+        }
+        if (vMinMax.second > vmax) {
+            vmax = vMinMax.second;
+        }
+    }
+    return std::make_pair(vmin, vmax);
 }
 
+/**
+ * @brief Same as renderFunctor() for float textures, but also returns the auto-contrast range of the rows.
+ * Each scan-line is converted to the texture right after its range was computed, while it is still in the cache,
+ * so the image is read from memory only once.
+ **/
 std::pair<double, double>
-findAutoContrastVminVmax(boost::shared_ptr<const Natron::Image> inputImage,
-                         Natron::DisplayChannelsEnum channels,
-                         const RectI & rect)
+renderFunctorWithAutoContrast(std::pair<int,int> yRange,
+                              const RenderViewerArgs & args,
+                              ViewerInstance* viewer,
+                              void *buffer)
 {
-    int nComps = inputImage->getComponents().getNumComponents();
-    if (nComps == 4) {
-        return findAutoContrastVminVmax_internal<4>(inputImage, channels, rect);
-    } else if (nComps == 3) {
-        return findAutoContrastVminVmax_internal<3>(inputImage, channels, rect);
-    } else if (nComps == 1) {
-        return findAutoContrastVminVmax_internal<1>(inputImage, channels, rect);
-    } else {
-        return findAutoContrastVminVmax_generic(inputImage, nComps, channels, rect);
+    assert(args.bitDepth == OpenGLViewerI::eBitDepthFloat || args.bitDepth == OpenGLViewerI::eBitDepthHalf);
+    
+    float vmin = std::numeric_limits<float>::infinity();
+    float vmax = -std::numeric_limits<float>::infinity();
+    int nComps = args.inputImage->getComponents().getNumComponents();
+    
+    for (int y = yRange.first; y < yRange.second; ++y) {
+        {
+            ///scaleToTexture32bits takes the read lock itself, do not hold it while converting the scan-line
+            Natron::Image::ReadAccess acc = args.inputImage->getReadRights();
+            const float* src_pixels = (const float*)acc.pixelAt(args.texRect.x1,y);
+            findAutoContrastVminVmaxForScanLine(nComps, args.channels, src_pixels, args.texRect.w, &vmin, &vmax);
+        }
+        scaleToTexture32bits(std::make_pair(y, y + 1), args, viewer, (float*)buffer);
     }
     
-} // findAutoContrastVminVmax
+    return std::make_pair(vmin, vmax);
+}
 
 template <typename PIX,int maxValue,bool opaque,int rOffset,int gOffset,int bOffset>
 void
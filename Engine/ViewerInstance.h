@@ -69,15 +69,20 @@ public:
         boost::shared_ptr<Natron::FrameKey> key;
         boost::shared_ptr<UpdateViewerParams> params;
         boost::shared_ptr<RenderingFlagSetter> isRenderingFlag;
+        bool isSpeculative;
     };
     
     /**
      * @brief Look-up the cache and try to find a matching texture for the portion to render.
+     * A speculative render prerenders a frame in the viewer cache without displaying it: it has no effect on the
+     * viewer (render ages, forced refresh, disconnected textures...) and returns eStatusReplyDefault if there is nothing
+     * to prerender. It must be sequential and abortable.
      **/
     Natron::StatusEnum getRenderViewerArgsAndCheckCache(SequenceTime time,
                                                         bool isSequential,
                                                         bool canAbort,
                                                         int view, int textureIndex, U64 viewerHash,
+                                                        bool isSpeculative,
                                                         ViewerArgs* outArgs);
 
     
@@ -18,6 +18,7 @@
 #include "ViewerInstance.h"
 
 #include <map>
+#include <boost/weak_ptr.hpp>
 #include <QtCore/QMutex>
 #include <QtCore/QWaitCondition>
 #include <QtCore/QThread>
@@ -27,6 +28,7 @@
 #include "Engine/ImageComponents.h"
 #include "Engine/FrameEntry.h"
 #include "Engine/Settings.h"
+#include "Engine/Rect.h"
 #include "Engine/TextureRect.h"
 
 namespace Natron {
@@ -143,6 +145,27 @@ public:
     bool isSequential;
 };
 
+/**
+ * @brief The auto-contrast range last computed for a texture. It only depends on the image, the rectangle
+ * and the displayed channels, so that changing the gain, gamma or color-space does not require to scan the image again.
+ **/
+struct AutoContrastRange
+{
+    boost::weak_ptr<const Natron::Image> image;
+    RectI rect;
+    Natron::DisplayChannelsEnum channels;
+    double vmin,vmax;
+    
+    AutoContrastRange()
+    : image()
+    , rect()
+    , channels(Natron::eDisplayChannelsRGB)
+    , vmin(0.)
+    , vmax(0.)
+    {
+    }
+};
+
 struct ViewerInstance::ViewerInstancePrivate
 : public QObject, public LockManagerI<Natron::FrameEntry>
 {
@@ -171,6 +194,13 @@ public:
     , lastRenderedHashMutex()
     , lastRenderedHash(0)
     , lastRenderedHashValid(false)
+    , textureBeingRenderedMutex()
+    , textureBeingRenderedCond()
+    , textureBeingRendered()
+    , textureRenderedSpeculatively()
+    , speculativeTextureLocks(this)
+    , autoContrastMutex()
+    , lastAutoContrast()
     , renderAgeMutex()
     , renderAge()
     , displayAge()
@@ -190,6 +220,45 @@ public:
         Q_EMIT mustRedrawViewer();
     }
     
+    /**
+     * @brief Returns true if the auto-contrast range of the given image has already been computed for the texture
+     * with the same rectangle and channels.
+     **/
+    bool getCachedAutoContrastRange(int texIndex,
+                                    const boost::shared_ptr<const Natron::Image>& image,
+                                    const RectI& rect,
+                                    Natron::DisplayChannelsEnum channels,
+                                    double* vmin,
+                                    double* vmax) const
+    {
+        assert(texIndex == 0 || texIndex == 1);
+        QMutexLocker k(&autoContrastMutex);
+        const AutoContrastRange& range = lastAutoContrast[texIndex];
+        if (range.image.lock() != image || range.rect != rect || range.channels != channels) {
+            return false;
+        }
+        *vmin = range.vmin;
+        *vmax = range.vmax;
+        return true;
+    }
+    
+    void setCachedAutoContrastRange(int texIndex,
+                                    const boost::shared_ptr<const Natron::Image>& image,
+                                    const RectI& rect,
+                                    Natron::DisplayChannelsEnum channels,
+                                    double vmin,
+                                    double vmax)
+    {
+        assert(texIndex == 0 || texIndex == 1);
+        QMutexLocker k(&autoContrastMutex);
+        AutoContrastRange& range = lastAutoContrast[texIndex];
+        range.image = image;
+        range.rect = rect;
+        range.channels = channels;
+        range.vmin = vmin;
+        range.vmax = vmax;
+    }
+    
 public:
     
     virtual void lock(const boost::shared_ptr<Natron::FrameEntry>& entry) OVERRIDE FINAL
@@ -209,6 +278,26 @@ public:
     }
     
     virtual bool tryLock(const boost::shared_ptr<Natron::FrameEntry>& entry) OVERRIDE FINAL
+    {
+        return tryLockTexture(entry, false);
+    }
+    
+    virtual void unlock(const boost::shared_ptr<Natron::FrameEntry>& entry) OVERRIDE FINAL
+    {
+
+        QMutexLocker l(&textureBeingRenderedMutex);
+        std::list<boost::shared_ptr<Natron::FrameEntry> >::iterator it =
+                std::find(textureBeingRendered.begin(), textureBeingRendered.end(), entry);
+        ///The image must exist, otherwise this is a bug
+        assert( it != textureBeingRendered.end() );
+        textureBeingRendered.erase(it);
+        textureRenderedSpeculatively.remove(entry);
+        ///Notify all waiting threads that we're finished
+        textureBeingRenderedCond.wakeAll();
+    }
+    
+    bool tryLockTexture(const boost::shared_ptr<Natron::FrameEntry>& entry,
+                        bool speculative)
     {
         QMutexLocker l(&textureBeingRenderedMutex);
         std::list<boost::shared_ptr<Natron::FrameEntry> >::iterator it =
@@ -219,21 +308,56 @@ public:
         ///Okay the image is not used by any other thread, claim that we want to use it
         assert( it == textureBeingRendered.end() );
         textureBeingRendered.push_back(entry);
+        if (speculative) {
+            textureRenderedSpeculatively.push_back(entry);
+        }
         return true;
     }
     
-    virtual void unlock(const boost::shared_ptr<Natron::FrameEntry>& entry) OVERRIDE FINAL
+    /**
+     * @brief Returns true if the texture is locked by a speculative render. Such a render backs off as soon as
+     * another render starts: it is worth waiting for it rather than skipping the texture.
+     **/
+    bool isTextureRenderedSpeculatively(const boost::shared_ptr<Natron::FrameEntry>& entry) const
     {
-
         QMutexLocker l(&textureBeingRenderedMutex);
-        std::list<boost::shared_ptr<Natron::FrameEntry> >::iterator it =
-                std::find(textureBeingRendered.begin(), textureBeingRendered.end(), entry);
-        ///The image must exist, otherwise this is a bug
-        assert( it != textureBeingRendered.end() );
-        textureBeingRendered.erase(it);
-        ///Notify all waiting threads that we're finished
-        textureBeingRenderedCond.wakeAll();
+        return std::find(textureRenderedSpeculatively.begin(), textureRenderedSpeculatively.end(), entry) !=
+               textureRenderedSpeculatively.end();
     }
+    
+    /**
+     * @brief Locks the textures on behalf of the speculative renders, see isTextureRenderedSpeculatively()
+     **/
+    class SpeculativeTextureLocks
+    : public LockManagerI<Natron::FrameEntry>
+    {
+        ViewerInstancePrivate* _imp;
+        
+    public:
+        
+        SpeculativeTextureLocks(ViewerInstancePrivate* imp)
+        : LockManagerI<Natron::FrameEntry>()
+        , _imp(imp)
+        {
+        }
+        
+        virtual void lock(const boost::shared_ptr<Natron::FrameEntry>& entry) OVERRIDE FINAL
+        {
+            ///Speculative renders never wait for a texture
+            (void)entry;
+            assert(false);
+        }
+        
+        virtual bool tryLock(const boost::shared_ptr<Natron::FrameEntry>& entry) OVERRIDE FINAL
+        {
+            return _imp->tryLockTexture(entry, true);
+        }
+        
+        virtual void unlock(const boost::shared_ptr<Natron::FrameEntry>& entry) OVERRIDE FINAL
+        {
+            _imp->unlock(entry);
+        }
+    };
 
     /**
      * @brief Returns the current render age of the viewer (a simple counter incrementing at each request).
@@ -375,6 +499,11 @@ public:
     mutable QMutex textureBeingRenderedMutex;
     QWaitCondition textureBeingRenderedCond;
     std::list<boost::shared_ptr<Natron::FrameEntry> > textureBeingRendered; ///< a list of all the texture being rendered simultaneously
+    std::list<boost::shared_ptr<Natron::FrameEntry> > textureRenderedSpeculatively; ///< the textures of textureBeingRendered locked by speculative renders
+    SpeculativeTextureLocks speculativeTextureLocks;
+    
+    mutable QMutex autoContrastMutex;
+    AutoContrastRange lastAutoContrast[2]; ///< the auto-contrast range last computed for each texture
     
 private:
     
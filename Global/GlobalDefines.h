@@ -86,6 +86,12 @@ typedef OfxRangeD RangeD;
 
 #define kBgProcessServerCreatedShort "--bg_server_created"
 
+///these are used between a client and NatronRenderer running with --server, see RenderServer
+#define kRenderServerJobShort "--job"
+#define kRenderServerQuitShort "--quit"
+#define kRenderServerJobFinishedShort "--job_finished"
+#define kRenderServerJobFailedShort "--job_failed"
+
 
 #define kNodeGraphObjectName "nodeGraph"
 #define kCurveEditorObjectName "curveEditor"
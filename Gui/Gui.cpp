@@ -65,6 +65,7 @@ CLANG_DIAG_ON(unused-parameter)
 #include "Engine/ViewerInstance.h"
 #include "Engine/Project.h"
 #include "Engine/Plugin.h"
+#include "Engine/RenderProfiler.h"
 #include "Engine/Settings.h"
 #include "Engine/KnobFile.h"
 #include "SequenceParsing.h"
@@ -250,6 +251,8 @@ struct GuiPrivate
     QAction *actionsOpenRecentFile[NATRON_MAX_RECENT_FILES];
     ActionWithShortcut *renderAllWriters;
     ActionWithShortcut *renderSelectedNode;
+    QAction *actionEnableRenderProfiling;
+    QAction *actionExportRenderProfile;
     ActionWithShortcut* actionConnectInput1;
     ActionWithShortcut* actionConnectInput2;
     ActionWithShortcut* actionConnectInput3;
@@ -415,6 +418,8 @@ struct GuiPrivate
         , actionsOpenRecentFile()
         , renderAllWriters(0)
         , renderSelectedNode(0)
+        , actionEnableRenderProfiling(0)
+        , actionExportRenderProfile(0)
         , actionConnectInput1(0)
         , actionConnectInput2(0)
         , actionConnectInput3(0)
@@ -945,6 +950,14 @@ Gui::createMenuActions()
     _imp->renderSelectedNode = new ActionWithShortcut(kShortcutGroupGlobal, kShortcutIDActionRenderSelected, kShortcutDescActionRenderSelected, this);
     QObject::connect( _imp->renderSelectedNode, SIGNAL( triggered() ), this, SLOT( renderSelectedNode() ) );
 
+    _imp->actionEnableRenderProfiling = new QAction(tr("Enable Render Profiling"), this);
+    _imp->actionEnableRenderProfiling->setCheckable(true);
+    _imp->actionEnableRenderProfiling->setChecked( Natron::RenderProfiler::isEnabled() );
+    QObject::connect( _imp->actionEnableRenderProfiling, SIGNAL( toggled(bool) ), this, SLOT( onEnableRenderProfilingToggled(bool) ) );
+
+    _imp->actionExportRenderProfile = new QAction(tr("Export Render Profile..."), this);
+    QObject::connect( _imp->actionExportRenderProfile, SIGNAL( triggered() ), this, SLOT( exportRenderProfile() ) );
+
 
     for (int c = 0; c < NATRON_MAX_RECENT_FILES; ++c) {
         _imp->actionsOpenRecentFile[c] = new QAction(this);
@@ -1052,6 +1065,9 @@ Gui::createMenuActions()
 
     _imp->menuRender->addAction(_imp->renderAllWriters);
     _imp->menuRender->addAction(_imp->renderSelectedNode);
+    _imp->menuRender->addSeparator();
+    _imp->menuRender->addAction(_imp->actionEnableRenderProfiling);
+    _imp->menuRender->addAction(_imp->actionExportRenderProfile);
 
     _imp->cacheMenu->addAction(_imp->actionClearDiskCache);
     _imp->cacheMenu->addAction(_imp->actionClearPlayBackCache);
@@ -3270,10 +3286,24 @@ Gui::loadProjectGui(boost::archive::xml_iarchive & obj) const
 }
 
 void
-Gui::saveProjectGui(boost::archive::xml_oarchive & archive)
+Gui::restorePendingNodesGui() const
+{
+    assert(_imp->_projectGui);
+    _imp->_projectGui->restorePendingNodesGui();
+}
+
+boost::shared_ptr<ProjectGuiSerialization>
+Gui::takeProjectGuiSnapshot() const
 {
     assert(_imp->_projectGui);
-    _imp->_projectGui->save(archive);
+    return _imp->_projectGui->takeSnapshot();
+}
+
+void
+Gui::saveProjectGui(boost::archive::xml_oarchive & archive,
+                    const boost::shared_ptr<ProjectGuiSerialization> & snapshot)
+{
+    ProjectGui::save(archive, snapshot);
 }
 
 void
@@ -4565,6 +4595,34 @@ Gui::renderSelectedNode()
     }
 }
 
+void
+Gui::onEnableRenderProfilingToggled(bool enabled)
+{
+    Natron::RenderProfiler::setEnabled(enabled);
+}
+
+void
+Gui::exportRenderProfile()
+{
+    std::vector<std::string> filters;
+
+    filters.push_back("json");
+    SequenceFileDialog dialog( this, filters, false, SequenceFileDialog::eFileDialogModeSave, _imp->_lastSaveProjectOpenedDir.toStdString(), this, false );
+    if ( dialog.exec() ) {
+        std::string filename = dialog.filesToSave();
+        QString filenameCpy( filename.c_str() );
+        QString ext = Natron::removeFileExtension(filenameCpy);
+        if (ext != "json") {
+            filename.append(".json");
+        }
+
+        std::string error;
+        if ( !Natron::RenderProfiler::exportChromeTrace(filename, &error) ) {
+            Natron::errorDialog( tr("Error").toStdString(), error, false );
+        }
+    }
+}
+
 void
 Gui::setUndoRedoStackLimit(int limit)
 {
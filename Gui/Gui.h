@@ -55,6 +55,7 @@ class QMutex;
 
 //Natron gui
 class GuiLayoutSerialization;
+class ProjectGuiSerialization;
 class GuiAppInstance;
 class NodeGui;
 class TabWidget;
@@ -339,8 +340,14 @@ public:
     static QPixmap screenShot(QWidget* w);
 
     void loadProjectGui(boost::archive::xml_iarchive & obj) const;
+    
+    ///Restores the gui state of the nodes of groups loaded on demand, see ProjectGui::restorePendingNodesGui
+    void restorePendingNodesGui() const;
+
+    boost::shared_ptr<ProjectGuiSerialization> takeProjectGuiSnapshot() const;
 
-    void saveProjectGui(boost::archive::xml_oarchive & archive);
+    void saveProjectGui(boost::archive::xml_oarchive & archive,
+                        const boost::shared_ptr<ProjectGuiSerialization> & snapshot);
 
     void setColorPickersColor(double r,double g, double b,double a);
 
@@ -611,6 +618,10 @@ public Q_SLOTS:
 
     void renderSelectedNode();
 
+    void onEnableRenderProfilingToggled(bool enabled);
+
+    void exportRenderProfile();
+
     void onRotoSelectedToolChanged(int tool);
 
     void onMaxVisibleDockablePanelChanged(int maxPanels);
@@ -93,6 +93,7 @@ SOURCES += \
     NodeGui.cpp \
     NodeGuiSerialization.cpp \
     PreferencesPanel.cpp \
+    PreviewThread.cpp \
     ProjectGui.cpp \
     ProjectGuiSerialization.cpp \
     PythonPanels.cpp \
@@ -174,6 +175,7 @@ HEADERS += \
     NodeGui.h \
     NodeGuiSerialization.h \
     PreferencesPanel.h \
+    PreviewThread.h \
     ProjectGui.h \
     ProjectGuiSerialization.h \
     Pyside_Gui_Python.h \
@@ -24,6 +24,7 @@
 #include "Gui/Gui.h"
 #include "Gui/NodeGraph.h"
 #include "Gui/NodeGui.h"
+#include "Gui/PreviewThread.h"
 #include "Gui/MultiInstancePanel.h"
 #include "Gui/ViewerTab.h"
 #include "Gui/SplashScreen.h"
@@ -70,7 +71,9 @@ struct GuiAppInstancePrivate
     std::string declareAppAndParamsString;
     int overlayRedrawRequests;
     
-    GuiAppInstancePrivate()
+    PreviewThread previewThread;
+    
+    GuiAppInstancePrivate(AppInstance* app)
     : _gui(NULL)
     , _activeBgProcesses()
     , _activeBgProcessesMutex()
@@ -83,6 +86,7 @@ struct GuiAppInstancePrivate
     , loadProjectSplash(0)
     , declareAppAndParamsString()
     , overlayRedrawRequests(0)
+    , previewThread(app)
     {
     }
     
@@ -91,7 +95,7 @@ struct GuiAppInstancePrivate
 
 GuiAppInstance::GuiAppInstance(int appID)
     : AppInstance(appID)
-      , _imp(new GuiAppInstancePrivate)
+      , _imp(new GuiAppInstancePrivate(this))
 
 {
 }
@@ -142,6 +146,7 @@ void
 GuiAppInstance::aboutToQuit()
 {
     
+    _imp->previewThread.quitThread();
     deletePreviewProvider();
     _imp->_isClosing = true;
     _imp->_gui->close();
@@ -154,6 +159,7 @@ GuiAppInstance::~GuiAppInstance()
     QCoreApplication::processEvents();
 
     ///clear nodes prematurely so that any thread running is stopped
+    _imp->previewThread.quitThread();
     getProject()->clearNodes(false);
 
     QCoreApplication::processEvents();
@@ -650,10 +656,17 @@ GuiAppInstance::loadProjectGui(boost::archive::xml_iarchive & archive) const
     _imp->_gui->loadProjectGui(archive);
 }
 
+boost::shared_ptr<ProjectGuiSerialization>
+GuiAppInstance::takeProjectGuiSnapshot() const
+{
+    return _imp->_gui->takeProjectGuiSnapshot();
+}
+
 void
-GuiAppInstance::saveProjectGui(boost::archive::xml_oarchive & archive)
+GuiAppInstance::saveProjectGui(boost::archive::xml_oarchive & archive,
+                               const boost::shared_ptr<ProjectGuiSerialization> & snapshot)
 {
-    _imp->_gui->saveProjectGui(archive);
+    _imp->_gui->saveProjectGui(archive, snapshot);
 }
 
 void
@@ -716,7 +729,8 @@ GuiAppInstance::startRenderingFullSequence(const AppInstance::RenderWork& w,bool
 
     if ( renderInSeparateProcess ) {
         try {
-            boost::shared_ptr<ProcessHandler> process( new ProcessHandler(this,savePath,w.writer) );
+            boost::shared_ptr<ProcessHandler> process( new ProcessHandler(this,savePath,w.writer,firstFrame,lastFrame,
+                                                                                appPTR->getCurrentSettings()->getNumberOfRenderProcesses()) );
             QObject::connect( process.get(), SIGNAL( processFinished(int) ), this, SLOT( onProcessFinished() ) );
             notifyRenderProcessHandlerStarted(outputFileSequence,firstFrame,lastFrame,process);
             process->startProcess();
@@ -836,6 +850,12 @@ GuiAppInstance::getPreviewProvider() const
     return _imp->_previewProvider;
 }
 
+void
+GuiAppInstance::requestNodePreview(const boost::shared_ptr<NodeGui>& node,int time)
+{
+    _imp->previewThread.appendToQueue(node, time);
+}
+
 void
 GuiAppInstance::projectFormatChanged(const Format& /*f*/)
 {
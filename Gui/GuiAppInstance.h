@@ -109,7 +109,9 @@ public:
                                                       bool* stopAsking) OVERRIDE FINAL WARN_UNUSED_RETURN;
     
     virtual void loadProjectGui(boost::archive::xml_iarchive & archive) const OVERRIDE FINAL;
-    virtual void saveProjectGui(boost::archive::xml_oarchive & archive) OVERRIDE FINAL;
+    virtual boost::shared_ptr<ProjectGuiSerialization> takeProjectGuiSnapshot() const OVERRIDE FINAL;
+    virtual void saveProjectGui(boost::archive::xml_oarchive & archive,
+                                const boost::shared_ptr<ProjectGuiSerialization> & snapshot) OVERRIDE FINAL;
     virtual void notifyRenderProcessHandlerStarted(const QString & sequenceName,
                                                    int firstFrame,int lastFrame,
                                                    const boost::shared_ptr<ProcessHandler> & process) OVERRIDE FINAL;
@@ -133,6 +135,11 @@ public:
 
 
     boost::shared_ptr<FileDialogPreviewProvider> getPreviewProvider() const;
+    
+    /**
+     * @brief Requests the preview of the given node to be rendered by the preview thread of the app.
+     **/
+    void requestNodePreview(const boost::shared_ptr<NodeGui>& node,int time);
 
     virtual std::string openImageFileDialog() OVERRIDE FINAL;
     virtual std::string saveImageFileDialog() OVERRIDE FINAL;
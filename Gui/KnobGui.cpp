@@ -154,6 +154,8 @@ KnobGui::KnobGui(boost::shared_ptr<KnobI> knob,
         QObject::connect( handler,SIGNAL( refreshGuiCurve(int)),this,SLOT( onRefreshGuiCurve(int) ) );
         QObject::connect( handler,SIGNAL( valueChanged(int,int) ),this,SLOT( onInternalValueChanged(int,int) ) );
         QObject::connect( handler,SIGNAL( keyFrameSet(SequenceTime,int,int,bool) ),this,SLOT( onInternalKeySet(SequenceTime,int,int,bool) ) );
+        QObject::connect( handler,SIGNAL( multipleKeyFramesSet(std::list<SequenceTime>,int,int) ),
+                          this,SLOT( onInternalMultipleKeysSet(std::list<SequenceTime>,int,int) ) );
         QObject::connect( handler,SIGNAL( keyFrameRemoved(SequenceTime,int,int) ),this,SLOT( onInternalKeyRemoved(SequenceTime,int,int) ) );
         QObject::connect( handler,SIGNAL( keyFrameMoved(int,int,int)), this, SLOT( onKeyFrameMoved(int,int,int)));
         QObject::connect( handler,SIGNAL( secretChanged() ),this,SLOT( setSecret() ) );
@@ -1508,6 +1510,21 @@ KnobGui::onInternalKeySet(SequenceTime time,
     updateCurveEditorKeyframes();
 }
 
+void
+KnobGui::onInternalMultipleKeysSet(std::list<SequenceTime> keys,
+                                   int /*dimension*/,
+                                   int reason)
+{
+    if ( ( (Natron::ValueChangedReasonEnum)reason != Natron::eValueChangedReasonUserEdited ) && !keys.empty() ) {
+        boost::shared_ptr<KnobI> knob = getKnob();
+        if ( !knob->getIsSecret() && knob->isDeclaredByPlugin() ) {
+            knob->getHolder()->getApp()->getTimeLine()->addMultipleKeyframeIndicatorsAdded(keys, true);
+        }
+    }
+    
+    updateCurveEditorKeyframes();
+}
+
 void
 KnobGui::onInternalKeyRemoved(SequenceTime time,
                               int /*dimension*/,
@@ -224,6 +224,8 @@ public Q_SLOTS:
     void onInternalValueChanged(int dimension,int reason);
 
     void onInternalKeySet(SequenceTime time,int dimension,int reason,bool added);
+    
+    void onInternalMultipleKeysSet(std::list<SequenceTime> keys,int dimension,int reason);
 
     void onInternalKeyRemoved(SequenceTime time,int dimension,int reason);
 
@@ -1702,7 +1702,7 @@ struct TrackerPanelPrivate
           , exportButton(0)
           , transformPage()
           , referenceFrame()
-          , scheduler(publicInterface)
+          , scheduler(publicInterface->getApp(), publicInterface)
     {
     }
 
@@ -1946,22 +1946,6 @@ TrackerPanel::onButtonTriggered(Button_Knob* button)
     }
 }
 
-static void
-handleTrackNextAndPrevious(Button_Knob* selectedInstance,
-                           SequenceTime currentFrame)
-{
-//        ///When a reason of eValueChangedReasonUserEdited is given, the tracker plug-in will move the timeline so just send it
-//        ///upon the last track if we want to update the viewer
-//        Natron::ValueChangedReasonEnum reason;
-//        if (updateViewer) {
-//            reason = next == selectedInstances.end() ? eValueChangedReasonNatronGuiEdited : eValueChangedReasonNatronInternalEdited;
-//        } else {
-//            reason = eValueChangedReasonNatronInternalEdited;
-//        }
-        selectedInstance->getHolder()->onKnobValueChanged_public(selectedInstance,eValueChangedReasonNatronInternalEdited,currentFrame,
-                                                                 true);
-}
-
 void
 TrackerPanel::onTrackingStarted()
 {
@@ -2385,264 +2369,3 @@ TrackerPanel::showMenuForInstance(Natron::Node* instance)
         centerKnob->copyAnimationToClipboard();
     }
 }
-
-
-struct TrackArgs
-{
-    int start,end;
-    bool forward;
-    std::list<Button_Knob*> instances;
-};
-
-struct TrackSchedulerPrivate
-{
-    const TrackerPanel* panel;
-    
-    QMutex argsMutex;
-    TrackArgs curArgs,requestedArgs;
-    
-    mutable QMutex mustQuitMutex;
-    bool mustQuit;
-    QWaitCondition mustQuitCond;
-    
-    mutable QMutex abortRequestedMutex;
-    int abortRequested;
-    QWaitCondition abortRequestedCond;
-    
-    QMutex startRequesstMutex;
-    int startRequests;
-    QWaitCondition startRequestsCond;
-    
-    mutable QMutex isWorkingMutex;
-    bool isWorking;
-    
-    
-    TrackSchedulerPrivate(const TrackerPanel* panel)
-    : panel(panel)
-    , argsMutex()
-    , curArgs()
-    , requestedArgs()
-    , mustQuitMutex()
-    , mustQuit(false)
-    , mustQuitCond()
-    , abortRequestedMutex()
-    , abortRequested(0)
-    , abortRequestedCond()
-    , startRequesstMutex()
-    , startRequests(0)
-    , startRequestsCond()
-    , isWorkingMutex()
-    , isWorking(false)
-    {
-        
-    }
-    
-    bool checkForExit()
-    {
-        QMutexLocker k(&mustQuitMutex);
-        if (mustQuit) {
-            mustQuit = false;
-            mustQuitCond.wakeAll();
-            return true;
-        }
-        return false;
-    }
-    
-};
-
-
-TrackScheduler::TrackScheduler(const TrackerPanel* panel)
-: QThread()
-, _imp(new TrackSchedulerPrivate(panel))
-{
-    setObjectName("TrackScheduler");
-}
-
-TrackScheduler::~TrackScheduler()
-{
-    
-}
-
-bool
-TrackScheduler::isWorking() const
-{
-    QMutexLocker k(&_imp->isWorkingMutex);
-    return _imp->isWorking;
-}
-
-void
-TrackScheduler::run()
-{
-    for (;;) {
-        
-        ///Check for exit of the thread
-        if (_imp->checkForExit()) {
-            return;
-        }
-        
-        ///Flag that we're working
-        {
-            QMutexLocker k(&_imp->isWorkingMutex);
-            _imp->isWorking = true;
-        }
-        
-        ///Copy the requested args to the args used for processing
-        {
-            QMutexLocker k(&_imp->argsMutex);
-            _imp->curArgs = _imp->requestedArgs;
-        }
-        
-        boost::shared_ptr<TimeLine> timeline = _imp->panel->getApp()->getTimeLine();
-
-        int end = _imp->curArgs.end;
-        int start = _imp->curArgs.start;
-        int cur = start;
-        
-        int framesCount = _imp->curArgs.forward ? (end - start) : (start - end);
-        
-        bool reportProgress = _imp->curArgs.instances.size() > 1 || framesCount > 1;
-        if (reportProgress) {
-            Q_EMIT trackingStarted();
-        }
-        
-        while (cur != end) {
-            
-            
-            ///Launch parallel thread for each track using the global thread pool
-            QtConcurrent::map(_imp->curArgs.instances,
-                              boost::bind(&handleTrackNextAndPrevious,
-                                          _1,
-                                          cur)).waitForFinished();
-            
-            
-            double progress;
-            if (_imp->curArgs.forward) {
-                ++cur;
-                progress = (double)(cur - start) / framesCount;
-            } else {
-                --cur;
-                progress = (double)(start - cur) / framesCount;
-            }
-            
-            ///Ok all tracks are finished now for this frame, refresh viewer if needed
-            bool updateViewer = _imp->panel->isUpdateViewerOnTrackingEnabled();
-            if (updateViewer) {
-                timeline->seekFrame(cur, true, 0, Natron::eTimelineChangeReasonPlaybackSeek);
-            }
-
-            if (reportProgress) {
-                ///Notify we progressed of 1 frame
-                Q_EMIT progressUpdate(progress);
-            }
-            
-            ///Check for abortion
-            {
-                QMutexLocker k(&_imp->abortRequestedMutex);
-                if (_imp->abortRequested > 0) {
-                    _imp->abortRequested = 0;
-                    _imp->abortRequestedCond.wakeAll();
-                    break;
-                }
-            }
-
-        }
-        
-        if (reportProgress) {
-            Q_EMIT trackingFinished();
-        }
-        
-        ///Flag that we're no longer working
-        {
-            QMutexLocker k(&_imp->isWorkingMutex);
-            _imp->isWorking = false;
-        }
-        
-        ///Make sure we really reset the abort flag
-        {
-            QMutexLocker k(&_imp->abortRequestedMutex);
-            if (_imp->abortRequested > 0) {
-                _imp->abortRequested = 0;
-                
-            }
-        }
-        
-        ///Sleep or restart if we've requests in the queue
-        {
-            QMutexLocker k(&_imp->startRequesstMutex);
-            while (_imp->startRequests <= 0) {
-                _imp->startRequestsCond.wait(&_imp->startRequesstMutex);
-            }
-            _imp->startRequests = 0;
-        }
-        
-    }
-}
-
-void
-TrackScheduler::track(int startingFrame,int end,bool forward, const std::list<Button_Knob*> & selectedInstances)
-{
-    if ((forward && startingFrame >= end) || (!forward && startingFrame <= end)) {
-        Q_EMIT trackingFinished();
-        return;
-    }
-    {
-        QMutexLocker k(&_imp->argsMutex);
-        _imp->requestedArgs.start = startingFrame;
-        _imp->requestedArgs.end = end;
-        _imp->requestedArgs.forward = forward;
-        _imp->requestedArgs.instances = selectedInstances;
-    }
-    if (isRunning()) {
-        QMutexLocker k(&_imp->startRequesstMutex);
-        ++_imp->startRequests;
-        _imp->startRequestsCond.wakeAll();
-    } else {
-        start();
-    }
-}
-
-
-void TrackScheduler::abortTracking()
-{
-    if (!isRunning() || !isWorking()) {
-        return;
-    }
-    
-    
-    {
-        QMutexLocker k(&_imp->abortRequestedMutex);
-        ++_imp->abortRequested;
-        _imp->abortRequestedCond.wakeAll();
-    }
-    
-}
-
-void
-TrackScheduler::quitThread()
-{
-    if (!isRunning()) {
-        return;
-    }
-    
-    abortTracking();
-    
-    {
-        QMutexLocker k(&_imp->mustQuitMutex);
-        _imp->mustQuit = true;
-
-        {
-            QMutexLocker k(&_imp->startRequesstMutex);
-            ++_imp->startRequests;
-            _imp->startRequestsCond.wakeAll();
-        }
-        
-        while (_imp->mustQuit) {
-            _imp->mustQuitCond.wait(&_imp->mustQuitMutex);
-        }
-
-    }
-
-    
-    wait();
-    
-}
@@ -21,7 +21,7 @@
 #include <boost/shared_ptr.hpp>
 #endif
 #include "Engine/Knob.h"
-#include <QThread>
+#include "Engine/TrackScheduler.h"
 namespace Natron {
 class Node;
 }
@@ -153,6 +153,7 @@ private:
 struct TrackerPanelPrivate;
 class TrackerPanel
     : public MultiInstancePanel
+    , public TrackerParamsProvider
 {
     Q_OBJECT
 
@@ -177,7 +178,7 @@ public:
 
     void setUpdateViewerOnTracking(bool update);
 
-    bool isUpdateViewerOnTrackingEnabled() const;
+    virtual bool isUpdateViewerOnTrackingEnabled() const OVERRIDE FINAL;
 public Q_SLOTS:
 
     void onAverageTracksButtonClicked();
@@ -205,46 +206,5 @@ private:
     boost::scoped_ptr<TrackerPanelPrivate> _imp;
 };
 
-struct TrackSchedulerPrivate;
-class TrackScheduler : public QThread
-{
-    Q_OBJECT
-    
-public:
-    
-    TrackScheduler(const TrackerPanel* panel);
-    
-    virtual ~TrackScheduler();
-    
-    /**
-     * @brief Track the selectedInstances, calling the instance change action on each button (either the previous or
-     * next button) in a separate thread. 
-     * @param start the first frame to track, if forward is true then start < end
-     * @param end the next frame after the last frame to track (a la STL iterators), if forward is true then end > start
-     **/
-    void track(int start,int end,bool forward,const std::list<Button_Knob*> & selectedInstances);
-    
-    void abortTracking();
-    
-    void quitThread();
-    
-    bool isWorking() const;
-    
-Q_SIGNALS:
-    
-    void trackingStarted();
-    
-    void trackingFinished();
-    
-    void progressUpdate(double progress);
-
-private:
-    
-    virtual void run() OVERRIDE FINAL;
-    
-    boost::scoped_ptr<TrackSchedulerPrivate> _imp;
-    
-};
-
 
 #endif // MULTIINSTANCEPANEL_H
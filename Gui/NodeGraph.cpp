@@ -53,6 +53,7 @@ CLANG_DIAG_ON(uninitialized)
 #include <SequenceParsing.h>
 
 #include "Engine/AppManager.h"
+#include "Engine/CacheCodec.h"
 
 #include "Engine/OfxEffectInstance.h"
 #include "Engine/ViewerInstance.h"
@@ -593,6 +594,27 @@ NodeGraph::onNodesCleared()
 
 }
 
+void
+NodeGraph::onPendingNodesLoaded()
+{
+    if (_imp->_gui) {
+        _imp->_gui->restorePendingNodesGui();
+    }
+}
+
+void
+NodeGraph::showEvent(QShowEvent* e)
+{
+    QGraphicsView::showEvent(e);
+    
+    ///The nodes of a group loaded on demand are created when its graph is shown
+    boost::shared_ptr<NodeCollection> group = getGroup();
+    NodeGroup* isGrp = dynamic_cast<NodeGroup*>( group.get() );
+    if ( isGrp && isGrp->hasPendingChildren() ) {
+        isGrp->loadPendingChildren();
+    }
+}
+
 void
 NodeGraph::resizeEvent(QResizeEvent* e)
 {
@@ -3045,6 +3067,33 @@ NodeGraph::updateCacheSizeText()
     quint64 cacheSize = appPTR->getCachesTotalMemorySize();
     QString cacheSizeStr = QDirModelPrivate_size(cacheSize);
     QString newText = tr("Memory cache size: ") + cacheSizeStr;
+
+    Natron::CacheCodecStats codecStats;
+    Natron::CacheCodec::getStats(&codecStats);
+    if (codecStats.nEncoded > 0) {
+        newText += '\n' + tr("Disk cache compression ratio: ") + QString::number(codecStats.getCompressionRatio(), 'f', 2);
+    }
+    if (codecStats.nDecoded > 0) {
+        newText += '\n' + tr("Disk cache decoding: ") + QDirModelPrivate_size( (quint64)codecStats.getDecodeThroughput() ) + tr("/s");
+    }
+    
+    ///The frames prerendered by the viewers while the renders were idle
+    std::list<ViewerInstance*> viewers;
+    getGui()->getApp()->getProject()->getViewers(&viewers);
+    U64 nPrerendered = 0,nDisplayed = 0;
+    for (std::list<ViewerInstance*>::iterator it = viewers.begin(); it != viewers.end(); ++it) {
+        RenderEngine* engine = (*it)->getRenderEngine();
+        if (!engine) {
+            continue;
+        }
+        SpeculativeRenderStats stats;
+        engine->getSpeculativeRenderStats(&stats);
+        nPrerendered += stats.nRendered;
+        nDisplayed += stats.nHits;
+    }
+    if (nPrerendered > 0) {
+        newText += '\n' + tr("Viewer prerendered frames: ") + QString::number(nPrerendered) + tr(" (%1% displayed)").arg(100. * nDisplayed / nPrerendered, 0, 'f', 1);
+    }
     if (newText != oldText) {
         _imp->_cacheSizeText->setPlainText(newText);
     }
@@ -142,6 +142,8 @@ public:
 
     virtual void onNodesCleared() OVERRIDE FINAL;
     
+    virtual void onPendingNodesLoaded() OVERRIDE FINAL;
+    
     void setLastSelectedViewer(ViewerTab* tab);
     
     ViewerTab* getLastSelectedViewer() const;
@@ -243,6 +245,7 @@ private:
     
     virtual void enterEvent(QEvent* e) OVERRIDE FINAL;
     virtual void leaveEvent(QEvent* e) OVERRIDE FINAL;
+    virtual void showEvent(QShowEvent* e) OVERRIDE FINAL;
     virtual void keyPressEvent(QKeyEvent* e) OVERRIDE FINAL;
     virtual void keyReleaseEvent(QKeyEvent* e) OVERRIDE FINAL;
     virtual bool event(QEvent* e) OVERRIDE FINAL;
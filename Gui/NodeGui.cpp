@@ -21,7 +21,6 @@ CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_OFF(uninitialized)
 #include <QLayout>
 #include <QAction>
-#include <QtConcurrentRun>
 #include <QFontMetrics>
 #include <QTextDocument> // for Qt::convertFromPlainText
 #include <QTextBlockFormat>
@@ -1142,7 +1141,10 @@ NodeGui::updatePreviewImage(int time)
         
         ensurePreviewCreated();
 
-        QtConcurrent::run(this,&NodeGui::computePreviewImage,time);
+        Gui* gui = _graph->getGui();
+        if (gui) {
+            gui->getApp()->requestNodePreview(shared_from_this(), time);
+        }
     }
 }
 
@@ -1159,46 +1161,28 @@ NodeGui::forceComputePreview(int time)
         
         ensurePreviewCreated();
 
-        QtConcurrent::run(this,&NodeGui::computePreviewImage,time);
+        Gui* gui = _graph->getGui();
+        if (gui) {
+            gui->getApp()->requestNodePreview(shared_from_this(), time);
+        }
     }
 }
 
 void
-NodeGui::computePreviewImage(int time)
+NodeGui::setPreviewImage(const QImage& image)
 {
-    NodePtr node = getNode();
-    if ( node->isRenderingPreview() ) {
+    assert( QThread::currentThread() == qApp->thread() );
+    if (!_previewPixmap) {
         return;
     }
-    
+    QPixmap prev_pixmap = QPixmap::fromImage(image);
+    _previewPixmap->setPixmap(prev_pixmap);
+    QPointF topLeft = mapFromParent( pos() );
+    QRectF bbox = boundingRect();
 
-    int w = NATRON_PREVIEW_WIDTH;
-    int h = NATRON_PREVIEW_HEIGHT;
-    size_t dataSize = 4 * w * h;
-    {
-#ifndef __NATRON_WIN32__
-        unsigned int* buf = (unsigned int*)calloc(dataSize,1);
-#else
-        unsigned int* buf = (unsigned int*)malloc(dataSize);
-        for (int i = 0; i < w * h; ++i) {
-            buf[i] = qRgba(0,0,0,255);
-        }
-#endif
-        bool success = node->makePreviewImage(time, &w, &h, buf);
-        
-        if (success) {
-            QImage img(reinterpret_cast<const uchar*>(buf), w, h, QImage::Format_ARGB32_Premultiplied);
-            QPixmap prev_pixmap = QPixmap::fromImage(img);
-            _previewPixmap->setPixmap(prev_pixmap);
-            QPointF topLeft = mapFromParent( pos() );
-            QRectF bbox = boundingRect();
-            
-            int iconWidth = _pluginIcon ? NATRON_PLUGIN_ICON_SIZE + PLUGIN_ICON_OFFSET * 2 : 0;
-            _previewPixmap->setPos(topLeft.x() + iconWidth + NODE_WIDTH / 4. ,
-                                   topLeft.y() + bbox.height() / 2 - NATRON_PREVIEW_HEIGHT / 2 + 10);
-        }
-        free(buf);
-    }
+    int iconWidth = _pluginIcon ? NATRON_PLUGIN_ICON_SIZE + PLUGIN_ICON_OFFSET * 2 : 0;
+    _previewPixmap->setPos(topLeft.x() + iconWidth + NODE_WIDTH / 4. ,
+                           topLeft.y() + bbox.height() / 2 - NATRON_PREVIEW_HEIGHT / 2 + 10);
 }
 
 bool
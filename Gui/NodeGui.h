@@ -56,6 +56,7 @@ class QUndoStack;
 class LinkArrow;
 class MultiInstancePanel;
 class QMenu;
+class QImage;
 class NodeGroup;
 class NodeCollection;
 namespace Natron {
@@ -382,6 +383,11 @@ public:
     virtual void setPluginDescription(const std::string& description) OVERRIDE FINAL;
     
     virtual void setPluginIDAndVersion(const std::string& pluginLabel,const std::string& pluginID,unsigned int version) OVERRIDE FINAL;
+
+    /**
+     * @brief Displays the preview rendered by the PreviewThread of the app, must be called on the main thread
+     **/
+    void setPreviewImage(const QImage& image);
     
 protected:
     
@@ -523,8 +529,6 @@ private:
     
     void setAboveItem(QGraphicsItem* item);
 
-    void computePreviewImage(int time);
-
     void populateMenu();
 
     void refreshCurrentBrush();
@@ -0,0 +1,299 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include "PreviewThread.h"
+
+#include <list>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QImage>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <boost/weak_ptr.hpp>
+
+#include "Engine/AppInstance.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Node.h"
+#include "Engine/OutputSchedulerThread.h"
+#include "Engine/Project.h"
+#include "Engine/ViewerInstance.h"
+
+#include "Gui/NodeGui.h"
+
+///Previews wait at most this many milliseconds for the viewers to be done rendering
+#define NATRON_PREVIEW_MAX_DEFER_MS 2000
+#define NATRON_PREVIEW_DEFER_STEP_MS 20
+
+namespace {
+
+///The thread only holds weak references on the nodes: a NodeGui must not be destroyed on the preview thread
+struct PreviewRequest
+{
+    boost::weak_ptr<NodeGui> nodeGui;
+    boost::weak_ptr<Natron::Node> node;
+    int time;
+    int depth;
+};
+
+struct RenderedPreview
+{
+    boost::weak_ptr<NodeGui> nodeGui;
+    QImage image;
+};
+
+bool
+isDeeperRequest(const PreviewRequest& lhs,
+                const PreviewRequest& rhs)
+{
+    return lhs.depth > rhs.depth;
+}
+
+///Returns the length of the longest branch upstream of the node
+int
+getUpstreamDepth(Natron::Node* node,
+                 std::map<Natron::Node*,int>* depths)
+{
+    std::map<Natron::Node*,int>::iterator found = depths->find(node);
+    if ( found != depths->end() ) {
+        return found->second;
+    }
+    int depth = 0;
+    int maxInputs = node->getMaxInputCount();
+    for (int i = 0; i < maxInputs; ++i) {
+        boost::shared_ptr<Natron::Node> input = node->getInput(i);
+        if (input) {
+            depth = std::max( depth, getUpstreamDepth(input.get(), depths) + 1 );
+        }
+    }
+    depths->insert( std::make_pair(node, depth) );
+
+    return depth;
+}
+
+}
+
+struct PreviewThreadPrivate
+{
+    AppInstance* app;
+
+    QMutex requestsMutex;
+    QWaitCondition requestsCond;
+    std::list<PreviewRequest> requests;
+    bool mustQuit;
+
+    QMutex renderedMutex;
+    std::list<RenderedPreview> rendered; //< previews waiting to be displayed, see onPreviewsRendered()
+
+    PreviewThreadPrivate(AppInstance* app)
+    : app(app)
+    , requestsMutex()
+    , requestsCond()
+    , requests()
+    , mustQuit(false)
+    , renderedMutex()
+    , rendered()
+    {
+    }
+
+    bool mustQuitThread()
+    {
+        QMutexLocker k(&requestsMutex);
+        return mustQuit;
+    }
+
+    bool hasPendingRequest(const boost::shared_ptr<Natron::Node>& node)
+    {
+        QMutexLocker k(&requestsMutex);
+        for (std::list<PreviewRequest>::iterator it = requests.begin(); it != requests.end(); ++it) {
+            if (it->node.lock() == node) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool areViewersRendering() const
+    {
+        std::list<ViewerInstance*> viewers;
+        app->getProject()->getViewers(&viewers);
+        for (std::list<ViewerInstance*>::iterator it = viewers.begin(); it != viewers.end(); ++it) {
+            if ( (*it)->getRenderEngine()->hasThreadsWorking() ) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+PreviewThread::PreviewThread(AppInstance* app)
+: QThread()
+, _imp( new PreviewThreadPrivate(app) )
+{
+    setObjectName("PreviewThread");
+}
+
+PreviewThread::~PreviewThread()
+{
+}
+
+void
+PreviewThread::appendToQueue(const boost::shared_ptr<NodeGui>& nodeGui,
+                             int time)
+{
+    boost::shared_ptr<Natron::Node> node = nodeGui->getNode();
+    if (!node) {
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->requestsMutex);
+        if (_imp->mustQuit) {
+            return;
+        }
+        bool found = false;
+        for (std::list<PreviewRequest>::iterator it = _imp->requests.begin(); it != _imp->requests.end(); ++it) {
+            if (it->node.lock() == node) {
+                it->time = time;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            PreviewRequest r;
+            r.nodeGui = nodeGui;
+            r.node = node;
+            r.time = time;
+            r.depth = 0;
+            _imp->requests.push_back(r);
+        }
+        _imp->requestsCond.wakeOne();
+    }
+    if ( !isRunning() ) {
+        start(QThread::LowestPriority);
+    }
+}
+
+void
+PreviewThread::quitThread()
+{
+    if ( !isRunning() ) {
+        return;
+    }
+    {
+        QMutexLocker k(&_imp->requestsMutex);
+        _imp->mustQuit = true;
+        _imp->requests.clear();
+        _imp->requestsCond.wakeOne();
+    }
+    wait();
+    QMutexLocker k(&_imp->renderedMutex);
+    _imp->rendered.clear();
+}
+
+void
+PreviewThread::onPreviewsRendered()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+    std::list<RenderedPreview> rendered;
+    {
+        QMutexLocker k(&_imp->renderedMutex);
+        rendered.swap(_imp->rendered);
+    }
+    for (std::list<RenderedPreview>::iterator it = rendered.begin(); it != rendered.end(); ++it) {
+        boost::shared_ptr<NodeGui> nodeGui = it->nodeGui.lock();
+        if (nodeGui) {
+            nodeGui->setPreviewImage(it->image);
+        }
+    }
+}
+
+void
+PreviewThread::run()
+{
+    for (;;) {
+
+        std::vector<PreviewRequest> batch;
+        {
+            QMutexLocker k(&_imp->requestsMutex);
+            while ( !_imp->mustQuit && _imp->requests.empty() ) {
+                _imp->requestsCond.wait(&_imp->requestsMutex);
+            }
+            if (_imp->mustQuit) {
+                return;
+            }
+            batch.insert( batch.end(), _imp->requests.begin(), _imp->requests.end() );
+            _imp->requests.clear();
+        }
+
+        ///Render the most downstream nodes first: their render caches the images of the nodes upstream
+        ///at the same mipmap level, so that the previews of the upstream nodes are found in the cache
+        std::map<Natron::Node*,int> depths;
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            boost::shared_ptr<Natron::Node> node = batch[i].node.lock();
+            if (node) {
+                batch[i].depth = getUpstreamDepth(node.get(), &depths);
+            }
+        }
+        std::stable_sort(batch.begin(), batch.end(), isDeeperRequest);
+
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+
+            ///Previews have a lower priority than the viewers and the playback
+            int deferred = 0;
+            while ( deferred < NATRON_PREVIEW_MAX_DEFER_MS && _imp->areViewersRendering() ) {
+                if ( _imp->mustQuitThread() ) {
+                    return;
+                }
+                msleep(NATRON_PREVIEW_DEFER_STEP_MS);
+                deferred += NATRON_PREVIEW_DEFER_STEP_MS;
+            }
+
+            if ( _imp->mustQuitThread() ) {
+                return;
+            }
+
+            boost::shared_ptr<Natron::Node> node = batch[i].node.lock();
+            if ( !node || node->isRenderingPreview() ) {
+                continue;
+            }
+
+            ///A more recent request for this node was made meanwhile, it will be rendered with the next batch
+            if ( _imp->hasPendingRequest(node) ) {
+                continue;
+            }
+
+            int w = NATRON_PREVIEW_WIDTH;
+            int h = NATRON_PREVIEW_HEIGHT;
+#ifndef __NATRON_WIN32__
+            std::vector<unsigned int> buf(w * h, 0);
+#else
+            std::vector<unsigned int> buf(w * h, qRgba(0,0,0,255));
+#endif
+            bool success = node->makePreviewImage(batch[i].time, &w, &h, &buf.front());
+            node.reset();
+            if (!success) {
+                continue;
+            }
+
+            ///The pixmap can only be made on the main thread
+            RenderedPreview preview;
+            preview.nodeGui = batch[i].nodeGui;
+            preview.image = QImage(reinterpret_cast<const uchar*>(&buf.front()), w, h, QImage::Format_ARGB32_Premultiplied).copy();
+            {
+                QMutexLocker k(&_imp->renderedMutex);
+                _imp->rendered.push_back(preview);
+            }
+            QMetaObject::invokeMethod(this, "onPreviewsRendered", Qt::QueuedConnection);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef NATRON_GUI_PREVIEWTHREAD_H_
+#define NATRON_GUI_PREVIEWTHREAD_H_
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#endif
+#include <QThread>
+
+#include "Global/Macros.h"
+
+class AppInstance;
+class NodeGui;
+
+/**
+ * @brief Renders the previews of the nodes of an app, one at a time, so that the images shared by several
+ * previews are rendered once. Requests for a node which is already waiting for its preview are merged and
+ * previews are only rendered while the viewers are not rendering.
+ * The thread only renders the images: they are displayed by the NodeGui on the main thread.
+ **/
+struct PreviewThreadPrivate;
+class PreviewThread
+    : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    PreviewThread(AppInstance* app);
+
+    virtual ~PreviewThread();
+
+    /**
+     * @brief Requests the preview of the given node at the given time. If a preview of the node is already
+     * pending, it is replaced by this request.
+     **/
+    void appendToQueue(const boost::shared_ptr<NodeGui>& node,int time);
+
+    void quitThread();
+
+private Q_SLOTS:
+
+    ///Gives the previews rendered by the thread to their node, on the main thread
+    void onPreviewsRendered();
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    boost::scoped_ptr<PreviewThreadPrivate> _imp;
+};
+
+#endif // NATRON_GUI_PREVIEWTHREAD_H_
@@ -22,6 +22,8 @@ CLANG_DIAG_OFF(uninitialized)
 #include <QHBoxLayout>
 #include <QSplitter>
 #include <QTimer>
+#include <QThread>
+#include <QCoreApplication>
 #include <QDebug>
 #include <QTextDocument> // for Qt::convertFromPlainText
 CLANG_DIAG_ON(deprecated)
@@ -33,6 +35,7 @@ CLANG_DIAG_ON(uninitialized)
 #include "Engine/KnobTypes.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
 #include "Engine/Settings.h"
 #include "Engine/BackDrop.h"
 
@@ -248,13 +251,168 @@ AddFormatDialog::getFormat() const
     return Format(0,0,w,h,name.toStdString(),pa);
 }
 
+boost::shared_ptr<ProjectGuiSerialization>
+ProjectGui::takeSnapshot() const
+{
+    assert( QThread::currentThread() == qApp->thread() );
+    boost::shared_ptr<ProjectGuiSerialization> ret(new ProjectGuiSerialization);
+    ret->initialize(this);
+    return ret;
+}
+
 void
-ProjectGui::save(boost::archive::xml_oarchive & archive) const
+ProjectGui::save(boost::archive::xml_oarchive & archive,
+                 const boost::shared_ptr<ProjectGuiSerialization> & snapshot)
 {
-    ProjectGuiSerialization projectGuiSerializationObj;
+    assert(snapshot);
+    archive << boost::serialization::make_nvp("ProjectGui",*snapshot);
+}
+
+void
+ProjectGui::restoreNodeGui(const NodeGuiSerialization & serialization,
+                           const boost::shared_ptr<NodeGui> & nGui)
+{
+    ///default color for nodes
+    float defR,defG,defB;
+    boost::shared_ptr<Settings> settings = appPTR->getCurrentSettings();
+    
+    nGui->refreshPosition( serialization.getX(),serialization.getY(), true );
+
+    if ( ( serialization.isPreviewEnabled() && !nGui->getNode()->isPreviewEnabled() ) ||
+         ( !serialization.isPreviewEnabled() && nGui->getNode()->isPreviewEnabled() ) ) {
+        nGui->togglePreview();
+    }
+
+    Natron::EffectInstance* iseffect = nGui->getNode()->getLiveInstance();
+
+    if ( serialization.colorWasFound() ) {
+        std::list<std::string> grouping;
+        iseffect->getPluginGrouping(&grouping);
+        std::string majGroup = grouping.empty() ? "" : grouping.front();
+
+        BackDropGui* isBd = dynamic_cast<BackDropGui*>(nGui.get());
+
+        if ( iseffect->isReader() ) {
+            settings->getReaderColor(&defR, &defG, &defB);
+        } else if ( iseffect->isWriter() ) {
+            settings->getWriterColor(&defR, &defG, &defB);
+        } else if ( iseffect->isGenerator() ) {
+            settings->getGeneratorColor(&defR, &defG, &defB);
+        } else if (majGroup == PLUGIN_GROUP_COLOR) {
+            settings->getColorGroupColor(&defR, &defG, &defB);
+        } else if (majGroup == PLUGIN_GROUP_FILTER) {
+            settings->getFilterGroupColor(&defR, &defG, &defB);
+        } else if (majGroup == PLUGIN_GROUP_CHANNEL) {
+            settings->getChannelGroupColor(&defR, &defG, &defB);
+        } else if (majGroup == PLUGIN_GROUP_KEYER) {
+            settings->getKeyerGroupColor(&defR, &defG, &defB);
+        } else if (majGroup == PLUGIN_GROUP_MERGE) {
+            settings->getMergeGroupColor(&defR, &defG, &defB);
+        } else if (majGroup == PLUGIN_GROUP_PAINT) {
+            settings->getDrawGroupColor(&defR, &defG, &defB);
+        } else if (majGroup == PLUGIN_GROUP_TIME) {
+            settings->getTimeGroupColor(&defR, &defG, &defB);
+        } else if (majGroup == PLUGIN_GROUP_TRANSFORM) {
+            settings->getTransformGroupColor(&defR, &defG, &defB);
+        } else if (majGroup == PLUGIN_GROUP_MULTIVIEW) {
+            settings->getViewsGroupColor(&defR, &defG, &defB);
+        } else if (majGroup == PLUGIN_GROUP_DEEP) {
+            settings->getDeepGroupColor(&defR, &defG, &defB);
+        } else if (isBd) {
+            settings->getDefaultBackDropColor(&defR, &defG, &defB);
+        } else {
+            settings->getDefaultNodeColor(&defR, &defG, &defB);
+        }
+
 
-    projectGuiSerializationObj.initialize(this);
-    archive << boost::serialization::make_nvp("ProjectGui",projectGuiSerializationObj);
+        float r,g,b;
+        serialization.getColor(&r, &g, &b);
+        ///restore color only if different from default.
+        if ( (std::abs(r - defR) > 0.05) || (std::abs(g - defG) > 0.05) || (std::abs(b - defB) > 0.05) ) {
+            QColor color;
+            color.setRgbF(r, g, b);
+            nGui->setCurrentColor(color);
+        }
+        
+        double ovR,ovG,ovB;
+        bool hasOverlayColor = serialization.getOverlayColor(&ovR,&ovG,&ovB);
+        if (hasOverlayColor) {
+            QColor c;
+            c.setRgbF(ovR, ovG, ovB);
+            nGui->setOverlayColor(c);
+        }
+        
+        if (isBd) {
+            double w,h;
+            serialization.getSize(&w, &h);
+            isBd->resize(w, h, true);
+        }
+    }
+}
+
+bool
+ProjectGui::isNodeInPendingGroup(const std::string & fullySpecifiedName) const
+{
+    boost::shared_ptr<NodeCollection> collection = _project.lock();
+    std::string remainder = fullySpecifiedName;
+    while ( collection && !remainder.empty() ) {
+        std::string name,next;
+        NodeCollection::getNodeNameAndRemainder_LeftToRight(remainder, name, next);
+        NodePtr node = collection->getNodeByName(name);
+        if (!node) {
+            return false;
+        }
+        NodeGroup* isGrp = dynamic_cast<NodeGroup*>( node->getLiveInstance() );
+        if (!isGrp || next.empty()) {
+            return false;
+        }
+        if ( isGrp->hasPendingChildren() ) {
+            return true;
+        }
+        collection = boost::dynamic_pointer_cast<NodeGroup>( isGrp->shared_from_this() );
+        remainder = next;
+    }
+    return false;
+}
+
+void
+ProjectGui::getPendingNodesGui(std::list<NodeGuiSerialization>* nodesGui) const
+{
+    for (std::list<boost::shared_ptr<NodeGuiSerialization> >::const_iterator it = _pendingNodesGui.begin(); it != _pendingNodesGui.end(); ++it) {
+        if ( isNodeInPendingGroup( (*it)->getFullySpecifiedName() ) ) {
+            nodesGui->push_back(**it);
+        }
+    }
+}
+
+void
+ProjectGui::restorePendingNodesGui()
+{
+    boost::shared_ptr<Natron::Project> project = _project.lock();
+    if (!project) {
+        return;
+    }
+    std::list<boost::shared_ptr<NodeGui> > restored;
+    for (std::list<boost::shared_ptr<NodeGuiSerialization> >::iterator it = _pendingNodesGui.begin(); it != _pendingNodesGui.end();) {
+        const std::string & name = (*it)->getFullySpecifiedName();
+        boost::shared_ptr<Natron::Node> internalNode = project->getNodeByFullySpecifiedName(name);
+        boost::shared_ptr<NodeGui> nGui;
+        if (internalNode) {
+            nGui = boost::dynamic_pointer_cast<NodeGui>( internalNode->getNodeGui() );
+        }
+        if (nGui) {
+            restoreNodeGui(**it, nGui);
+            restored.push_back(nGui);
+        } else if ( isNodeInPendingGroup(name) ) {
+            ++it;
+            continue;
+        }
+        it = _pendingNodesGui.erase(it);
+    }
+    for (std::list<boost::shared_ptr<NodeGui> >::const_iterator it = restored.begin(); it != restored.end(); ++it) {
+        (*it)->refreshEdges();
+        (*it)->refreshKnobLinks();
+    }
 }
 
 void
@@ -270,14 +428,14 @@ ProjectGui::load(boost::archive::xml_iarchive & archive)
     _project.lock()->getFrameRange(&leftBound, &rightBound);
 
     
-    ///default color for nodes
-    float defR,defG,defB;
-    boost::shared_ptr<Settings> settings = appPTR->getCurrentSettings();
+    _pendingNodesGui.clear();
     const std::list<NodeGuiSerialization> & nodesGuiSerialization = obj.getSerializedNodesGui();
     for (std::list<NodeGuiSerialization>::const_iterator it = nodesGuiSerialization.begin(); it != nodesGuiSerialization.end(); ++it) {
         const std::string & name = it->getFullySpecifiedName();
         boost::shared_ptr<Natron::Node> internalNode = _gui->getApp()->getProject()->getNodeByFullySpecifiedName(name);
         if (!internalNode) {
+            ///The node may be in a group loaded on demand, see restorePendingNodesGui()
+            _pendingNodesGui.push_back( boost::shared_ptr<NodeGuiSerialization>( new NodeGuiSerialization(*it) ) );
             continue;
         }
         
@@ -285,78 +443,7 @@ ProjectGui::load(boost::archive::xml_iarchive & archive)
         assert(nGui_i);
         boost::shared_ptr<NodeGui> nGui = boost::dynamic_pointer_cast<NodeGui>(nGui_i);
         
-        nGui->refreshPosition( it->getX(),it->getY(), true );
-
-        if ( ( it->isPreviewEnabled() && !nGui->getNode()->isPreviewEnabled() ) ||
-             ( !it->isPreviewEnabled() && nGui->getNode()->isPreviewEnabled() ) ) {
-            nGui->togglePreview();
-        }
-
-        Natron::EffectInstance* iseffect = nGui->getNode()->getLiveInstance();
-
-        if ( it->colorWasFound() ) {
-            std::list<std::string> grouping;
-            iseffect->getPluginGrouping(&grouping);
-            std::string majGroup = grouping.empty() ? "" : grouping.front();
-
-            BackDropGui* isBd = dynamic_cast<BackDropGui*>(nGui.get());
-
-            if ( iseffect->isReader() ) {
-                settings->getReaderColor(&defR, &defG, &defB);
-            } else if ( iseffect->isWriter() ) {
-                settings->getWriterColor(&defR, &defG, &defB);
-            } else if ( iseffect->isGenerator() ) {
-                settings->getGeneratorColor(&defR, &defG, &defB);
-            } else if (majGroup == PLUGIN_GROUP_COLOR) {
-                settings->getColorGroupColor(&defR, &defG, &defB);
-            } else if (majGroup == PLUGIN_GROUP_FILTER) {
-                settings->getFilterGroupColor(&defR, &defG, &defB);
-            } else if (majGroup == PLUGIN_GROUP_CHANNEL) {
-                settings->getChannelGroupColor(&defR, &defG, &defB);
-            } else if (majGroup == PLUGIN_GROUP_KEYER) {
-                settings->getKeyerGroupColor(&defR, &defG, &defB);
-            } else if (majGroup == PLUGIN_GROUP_MERGE) {
-                settings->getMergeGroupColor(&defR, &defG, &defB);
-            } else if (majGroup == PLUGIN_GROUP_PAINT) {
-                settings->getDrawGroupColor(&defR, &defG, &defB);
-            } else if (majGroup == PLUGIN_GROUP_TIME) {
-                settings->getTimeGroupColor(&defR, &defG, &defB);
-            } else if (majGroup == PLUGIN_GROUP_TRANSFORM) {
-                settings->getTransformGroupColor(&defR, &defG, &defB);
-            } else if (majGroup == PLUGIN_GROUP_MULTIVIEW) {
-                settings->getViewsGroupColor(&defR, &defG, &defB);
-            } else if (majGroup == PLUGIN_GROUP_DEEP) {
-                settings->getDeepGroupColor(&defR, &defG, &defB);
-            } else if (isBd) {
-                settings->getDefaultBackDropColor(&defR, &defG, &defB);
-            } else {
-                settings->getDefaultNodeColor(&defR, &defG, &defB);
-            }
-
-
-            float r,g,b;
-            it->getColor(&r, &g, &b);
-            ///restore color only if different from default.
-            if ( (std::abs(r - defR) > 0.05) || (std::abs(g - defG) > 0.05) || (std::abs(b - defB) > 0.05) ) {
-                QColor color;
-                color.setRgbF(r, g, b);
-                nGui->setCurrentColor(color);
-            }
-            
-            double ovR,ovG,ovB;
-            bool hasOverlayColor = it->getOverlayColor(&ovR,&ovG,&ovB);
-            if (hasOverlayColor) {
-                QColor c;
-                c.setRgbF(ovR, ovG, ovB);
-                nGui->setOverlayColor(c);
-            }
-            
-            if (isBd) {
-                double w,h;
-                it->getSize(&w, &h);
-                isBd->resize(w, h, true);
-            }
-        }
+        restoreNodeGui(*it, nGui);
         
         ViewerInstance* viewer = dynamic_cast<ViewerInstance*>( nGui->getNode()->getLiveInstance() );
         if (viewer) {
@@ -15,6 +15,9 @@
 // "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
 #include <Python.h>
 
+#include <list>
+#include <string>
+
 #include "Global/Macros.h"
 CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_OFF(uninitialized)
@@ -78,9 +81,27 @@ public:
         return _project.lock();
     }
 
-    void save(boost::archive::xml_oarchive & archive) const;
+    /**
+     * @brief Copies the Gui state of the project. Must be called on the main-thread.
+     **/
+    boost::shared_ptr<ProjectGuiSerialization> takeSnapshot() const;
+
+    /**
+     * @brief Writes a snapshot previously returned by takeSnapshot(). This may be called from any thread.
+     **/
+    static void save(boost::archive::xml_oarchive & archive,const boost::shared_ptr<ProjectGuiSerialization> & snapshot);
 
     void load(boost::archive::xml_iarchive & archive);
+    
+    /**
+     * @brief Restores the state of the nodes of groups loaded on demand that were created since the project was loaded.
+     **/
+    void restorePendingNodesGui();
+    
+    /**
+     * @brief Appends the state read by load() of the nodes that are not created yet because they are in a group loaded on demand.
+     **/
+    void getPendingNodesGui(std::list<NodeGuiSerialization>* nodesGui) const;
 
     void registerNewColorPicker(boost::shared_ptr<Color_Knob> knob);
 
@@ -111,6 +132,10 @@ public Q_SLOTS:
     void initializeKnobsGui();
 
 private:
+    
+    void restoreNodeGui(const NodeGuiSerialization & serialization,const boost::shared_ptr<NodeGui> & nGui);
+    
+    bool isNodeInPendingGroup(const std::string & fullySpecifiedName) const;
 
 
     Gui* _gui;
@@ -118,6 +143,7 @@ private:
     DockablePanel* _panel;
     bool _created;
     std::vector<boost::shared_ptr<Color_Knob> > _colorPickersEnabled;
+    std::list<boost::shared_ptr<NodeGuiSerialization> > _pendingNodesGui;
 };
 
 
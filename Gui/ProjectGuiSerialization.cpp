@@ -97,6 +97,9 @@ ProjectGuiSerialization::initialize(const ProjectGui* projectGui)
             }
         }
     }
+    
+    ///The nodes of groups loaded on demand that were not created yet keep the state they were loaded with
+    projectGui->getPendingNodesGui(&_serializedNodes);
 
     ///Init windows
     _layoutSerialization.initialize( projectGui->getGui() );
@@ -23,6 +23,7 @@
 #include <QCoreApplication>
 
 #include "Engine/AppManager.h"
+#include "Engine/RenderServer.h"
 
 static void setShutDownSignal(int signalId);
 static void handleShutDownSignal(int signalId);
@@ -71,6 +72,8 @@ setShutDownSignal(int signalId)
 static void
 handleShutDownSignal( int /*signalId*/ )
 {
+    ///In --server mode there is no event loop, the server polls this flag
+    RenderServer::quit();
     QCoreApplication::exit(0);
 }
 
@@ -0,0 +1,120 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+#include "Engine/CacheCodec.h"
+
+using namespace Natron;
+
+namespace {
+
+///A float ramp with noise in the low bits, spanning several tiles
+std::vector<float>
+makeImage(std::size_t nFloats)
+{
+    std::vector<float> image(nFloats);
+    for (std::size_t i = 0; i < nFloats; ++i) {
+        image[i] = (float)( (i / 4) % 1920 ) / 1920.f + (std::rand() % 16) * 1e-6f;
+    }
+
+    return image;
+}
+
+}
+
+TEST(CacheCodec,LZ4RoundTrip)
+{
+    const int nBuffers = 50;
+
+    for (int b = 0; b < nBuffers; ++b) {
+        std::size_t size = std::rand() % 100000;
+        std::vector<unsigned char> src(size + 1);
+        int pattern = b % 3;
+        for (std::size_t i = 0; i < size; ++i) {
+            src[i] = pattern == 0 ? (unsigned char)std::rand() : pattern == 1 ? (unsigned char)(i % 13) : (unsigned char)(std::rand() % 4);
+        }
+        std::vector<unsigned char> compressed( CacheCodec::lz4CompressBound(size) );
+        std::size_t compressedSize = CacheCodec::lz4Compress(&src.front(), size, &compressed.front());
+        ASSERT_LE( compressedSize, compressed.size() );
+
+        std::vector<unsigned char> decompressed(size + 1);
+        ASSERT_TRUE( CacheCodec::lz4Decompress(&compressed.front(), compressedSize, &decompressed.front(), size) );
+        EXPECT_EQ( 0, std::memcmp(&src.front(), &decompressed.front(), size) );
+    }
+}
+
+TEST(CacheCodec,EncodeDecodeIsLossless)
+{
+    std::vector<float> image = makeImage(3 * 1024 * 1024 + 3);
+    std::size_t size = image.size() * sizeof(float);
+    CacheCodecEnum codecs[3] = { eCacheCodecNone, eCacheCodecLZ4, eCacheCodecDeflate };
+
+    for (int c = 0; c < 3; ++c) {
+        std::vector<char> encoded;
+        CacheCodec::encode(&image.front(), size, codecs[c], sizeof(float), false, &encoded);
+        ASSERT_TRUE( CacheCodec::isEncoded( &encoded.front(), encoded.size() ) );
+        ASSERT_EQ( size, CacheCodec::getDecodedSize( &encoded.front(), encoded.size() ) );
+        if (codecs[c] != eCacheCodecNone) {
+            ///The shuffled ramp must compress
+            EXPECT_LT( encoded.size(), size / 2 );
+        }
+
+        std::vector<float> decoded( image.size() );
+        ASSERT_TRUE( CacheCodec::decode(&encoded.front(), encoded.size(), &decoded.front(), size) );
+        EXPECT_EQ( 0, std::memcmp(&image.front(), &decoded.front(), size) );
+    }
+}
+
+TEST(CacheCodec,HalfFloat)
+{
+    std::vector<float> image = makeImage(1024 * 1024);
+    image[0] = 65504.f; //< largest half
+    image[1] = -2.5f;
+    image[2] = 1e-7f; //< denormalized half
+    image[3] = 0.f;
+    std::size_t size = image.size() * sizeof(float);
+
+    std::vector<char> encoded;
+    CacheCodec::encode(&image.front(), size, eCacheCodecLZ4, sizeof(float), true, &encoded);
+    std::vector<float> decoded( image.size() );
+    ASSERT_TRUE( CacheCodec::decode(&encoded.front(), encoded.size(), &decoded.front(), size) );
+
+    EXPECT_EQ(65504.f, decoded[0]);
+    EXPECT_EQ(-2.5f, decoded[1]);
+    EXPECT_NEAR(1e-7f, decoded[2], 6e-8f);
+    EXPECT_EQ(0.f, decoded[3]);
+    for (std::size_t i = 4; i < image.size(); ++i) {
+        ///A half has 11 significant bits
+        ASSERT_NEAR( image[i], decoded[i], std::fabs(image[i]) / 2048.f + 1e-7f );
+    }
+}
+
+TEST(CacheCodec,CorruptedData)
+{
+    std::vector<float> image = makeImage(256 * 1024);
+    std::size_t size = image.size() * sizeof(float);
+    std::vector<char> encoded;
+    CacheCodec::encode(&image.front(), size, eCacheCodecLZ4, sizeof(float), false, &encoded);
+
+    std::vector<float> decoded( image.size() );
+    EXPECT_FALSE( CacheCodec::decode(&encoded.front(), encoded.size() / 2, &decoded.front(), size) );
+    EXPECT_FALSE( CacheCodec::decode(&encoded.front(), encoded.size(), &decoded.front(), size - 4) );
+
+    std::vector<char> raw( (char*)&image.front(), (char*)&image.front() + size );
+    EXPECT_FALSE( CacheCodec::isEncoded( &raw.front(), raw.size() ) );
+    EXPECT_EQ( (std::size_t)0, CacheCodec::getDecodedSize( &raw.front(), raw.size() ) );
+}
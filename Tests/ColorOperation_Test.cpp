@@ -0,0 +1,188 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include <cmath>
+#include <list>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Engine/ColorOperation.h"
+
+using namespace Natron;
+
+namespace {
+
+ColorOperation
+makeGrade(double gain,
+          double offset)
+{
+    double m[12] = { gain, 0, 0, offset,
+                     0, gain, 0, offset,
+                     0, 0, gain, offset };
+    ColorOperation op;
+    op.setMatrix(m);
+
+    return op;
+}
+
+ColorOperation
+makeSaturation(double s)
+{
+    ///Rec.709 luminance
+    const double w[3] = { 0.2126, 0.7152, 0.0722 };
+    double m[12];
+    for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 3; ++col) {
+            m[row * 4 + col] = (1. - s) * w[col] + (row == col ? s : 0.);
+        }
+        m[row * 4 + 3] = 0.;
+    }
+    ColorOperation op;
+    op.setMatrix(m);
+
+    return op;
+}
+
+///A gamma curve sampled on [0,1]
+ColorOperation
+makeGamma(double gamma)
+{
+    const int n = 256;
+    std::vector<float> samples(n * 3);
+    for (int i = 0; i < n; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            samples[i * 3 + c] = (float)std::pow(i / (double)(n - 1), 1. / gamma);
+        }
+    }
+    ColorOperation op;
+    op.setCurve(0., 1., samples);
+
+    return op;
+}
+
+///A 3D LUT swapping red and blue
+ColorOperation
+makeSwapLut()
+{
+    const int n = 5;
+    std::vector<float> samples(n * n * n * 3);
+    for (int b = 0; b < n; ++b) {
+        for (int g = 0; g < n; ++g) {
+            for (int r = 0; r < n; ++r) {
+                std::size_t i = ( (b * n + g) * n + r ) * 3;
+                samples[i] = b / (float)(n - 1);
+                samples[i + 1] = g / (float)(n - 1);
+                samples[i + 2] = r / (float)(n - 1);
+            }
+        }
+    }
+    ColorOperation op;
+    op.setLut3D(n, 0., 1., samples);
+
+    return op;
+}
+
+double
+getChainError(const std::list<ColorOperation> & ops,
+              const ColorOperationChain & chain)
+{
+    std::vector<ColorOperation> ref( ops.begin(), ops.end() );
+    double maxError = 0.;
+    for (int i = 0; i < 1000; ++i) {
+        float expected[3] = { (i % 10) / 9.f, ( (i / 10) % 10 ) / 9.f, (i / 100) / 9.f };
+        float actual[3] = { expected[0], expected[1], expected[2] };
+        for (std::size_t j = 0; j < ref.size(); ++j) {
+            ref[j].apply(expected);
+        }
+        chain.apply(actual);
+        for (int c = 0; c < 3; ++c) {
+            maxError = std::max( maxError, (double)std::fabs(actual[c] - expected[c]) );
+        }
+    }
+
+    return maxError;
+}
+
+}
+
+TEST(ColorOperation,MatricesAreFused)
+{
+    std::list<ColorOperation> ops;
+    ops.push_back( makeGrade(1.5, 0.1) );
+    ops.push_back( makeSaturation(0.5) );
+    ops.push_back( makeGrade(0.8, -0.05) );
+
+    ColorOperationChain chain(ops, NATRON_COLOR_CONCATENATION_TOLERANCE);
+    EXPECT_EQ( 3, chain.getNumConcatenated() );
+    EXPECT_TRUE( chain.isFused() );
+    EXPECT_LT( getChainError(ops, chain), 1e-5 );
+}
+
+TEST(ColorOperation,CurvesSeparatedByGainAreFused)
+{
+    std::list<ColorOperation> ops;
+    ops.push_back( makeGamma(2.2) );
+    ops.push_back( makeGrade(0.9, 0.) );
+    ops.push_back( makeGamma(1. / 2.2) );
+
+    ColorOperationChain chain(ops, NATRON_COLOR_CONCATENATION_TOLERANCE);
+    EXPECT_TRUE( chain.isFused() );
+    EXPECT_LT( getChainError(ops, chain), NATRON_COLOR_CONCATENATION_TOLERANCE );
+}
+
+TEST(ColorOperation,CurveThenMatrixIsNotFused)
+{
+    ///The saturation mixes channels after a non-linear curve: this cannot be a single matrix and curve
+    std::list<ColorOperation> ops;
+    ops.push_back( makeGamma(2.2) );
+    ops.push_back( makeSaturation(0.2) );
+
+    ColorOperationChain chain(ops, NATRON_COLOR_CONCATENATION_TOLERANCE);
+    EXPECT_FALSE( chain.isFused() );
+    EXPECT_EQ( 2, chain.getNumOperations() );
+    ///The unfused chain is still exact
+    EXPECT_EQ( 0., getChainError(ops, chain) );
+}
+
+TEST(ColorOperation,Lut3DAbsorbsDownstreamOperations)
+{
+    std::list<ColorOperation> ops;
+    ops.push_back( makeSwapLut() );
+    ops.push_back( makeGrade(0.5, 0.25) );
+
+    ColorOperationChain chain(ops, NATRON_COLOR_CONCATENATION_TOLERANCE);
+    EXPECT_TRUE( chain.isFused() );
+
+    float rgb[3] = { 1.f, 0.5f, 0.f };
+    chain.apply(rgb);
+    EXPECT_NEAR(0.25f, rgb[0], 1e-6);
+    EXPECT_NEAR(0.5f, rgb[1], 1e-6);
+    EXPECT_NEAR(0.75f, rgb[2], 1e-6);
+}
+
+TEST(ColorOperation,ToleranceRejectsInaccurateMerge)
+{
+    ///A coarse curve merged with a strongly non-linear one loses precision
+    std::vector<float> samples(2 * 3);
+    for (int c = 0; c < 3; ++c) {
+        samples[c] = 0.f;
+        samples[3 + c] = 1.f;
+    }
+    ColorOperation linear;
+    linear.setCurve(0., 1., samples);
+
+    std::list<ColorOperation> ops;
+    ops.push_back(linear);
+    ops.push_back( makeGamma(4.) );
+
+    ColorOperationChain exact(ops, 0.);
+    EXPECT_FALSE( exact.isFused() );
+    EXPECT_EQ( 0., getChainError(ops, exact) );
+}
@@ -13,6 +13,8 @@
 #include <QString>
 #include <QDir>
 
+#include <vector>
+
 #include "Engine/Curve.h"
 
 TEST(KeyFrame,Basic)
@@ -105,3 +107,27 @@ TEST(Curve,Basic)
 }
 
 
+
+TEST(Curve,AddKeyFrames)
+{
+    ///Adding the keyframes at once must give the same curve as adding them one by one
+    Curve c1,c2;
+    std::vector<KeyFrame> keys;
+    for (int i = 0; i < 20; ++i) {
+        KeyFrame k( (i * 7) % 20, (i % 3) * 10. );
+        c1.addKeyFrame(k);
+        keys.push_back(k);
+    }
+    EXPECT_TRUE( c2.addKeyFrame( KeyFrame(5.,100.) ) );
+    std::vector<bool> added;
+    c2.addKeyFrames(keys, &added);
+    ASSERT_EQ( keys.size(), added.size() );
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ( keys[i].getTime() != 5., (bool)added[i] );
+    }
+    ASSERT_EQ( c1.getKeyFramesCount(), c2.getKeyFramesCount() );
+    for (double t = -1.; t <= 21.; t += 0.25) {
+        EXPECT_DOUBLE_EQ( c1.getValueAt(t), c2.getValueAt(t) );
+        EXPECT_DOUBLE_EQ( c1.getDerivativeAt(t), c2.getDerivativeAt(t) );
+    }
+}
@@ -0,0 +1,119 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include <vector>
+#include <gtest/gtest.h>
+#include <boost/shared_ptr.hpp>
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+#include "Engine/LRUHashTable.h"
+
+typedef boost::shared_ptr<int> IntPtr;
+typedef FlatLRUHashTable<U64,IntPtr> FlatTable;
+
+TEST(FlatLRUHashTable,InsertFindErase)
+{
+    FlatTable table;
+    const int nKeys = 1000;
+
+    for (int i = 0; i < nKeys; ++i) {
+        table.insert( (U64)i * 7919, IntPtr( new int(i) ) );
+    }
+    EXPECT_EQ( (unsigned int)nKeys, table.size() );
+
+    ///Erase every other key, the probe sequences of the remaining keys must still be found
+    for (int i = 0; i < nKeys; i += 2) {
+        FlatTable::iterator it = table( (U64)i * 7919 );
+        ASSERT_TRUE( it != table.end() );
+        table.erase(it);
+    }
+    EXPECT_EQ( (unsigned int)nKeys / 2, table.size() );
+    for (int i = 0; i < nKeys; ++i) {
+        FlatTable::iterator it = table( (U64)i * 7919 );
+        if (i % 2) {
+            ASSERT_TRUE( it != table.end() );
+            ASSERT_EQ( 1, (int)it->second.size() );
+            EXPECT_EQ( i, *it->second.front() );
+        } else {
+            EXPECT_TRUE( it == table.end() );
+        }
+    }
+
+    int nIterated = 0;
+    for (FlatTable::iterator it = table.begin(); it != table.end(); ++it) {
+        ++nIterated;
+    }
+    EXPECT_EQ(nKeys / 2, nIterated);
+}
+
+TEST(FlatLRUHashTable,SeveralValuesPerKey)
+{
+    FlatTable table;
+    std::vector<IntPtr> values;
+
+    for (int i = 0; i < 5; ++i) {
+        values.push_back( IntPtr( new int(i) ) );
+        table.insert(42, values.back());
+    }
+    EXPECT_EQ( 1u, table.size() );
+    FlatTable::iterator it = table(42);
+    ASSERT_TRUE( it != table.end() );
+    ASSERT_EQ( 5, (int)it->second.size() );
+    int i = 0;
+    for (FlatTable::value_type::iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2, ++i) {
+        EXPECT_EQ( values[i], *it2 );
+    }
+
+    ///Erased values must not be referenced by the table anymore
+    it->second.erase( it->second.begin() );
+    EXPECT_EQ( 1, (int)values[0].use_count() );
+    EXPECT_EQ( 1, *it->second.front() );
+
+    table.erase(it);
+    for (std::size_t j = 0; j < values.size(); ++j) {
+        EXPECT_EQ( 1, (int)values[j].use_count() );
+    }
+}
+
+TEST(FlatLRUHashTable,EvictionOrder)
+{
+    FlatTable table;
+
+    for (int i = 0; i < 10; ++i) {
+        table.insert( i, IntPtr( new int(i) ) );
+    }
+
+    ///Mark 0 as the most recently used
+    ASSERT_TRUE( table(0) != table.end() );
+
+    ///A value referenced outside of the table may not be evicted
+    IntPtr held = table(1)->second.front();
+
+    std::pair<U64,IntPtr> evicted = table.evict();
+    EXPECT_EQ( 2u, evicted.first );
+    evicted = table.evict();
+    EXPECT_EQ( 3u, evicted.first );
+    for (int i = 4; i < 10; ++i) {
+        evicted = table.evict();
+        EXPECT_EQ( (U64)i, evicted.first );
+    }
+    evicted = table.evict();
+    EXPECT_EQ( 0u, evicted.first );
+
+    ///Only the held value is left
+    evicted = table.evict();
+    EXPECT_FALSE(evicted.second);
+    EXPECT_EQ( 1u, table.size() );
+    held.reset();
+    evicted = table.evict();
+    EXPECT_EQ( 1u, evicted.first );
+    EXPECT_EQ( 0u, table.size() );
+}
@@ -0,0 +1,71 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include "BaseTest.h"
+
+#include <vector>
+
+#include "Engine/Node.h"
+#include "Engine/Project.h"
+#include "Engine/AppInstance.h"
+#include "Engine/EffectInstance.h"
+
+using namespace Natron;
+
+TEST_F(BaseTest,NodeLookupAfterRename)
+{
+    boost::shared_ptr<Natron::Project> project = _app->getProject();
+    boost::shared_ptr<Node> dot = createNode(PLUGINID_NATRON_DOT);
+    assert(dot);
+    std::string name = dot->getScriptName();
+    EXPECT_EQ( dot, project->getNodeByName(name) );
+    EXPECT_TRUE( project->checkIfNodeNameExists(name, 0) );
+    EXPECT_FALSE( project->checkIfNodeNameExists(name, dot.get()) );
+
+    ASSERT_TRUE( dot->setScriptName("renamedDot") );
+    EXPECT_EQ( (Node*)NULL, project->getNodeByName(name).get() );
+    EXPECT_EQ( dot, project->getNodeByName("renamedDot") );
+    EXPECT_EQ( dot, project->getNodeByFullySpecifiedName("renamedDot") );
+
+    ///The freed name is given to the next node
+    boost::shared_ptr<Node> other = createNode(PLUGINID_NATRON_DOT);
+    assert(other);
+    EXPECT_EQ( name, other->getScriptName() );
+
+    project->removeNode(other);
+    EXPECT_EQ( (Node*)NULL, project->getNodeByName(name).get() );
+}
+
+///Every node of a collection is found by its name, a removed node no longer is
+TEST_F(BaseTest,NodeLookupAfterRemoval)
+{
+    const int nNodes = 16;
+    boost::shared_ptr<Natron::Project> project = _app->getProject();
+    std::vector<boost::shared_ptr<Node> > nodes(nNodes);
+    for (int i = 0; i < nNodes; ++i) {
+        nodes[i] = createNode(PLUGINID_NATRON_DOT);
+        assert(nodes[i]);
+    }
+    for (int i = 0; i < nNodes; ++i) {
+        EXPECT_EQ( nodes[i], project->getNodeByName( nodes[i]->getScriptName() ) );
+        EXPECT_EQ( nodes[i], project->getNodeByFullySpecifiedName( nodes[i]->getFullyQualifiedName() ) );
+    }
+
+    std::string removedName = nodes[nNodes / 2]->getScriptName();
+    project->removeNode(nodes[nNodes / 2]);
+    EXPECT_EQ( (Node*)NULL, project->getNodeByName(removedName).get() );
+    EXPECT_FALSE( project->checkIfNodeNameExists(removedName, 0) );
+    for (int i = 0; i < nNodes; ++i) {
+        if (i != nNodes / 2) {
+            EXPECT_EQ( nodes[i], project->getNodeByName( nodes[i]->getScriptName() ) );
+        }
+    }
+    EXPECT_EQ( (Node*)NULL, project->getNodeByName("notANode").get() );
+}
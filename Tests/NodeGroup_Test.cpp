@@ -0,0 +1,89 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include "BaseTest.h"
+
+#include <climits>
+
+#include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
+#include "Engine/NodeGroupSerialization.h"
+#include "Engine/Project.h"
+#include "Engine/AppManager.h"
+#include "Engine/AppInstance.h"
+#include "Engine/EffectInstance.h"
+
+using namespace Natron;
+
+///Loads the nodes of the project as a project opened with "Load groups on demand" checked
+static void
+restoreDeferringGroups(const NodeCollectionSerialization & serialization,
+                       const boost::shared_ptr<Natron::Project> & project,
+                       NodesLoadContext* context)
+{
+    context->deferGroups = true;
+    context->addReferencedNames( serialization.getNodesSerialization() );
+    std::map<std::string,bool> processedModules;
+    bool hasWriter = false;
+    project->beginLoadingGroupOnDemand();
+    bool ok = NodeCollectionSerialization::restoreFromSerialization(serialization.getNodesSerialization(), project, true,
+                                                                    &processedModules, &hasWriter, context);
+    project->endLoadingGroupOnDemand();
+    EXPECT_TRUE(ok);
+}
+
+///The nodes of a group loaded on demand are created when a script reaches them through the attributes of the group
+TEST_F(BaseTest,LoadGroupOnDemand)
+{
+    boost::shared_ptr<Natron::Project> project = _app->getProject();
+    boost::shared_ptr<Node> groupNode = createNode(PLUGINID_NATRON_GROUP);
+    ASSERT_TRUE(groupNode.get() != NULL);
+    NodeGroup* isGrp = dynamic_cast<NodeGroup*>( groupNode->getLiveInstance() );
+    ASSERT_TRUE(isGrp != NULL);
+    boost::shared_ptr<NodeCollection> group = boost::dynamic_pointer_cast<NodeGroup>( isGrp->shared_from_this() );
+    boost::shared_ptr<Node> generator = _app->createNode( CreateNodeArgs(_dotGeneratorPluginID,
+                                                                         "",
+                                                                         -1,-1,false,INT_MIN,INT_MIN,true,true,false,
+                                                                         QString(),CreateNodeArgs::DefaultValuesList(),
+                                                                         group) );
+    ASSERT_TRUE(generator.get() != NULL);
+    std::string groupName = groupNode->getScriptName();
+    std::string generatorName = groupName + "." + generator->getScriptName();
+
+    NodeCollectionSerialization serialization;
+    serialization.initialize(*project);
+    groupNode.reset();
+    generator.reset();
+    group.reset();
+    project->clearNodes(true);
+
+    NodesLoadContext context;
+    restoreDeferringGroups(serialization, project, &context);
+    EXPECT_EQ(1, context.nDeferredGroups);
+    EXPECT_LE(1, context.nDeferredNodes);
+
+    groupNode = project->getNodeByFullySpecifiedName(groupName);
+    ASSERT_TRUE(groupNode.get() != NULL);
+    isGrp = dynamic_cast<NodeGroup*>( groupNode->getLiveInstance() );
+    ASSERT_TRUE(isGrp != NULL);
+    EXPECT_TRUE( isGrp->hasPendingChildren() );
+    EXPECT_TRUE( project->getNodeByFullySpecifiedName(generatorName).get() == NULL );
+
+    std::string script = "generatorName = " + _app->getAppIDString() + "." + generatorName + ".getScriptName()\n";
+    std::string err;
+    EXPECT_TRUE( Natron::interpretPythonScript(script, &err, 0) );
+    EXPECT_TRUE( err.empty() );
+    EXPECT_FALSE( isGrp->hasPendingChildren() );
+    EXPECT_TRUE( project->getNodeByFullySpecifiedName(generatorName).get() != NULL );
+
+    ///An attribute which is not a node still raises an error
+    script = _app->getAppIDString() + "." + groupName + ".notANode\n";
+    EXPECT_FALSE( Natron::interpretPythonScript(script, &err, 0) );
+}
@@ -0,0 +1,228 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include <cstring>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <gtest/gtest.h>
+
+#include "Engine/NumaPlacement.h"
+
+using namespace Natron;
+
+namespace {
+
+std::vector<std::vector<int> >
+makeTopology(int nNodes,
+             int nCoresPerNode)
+{
+    std::vector<std::vector<int> > nodes(nNodes);
+    for (int i = 0; i < nNodes; ++i) {
+        for (int c = 0; c < nCoresPerNode; ++c) {
+            nodes[i].push_back(i * nCoresPerNode + c);
+        }
+    }
+    return nodes;
+}
+
+}
+
+TEST(NumaPlacement,ParseCoresList)
+{
+    std::vector<int> cores;
+    EXPECT_TRUE( NumaPlacement::parseCoresList("0-3,8,10-11\n", &cores) );
+    ASSERT_EQ( (std::size_t)7, cores.size() );
+    EXPECT_EQ(0, cores[0]);
+    EXPECT_EQ(3, cores[3]);
+    EXPECT_EQ(8, cores[4]);
+    EXPECT_EQ(11, cores[6]);
+
+    cores.clear();
+    EXPECT_TRUE( NumaPlacement::parseCoresList("", &cores) );
+    EXPECT_TRUE( cores.empty() );
+
+    EXPECT_FALSE( NumaPlacement::parseCoresList("4-2", &cores) );
+    EXPECT_FALSE( NumaPlacement::parseCoresList("a", &cores) );
+}
+
+TEST(NumaPlacement,FramesArePlacedOnceEveryNodeIsBusy)
+{
+    NumaPlacement placement( makeTopology(2, 4) );
+    ASSERT_EQ(2, placement.getNodesCount());
+
+    ///A frame alone uses all the cores
+    int first = placement.acquireNode();
+    EXPECT_EQ(-1, first);
+
+    ///Then frames are spread on the least loaded node
+    int second = placement.acquireNode();
+    int third = placement.acquireNode();
+    EXPECT_NE(-1, second);
+    EXPECT_NE(-1, third);
+    EXPECT_NE(second, third);
+
+    placement.releaseNode(second);
+    EXPECT_EQ( second, placement.acquireNode() );
+
+    placement.releaseNode(first);
+    placement.releaseNode(second);
+    placement.releaseNode(third);
+
+    EXPECT_EQ( (U64)1, placement.getPlacedFramesCount(-1) );
+    EXPECT_EQ( (U64)3, placement.getPlacedFramesCount(0) + placement.getPlacedFramesCount(1) );
+}
+
+TEST(NumaPlacement,NothingIsPlacedOnASingleNode)
+{
+    NumaPlacement placement( makeTopology(1, 8) );
+    std::vector<int> nodes;
+    for (int i = 0; i < 4; ++i) {
+        nodes.push_back( placement.acquireNode() );
+        EXPECT_EQ(-1, nodes.back());
+    }
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        placement.releaseNode(nodes[i]);
+    }
+}
+
+TEST(NumaPlacement,DisabledPlacementDoesNotPlace)
+{
+    NumaPlacement placement( makeTopology(2, 4) );
+    placement.setEnabled(false);
+    std::vector<int> nodes;
+    for (int i = 0; i < 4; ++i) {
+        nodes.push_back( placement.acquireNode() );
+        EXPECT_EQ(-1, nodes.back());
+    }
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        placement.releaseNode(nodes[i]);
+    }
+}
+
+TEST(NumaPlacement,FirstTouchAllocation)
+{
+    bool wasEnabled = NumaPlacement::isFirstTouchAllocationEnabled();
+
+    bool mapped = true;
+    NumaPlacement::setFirstTouchAllocationEnabled(false);
+    void* data = NumaPlacement::allocateBuffer(NATRON_NUMA_FIRST_TOUCH_MIN_SIZE, &mapped);
+    ASSERT_TRUE(data != NULL);
+    EXPECT_FALSE(mapped);
+    NumaPlacement::freeBuffer(data, NATRON_NUMA_FIRST_TOUCH_MIN_SIZE, mapped);
+
+    NumaPlacement::setFirstTouchAllocationEnabled(true);
+    data = NumaPlacement::allocateBuffer(16, &mapped);
+    ASSERT_TRUE(data != NULL);
+    EXPECT_FALSE(mapped);
+    NumaPlacement::freeBuffer(data, 16, mapped);
+
+    data = NumaPlacement::allocateBuffer(NATRON_NUMA_FIRST_TOUCH_MIN_SIZE, &mapped);
+    ASSERT_TRUE(data != NULL);
+#if defined(__linux__)
+    EXPECT_TRUE(mapped);
+#endif
+    std::memset(data, 0, NATRON_NUMA_FIRST_TOUCH_MIN_SIZE);
+    NumaPlacement::freeBuffer(data, NATRON_NUMA_FIRST_TOUCH_MIN_SIZE, mapped);
+
+    NumaPlacement::setFirstTouchAllocationEnabled(wasEnabled);
+}
+
+TEST(NumaPlacement,ThreadPlacementIsRestored)
+{
+    NumaPlacement placement;
+    EXPECT_EQ( -1, placement.getCurrentThreadNode() );
+    {
+        NumaThreadPlacement scope(&placement, placement.getNodesCount() - 1);
+#if defined(__linux__)
+        EXPECT_EQ( placement.getNodesCount() - 1, placement.getCurrentThreadNode() );
+#endif
+    }
+    EXPECT_EQ( -1, placement.getCurrentThreadNode() );
+}
+
+///The frames of a writer rendered by several threads are placed once they outnumber the nodes, the frames of a
+///render that is not a parallel sequence never are
+TEST(NumaPlacement,ParallelSequenceFramesArePlaced)
+{
+    ///Both nodes have all the cores the process may run on: placing the test thread does not restrict it
+    std::vector<int> cores;
+    NumaPlacement system;
+    for (int i = 0; i < system.getNodesCount(); ++i) {
+        cores.insert( cores.end(), system.getNodeCores(i).begin(), system.getNodeCores(i).end() );
+    }
+    std::vector<std::vector<int> > nodes(2, cores);
+    NumaPlacement placement(nodes);
+
+    ///A writer rendering 4 frames at once
+    std::vector<boost::shared_ptr<NumaFramePlacement> > frames;
+    for (int i = 0; i < 4; ++i) {
+        frames.push_back( boost::shared_ptr<NumaFramePlacement>( new NumaFramePlacement(&placement, true) ) );
+    }
+    EXPECT_EQ( -1, frames[0]->getNode() );
+    for (int i = 1; i < 4; ++i) {
+        EXPECT_NE( -1, frames[i]->getNode() );
+    }
+    EXPECT_EQ( (U64)3, placement.getPlacedFramesCount(0) + placement.getPlacedFramesCount(1) );
+#if defined(__linux__)
+    EXPECT_EQ( frames[3]->getNode(), placement.getCurrentThreadNode() );
+#endif
+
+    ///e.g: the viewer computing the region of definition of a frame in the meantime
+    {
+        NumaFramePlacement notPlaced(&placement, false);
+        EXPECT_EQ( -1, notPlaced.getNode() );
+    }
+    EXPECT_EQ( (U64)1, placement.getPlacedFramesCount(-1) );
+
+    ///Each frame restores the placement the thread had before it
+    while ( !frames.empty() ) {
+        frames.pop_back();
+    }
+    EXPECT_EQ( -1, placement.getCurrentThreadNode() );
+}
+
+///A buffer first touched by a thread of node 0 is read back unchanged from the last node.
+///This is a tile reading an image produced on another node.
+TEST(NumaPlacement,FirstTouchedBufferIsReadFromAnotherNode)
+{
+    NumaPlacement placement;
+    if (placement.getNodesCount() < 2) {
+        ///Nothing to place on a single node
+        return;
+    }
+
+    bool wasEnabled = NumaPlacement::isFirstTouchAllocationEnabled();
+    NumaPlacement::setFirstTouchAllocationEnabled(true);
+
+    const std::size_t count = NATRON_NUMA_FIRST_TOUCH_MIN_SIZE / sizeof(U64);
+    bool mapped = false;
+    U64* data = (U64*)NumaPlacement::allocateBuffer(count * sizeof(U64), &mapped);
+    ASSERT_TRUE(data != NULL);
+
+    {
+        NumaThreadPlacement onFirstNode(&placement, 0);
+        for (std::size_t i = 0; i < count; ++i) {
+            data[i] = i;
+        }
+    }
+    U64 sum = 0;
+    {
+        NumaThreadPlacement onLastNode(&placement, placement.getNodesCount() - 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            sum += data[i];
+        }
+    }
+    NumaPlacement::freeBuffer(data, count * sizeof(U64), mapped);
+    NumaPlacement::setFirstTouchAllocationEnabled(wasEnabled);
+
+    EXPECT_EQ( (U64)count * (count - 1) / 2, sum );
+}
@@ -0,0 +1,91 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include "BaseTest.h"
+
+#include <sstream>
+
+#include "Engine/Node.h"
+#include "Engine/Project.h"
+#include "Engine/AppInstance.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/ProjectSerialization.h"
+
+using namespace Natron;
+
+static std::string
+archiveProject(const ProjectSerialization & obj)
+{
+    std::ostringstream ss;
+    {
+        boost::archive::xml_oarchive oArchive(ss);
+        oArchive << boost::serialization::make_nvp("Project",obj);
+    }
+    return ss.str();
+}
+
+///Applying a journal record to the last full save must give the same project as a full save
+TEST_F(BaseTest,ProjectJournalRoundTrip)
+{
+    boost::shared_ptr<Node> generator = createNode(_dotGeneratorPluginID);
+    boost::shared_ptr<Node> other = createNode(_dotGeneratorPluginID);
+    assert(generator && other);
+    boost::shared_ptr<Natron::Project> project = _app->getProject();
+
+    ProjectSerialization lastFullSave( _app );
+    lastFullSave.initialize( project.get() );
+
+    boost::shared_ptr<KnobI> knob = generator->getKnobByName("radius");
+    Double_Knob* radius = dynamic_cast<Double_Knob*>(knob.get());
+    assert(radius);
+    radius->setValue(radius->getValue() + 10, 0);
+    radius->setValueAtTime(5, 20, 0);
+
+    std::list<boost::shared_ptr<Node> > modifiedNodes;
+    modifiedNodes.push_back(generator);
+    ProjectJournalRecordSerialization record;
+    record.initialize(project.get(), modifiedNodes);
+    EXPECT_EQ( 1, (int)record.getNodesCount() );
+
+    ///Write the record and read it back as the journal does
+    std::ostringstream recordStream;
+    {
+        boost::archive::xml_oarchive oArchive(recordStream);
+        oArchive << boost::serialization::make_nvp("Record",record);
+    }
+    ProjectJournalRecordSerialization readRecord;
+    {
+        std::istringstream iss( recordStream.str() );
+        boost::archive::xml_iarchive iArchive(iss);
+        iArchive >> boost::serialization::make_nvp("Record",readRecord);
+    }
+    EXPECT_EQ( record.getNodesCount(), readRecord.getNodesCount() );
+    EXPECT_TRUE( readRecord.applyTo(&lastFullSave) );
+
+    ProjectSerialization fullSave( _app );
+    fullSave.initialize( project.get() );
+    EXPECT_EQ( archiveProject(fullSave), archiveProject(lastFullSave) );
+}
+
+TEST_F(BaseTest,ProjectJournalUnknownNode)
+{
+    boost::shared_ptr<Node> generator = createNode(_dotGeneratorPluginID);
+    assert(generator);
+    boost::shared_ptr<Natron::Project> project = _app->getProject();
+
+    ///The node did not exist when the project was saved
+    ProjectSerialization emptySave( _app );
+
+    std::list<boost::shared_ptr<Node> > modifiedNodes;
+    modifiedNodes.push_back(generator);
+    ProjectJournalRecordSerialization record;
+    record.initialize(project.get(), modifiedNodes);
+    EXPECT_FALSE( record.applyTo(&emptySave) );
+}
@@ -0,0 +1,168 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include <gtest/gtest.h>
+
+#include <QThread>
+
+#include "Engine/RenderPriority.h"
+
+using namespace Natron;
+
+namespace {
+
+///The longest a test waits for a render: long enough that only the arbiter can end the wait
+#define RENDER_PRIORITY_TEST_MAX_WAIT_MS (3600 * 1000)
+
+///A batch tile yielding to the higher priority renders
+class YieldingTile
+    : public QThread
+{
+    RenderPriorityArbiter* _arbiter;
+
+public:
+
+    YieldingTile(RenderPriorityArbiter* arbiter)
+    : QThread()
+    , _arbiter(arbiter)
+    {
+    }
+
+private:
+
+    virtual void run()
+    {
+        _arbiter->yieldToHigherPriorities(eRenderPriorityBatch, RENDER_PRIORITY_TEST_MAX_WAIT_MS);
+    }
+};
+
+///Returns once the tile is blocked in the arbiter
+void
+waitUntilTileIsWaiting(const RenderPriorityArbiter & arbiter)
+{
+    while (arbiter.getWaitingThreadsCount() == 0) {
+        QThread::yieldCurrentThread();
+    }
+}
+
+}
+
+TEST(RenderPriority,HigherPrioritiesAreDetected)
+{
+    RenderPriorityArbiter arbiter;
+    EXPECT_FALSE( arbiter.hasHigherPriorityRenders(eRenderPriorityBatch) );
+
+    arbiter.beginRender(eRenderPriorityPlayback);
+    EXPECT_TRUE( arbiter.hasHigherPriorityRenders(eRenderPriorityBatch) );
+    EXPECT_TRUE( arbiter.hasHigherPriorityRenders(eRenderPriorityPreview) );
+    EXPECT_FALSE( arbiter.hasHigherPriorityRenders(eRenderPriorityPlayback) );
+    EXPECT_FALSE( arbiter.hasHigherPriorityRenders(eRenderPriorityInteractive) );
+
+    arbiter.endRender(eRenderPriorityPlayback, 1.);
+    EXPECT_FALSE( arbiter.hasHigherPriorityRenders(eRenderPriorityBatch) );
+
+    RenderPriorityStats stats;
+    arbiter.getStats(eRenderPriorityPlayback, &stats);
+    EXPECT_EQ( (U64)1, stats.nRenders );
+    EXPECT_EQ( 1., stats.maxLatency );
+}
+
+TEST(RenderPriority,YieldIsBounded)
+{
+    RenderPriorityArbiter arbiter;
+    EXPECT_EQ( 0., arbiter.yieldToHigherPriorities(eRenderPriorityBatch, 1000) );
+
+    ///The wait times out while the interactive render is still running
+    arbiter.beginRender(eRenderPriorityInteractive);
+    arbiter.yieldToHigherPriorities(eRenderPriorityBatch, 1);
+    EXPECT_TRUE( arbiter.hasHigherPriorityRenders(eRenderPriorityBatch) );
+    EXPECT_EQ( 0, arbiter.getWaitingThreadsCount() );
+
+    ///Renders of the highest priority never wait
+    EXPECT_EQ( 0., arbiter.yieldToHigherPriorities(eRenderPriorityInteractive, 1000) );
+    arbiter.endRender(eRenderPriorityInteractive, 0.);
+
+    RenderPriorityStats stats;
+    arbiter.getStats(eRenderPriorityBatch, &stats);
+    EXPECT_EQ( (U64)1, stats.nPreemptions );
+}
+
+TEST(RenderPriority,YieldEndsWithHigherPriorityRenders)
+{
+    RenderPriorityArbiter arbiter;
+    arbiter.beginRender(eRenderPriorityInteractive);
+
+    YieldingTile tile(&arbiter);
+    tile.start();
+    waitUntilTileIsWaiting(arbiter);
+    arbiter.endRender(eRenderPriorityInteractive, 0.);
+    tile.wait();
+
+    EXPECT_EQ( 0, arbiter.getWaitingThreadsCount() );
+    RenderPriorityStats stats;
+    arbiter.getStats(eRenderPriorityBatch, &stats);
+    EXPECT_EQ( (U64)1, stats.nPreemptions );
+}
+
+TEST(RenderPriority,DisablingReleasesWaitingTiles)
+{
+    RenderPriorityArbiter arbiter;
+    arbiter.beginRender(eRenderPriorityInteractive);
+
+    YieldingTile tile(&arbiter);
+    tile.start();
+    waitUntilTileIsWaiting(arbiter);
+    arbiter.setEnabled(false);
+    tile.wait();
+
+    EXPECT_EQ( 0, arbiter.getWaitingThreadsCount() );
+    EXPECT_TRUE( arbiter.hasHigherPriorityRenders(eRenderPriorityBatch) );
+    arbiter.endRender(eRenderPriorityInteractive, 0.);
+}
+
+TEST(RenderPriority,SpeculativeRendersYieldToAllOthers)
+{
+    RenderPriorityArbiter arbiter;
+    EXPECT_FALSE( arbiter.hasHigherPriorityRenders(eRenderPrioritySpeculative) );
+
+    arbiter.beginRender(eRenderPriorityBatch);
+    EXPECT_TRUE( arbiter.hasHigherPriorityRenders(eRenderPrioritySpeculative) );
+    arbiter.endRender(eRenderPriorityBatch, 0.);
+
+    arbiter.beginRender(eRenderPrioritySpeculative);
+    EXPECT_FALSE( arbiter.hasHigherPriorityRenders(eRenderPriorityBatch) );
+    arbiter.endRender(eRenderPrioritySpeculative, 0.);
+}
+
+///A render of a higher priority that started and ended since the last call is still reported
+TEST(RenderPriority,HigherPriorityActivityIsReported)
+{
+    RenderPriorityArbiter arbiter;
+    int activity = arbiter.getHigherPriorityActivity(eRenderPrioritySpeculative);
+
+    arbiter.beginRender(eRenderPrioritySpeculative);
+    arbiter.endRender(eRenderPrioritySpeculative, 0.);
+    EXPECT_EQ( activity, arbiter.getHigherPriorityActivity(eRenderPrioritySpeculative) );
+
+    arbiter.beginRender(eRenderPriorityInteractive);
+    arbiter.endRender(eRenderPriorityInteractive, 0.);
+    EXPECT_FALSE( arbiter.hasHigherPriorityRenders(eRenderPrioritySpeculative) );
+    EXPECT_NE( activity, arbiter.getHigherPriorityActivity(eRenderPrioritySpeculative) );
+    EXPECT_EQ( 0, arbiter.getHigherPriorityActivity(eRenderPriorityInteractive) );
+}
+
+TEST(RenderPriority,DisabledArbiterDoesNotWait)
+{
+    RenderPriorityArbiter arbiter;
+    arbiter.setEnabled(false);
+    arbiter.beginRender(eRenderPriorityInteractive);
+    EXPECT_EQ( 0., arbiter.yieldToHigherPriorities(eRenderPriorityBatch, 1000) );
+    arbiter.endRender(eRenderPriorityInteractive, 0.);
+}
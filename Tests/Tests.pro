@@ -157,7 +157,16 @@ SOURCES += \
     Image_Test.cpp \
     Lut_Test.cpp \
     File_Knob_Test.cpp \
-    Curve_Test.cpp
+    Curve_Test.cpp \
+    ProjectJournal_Test.cpp \
+    NodeCollection_Test.cpp \
+    LRUHashTable_Test.cpp \
+    TimeLine_Test.cpp \
+    CacheCodec_Test.cpp \
+    ColorOperation_Test.cpp \
+    RenderPriority_Test.cpp \
+    NumaPlacement_Test.cpp \
+    NodeGroup_Test.cpp
 
 HEADERS += \
     BaseTest.h
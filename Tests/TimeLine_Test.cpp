@@ -0,0 +1,93 @@
+//  Natron
+//
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+
+#include "BaseTest.h"
+
+#include <list>
+
+#include "Engine/AppInstance.h"
+#include "Engine/TimeLine.h"
+
+TEST_F(BaseTest,TimeLineKeyframeIndicators)
+{
+    boost::shared_ptr<TimeLine> timeline = _app->getTimeLine();
+    timeline->removeAllKeyframesIndicators();
+
+    ///Two knobs keyed at frame 10
+    std::list<SequenceTime> keys;
+    keys.push_back(30);
+    keys.push_back(10);
+    keys.push_back(10);
+    keys.push_back(20);
+    timeline->addMultipleKeyframeIndicatorsAdded(keys, true);
+
+    std::list<SequenceTime> indicators;
+    timeline->getKeyframes(&indicators);
+    ASSERT_EQ(3, (int)indicators.size());
+    EXPECT_EQ( 10, indicators.front() );
+    EXPECT_EQ( 30, indicators.back() );
+
+    ///The indicator stays as long as one knob is keyed at that time
+    timeline->removeKeyFrameIndicator(10);
+    EXPECT_TRUE( timeline->hasKeyframeIndicator(10) );
+    timeline->removeKeyFrameIndicator(10);
+    EXPECT_FALSE( timeline->hasKeyframeIndicator(10) );
+
+    timeline->seekFrame(25, false, NULL, Natron::eTimelineChangeReasonUserSeek);
+    timeline->goToNextKeyframe();
+    EXPECT_EQ( 30, timeline->currentFrame() );
+    timeline->goToPreviousKeyframe();
+    EXPECT_EQ( 20, timeline->currentFrame() );
+    timeline->goToPreviousKeyframe();
+    EXPECT_EQ( 20, timeline->currentFrame() );
+
+    timeline->removeAllKeyframesIndicators();
+}
+
+///Show and hide the keyframes of two knobs keyed at the same times in a single batch
+TEST_F(BaseTest,TimeLineKeyframeIndicatorsBatch)
+{
+    const int nKeys = 1000;
+    boost::shared_ptr<TimeLine> timeline = _app->getTimeLine();
+    timeline->removeAllKeyframesIndicators();
+
+    std::list<SequenceTime> keys;
+    for (int i = 0; i < nKeys; ++i) {
+        keys.push_back(i);
+    }
+
+    timeline->beginKeyframeIndicatorsChanges();
+    timeline->addMultipleKeyframeIndicatorsAdded(keys, true);
+    timeline->addMultipleKeyframeIndicatorsAdded(keys, true);
+    timeline->endKeyframeIndicatorsChanges();
+
+    std::list<SequenceTime> indicators;
+    timeline->getKeyframes(&indicators);
+    ASSERT_EQ( nKeys, (int)indicators.size() );
+    EXPECT_EQ( 0, indicators.front() );
+    EXPECT_EQ( nKeys - 1, indicators.back() );
+
+    timeline->seekFrame(0, false, NULL, Natron::eTimelineChangeReasonUserSeek);
+    for (int i = 0; i < 100; ++i) {
+        timeline->goToNextKeyframe();
+    }
+    EXPECT_EQ( 100, timeline->currentFrame() );
+
+    ///The indicators stay until the keys of both knobs are removed
+    timeline->removeMultipleKeyframeIndicator(keys, true);
+    indicators.clear();
+    timeline->getKeyframes(&indicators);
+    EXPECT_EQ( nKeys, (int)indicators.size() );
+
+    timeline->removeMultipleKeyframeIndicator(keys, true);
+    indicators.clear();
+    timeline->getKeyframes(&indicators);
+    EXPECT_TRUE( indicators.empty() );
+}